@@ -0,0 +1,145 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#include <string.h>
+#include "Analysis.h"
+#include "Logger.h"
+
+static gboolean notify_cb(gpointer data) {
+    ShogiAnalysis *analysis = data;
+    g_atomic_int_set(&analysis->notify_pending, 0);
+    analysis->ready(analysis->ready_data);
+    return G_SOURCE_REMOVE;
+}
+
+/// publishes finished iteration, runs on the analysis thread
+static void report(const ShogiSearch *search, int depth, int score, gpointer data) {
+    ShogiAnalysis *analysis = data;
+    if (g_atomic_int_get(&analysis->generation) != analysis->searched_generation) {
+        // position changed before the search reset it's stop flag, the request to stop was lost
+        shogi_search_stop((ShogiSearch *) search);
+        return;
+    }
+
+    ShogiAnalysisInfo info;
+    info.key = search->pos.key;
+    info.depth = depth;
+    info.score = search->pos.black_turn ? score : -score;
+    info.pv_length = MIN(search->pv_length[0], SHOGI_ANALYSIS_PV_LENGTH);
+    memcpy(info.pv, search->pv[0], info.pv_length * sizeof(ShogiMove));
+    info.nodes = search->stats.nodes;
+    info.elapsed = g_get_monotonic_time() - analysis->start;
+
+    g_mutex_lock(&analysis->lock);
+    gboolean current = analysis->generation == analysis->searched_generation;
+    if (current)
+        analysis->info = info;
+    g_mutex_unlock(&analysis->lock);
+
+    if (current && g_atomic_int_compare_and_exchange(&analysis->notify_pending, 0, 1))
+        g_idle_add(notify_cb, analysis);
+}
+
+static gpointer analysis_thread(gpointer data) {
+    ShogiAnalysis *analysis = data;
+    g_mutex_lock(&analysis->lock);
+    while (TRUE) {
+        while (!analysis->has_next && !analysis->quit)
+            g_cond_wait(&analysis->wake, &analysis->lock);
+        if (analysis->quit)
+            break;
+        ShogiPosition pos = analysis->next;
+        analysis->has_next = FALSE;
+        analysis->searched_generation = analysis->generation;
+        g_mutex_unlock(&analysis->lock);
+
+        analysis->start = g_get_monotonic_time();
+        shogi_search_run(analysis->search, &pos, SHOGI_SEARCH_MAX_PLY - 1, NULL); // runs until stopped or mate
+
+        g_mutex_lock(&analysis->lock);
+    }
+    g_mutex_unlock(&analysis->lock);
+    return NULL;
+}
+
+ShogiAnalysis *shogi_analysis_new(GSourceFunc ready, gpointer data) {
+    ShogiSearch *search = shogi_search_new(SHOGI_ANALYSIS_HASH_MB);
+    if (search == NULL)
+        return NULL;
+    ShogiAnalysis *analysis = g_new0(ShogiAnalysis, 1);
+    analysis->search = search;
+    analysis->ready = ready;
+    analysis->ready_data = data;
+    search->report = report;
+    search->report_data = analysis;
+    g_mutex_init(&analysis->lock);
+    g_cond_init(&analysis->wake);
+
+    GError *error = NULL;
+    analysis->thread = g_thread_try_new("analysis", analysis_thread, analysis, &error);
+    if (analysis->thread == NULL) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_ERROR, "Cannot start analysis thread: %s", error->message);
+        g_error_free(error);
+        g_mutex_clear(&analysis->lock);
+        g_cond_clear(&analysis->wake);
+        shogi_search_free(search);
+        g_free(analysis);
+        return NULL;
+    }
+    return analysis;
+}
+
+void shogi_analysis_free(ShogiAnalysis *analysis) {
+    if (analysis == NULL) return;
+    g_mutex_lock(&analysis->lock);
+    analysis->quit = TRUE;
+    g_atomic_int_inc(&analysis->generation);
+    shogi_search_stop(analysis->search);
+    g_cond_signal(&analysis->wake);
+    g_mutex_unlock(&analysis->lock);
+    g_thread_join(analysis->thread);
+
+    if (g_atomic_int_get(&analysis->notify_pending))
+        g_idle_remove_by_data(analysis);
+    g_mutex_clear(&analysis->lock);
+    g_cond_clear(&analysis->wake);
+    shogi_search_free(analysis->search);
+    g_free(analysis);
+}
+
+void shogi_analysis_set_position(ShogiAnalysis *analysis, const ShogiPosition *pos) {
+    g_mutex_lock(&analysis->lock);
+    if (analysis->active && analysis->info.key == pos->key) {
+        g_mutex_unlock(&analysis->lock);
+        return;
+    }
+    analysis->next = *pos;
+    analysis->has_next = TRUE;
+    analysis->active = TRUE;
+    g_atomic_int_inc(&analysis->generation);
+    memset(&analysis->info, 0, sizeof(ShogiAnalysisInfo));
+    analysis->info.key = pos->key;
+    shogi_search_stop(analysis->search); // thread picks the position up as soon as the search returns
+    g_cond_signal(&analysis->wake);
+    g_mutex_unlock(&analysis->lock);
+}
+
+void shogi_analysis_stop(ShogiAnalysis *analysis) {
+    g_mutex_lock(&analysis->lock);
+    if (analysis->active) {
+        analysis->active = FALSE;
+        analysis->has_next = FALSE;
+        g_atomic_int_inc(&analysis->generation);
+        shogi_search_stop(analysis->search);
+    }
+    g_mutex_unlock(&analysis->lock);
+}
+
+gboolean shogi_analysis_get_info(ShogiAnalysis *analysis, ShogiAnalysisInfo *info) {
+    g_mutex_lock(&analysis->lock);
+    *info = analysis->info;
+    gboolean available = analysis->active && info->depth > 0;
+    g_mutex_unlock(&analysis->lock);
+    return available;
+}
@@ -0,0 +1,83 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#ifndef SHOGI_ANALYSIS_H
+#define SHOGI_ANALYSIS_H
+
+#include <glib.h>
+#include "Search.h"
+
+// Live analysis of the game. One long lived thread searches the current position with iterative deepening until
+// the position changes, publishing the score and principal variation after every finished iteration. The search
+// keeps it's transposition table between positions, so after a move the analysis starts from what it learned
+// about the previous position and the first iterations are almost free.
+// The main thread is told about new results through the ready callback, at most one pending call at a time.
+
+#define SHOGI_ANALYSIS_HASH_MB      64
+#define SHOGI_ANALYSIS_PV_LENGTH    12 // moves of principal variation kept for display
+
+typedef struct _shogi_analysis_info {
+    HASH key; // position the info is about
+    int depth; // last finished iteration, 0 if none finished yet
+    int score; // from black's perspective
+    ShogiMove pv[SHOGI_ANALYSIS_PV_LENGTH];
+    int pv_length;
+    guint64 nodes; // nodes of the last iteration
+    gint64 elapsed; // time since analysis of the position started, in microseconds
+} ShogiAnalysisInfo;
+
+typedef struct _shogi_analysis {
+    ShogiSearch *search; // used by the analysis thread only, except for stopping it
+    GThread *thread;
+    GMutex lock; // protects fields below
+    GCond wake;
+    ShogiPosition next; // position to search next
+    gboolean has_next;
+    gboolean active; // a position is analysed or waits for the thread
+    gboolean quit;
+    gint generation; // bumped with every change of analysed position, results of older ones are dropped
+    ShogiAnalysisInfo info; // latest result
+    int searched_generation; // generation the thread searches, owned by the thread
+    gint64 start; // monotonic time the search of the position started, owned by the thread
+    gint notify_pending; // ready callback is scheduled and didn't run yet
+    GSourceFunc ready;
+    gpointer ready_data;
+} ShogiAnalysis;
+
+/**
+ * Starts idle analysis thread
+ * @param ready called on the main context when new result is published, it's return value is ignored
+ * @param data user data of ready
+ * @return new analysis or NULL on failure
+ */
+ShogiAnalysis *shogi_analysis_new(GSourceFunc ready, gpointer data);
+
+/**
+ * Stops and joins analysis thread and frees the analysis
+ * @param analysis analysis to free
+ */
+void shogi_analysis_free(ShogiAnalysis *analysis);
+
+/**
+ * Restarts analysis on a new position. Setting the position already analysed does nothing
+ * @param analysis analysis
+ * @param pos position to analyse
+ */
+void shogi_analysis_set_position(ShogiAnalysis *analysis, const ShogiPosition *pos);
+
+/**
+ * Stops analysing, the thread waits for the next position
+ * @param analysis analysis
+ */
+void shogi_analysis_stop(ShogiAnalysis *analysis);
+
+/**
+ * Copies latest result of the analysed position
+ * @param analysis analysis
+ * @param info filled with the result
+ * @return false if analysis is stopped or no iteration finished yet
+ */
+gboolean shogi_analysis_get_info(ShogiAnalysis *analysis, ShogiAnalysisInfo *info);
+
+#endif //SHOGI_ANALYSIS_H
@@ -4,9 +4,16 @@
 
 #include <stdint.h>
 #include <string.h>
+#include <math.h>
 #include "App.h"
 #include "ResourceManager.h"
 #include "Logger.h"
+#include "Book.h"
+#include "Trace.h"
+#include "Counters.h"
+#include "Opponent.h"
+#include "Analysis.h"
+#include "Replay.h"
 
 
 double SHOGI_SCALE_FACTOR;
@@ -15,13 +22,56 @@ static GtkWidget *window;
 static GtkWidget *board;
 static GtkWidget *footer;
 static GtkWidget *footer_player_label;
-static cairo_surface_t *surface = NULL; // surface to store board
+// board is composited from the static board texture and two transparent layers above it
+static cairo_surface_t *layer_pieces = NULL; // pawns, changes only with the position
+static cairo_surface_t *layer_overlay = NULL; // highlights of available moves
+static enum SHOGI_PAWN_DETAILED drawn_pawns[9][9]; // pawns as painted on pieces layer...
+static char drawn_moves[9][9]; // ...and highlights as painted on overlay layer...
+static gboolean drawn_valid = FALSE; // ...false if layers have to be painted whole
 static GtkWidget *timer[2];
 static GtkWidget *hand_labels[2][SHOGI_PAWN_COUNT]; // 0 for white, 1 for black...
 static GtkWidget *hand_buttons[2][SHOGI_PAWN_COUNT]; // ...same
 static GtkWidget *resign_button[2];
-static gboolean TIMER_RUN = FALSE;
-static clock_t t0 = 0;
+typedef struct _shogi_ui_view { // values shown by widgets outside of the board
+    gboolean valid; // false until widgets were set for the first time
+    gboolean black_turn;
+    int hand[2][SHOGI_PAWN_COUNT]; // 0 for white, 1 for black
+    gboolean hand_sensitive[2][SHOGI_PAWN_COUNT];
+    gboolean resign_sensitive[2];
+} ShogiUiView;
+static ShogiUiView shown_view;
+static guint ui_tick = 0; // pending frame callback updating the UI, 0 if none
+static guint ui_dialog_source = 0; // pending win or promotion dialog, 0 if none
+static guint timer_source = 0; // timeout waking the UI when a shown second changes, 0 if no timer runs
+static gint64 timer_deadline; // monotonic time the timeout should fire at, us
+static ShogiOpponent *opponent = NULL; // computer player, NULL if it couldn't be created
+static int computer_side = -1; // SHOGI_CLOCK_WHITE or SHOGI_CLOCK_BLACK played by the computer, -1 in hot-seat games
+static ShogiAnalysis *analysis = NULL; // created when the analysis panel is shown for the first time
+static gboolean analysis_shown = FALSE;
+static GtkWidget *analysis_panel;
+static GtkWidget *analysis_bar; // evaluation bar, black's share grows to the left
+static GtkWidget *analysis_score_label;
+static GtkWidget *analysis_pv_label;
+static ShogiAnalysisInfo shown_analysis; // result drawn as arrows and labels, depth 0 if none
+static guint analysis_tick = 0; // pending frame callback showing new analysis result, 0 if none
+static guint file_jobs = 0; // save and load tasks whose completion didn't run yet
+static gboolean window_closing = FALSE; // completions only log, the window and the model are going away
+enum { HISTORY_COLUMN_NUMBER, HISTORY_COLUMN_BLACK, HISTORY_COLUMN_WHITE, HISTORY_COLUMNS };
+static GtkListStore *history_store; // one row per move pair, filled as moves are played
+static GtkTreeIter history_last_row; // row of the last move pair, valid if history_shown > 0
+static int history_shown = 0; // moves in history_store...
+static guint32 history_shown_id; // ...and history they come from
+static GtkWidget *history_dialog = NULL; // created when history is opened for the first time
+static GtkWidget *history_view;
+static ShogiReplay *replay = NULL; // positions of the current history, extended as moves are played
+static int replay_synced = 0; // moves of history appended to replay...
+static guint32 replay_id; // ...and history they come from
+static int replay_ply = -1; // ply shown on the board in replay mode, -1 if the board shows the game
+static gboolean replay_follow; // replay follows new moves if it shows the last position
+static ShogiPosition replay_position; // position at replay_ply
+static GtkWidget *replay_bar;
+static GtkWidget *replay_scale;
+#define SHOGI_REDRAW_FULL_THRESHOLD 27 // with more changed squares whole layer is repainted at once
 
 /// Macros returning clicked square on board as on image
 #define SHOGI_TO_BOARD_COL(x) (((x)/SHOGI_SCALE_FACTOR < 68 || (x)/SHOGI_SCALE_FACTOR > 932) ?\
@@ -30,11 +80,17 @@ static clock_t t0 = 0;
 #define SHOGI_TO_BOARD_ROW(y) (((y)/SHOGI_SCALE_FACTOR < 68 || (y)/SHOGI_SCALE_FACTOR > 932) ?\
                                 -1 : 1+((y)/SHOGI_SCALE_FACTOR-68)/96)
 #define COLOR(c) ((c)/255.0)
+#define SHOGI_ANALYSIS_BAR_SCALE 1000.0 // score at which evaluation bar is filled in ~76%
 
 static int shogi_init() {
-    // set scale factor so the window will take approx 70% of the screen height
-    SHOGI_SCALE_FACTOR =
-            gdk_screen_get_height(gdk_display_get_default_screen(gdk_display_get_default())) * SHOGI_UI_SCALE / 1060.0;
+    // set scale factor so the window will take approx 70% of the primary monitor height
+    GdkDisplay *display = gdk_display_get_default();
+    GdkMonitor *monitor = gdk_display_get_primary_monitor(display);
+    if (monitor == NULL) // not every windowing system has a primary monitor
+        monitor = gdk_display_get_monitor(display, 0);
+    GdkRectangle screen;
+    gdk_monitor_get_geometry(monitor, &screen);
+    SHOGI_SCALE_FACTOR = screen.height * SHOGI_UI_SCALE / 1060.0;
 
     if (shogi_resource_manager_init() != 0)
         return 1;
@@ -44,8 +100,6 @@ static int shogi_init() {
         return 2;
 
 
-    g_timeout_add(15, (GSourceFunc) timer_cb, NULL);
-
     for (int i = 0; i < SHOGI_PAWN_COUNT; ++i) {
         hand_labels[0][i] = gtk_label_new(NULL);
         hand_labels[1][i] = gtk_label_new(NULL);
@@ -57,59 +111,207 @@ static int shogi_init() {
     gtk_label_set_use_markup(GTK_LABEL(timer[1]), TRUE);
     resign_button[0] = gtk_button_new_with_label("Resign");
     resign_button[1] = gtk_button_new_with_label("Resign");
+    history_store = gtk_list_store_new(HISTORY_COLUMNS, G_TYPE_INT, G_TYPE_STRING, G_TYPE_STRING);
+
+    opponent = shogi_opponent_new();
+    if (opponent == NULL)
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_ERROR, "Cannot create computer opponent, only hot-seat games are available.");
 
     return 0;
 }
 
 static void close_window(void) {
-    if (surface)
-        cairo_surface_destroy(surface);
-    TIMER_RUN = FALSE; // after close the timeout still runs for a while, thus labels are improper
+    if (analysis_tick)
+        gtk_widget_remove_tick_callback(window, analysis_tick);
+    shogi_analysis_free(analysis);
+    analysis = NULL;
+    shogi_replay_free(replay);
+    replay = NULL;
+    window_closing = TRUE;
+    while (file_jobs > 0) // worker records trace spans, let it finish before the trace is stopped after the main loop
+        g_main_context_iteration(NULL, TRUE);
+    if (opponent) { // search thread holds the engine, wait until it notices the cancellation
+        computer_side = -1;
+        shogi_opponent_cancel(opponent);
+        while (shogi_opponent_is_thinking(opponent))
+            g_main_context_iteration(NULL, TRUE);
+        shogi_opponent_free(opponent);
+        opponent = NULL;
+    }
+    if (layer_pieces)
+        cairo_surface_destroy(layer_pieces);
+    if (layer_overlay)
+        cairo_surface_destroy(layer_overlay);
+    if (timer_source) // labels are destroyed with the window
+        g_source_remove(timer_source);
+    timer_source = 0;
     shogi_model_close();
 }
 
-static void redraw_board(void) {
-    cairo_t *cr;
+/// paints pawn of square at board[i][j] with textures scaled to device resolution
+static void paint_pawn(cairo_t *cr, enum SHOGI_PAWN_DETAILED **pawns, int i, int j) {
+    if (pawns[i][j] != SHOGI_PAWN_DETAILED_NONE) {
+        cairo_set_source_surface(cr, shogi_resource_manager_get_pawn_scaled(pawns[i][j]),
+                                 shogi_resource_manager_square_offset(j), shogi_resource_manager_square_offset(i));
+        cairo_paint(cr);
+    }
+}
 
-    cr = cairo_create(surface);
+/// paints highlight of square at board[i][j]
+static void paint_highlight(cairo_t *cr, char **available_moves, int i, int j) {
+    if (available_moves[i][j] == ' ')
+        return;
+    if (available_moves[i][j] == 'x')
+        cairo_set_source_rgba(cr, COLOR(66), COLOR(134), COLOR(244), 0.5);
+    if (available_moves[i][j] == 'o')
+        cairo_set_source_rgba(cr, COLOR(150), COLOR(150), COLOR(150), 0.3);
+    double x = shogi_resource_manager_square_offset(j), y = shogi_resource_manager_square_offset(i);
+    cairo_rectangle(cr, x, y, shogi_resource_manager_square_offset(j + 1) - x,
+                    shogi_resource_manager_square_offset(i + 1) - y);
+    cairo_fill(cr);
+}
+
+/// clears square of a layer to transparency and clips further painting to it
+static void clear_square(cairo_t *cr, int i, int j) {
+    double x0 = shogi_resource_manager_square_offset(j), x1 = shogi_resource_manager_square_offset(j + 1);
+    double y0 = shogi_resource_manager_square_offset(i), y1 = shogi_resource_manager_square_offset(i + 1);
+    cairo_rectangle(cr, x0, y0, x1 - x0, y1 - y0);
+    cairo_clip(cr);
+    cairo_set_operator(cr, CAIRO_OPERATOR_CLEAR);
+    cairo_paint(cr);
+    cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+    gtk_widget_queue_draw_area(board, x0, y0, x1 - x0, y1 - y0);
+}
 
-    cairo_scale(cr, SHOGI_SCALE_FACTOR, SHOGI_SCALE_FACTOR); // scale down graphics to fit screens
-    cairo_set_source_rgba(cr, 254, 194, 72, 1);
-    cairo_set_source_surface(cr, shogi_resource_manager_get_board(), 0, 0);
+/// clears whole layer to transparency
+static void clear_layer(cairo_t *cr) {
+    cairo_set_operator(cr, CAIRO_OPERATOR_CLEAR);
     cairo_paint(cr);
+    cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+}
 
-    enum SHOGI_PAWN_DETAILED **board = shogi_model_get_board();
+/// repaints layers where the board changed since the last redraw, whole layers after they were recreated
+static void redraw_board(void) {
+    SHOGI_TRACE_FUNCTION();
+    gint64 start = g_get_monotonic_time();
+    enum SHOGI_PAWN_DETAILED **pawns = shogi_model_get_board();
     char **available_moves = shogi_model_get_available_moves();
+    enum SHOGI_PAWN_DETAILED *replay_rows[9];
+    static char no_moves[9][9];
+    char *no_moves_rows[9];
+    if (replay_ply >= 0) { // replayed position has no hints
+        memset(no_moves, ' ', sizeof(no_moves));
+        for (int i = 0; i < 9; ++i) {
+            replay_rows[i] = replay_position.board[i];
+            no_moves_rows[i] = no_moves[i];
+        }
+        pawns = replay_rows;
+        available_moves = no_moves_rows;
+    }
+    int repainted = 0;
 
-    for (int i = 0; i < 9; ++i) {
+    int changed_pawns = 0, changed_moves = 0;
+    for (int i = 0; drawn_valid && i < 9; ++i) {
         for (int j = 0; j < 9; ++j) {
+            changed_pawns += drawn_pawns[i][j] != pawns[i][j];
+            changed_moves += drawn_moves[i][j] != available_moves[i][j];
+        }
+    }
 
-            if (board[i][j] != SHOGI_PAWN_DETAILED_NONE) {
-                cairo_set_source_surface(cr, shogi_resource_manager_get_pawn(board[i][j]), 68 + 96 * j, 68 + 96 * i);
-                cairo_paint(cr);
+    // pieces layer, selecting a piece or showing hints leaves it untouched
+    cairo_t *cr = cairo_create(layer_pieces); // textures are already in device resolution, no scaling
+    if (!drawn_valid || changed_pawns > SHOGI_REDRAW_FULL_THRESHOLD) {
+        clear_layer(cr);
+        for (int i = 0; i < 9; ++i)
+            for (int j = 0; j < 9; ++j)
+                paint_pawn(cr, pawns, i, j);
+        gtk_widget_queue_draw(board);
+        repainted += 81;
+    } else if (changed_pawns) {
+        for (int i = 0; i < 9; ++i) {
+            for (int j = 0; j < 9; ++j) {
+                if (drawn_pawns[i][j] == pawns[i][j])
+                    continue;
+                cairo_save(cr);
+                clear_square(cr, i, j);
+                // rounded pawn textures can overlap neighbours by a pixel, so they are painted as well
+                for (int di = MAX(i - 1, 0); di <= MIN(i + 1, 8); ++di)
+                    for (int dj = MAX(j - 1, 0); dj <= MIN(j + 1, 8); ++dj)
+                        paint_pawn(cr, pawns, di, dj);
+                cairo_restore(cr);
+                repainted++;
             }
+        }
+    }
+    cairo_destroy(cr);
 
-            if (available_moves[i][j] != ' ') {
-                if (available_moves[i][j] == 'x')
-                    cairo_set_source_rgba(cr, COLOR(66), COLOR(134), COLOR(244), 0.5);
-                if (available_moves[i][j] == 'o')
-                    cairo_set_source_rgba(cr, COLOR(150), COLOR(150), COLOR(150), 0.3);
-                cairo_rectangle(cr, 68 + 96 * j, 68 + 96 * i, 96, 96);
-                cairo_fill(cr);
+    // overlay layer, highlights cover exactly their squares
+    cr = cairo_create(layer_overlay);
+    if (!drawn_valid || changed_moves > SHOGI_REDRAW_FULL_THRESHOLD) {
+        clear_layer(cr);
+        for (int i = 0; i < 9; ++i)
+            for (int j = 0; j < 9; ++j)
+                paint_highlight(cr, available_moves, i, j);
+        gtk_widget_queue_draw(board);
+        repainted += 81;
+    } else if (changed_moves) {
+        for (int i = 0; i < 9; ++i) {
+            for (int j = 0; j < 9; ++j) {
+                if (drawn_moves[i][j] == available_moves[i][j])
+                    continue;
+                cairo_save(cr);
+                clear_square(cr, i, j);
+                paint_highlight(cr, available_moves, i, j);
+                cairo_restore(cr);
+                repainted++;
             }
         }
     }
+    cairo_destroy(cr);
+
+    for (int i = 0; i < 9; ++i) {
+        for (int j = 0; j < 9; ++j) {
+            drawn_pawns[i][j] = pawns[i][j];
+            drawn_moves[i][j] = available_moves[i][j];
+        }
+    }
+    drawn_valid = TRUE;
 
-    // Invoke on click
-    /// gtk_widget_queue_draw_area(widget, x - 3, y - 3, 6, 6);
+    shogi_counters_add(SHOGI_COUNTER_REDRAWS, 1);
+    shogi_counters_add(SHOGI_COUNTER_REDRAW_SQUARES, (guint64) repainted);
+    shogi_counters_record(SHOGI_HISTOGRAM_REDRAW, (guint64) (g_get_monotonic_time() - start) * 1000);
+}
 
-    cairo_destroy(cr);
+/// sets timer labels, markup is rebuilt only for the ones whose shown time changed
+static void timer_labels_update() {
+    static gint64 shown[2] = {-1, -1}; // seconds on labels
+    for (int i = 0; i < 2; ++i) {
+        gint64 time_left = shogi_model_timer_get_time(i == 0);
+        if (time_left / 1000 == shown[i])
+            continue;
+        shown[i] = time_left / 1000;
+        char timer_label[65];
+        sprintf(timer_label, "<span foreground='#231916' weight='bold' font='20'>%02d:%02d</span>",
+                (int) TO_MINUTES(time_left), (int) TO_SECONDS(time_left));
+        gtk_label_set_label(GTK_LABEL(timer[i]), timer_label);
+    }
 }
 
-static void ui_reload() {
-    redraw_board(); // first redraw to check for wins at print the king capture
-    gtk_widget_queue_draw(board);
+/// updates model timers and wakes the UI again when a shown second changes, not at all if no timer runs
+static void timer_schedule() {
+    if (timer_source)
+        g_source_remove(timer_source);
+    timer_source = 0;
+    gint64 delay = shogi_model_timer_update();
+    if (delay < 0)
+        return;
+    timer_deadline = g_get_monotonic_time() + delay * 1000;
+    timer_source = g_timeout_add((guint) delay, (GSourceFunc) timer_cb, NULL);
+}
 
+/// shows win or promotion dialog, run from idle so modal loops don't block the frame clock
+static gboolean ui_dialog_cb(G_GNUC_UNUSED gpointer data) {
+    ui_dialog_source = 0;
     enum SHOGI_MODEL_MODE model_mode = shogi_model_get_mode();
     if (model_mode == WHITE_WIN || model_mode == BLACK_WIN) {
         GtkWidget *dialog = gtk_message_dialog_new_with_markup(GTK_WINDOW(window),
@@ -138,66 +340,331 @@ static void ui_reload() {
             shogi_model_promote(TRUE);
         else
             shogi_model_promote(FALSE);
+        ui_reload(); // print promotion
     }
+    return FALSE;
+}
 
-    redraw_board(); // second redraw to print promotions
-    gtk_widget_queue_draw(board);
+/// point in the middle of square of the board, in user units
+static void square_center(int sq, double *x, double *y) {
+    int col_ix = sq % 9, row_ix = sq / 9;
+    *x = (shogi_resource_manager_square_offset(col_ix) + shogi_resource_manager_square_offset(col_ix + 1)) / 2.0;
+    *y = (shogi_resource_manager_square_offset(row_ix) + shogi_resource_manager_square_offset(row_ix + 1)) / 2.0;
+}
 
-    char timer_label[65];
-    guint32 time_left = (guint32) shogi_model_timer_get_time(TRUE);
-    sprintf(timer_label, "<span foreground='#231916' weight='bold' font='20'>%02d:%02d</span>", TO_MINUTES(time_left),
-            TO_SECONDS(time_left));
-    gtk_label_set_label(GTK_LABEL(timer[0]), timer_label);
+/// draws first moves of principal variation, best move as a blue arrow and the expected reply as a red one
+static void paint_analysis_arrows(cairo_t *cr) {
+    if (!analysis_shown || shown_analysis.depth == 0 || replay_ply >= 0)
+        return;
+    double size = shogi_resource_manager_square_offset(1) - shogi_resource_manager_square_offset(0);
+    cairo_set_line_width(cr, size * 0.12);
+    cairo_set_line_cap(cr, CAIRO_LINE_CAP_ROUND);
+    for (int k = MIN(shown_analysis.pv_length, 2) - 1; k >= 0; --k) { // best move on top
+        ShogiMove move = shown_analysis.pv[k];
+        if (k == 0)
+            cairo_set_source_rgba(cr, COLOR(66), COLOR(134), COLOR(244), 0.8);
+        else
+            cairo_set_source_rgba(cr, COLOR(219), COLOR(68), COLOR(55), 0.6);
+        double x1, y1;
+        square_center(SHOGI_MOVE_TO(move), &x1, &y1);
+        if (SHOGI_MOVE_IS_DROP(move)) { // dropped pawn comes from the hand, mark the target only
+            cairo_arc(cr, x1, y1, size * 0.3, 0, 2 * G_PI);
+            cairo_stroke(cr);
+            continue;
+        }
+        double x0, y0;
+        square_center(SHOGI_MOVE_FROM(move), &x0, &y0);
+        double angle = atan2(y1 - y0, x1 - x0), head = size * 0.3;
+        cairo_move_to(cr, x0, y0);
+        cairo_line_to(cr, x1 - cos(angle) * head * 0.5, y1 - sin(angle) * head * 0.5);
+        cairo_stroke(cr);
+        cairo_move_to(cr, x1, y1);
+        cairo_line_to(cr, x1 - head * cos(angle - 0.5), y1 - head * sin(angle - 0.5));
+        cairo_line_to(cr, x1 - head * cos(angle + 0.5), y1 - head * sin(angle + 0.5));
+        cairo_close_path(cr);
+        cairo_fill(cr);
+    }
+}
 
-    time_left = (guint32) shogi_model_timer_get_time(FALSE);
-    sprintf(timer_label, "<span foreground='#231916' weight='bold' font='20'>%02d:%02d</span>", TO_MINUTES(time_left),
-            TO_SECONDS(time_left));
-    gtk_label_set_label(GTK_LABEL(timer[1]), timer_label);
+static gboolean analysis_bar_draw_cb(GtkWidget *widget, cairo_t *cr, G_GNUC_UNUSED gpointer data) {
+    int width = gtk_widget_get_allocated_width(widget), height = gtk_widget_get_allocated_height(widget);
+    double black_share = 0.5;
+    if (shown_analysis.depth > 0 && ABS(shown_analysis.score) >= SHOGI_SEARCH_MATE_IN_MAX_PLY)
+        black_share = shown_analysis.score > 0;
+    else if (shown_analysis.depth > 0)
+        black_share = 0.5 + 0.5 * tanh(shown_analysis.score / SHOGI_ANALYSIS_BAR_SCALE);
+    cairo_set_source_rgb(cr, COLOR(249), COLOR(250), COLOR(216));
+    cairo_paint(cr);
+    cairo_set_source_rgb(cr, COLOR(35), COLOR(25), COLOR(22));
+    cairo_rectangle(cr, 0, 0, width * black_share, height);
+    cairo_fill(cr);
+    cairo_set_source_rgb(cr, COLOR(150), COLOR(150), COLOR(150));
+    cairo_rectangle(cr, width / 2 - 1, 0, 2, height);
+    cairo_fill(cr);
+    return FALSE;
+}
 
-    gtk_widget_queue_draw(timer[0]);
-    gtk_widget_queue_draw(timer[1]);
+/// shows latest analysis result in the panel and on the board
+static void analysis_panel_update() {
+    ShogiAnalysisInfo info;
+    if (!analysis || !analysis_shown || !shogi_analysis_get_info(analysis, &info))
+        memset(&info, 0, sizeof(info));
+
+    if (info.depth != shown_analysis.depth || info.key != shown_analysis.key ||
+        memcmp(info.pv, shown_analysis.pv, 2 * sizeof(ShogiMove)) != 0)
+        gtk_widget_queue_draw(board); // arrows
+    if (info.score != shown_analysis.score || info.depth != shown_analysis.depth)
+        gtk_widget_queue_draw(analysis_bar);
+
+    char text[SHOGI_ANALYSIS_PV_LENGTH * (SHOGI_MODEL_MOVE_LENGTH + 1) + 1] = "";
+    if (info.depth > 0) {
+        for (int i = 0; i < info.pv_length; ++i) {
+            char notation[SHOGI_MODEL_MOVE_LENGTH];
+            shogi_position_move_notation(info.pv[i], notation);
+            strcat(text, notation);
+            strcat(text, " ");
+        }
+    }
+    gtk_label_set_text(GTK_LABEL(analysis_pv_label), text);
+
+    if (info.depth == 0)
+        g_snprintf(text, sizeof(text), "depth -");
+    else if (ABS(info.score) >= SHOGI_SEARCH_MATE_IN_MAX_PLY)
+        g_snprintf(text, sizeof(text), "%s mates in %d  depth %d", info.score > 0 ? "black" : "white",
+                   (SHOGI_SEARCH_MATE - ABS(info.score) + 1) / 2, info.depth);
+    else
+        g_snprintf(text, sizeof(text), "%+.2f  depth %d  %.0f kN/s", info.score / 100.0, info.depth,
+                   info.elapsed > 0 ? info.nodes * 1000.0 / info.elapsed : 0.0);
+    gtk_label_set_text(GTK_LABEL(analysis_score_label), text);
+    shown_analysis = info;
+}
 
+static gboolean analysis_tick_cb(G_GNUC_UNUSED GtkWidget *widget, G_GNUC_UNUSED GdkFrameClock *frame_clock,
+                                 G_GNUC_UNUSED gpointer data) {
+    analysis_tick = 0;
+    analysis_panel_update();
+    return G_SOURCE_REMOVE;
+}
+
+/// called from main context when analysis has a new result, shows it with the next frame
+static gboolean analysis_ready_cb(G_GNUC_UNUSED gpointer data) {
+    if (analysis_tick == 0)
+        analysis_tick = gtk_widget_add_tick_callback(window, analysis_tick_cb, NULL, NULL);
+    return G_SOURCE_REMOVE;
+}
+
+/// restarts analysis if the position changed, stops it when the game ends or the panel is hidden
+static void analysis_update() {
+    if (!analysis)
+        return;
     enum SHOGI_MODEL_MODE mm = shogi_model_get_mode();
-    gboolean any_won = (mm == WHITE_WIN || mm == BLACK_WIN);
-    int *white_hand = shogi_model_get_hand(TRUE);
-    int *black_hand = shogi_model_get_hand(FALSE);
-    for (int i = SHOGI_PAWN_G; i < SHOGI_PAWN_COUNT; ++i) {
-        gtk_widget_set_sensitive(hand_buttons[0][i],
-                                 any_won ? FALSE : (!shogi_model_is_black_turn() && white_hand[i] > 0));
-        gtk_widget_set_sensitive(hand_buttons[1][i],
-                                 any_won ? FALSE : (shogi_model_is_black_turn() && black_hand[i] > 0));
+    if (!analysis_shown || mm == WHITE_WIN || mm == BLACK_WIN) {
+        shogi_analysis_stop(analysis);
+    } else if (mm != PROMOTING) { // piece waiting for promotion is not a position yet
+        ShogiPosition pos;
+        int *hand[2] = {shogi_model_get_hand(TRUE), shogi_model_get_hand(FALSE)};
+        shogi_position_from_model(&pos, shogi_model_get_board(), hand, shogi_model_is_black_turn());
+        shogi_analysis_set_position(analysis, &pos);
     }
+    analysis_panel_update(); // result of the previous position is gone
+}
 
-    gtk_widget_set_sensitive(resign_button[0], any_won ? FALSE : !shogi_model_is_black_turn());
-    gtk_widget_set_sensitive(resign_button[1], any_won ? FALSE : shogi_model_is_black_turn());
+/// scrolls history view to the last move
+static void history_scroll() {
+    if (history_dialog && history_shown > 0) {
+        GtkTreePath *path = gtk_tree_model_get_path(GTK_TREE_MODEL(history_store), &history_last_row);
+        gtk_tree_view_scroll_to_cell(GTK_TREE_VIEW(history_view), path, NULL, FALSE, 0, 0);
+        gtk_tree_path_free(path);
+    }
+}
 
+/// brings history store up to date, appending only the moves played since the last update
+static void history_update() {
+    if (history_shown_id != shogi_model_history_id() || history_shown > model->history_entries) {
+        gtk_list_store_clear(history_store);
+        history_shown = 0;
+        history_shown_id = shogi_model_history_id();
+    }
+    if (history_shown == model->history_entries)
+        return;
+    for (; history_shown < model->history_entries; ++history_shown) {
+        const char *move = shogi_model_history_move(history_shown);
+        if (history_shown % 2 == 0)
+            gtk_list_store_insert_with_values(history_store, &history_last_row, -1,
+                                              HISTORY_COLUMN_NUMBER, history_shown / 2 + 1,
+                                              HISTORY_COLUMN_BLACK, move, -1);
+        else
+            gtk_list_store_set(history_store, &history_last_row, HISTORY_COLUMN_WHITE, move, -1);
+    }
+    if (history_dialog && gtk_widget_get_visible(history_dialog))
+        history_scroll();
+}
 
-    for (int j = 0; j < SHOGI_PAWN_COUNT; ++j) {
-        char label_text[62];
-        sprintf(label_text, "<span foreground='#231916' weight='bold' font='15'>%d</span>", white_hand[j]);
-        gtk_label_set_label(GTK_LABEL(hand_labels[0][j]), label_text);
-        sprintf(label_text, "<span foreground='#231916' weight='bold' font='15'>%d</span>", black_hand[j]);
-        gtk_label_set_label(GTK_LABEL(hand_labels[1][j]), label_text);
+/// extends replay with moves played since the last update and sets up the replayed position
+static void replay_update() {
+    if (replay == NULL || replay_id != shogi_model_history_id() || replay_synced > model->history_entries) {
+        ShogiPosition start;
+        shogi_position_init(&start);
+        shogi_replay_free(replay);
+        replay = shogi_replay_new(&start);
+        replay_synced = 0;
+        replay_id = shogi_model_history_id();
     }
-    gtk_label_set_label(GTK_LABEL(footer_player_label),
-                        shogi_model_is_black_turn() ?
-                        "<span weight='bold' foreground='#f9fad8' background='#231916' font='15'>          【 BLACK'S TURN 】          </span>"
-                                                    :
-                        "<span weight='bold' foreground='#231916' background='#f9fad8' font='15'>          【 WHITE'S TURN 】          </span>");
+    // a move which can't be replayed stops the replay there, later moves would be replayed on a wrong position
+    while (replay_synced < model->history_entries && replay_synced == shogi_replay_length(replay) &&
+           shogi_replay_append(replay, shogi_model_history_move(replay_synced)))
+        replay_synced++;
 
+    if (replay_ply < 0)
+        return;
+    int length = shogi_replay_length(replay);
+    if (replay_follow || replay_ply > length)
+        replay_ply = length;
+    int ply = replay_ply;
+    replay_ply = -1; // slider changes below are made by the replay, not by the user
+    gtk_range_set_range(GTK_RANGE(replay_scale), 0, MAX(length, 1));
+    gtk_range_set_value(GTK_RANGE(replay_scale), ply);
+    replay_ply = ply;
+    shogi_replay_seek(replay, replay_ply, &replay_position);
 }
 
-// Create board surface for rendering
-static gboolean configure_event_cb(GtkWidget *widget) {
-    if (surface)
-        cairo_surface_destroy(surface);
+static void replay_scale_changed_cb(GtkRange *range, G_GNUC_UNUSED gpointer data) {
+    if (replay_ply < 0)
+        return;
+    replay_ply = (int) lround(gtk_range_get_value(range));
+    replay_follow = replay_ply == shogi_replay_length(replay);
+    ui_reload(); // seeks once per frame however fast the slider moves
+}
+
+/// returns true if the side to move is played by the computer
+static gboolean computer_turn() {
+    return computer_side == (shogi_model_is_black_turn() ? SHOGI_CLOCK_BLACK : SHOGI_CLOCK_WHITE);
+}
+
+/// plays move found by the opponent, run on the main thread once the search ends
+static void opponent_done_cb(G_GNUC_UNUSED GObject *source, GAsyncResult *result, G_GNUC_UNUSED gpointer data) {
+    GError *error = NULL;
+    ShogiMove move = shogi_opponent_think_finish(opponent, result, &error);
+    if (error) { // cancelled by resign, new game, load or close, the position it thought about is gone
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_DEBUG, "Opponent stopped thinking: %s", error->message);
+        g_error_free(error);
+        ui_reload(); // position may again be computer's turn
+        return;
+    }
+
+    enum SHOGI_MODEL_MODE mm = shogi_model_get_mode();
+    if (computer_turn() && mm != WHITE_WIN && mm != BLACK_WIN && !shogi_opponent_play(move)) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_ERROR, "Opponent has no move to play (move=%u), it resigns.", move);
+        shogi_model_resign();
+    }
+    ui_reload();
+}
+
+/// lets the computer think when it's to move, the game goes on and no search runs yet
+static void opponent_update() {
+    enum SHOGI_MODEL_MODE mm = shogi_model_get_mode();
+    if (opponent == NULL || !computer_turn() || mm == WHITE_WIN || mm == BLACK_WIN || mm == PROMOTING ||
+        shogi_opponent_is_thinking(opponent))
+        return;
+    shogi_opponent_think(opponent, model->history_entries, opponent_done_cb, NULL);
+}
+
+/// stops the search of the opponent, it's callback discards the move
+static void opponent_cancel() {
+    if (opponent)
+        shogi_opponent_cancel(opponent);
+}
+
+/// brings widgets up to date with the model, touching only the ones whose shown values changed
+static void ui_update() {
+    SHOGI_TRACE_FUNCTION();
+    replay_update(); // before the board is drawn from it
+    if (layer_pieces) // layers are created on the first configure event
+        redraw_board(); // before dialogs to print the king capture and the move being promoted
+
+    timer_schedule(); // turn changed, so did the running clock
+    timer_labels_update();
+
+    ShogiUiView view = {.valid = TRUE, .black_turn = shogi_model_is_black_turn()};
+    enum SHOGI_MODEL_MODE mm = shogi_model_get_mode();
+    gboolean any_won = (mm == WHITE_WIN || mm == BLACK_WIN);
+    int *white_hand = shogi_model_get_hand(TRUE);
+    int *black_hand = shogi_model_get_hand(FALSE);
+    gboolean human_turn = !any_won && !computer_turn() && replay_ply < 0;
+    if (replay_ply >= 0) {
+        white_hand = replay_position.hand[0];
+        black_hand = replay_position.hand[1];
+    }
+    for (int i = 0; i < SHOGI_PAWN_COUNT; ++i) {
+        view.hand[0][i] = white_hand[i];
+        view.hand[1][i] = black_hand[i];
+        view.hand_sensitive[0][i] = human_turn && !view.black_turn && white_hand[i] > 0;
+        view.hand_sensitive[1][i] = human_turn && view.black_turn && black_hand[i] > 0;
+    }
+    view.resign_sensitive[0] = human_turn && !view.black_turn;
+    view.resign_sensitive[1] = human_turn && view.black_turn;
+
+    for (int player = 0; player < 2; ++player) {
+        for (int i = 0; i < SHOGI_PAWN_COUNT; ++i) {
+            if (i >= SHOGI_PAWN_G && (!shown_view.valid ||
+                                      view.hand_sensitive[player][i] != shown_view.hand_sensitive[player][i]))
+                gtk_widget_set_sensitive(hand_buttons[player][i], view.hand_sensitive[player][i]);
+            if (!shown_view.valid || view.hand[player][i] != shown_view.hand[player][i]) {
+                char label_text[62];
+                sprintf(label_text, "<span foreground='#231916' weight='bold' font='15'>%d</span>",
+                        view.hand[player][i]);
+                gtk_label_set_label(GTK_LABEL(hand_labels[player][i]), label_text);
+            }
+        }
+        if (!shown_view.valid || view.resign_sensitive[player] != shown_view.resign_sensitive[player])
+            gtk_widget_set_sensitive(resign_button[player], view.resign_sensitive[player]);
+    }
+
+    if (!shown_view.valid || view.black_turn != shown_view.black_turn)
+        gtk_label_set_label(GTK_LABEL(footer_player_label),
+                            view.black_turn ?
+                            "<span weight='bold' foreground='#f9fad8' background='#231916' font='15'>          【 BLACK'S TURN 】          </span>"
+                                            :
+                            "<span weight='bold' foreground='#231916' background='#f9fad8' font='15'>          【 WHITE'S TURN 】          </span>");
+    shown_view = view;
+
+    if ((any_won || mm == PROMOTING) && ui_dialog_source == 0)
+        ui_dialog_source = g_idle_add(ui_dialog_cb, NULL);
+    opponent_update();
+    analysis_update();
+    history_update();
+}
 
-    surface = gdk_window_create_similar_surface(gtk_widget_get_window(widget),
-                                                CAIRO_CONTENT_COLOR,
-                                                gtk_widget_get_allocated_width(widget),
-                                                gtk_widget_get_allocated_height(widget));
+static gboolean ui_reload_tick_cb(G_GNUC_UNUSED GtkWidget *widget, G_GNUC_UNUSED GdkFrameClock *frame_clock,
+                                  G_GNUC_UNUSED gpointer data) {
+    ui_tick = 0;
+    ui_update();
+    return G_SOURCE_REMOVE;
+}
+
+/// requests UI update, all requests until the next frame are coalesced into one
+static void ui_reload() {
+    if (ui_tick == 0)
+        ui_tick = gtk_widget_add_tick_callback(window, ui_reload_tick_cb, NULL, NULL);
+}
 
-    /* Initialize the surface to white */
+// Create board layers for rendering
+static gboolean configure_event_cb(GtkWidget *widget) {
+    SHOGI_TRACE_FUNCTION();
+    if (layer_pieces)
+        cairo_surface_destroy(layer_pieces);
+    if (layer_overlay)
+        cairo_surface_destroy(layer_overlay);
+
+    int width = gtk_widget_get_allocated_width(widget), height = gtk_widget_get_allocated_height(widget);
+    layer_pieces = gdk_window_create_similar_surface(gtk_widget_get_window(widget), CAIRO_CONTENT_COLOR_ALPHA,
+                                                     width, height);
+    layer_overlay = gdk_window_create_similar_surface(gtk_widget_get_window(widget), CAIRO_CONTENT_COLOR_ALPHA,
+                                                      width, height);
+
+    // static board layer is the board texture scaled once per size, in device pixels on HiDPI screens
+    shogi_resource_manager_scale(SHOGI_SCALE_FACTOR, gtk_widget_get_scale_factor(widget)); // no-op unless it changed
+    drawn_valid = FALSE;
     redraw_board();
 
     gint w;
@@ -210,19 +677,35 @@ static gboolean configure_event_cb(GtkWidget *widget) {
     return TRUE;
 }
 
+/// recreates layers and textures when the board moves to a screen with another scale factor, no configure event comes
+static void scale_factor_changed_cb(GtkWidget *widget, G_GNUC_UNUSED GParamSpec *pspec, G_GNUC_UNUSED gpointer data) {
+    if (gtk_widget_get_realized(widget))
+        configure_event_cb(widget);
+}
+
 // Redraw gameboard
-static gboolean redraw_board_cb(GtkWidget *widget, cairo_t *cr, gpointer data) {
-    cairo_set_source_surface(cr, surface, 0, 0);
+static gboolean redraw_board_cb(G_GNUC_UNUSED GtkWidget *widget, cairo_t *cr, G_GNUC_UNUSED gpointer data) {
+    SHOGI_TRACE_FUNCTION();
+    cairo_set_source_surface(cr, shogi_resource_manager_get_board_scaled(), 0, 0);
+    cairo_paint(cr);
+    cairo_set_source_surface(cr, layer_pieces, 0, 0);
+    cairo_paint(cr);
+    cairo_set_source_surface(cr, layer_overlay, 0, 0);
     cairo_paint(cr);
+    paint_analysis_arrows(cr);
 
     return FALSE;
 }
 
 // Handle gameboard events
-static gboolean gameboard_press_event_cb(GtkWidget *widget, GdkEventButton *event, gpointer data) {
+static gboolean gameboard_press_event_cb(G_GNUC_UNUSED GtkWidget *widget, GdkEventButton *event,
+                                         G_GNUC_UNUSED gpointer data) {
+    SHOGI_TRACE_FUNCTION();
     /* paranoia check, in case we haven't gotten a configure event */
-    if (surface == NULL)
+    if (layer_pieces == NULL)
         return FALSE;
+    if (computer_turn() || replay_ply >= 0) // computer's pieces are moved by it's search, replay can't be played on
+        return TRUE;
 
     if (event->button == GDK_BUTTON_PRIMARY) {
         int col = (int) SHOGI_TO_BOARD_COL(event->x);
@@ -237,50 +720,27 @@ static gboolean gameboard_press_event_cb(GtkWidget *widget, GdkEventButton *even
     return TRUE;
 }
 
-static gboolean timer_cb(gpointer data) {
-
-    if (!TIMER_RUN) {
-        t0 = clock();
-        return TRUE;
-    }
-    if (t0 == 0)
-        t0 = clock();
-    clock_t t1 = clock();
-
-    char timer_label[65];
-
-    guint32 time_left = (guint32) shogi_model_timer_get_time(TRUE);
-    sprintf(timer_label, "<span foreground='#231916' weight='bold' font='20'>%02d:%02d</span>", TO_MINUTES(time_left),
-            TO_SECONDS(time_left));
-    gtk_label_set_label(GTK_LABEL(timer[0]), timer_label);
-
-    time_left = (guint32) shogi_model_timer_get_time(FALSE);
-    sprintf(timer_label, "<span foreground='#231916' weight='bold' font='20'>%02d:%02d</span>", TO_MINUTES(time_left),
-            TO_SECONDS(time_left));
-    gtk_label_set_label(GTK_LABEL(timer[1]), timer_label);
-
-    gtk_widget_queue_draw(timer[0]);
-    gtk_widget_queue_draw(timer[1]);
+static gboolean timer_cb(G_GNUC_UNUSED gpointer data) {
+    gint64 now = g_get_monotonic_time();
+    shogi_counters_record(SHOGI_HISTOGRAM_TIMER_JITTER, (guint64) ABS(now - timer_deadline) * 1000);
+    timer_source = 0; // this timeout ends, timer_schedule() adds the next one
 
-    if (shogi_model_get_mode() == WHITE_WIN || shogi_model_get_mode() == BLACK_WIN) {
-        TIMER_RUN = FALSE;
+    timer_schedule();
+    timer_labels_update();
+    if (shogi_model_get_mode() == WHITE_WIN || shogi_model_get_mode() == BLACK_WIN)
         ui_reload();
-    }
-
-    shogi_model_timer_decrease((t1 - t0) * 1000 / CLOCKS_PER_SEC); // get actual time difference
 
-    t0 = t1;
-    return TRUE;
+    return FALSE;
 }
 
 static void resign_cb() {
+    opponent_cancel();
     shogi_model_resign();
-    TIMER_RUN = FALSE;
     ui_reload();
 }
 
 //----------------------------------------------------------------------------------------------------------------------
-static void new_game_response(GtkWidget *w, gpointer data) { // FIXME
+static void new_game_response(G_GNUC_UNUSED GtkWidget *w, G_GNUC_UNUSED gpointer data) { // FIXME
     shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_DEBUG, "Begin new game creator...");
 
     GtkWidget *dialog = gtk_dialog_new_with_buttons("New game options.",
@@ -304,33 +764,113 @@ static void new_game_response(GtkWidget *w, gpointer data) { // FIXME
     gtk_grid_attach(GTK_GRID(grid), label, 0, 1, 1, 1);
     label = gtk_label_new("seconds");
     gtk_grid_attach(GTK_GRID(grid), label, 0, 2, 1, 1);
+    label = gtk_label_new("byoyomi (s)");
+    gtk_grid_attach(GTK_GRID(grid), label, 0, 3, 1, 1);
+    label = gtk_label_new("increment (s)");
+    gtk_grid_attach(GTK_GRID(grid), label, 0, 4, 1, 1);
     GtkWidget *minutes_input = gtk_spin_button_new_with_range(0, 999, 1);
     GtkWidget *seconds_input = gtk_spin_button_new_with_range(0, 59, 1);
+    GtkWidget *byoyomi_input = gtk_spin_button_new_with_range(0, 300, 1);
+    GtkWidget *increment_input = gtk_spin_button_new_with_range(0, 300, 1);
 
     gtk_grid_attach(GTK_GRID(grid), minutes_input, 1, 1, 1, 1);
     gtk_grid_attach(GTK_GRID(grid), seconds_input, 1, 2, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), byoyomi_input, 1, 3, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), increment_input, 1, 4, 1, 1);
 
-    label = gtk_label_new(" Set to 00:00 to play without time restrictions. ");
+    label = gtk_label_new(" Set time and byoyomi to 0 to play without time restrictions. ");
     gtk_widget_set_sensitive(label, FALSE);
-    gtk_grid_attach(GTK_GRID(grid), label, 0, 3, 3, 1);
+    gtk_grid_attach(GTK_GRID(grid), label, 0, 5, 3, 1);
+
+    GtkWidget *opponent_frame = gtk_frame_new("Players");
+    GtkWidget *opponent_input = gtk_combo_box_text_new();
+    gtk_container_set_border_width(GTK_CONTAINER(opponent_frame), 3);
+    gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(opponent_input), "Human vs human");
+    gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(opponent_input), "Computer plays white");
+    gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(opponent_input), "Computer plays black");
+    gtk_combo_box_set_active(GTK_COMBO_BOX(opponent_input), computer_side + 1);
+    gtk_widget_set_sensitive(opponent_input, opponent != NULL);
+    gtk_container_add(GTK_CONTAINER(opponent_frame), opponent_input);
+    gtk_box_pack_start(GTK_BOX(context_area), opponent_frame, FALSE, FALSE, 0);
 
     gtk_widget_show_all(frame);
+    gtk_widget_show_all(opponent_frame);
 
     gint response = gtk_dialog_run(GTK_DIALOG(dialog));
     if (response == GTK_RESPONSE_OK) {
+        opponent_cancel();
+        computer_side = gtk_combo_box_get_active(GTK_COMBO_BOX(opponent_input)) - 1;
         shogi_model_reset();
         guint32 minutes = (guint32) gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(minutes_input));
         guint32 seconds = (guint32) gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(seconds_input));
-        shogi_model_timer_set(minutes * 60 * 1000 + seconds * 1000);
+        guint32 byoyomi = (guint32) gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(byoyomi_input));
+        guint32 increment = (guint32) gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(increment_input));
+        shogi_model_timer_set(minutes * 60 * 1000 + seconds * 1000, byoyomi * 1000, increment * 1000);
         ui_reload();
         shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_INFO, "New game started");
-        TIMER_RUN = TRUE;
     }
 
     gtk_widget_destroy(dialog);
 }
 
-static void save_game_response(GtkWidget *w, gpointer data) {
+/// shows error of background save or load without blocking the main loop
+static void show_file_error(const char *action, const char *path, const GError *error) {
+    char *name = g_filename_display_name(path);
+    GtkWidget *dialog = gtk_message_dialog_new(GTK_WINDOW(window), GTK_DIALOG_DESTROY_WITH_PARENT,
+                                               GTK_MESSAGE_ERROR, GTK_BUTTONS_CLOSE,
+                                               "Cannot %s %s: %s", action, name, error->message);
+    g_signal_connect(dialog, "response", G_CALLBACK(gtk_widget_destroy), NULL);
+    gtk_widget_show(dialog);
+    g_free(name);
+}
+
+typedef struct _shogi_app_file_job {
+    char *path;
+    ShogiModelSave *save; // written by save, read by load
+} ShogiAppFileJob;
+
+static void file_job_free(gpointer data) {
+    ShogiAppFileJob *job = data;
+    g_free(job->path);
+    shogi_model_save_free(job->save);
+    g_free(job);
+}
+
+/// serializes and writes the save on a worker thread, so slow disks don't stall the board and clocks
+static void save_game_thread(GTask *task, G_GNUC_UNUSED gpointer source, gpointer data,
+                             G_GNUC_UNUSED GCancellable *cancellable) {
+    SHOGI_TRACE_FUNCTION();
+    ShogiAppFileJob *job = data;
+    gsize length;
+    char *contents = shogi_model_save_serialize(job->save, &length);
+    GError *error = NULL;
+    // writes to a temporary file in the same directory and renames it over the old save, so a failed
+    // save never leaves a truncated file behind
+    if (g_file_set_contents(job->path, contents, (gssize) length, &error))
+        g_task_return_boolean(task, TRUE);
+    else
+        g_task_return_error(task, error);
+    g_free(contents);
+}
+
+static void save_game_done(G_GNUC_UNUSED GObject *source, GAsyncResult *result, G_GNUC_UNUSED gpointer data) {
+    file_jobs--; // runs after save_game_thread() returned
+    ShogiAppFileJob *job = g_task_get_task_data(G_TASK(result));
+    GError *error = NULL;
+    gboolean saved = g_task_propagate_boolean(G_TASK(result), &error);
+    shogi_model_log_event(SHOGI_LOGGER_EVENT_SAVE, saved, job->save->history_entries);
+    if (error) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_ERROR, "Cannot save game to %s: %s", job->path, error->message);
+        if (!window_closing)
+            show_file_error("save game to", job->path, error);
+        g_error_free(error);
+    } else {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_INFO, "Game saved to %s", job->path);
+    }
+}
+
+static void save_game_response(G_GNUC_UNUSED GtkWidget *w, G_GNUC_UNUSED gpointer data) {
+    SHOGI_TRACE_FUNCTION();
     if (shogi_model_get_mode() == WHITE_WIN || shogi_model_get_mode() == BLACK_WIN) // if either one won, don't save
         return;
 
@@ -346,66 +886,87 @@ static void save_game_response(GtkWidget *w, gpointer data) {
     gint result = gtk_dialog_run(GTK_DIALOG(dialog));
 
     if (result == GTK_RESPONSE_ACCEPT) {
-        char *filename;
-        filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
-        FILE *file = fopen(filename, "wb+"); // opens new binary file for save
-
-        // save structure as follows:
-        // [state][black_turn][timed][timer[2]][entries][{history}]
-        char *state = shogi_model_serialize_state();
-        fwrite(state, sizeof(char), SHOGI_MODEL_SERIALIZED_STATE_LENGTH, file); // copy state into file
-        free(state);
-        gboolean is_black_turn = shogi_model_is_black_turn();
-        fwrite(&is_black_turn, sizeof(gboolean), 1, file); // if black turn
-        fwrite(&model->TIMED_MODE, sizeof(gboolean), 1, file); // if timed mode
-        fwrite(&model->timer, sizeof(gint64), 2, file); // timers time
-
-        fwrite(&model->history_entries, sizeof(int), 1, file); // entries in history
-        fseek(model->history, 0, SEEK_SET); // rewind history file to the beginning
-        for (int i = 0; i < model->history_entries; ++i) { // copy history
-            ShogiModelHistoryEntry entry;
-            fread(&entry, sizeof(ShogiModelHistoryEntry), 1, model->history);
-            fwrite(&entry, sizeof(ShogiModelHistoryEntry), 1, file);
-        }
-        fseek(model->history, 0, SEEK_END); // rewind history file to the end
-
-        fflush(file);
-        fclose(file);
+        ShogiAppFileJob *job = g_new(ShogiAppFileJob, 1);
+        job->path = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
+        job->save = shogi_model_save_new(); // snapshot of the game as of now, the game goes on while it's written
+
+        GTask *task = g_task_new(NULL, NULL, save_game_done, NULL);
+        g_task_set_task_data(task, job, file_job_free);
+        file_jobs++;
+        g_task_run_in_thread(task, save_game_thread);
+        g_object_unref(task);
     }
 
     gtk_widget_destroy(dialog);
 }
 
-static void load_game_response(GtkWidget *w, gpointer data) {
+/// reads and parses the save on a worker thread, the model is touched only when it's done
+static void load_game_thread(GTask *task, G_GNUC_UNUSED gpointer source, gpointer data,
+                             G_GNUC_UNUSED GCancellable *cancellable) {
+    SHOGI_TRACE_FUNCTION();
+    ShogiAppFileJob *job = data;
+    char *contents;
+    gsize length;
+    GError *error = NULL;
+    if (!g_file_get_contents(job->path, &contents, &length, &error)) {
+        g_task_return_error(task, error);
+        return;
+    }
+    job->save = shogi_model_save_parse(contents, length);
+    g_free(contents);
+    if (job->save)
+        g_task_return_boolean(task, TRUE);
+    else
+        g_task_return_new_error(task, G_FILE_ERROR, G_FILE_ERROR_INVAL, "not a saved game");
+}
+
+static void load_game_done(G_GNUC_UNUSED GObject *source, GAsyncResult *result, G_GNUC_UNUSED gpointer data) {
+    file_jobs--; // runs after load_game_thread() returned
+    if (window_closing)
+        return;
+    ShogiAppFileJob *job = g_task_get_task_data(G_TASK(result));
+    GError *error = NULL;
+    if (!g_task_propagate_boolean(G_TASK(result), &error)) {
+        shogi_model_log_event(SHOGI_LOGGER_EVENT_LOAD, FALSE, 0);
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_ERROR, "Cannot load game from %s: %s", job->path, error->message);
+        show_file_error("load game from", job->path, error);
+        g_error_free(error);
+        return;
+    }
+    opponent_cancel();
+    shogi_model_save_restore(job->save);
+    shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_INFO, "Game loaded from %s", job->path);
+    ui_reload();
+}
+
+static void load_game_response(G_GNUC_UNUSED GtkWidget *w, G_GNUC_UNUSED gpointer data) {
+    SHOGI_TRACE_FUNCTION();
     shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_DEBUG, "Begin loading game...");
-    GtkWidget *dialog = gtk_file_chooser_dialog_new("Save game", GTK_WINDOW(window), GTK_FILE_CHOOSER_ACTION_OPEN,
+    GtkWidget *dialog = gtk_file_chooser_dialog_new("Load game", GTK_WINDOW(window), GTK_FILE_CHOOSER_ACTION_OPEN,
                                                     "Cancel", GTK_RESPONSE_CANCEL,
                                                     "Open", GTK_RESPONSE_ACCEPT,
                                                     NULL);
     gint result = gtk_dialog_run(GTK_DIALOG(dialog));
 
     if (result == GTK_RESPONSE_ACCEPT) {
-        char *filename;
-        filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
-        FILE *file = fopen(filename, "r"); // opens new binary file for save
-
-        fseek(file, 0, SEEK_SET);
-        shogi_model_load_game(file);
-        if (model->TIMED_MODE) TIMER_RUN = TRUE;
-
-        fflush(file);
-        fclose(file);
+        ShogiAppFileJob *job = g_new0(ShogiAppFileJob, 1);
+        job->path = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
+
+        GTask *task = g_task_new(NULL, NULL, load_game_done, NULL);
+        g_task_set_task_data(task, job, file_job_free);
+        file_jobs++;
+        g_task_run_in_thread(task, load_game_thread);
+        g_object_unref(task);
     }
 
     gtk_widget_destroy(dialog);
-    ui_reload();
 }
 
-static void show_history_response(GtkWidget *w, gpointer data) {
-    shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_DEBUG, "Showing history.");
+/// creates the history window, it's kept hidden between uses so opening it costs nothing
+static GtkWidget *create_history_dialog() {
     GtkWidget *dialog = gtk_dialog_new_with_buttons("History",
                                                     GTK_WINDOW(window),
-                                                    GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
+                                                    GTK_DIALOG_DESTROY_WITH_PARENT,
                                                     "Close", GTK_RESPONSE_CLOSE,
                                                     NULL);
     GtkWidget *context_area = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
@@ -414,51 +975,83 @@ static void show_history_response(GtkWidget *w, gpointer data) {
     gtk_box_pack_start(GTK_BOX(context_area), frame, TRUE, TRUE, 0);
     gtk_widget_set_size_request(frame, 200, 300);
 
-    GtkTextBuffer *buffer = gtk_text_buffer_new(NULL);
-    GtkWidget *view = gtk_text_view_new_with_buffer(buffer);
-    gtk_text_view_set_editable(GTK_TEXT_VIEW (view), FALSE);
-    gtk_text_view_set_wrap_mode(GTK_TEXT_VIEW (view), GTK_WRAP_WORD);
-    gtk_text_view_set_left_margin(GTK_TEXT_VIEW (view), 3);
-    gtk_text_view_set_cursor_visible(GTK_TEXT_VIEW (view), FALSE);
+    // fixed height rows let the view lay out and draw only the rows scrolled into view
+    history_view = gtk_tree_view_new_with_model(GTK_TREE_MODEL(history_store));
+    gtk_tree_view_set_headers_visible(GTK_TREE_VIEW(history_view), FALSE);
+    const char *titles[HISTORY_COLUMNS] = {"", "Black", "White"};
+    const int widths[HISTORY_COLUMNS] = {40, 70, 70};
+    for (int i = 0; i < HISTORY_COLUMNS; ++i) {
+        GtkTreeViewColumn *column = gtk_tree_view_column_new_with_attributes(titles[i], gtk_cell_renderer_text_new(),
+                                                                             "text", i, NULL);
+        gtk_tree_view_column_set_sizing(column, GTK_TREE_VIEW_COLUMN_FIXED);
+        gtk_tree_view_column_set_fixed_width(column, widths[i]);
+        gtk_tree_view_append_column(GTK_TREE_VIEW(history_view), column);
+    }
+    gtk_tree_view_set_fixed_height_mode(GTK_TREE_VIEW(history_view), TRUE);
 
     GtkWidget *sw = gtk_scrolled_window_new(NULL, NULL);
     gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW (sw),
                                    GTK_POLICY_AUTOMATIC,
                                    GTK_POLICY_AUTOMATIC);
-    gtk_container_add(GTK_CONTAINER (sw), view);
+    gtk_container_add(GTK_CONTAINER (sw), history_view);
     gtk_container_add(GTK_CONTAINER(frame), sw);
-    gtk_widget_show_all(sw);
-
     gtk_widget_show_all(frame);
 
-    // copy entries from binary to buffer
-    fseek(model->history, 0, SEEK_SET);
-    ShogiModelHistoryEntry entry;
-    GtkTextIter iter;
-    gtk_text_buffer_get_start_iter(GTK_TEXT_BUFFER(buffer), &iter);
-    for (int i = 0; i < model->history_entries; ++i) {
-        gchar str[30];
-        if (i % 2 == 0) {
-            sprintf(str, "%d.", i / 2 + 1);
-            while (strlen(str) < 4) strcat(str, " ");
-            gtk_text_buffer_insert(GTK_TEXT_BUFFER(buffer), &iter, g_strdup(str), -1);
-        }
-        fread(&entry, sizeof(ShogiModelHistoryEntry), 1, model->history);
-        sprintf(str, "\t%s", entry.move);
-        while (strlen(str) < 7) strcat(str, " ");
-        gtk_text_buffer_insert(GTK_TEXT_BUFFER(buffer), &iter, g_strdup(str), -1);
-        if (i % 2 == 1) {
-            sprintf(str, "\n");
-            gtk_text_buffer_insert(GTK_TEXT_BUFFER(buffer), &iter, g_strdup(str), -1);
-        }
-    }
+    g_signal_connect(dialog, "response", G_CALLBACK(gtk_widget_hide), NULL);
+    g_signal_connect(dialog, "delete-event", G_CALLBACK(gtk_widget_hide_on_delete), NULL);
+    return dialog;
+}
 
+static void show_history_response(G_GNUC_UNUSED GtkWidget *w, G_GNUC_UNUSED gpointer data) {
+    SHOGI_TRACE_FUNCTION();
+    shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_DEBUG, "Showing history.");
+    if (history_dialog == NULL)
+        history_dialog = create_history_dialog();
+    history_scroll();
+    gtk_window_present(GTK_WINDOW(history_dialog));
+}
+
+static void show_book_moves_response(G_GNUC_UNUSED GtkWidget *w, G_GNUC_UNUSED gpointer data) {
+    SHOGI_TRACE_FUNCTION();
+    shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_DEBUG, "Showing book moves.");
+    char moves[SHOGI_BOOK_MAX_MOVES][SHOGI_MODEL_MOVE_LENGTH];
+    guint32 counts[SHOGI_BOOK_MAX_MOVES];
+    int count = shogi_model_book_moves(moves, counts, SHOGI_BOOK_MAX_MOVES);
+
+    GString *text = g_string_new(count == 0 ? "Current position is not in the opening book." : "");
+    for (int i = 0; i < count; ++i)
+        g_string_append_printf(text, "%s%-8s played %u times", i > 0 ? "\n" : "", moves[i], counts[i]);
+
+    GtkWidget *dialog = gtk_message_dialog_new(GTK_WINDOW(window),
+                                               GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
+                                               GTK_MESSAGE_INFO, GTK_BUTTONS_CLOSE, "%s", text->str);
+    gtk_window_set_title(GTK_WINDOW(dialog), "Book moves");
     gtk_dialog_run(GTK_DIALOG(dialog));
-    fseek(model->history, 0, SEEK_END);
     gtk_widget_destroy(dialog);
+    g_string_free(text, TRUE);
+}
+
+static void analysis_response(GtkWidget *w, G_GNUC_UNUSED gpointer data) {
+    analysis_shown = gtk_check_menu_item_get_active(GTK_CHECK_MENU_ITEM(w));
+    if (analysis_shown && analysis == NULL) {
+        analysis = shogi_analysis_new(analysis_ready_cb, NULL);
+        if (analysis == NULL)
+            shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_ERROR, "Cannot start analysis.");
+    }
+    gtk_widget_set_visible(analysis_panel, analysis_shown);
+    analysis_update();
 }
 
-static void info_response(GtkWidget *w, gpointer data) {
+static void replay_response(GtkWidget *w, G_GNUC_UNUSED gpointer data) {
+    gboolean shown = gtk_check_menu_item_get_active(GTK_CHECK_MENU_ITEM(w));
+    replay_ply = shown ? model->history_entries : -1; // starts at the current position
+    replay_follow = TRUE;
+    gtk_widget_set_visible(replay_bar, shown);
+    drawn_valid = FALSE; // board switches between the game and the replay as a whole
+    ui_reload();
+}
+
+static void info_response(G_GNUC_UNUSED GtkWidget *w, G_GNUC_UNUSED gpointer data) {
     shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_DEBUG, "Launched info dialog.");
     GtkWidget *dialog = gtk_dialog_new_with_buttons("Info",
                                                     GTK_WINDOW(window),
@@ -543,10 +1136,10 @@ static void info_response(GtkWidget *w, gpointer data) {
 }
 //----------------------------------------------------------------------------------------------------------------------
 
-static void button_drop_response(GtkWidget *w, gpointer data) {
+static void button_drop_response(G_GNUC_UNUSED GtkWidget *w, gpointer data) {
     shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_DEBUG, "Clicked drop button with ID:%d.", (int) (intptr_t) data);
     // hack to pass integer as pointer address (intptr_t to silence warn)
-    if (shogi_model_drop_mode((enum SHOGI_PAWN_DETAILED) ((int) (intptr_t) data)));
+    shogi_model_drop_mode((enum SHOGI_PAWN_DETAILED) ((int) (intptr_t) data));
     // disable button
 
     ui_reload();
@@ -611,7 +1204,7 @@ static GtkWidget *create_hand_box(gboolean is_white) {
     return side_panel;
 }
 
-static void activate(GtkApplication *app, gpointer data) {
+static void activate(GtkApplication *app, G_GNUC_UNUSED gpointer data) {
     GtkWidget *vbox;
     GtkWidget *menubar;
     GtkWidget *hbox;
@@ -684,6 +1277,21 @@ static void activate(GtkApplication *app, gpointer data) {
     gtk_menu_shell_append(GTK_MENU_SHELL(main_menu), menu_item);
     g_signal_connect(menu_item, "activate", G_CALLBACK(show_history_response), NULL);
 
+    // opening book moves of current position
+    menu_item = gtk_menu_item_new_with_label("Book moves");
+    gtk_menu_shell_append(GTK_MENU_SHELL(main_menu), menu_item);
+    g_signal_connect(menu_item, "activate", G_CALLBACK(show_book_moves_response), NULL);
+
+    // live analysis panel
+    menu_item = gtk_check_menu_item_new_with_label("Analysis");
+    gtk_menu_shell_append(GTK_MENU_SHELL(main_menu), menu_item);
+    g_signal_connect(menu_item, "toggled", G_CALLBACK(analysis_response), NULL);
+
+    // replay of the game
+    menu_item = gtk_check_menu_item_new_with_label("Replay");
+    gtk_menu_shell_append(GTK_MENU_SHELL(main_menu), menu_item);
+    g_signal_connect(menu_item, "toggled", G_CALLBACK(replay_response), NULL);
+
     // info
     menu_item = gtk_menu_item_new_with_label("info");
     gtk_menu_shell_append(GTK_MENU_SHELL(help_menu), menu_item);
@@ -718,6 +1326,8 @@ static void activate(GtkApplication *app, gpointer data) {
                       G_CALLBACK(redraw_board_cb), NULL);
     g_signal_connect (board, "configure-event",
                       G_CALLBACK(configure_event_cb), NULL);
+    g_signal_connect (board, "notify::scale-factor",
+                      G_CALLBACK(scale_factor_changed_cb), NULL);
 
     /* Event signals */
     g_signal_connect (board, "button-press-event",
@@ -739,6 +1349,42 @@ static void activate(GtkApplication *app, gpointer data) {
     gtk_box_pack_start(GTK_BOX(hbox), create_hand_box(FALSE), FALSE, TRUE, 8);
 
     gtk_box_pack_start(GTK_BOX(vbox), hbox, FALSE, TRUE, 0);
+
+    //////
+    /// create analysis panel, hidden until enabled in the menu
+    //////
+    analysis_panel = gtk_box_new(GTK_ORIENTATION_VERTICAL, 4);
+    gtk_container_set_border_width(GTK_CONTAINER(analysis_panel), 4);
+    analysis_bar = gtk_drawing_area_new();
+    gtk_widget_set_size_request(analysis_bar, -1, 16);
+    g_signal_connect(analysis_bar, "draw", G_CALLBACK(analysis_bar_draw_cb), NULL);
+    analysis_score_label = gtk_label_new(NULL);
+    analysis_pv_label = gtk_label_new(NULL);
+    gtk_label_set_ellipsize(GTK_LABEL(analysis_pv_label), PANGO_ELLIPSIZE_END);
+    gtk_box_pack_start(GTK_BOX(analysis_panel), analysis_bar, FALSE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX(analysis_panel), analysis_score_label, FALSE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX(analysis_panel), analysis_pv_label, FALSE, TRUE, 0);
+    gtk_widget_show_all(analysis_panel);
+    gtk_widget_set_no_show_all(analysis_panel, TRUE);
+    gtk_widget_hide(analysis_panel);
+    gtk_box_pack_start(GTK_BOX(vbox), analysis_panel, FALSE, TRUE, 0);
+
+    //////
+    /// create replay bar, hidden until enabled in the menu
+    //////
+    replay_bar = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 4);
+    gtk_container_set_border_width(GTK_CONTAINER(replay_bar), 4);
+    replay_scale = gtk_scale_new_with_range(GTK_ORIENTATION_HORIZONTAL, 0, 1, 1);
+    gtk_scale_set_digits(GTK_SCALE(replay_scale), 0);
+    gtk_range_set_increments(GTK_RANGE(replay_scale), 1, SHOGI_REPLAY_KEYFRAME_INTERVAL);
+    g_signal_connect(replay_scale, "value-changed", G_CALLBACK(replay_scale_changed_cb), NULL);
+    gtk_box_pack_start(GTK_BOX(replay_bar), gtk_label_new("Ply"), FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(replay_bar), replay_scale, TRUE, TRUE, 0);
+    gtk_widget_show_all(replay_bar);
+    gtk_widget_set_no_show_all(replay_bar, TRUE);
+    gtk_widget_hide(replay_bar);
+    gtk_box_pack_start(GTK_BOX(vbox), replay_bar, FALSE, TRUE, 0);
+
     //-----------------------------------------------------------
     // FOOTER
     //-----------------------------------------------------------
@@ -770,12 +1416,16 @@ int main(int argc, char **argv) {
     GtkApplication *app;
     int status;
 
+    shogi_trace_start_from_env();
+    shogi_counters_dump_start_from_env();
     app = gtk_application_new("ttr.Shogi", G_APPLICATION_FLAGS_NONE);
     g_signal_connect (app, "activate", G_CALLBACK(activate), NULL);
     status = g_application_run(G_APPLICATION (app), argc, argv);
 
     g_object_unref(app);
 
+    shogi_trace_stop();
+    shogi_counters_dump_stop();
     shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_INFO, "App closed with status %d.", status);
     shogi_logger_close();
 
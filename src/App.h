@@ -14,4 +14,6 @@ static gboolean timer_cb(gpointer data);
 
 static void resign_cb();
 
+static void ui_reload();
+
 #endif //CUWR_APP_H
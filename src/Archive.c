@@ -0,0 +1,330 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Archive.h"
+#include "Logger.h"
+#include "Trace.h"
+
+// index is written at an aligned offset and the game table right after it
+G_STATIC_ASSERT(SHOGI_ARCHIVE_ALIGNMENT % G_ALIGNOF(ShogiArchiveBlock) == 0);
+G_STATIC_ASSERT(SHOGI_ARCHIVE_ALIGNMENT % G_ALIGNOF(ShogiArchiveGame) == 0);
+G_STATIC_ASSERT(sizeof(ShogiArchiveBlock) % G_ALIGNOF(ShogiArchiveGame) == 0);
+
+#define ARCHIVE_DROP_FROM           SHOGI_SQUARE_COUNT // origin of packed drops is ARCHIVE_DROP_FROM + enum SHOGI_PAWN
+#define ARCHIVE_COMPRESSION_LEVEL   9
+
+static guint16 pack_move(ShogiMove move) {
+    int from = SHOGI_MOVE_IS_DROP(move) ? ARCHIVE_DROP_FROM + SHOGI_PAWN_TO_BASE_TYPE(SHOGI_MOVE_PAWN(move))
+                                        : SHOGI_MOVE_FROM(move);
+    return (guint16) (SHOGI_MOVE_TO(move) | from << 7 | SHOGI_MOVE_IS_PROMOTION(move) << 14);
+}
+
+/// restores pawns of packed move from the position, SHOGI_MOVE_NONE if it cannot be played there
+static ShogiMove unpack_move(const ShogiPosition *pos, guint16 packed) {
+    int to = packed & 0x7F, from = (packed >> 7) & 0x7F;
+    ShogiMove move;
+    if (to >= SHOGI_SQUARE_COUNT || from >= ARCHIVE_DROP_FROM + SHOGI_PAWN_COUNT)
+        return SHOGI_MOVE_NONE;
+    if (from >= ARCHIVE_DROP_FROM) {
+        move = SHOGI_MOVE_DROP_NEW(to, SHOGI_PAWN_TO_DETAILED_TYPE(from - ARCHIVE_DROP_FROM, pos->black_turn));
+    } else {
+        enum SHOGI_PAWN_DETAILED pawn = pos->board[from / 9][from % 9];
+        if (pawn == SHOGI_PAWN_DETAILED_NONE)
+            return SHOGI_MOVE_NONE;
+        move = SHOGI_MOVE_NEW(from, to, pawn, pos->board[to / 9][to % 9], (packed >> 14) & 1);
+    }
+    return shogi_position_is_pseudo_legal(pos, move) ? move : SHOGI_MOVE_NONE;
+}
+
+/// runs whole input through zlib converter, false if it fails or the output doesn't fit
+static gboolean convert(GConverter *converter, const guint8 *input, gsize input_size, guint8 *output,
+                        gsize output_size, gsize *written) {
+    g_converter_reset(converter);
+    gsize read_total = 0, written_total = 0;
+    GError *error = NULL;
+    while (TRUE) {
+        gsize read = 0, wrote = 0;
+        GConverterResult result = g_converter_convert(converter, input + read_total, input_size - read_total,
+                                                      output + written_total, output_size - written_total,
+                                                      G_CONVERTER_INPUT_AT_END, &read, &wrote, &error);
+        if (result == G_CONVERTER_ERROR) {
+            shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_WARN, "Archive block cannot be converted: %s", error->message);
+            g_error_free(error);
+            return FALSE;
+        }
+        read_total += read;
+        written_total += wrote;
+        if (result == G_CONVERTER_FINISHED)
+            break;
+    }
+    *written = written_total;
+    return TRUE;
+}
+
+/// inflates block into the reader's cache unless it's already there
+static gboolean load_block(ShogiArchiveReader *reader, guint32 index) {
+    if (reader->block_index == index)
+        return TRUE;
+    const ShogiArchive *archive = reader->archive;
+    const ShogiArchiveBlock *block = &archive->blocks[index];
+    gsize size = (gsize) block->moves * sizeof(guint16);
+    if (size > reader->block_capacity) {
+        reader->block = g_realloc(reader->block, size);
+        reader->block_capacity = size;
+    }
+    reader->block_index = -1;
+
+    gsize written;
+    if (block->moves == 0) {
+        reader->block_index = index;
+        return TRUE;
+    }
+    if (block->offset + block->size > archive->header->index_offset ||
+        !convert(reader->decompressor, archive->data + block->offset, block->size, reader->block, size, &written) ||
+        written != size) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_WARN, "Archive block %u is corrupted.", index);
+        return FALSE;
+    }
+    reader->block_index = index;
+    return TRUE;
+}
+
+/// compresses moves of the block being filled and writes them to the file
+static void flush_block(ShogiArchiveWriter *writer) {
+    guint count = writer->moves->len;
+    if (writer->failed)
+        return;
+    if (count == 0) { // block of games without moves
+        ShogiArchiveBlock block = {writer->offset, 0, 0};
+        g_array_append_val(writer->blocks, block);
+        return;
+    }
+    gsize size = count * sizeof(guint16);
+    guint8 *planes = g_malloc(size);
+    for (guint i = 0; i < count; ++i) {
+        guint16 packed = g_array_index(writer->moves, guint16, i);
+        planes[i] = (guint8) (packed & 0xFF);
+        planes[count + i] = (guint8) (packed >> 8);
+    }
+
+    gsize capacity = size + size / 8 + 64, compressed;
+    guint8 *output = g_malloc(capacity);
+    if (convert(writer->compressor, planes, size, output, capacity, &compressed) &&
+        fwrite(output, 1, compressed, writer->file) == compressed) {
+        ShogiArchiveBlock block = {writer->offset, (guint32) compressed, count};
+        g_array_append_val(writer->blocks, block);
+        writer->offset += compressed;
+    } else {
+        writer->failed = TRUE;
+    }
+    g_array_set_size(writer->moves, 0);
+    g_free(output);
+    g_free(planes);
+}
+
+static void writer_free(ShogiArchiveWriter *writer) {
+    g_object_unref(writer->compressor);
+    g_array_free(writer->games, TRUE);
+    g_array_free(writer->blocks, TRUE);
+    g_array_free(writer->moves, TRUE);
+    g_free(writer->path);
+    g_free(writer->temp_path);
+    g_free(writer);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+ShogiArchive *shogi_archive_open(const char *path) {
+    SHOGI_TRACE_FUNCTION();
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_ERROR, "Cannot open archive %s.", path);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (gsize) st.st_size < sizeof(ShogiArchiveHeader)) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_WARN, "Archive %s is too small.", path);
+        close(fd);
+        return NULL;
+    }
+
+    void *data = mmap(NULL, (gsize) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_ERROR, "Cannot map archive %s.", path);
+        close(fd);
+        return NULL;
+    }
+
+    const ShogiArchiveHeader *header = data;
+    gsize size = (gsize) st.st_size;
+    if (memcmp(header->magic, SHOGI_ARCHIVE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->game_size != sizeof(ShogiArchiveGame) || header->block_size != sizeof(ShogiArchiveBlock) ||
+        header->block_count != (header->game_count + SHOGI_ARCHIVE_BLOCK_GAMES - 1) / SHOGI_ARCHIVE_BLOCK_GAMES ||
+        header->index_offset % SHOGI_ARCHIVE_ALIGNMENT != 0 || header->games_offset % SHOGI_ARCHIVE_ALIGNMENT != 0 ||
+        header->index_offset + (guint64) header->block_count * sizeof(ShogiArchiveBlock) > header->games_offset ||
+        header->games_offset + (guint64) header->game_count * sizeof(ShogiArchiveGame) > size) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_WARN, "File %s is not a valid archive.", path);
+        munmap(data, size);
+        close(fd);
+        return NULL;
+    }
+
+    ShogiArchive *archive = g_new(ShogiArchive, 1);
+    archive->fd = fd;
+    archive->size = size;
+    archive->data = data;
+    archive->header = header;
+    archive->blocks = (const ShogiArchiveBlock *) (archive->data + header->index_offset);
+    archive->games = (const ShogiArchiveGame *) (archive->data + header->games_offset);
+    shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_INFO, "Opened archive %s with %u games.", path, header->game_count);
+    return archive;
+}
+
+void shogi_archive_close(ShogiArchive *archive) {
+    if (archive == NULL) return;
+    munmap((void *) archive->data, archive->size);
+    close(archive->fd);
+    g_free(archive);
+}
+
+guint32 shogi_archive_game_count(const ShogiArchive *archive) {
+    return archive->header->game_count;
+}
+
+const ShogiArchiveGame *shogi_archive_game(const ShogiArchive *archive, guint32 game) {
+    return &archive->games[game];
+}
+
+ShogiArchiveReader *shogi_archive_reader_new(const ShogiArchive *archive) {
+    ShogiArchiveReader *reader = g_new0(ShogiArchiveReader, 1);
+    reader->archive = archive;
+    reader->decompressor = G_CONVERTER(g_zlib_decompressor_new(G_ZLIB_COMPRESSOR_FORMAT_ZLIB));
+    reader->block_index = -1;
+    return reader;
+}
+
+void shogi_archive_reader_free(ShogiArchiveReader *reader) {
+    if (reader == NULL) return;
+    g_object_unref(reader->decompressor);
+    g_free(reader->block);
+    g_free(reader);
+}
+
+int shogi_archive_read_game(ShogiArchiveReader *reader, guint32 game, ShogiMove *moves, ShogiPosition *pos) {
+    const ShogiArchiveGame *info = &reader->archive->games[game];
+    guint32 index = game / SHOGI_ARCHIVE_BLOCK_GAMES;
+    if (!load_block(reader, index))
+        return -1;
+    guint32 block_moves = reader->archive->blocks[index].moves;
+    if ((guint64) info->first_move + info->length > block_moves || info->length > SHOGI_ARCHIVE_MAX_MOVES)
+        return -1;
+
+    ShogiPosition position;
+    shogi_position_init(&position);
+    const guint8 *low = reader->block + info->first_move, *high = low + block_moves;
+    for (int i = 0; i < info->length; ++i) {
+        ShogiMove move = unpack_move(&position, (guint16) (low[i] | high[i] << 8));
+        if (move == SHOGI_MOVE_NONE) {
+            shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_WARN, "Move %d of archived game %u cannot be played.", i, game);
+            return -1;
+        }
+        shogi_position_do_move(&position, move);
+        if (moves)
+            moves[i] = move;
+    }
+    if (pos)
+        *pos = position;
+    return info->length;
+}
+
+ShogiArchiveWriter *shogi_archive_writer_new(const char *path) {
+    char *temp_path = g_strconcat(path, ".tmp", NULL);
+    FILE *file = fopen(temp_path, "wb");
+    if (file == NULL) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_ERROR, "Cannot create archive %s.", temp_path);
+        g_free(temp_path);
+        return NULL;
+    }
+
+    ShogiArchiveWriter *writer = g_new0(ShogiArchiveWriter, 1);
+    writer->file = file;
+    writer->path = g_strdup(path);
+    writer->temp_path = temp_path;
+    writer->compressor = G_CONVERTER(g_zlib_compressor_new(G_ZLIB_COMPRESSOR_FORMAT_ZLIB,
+                                                           ARCHIVE_COMPRESSION_LEVEL));
+    writer->games = g_array_new(FALSE, FALSE, sizeof(ShogiArchiveGame));
+    writer->blocks = g_array_new(FALSE, FALSE, sizeof(ShogiArchiveBlock));
+    writer->moves = g_array_new(FALSE, FALSE, sizeof(guint16));
+
+    ShogiArchiveHeader header; // placeholder, written again when the archive is finished
+    memset(&header, 0, sizeof(header));
+    writer->failed = fwrite(&header, sizeof(header), 1, file) != 1;
+    writer->offset = sizeof(header);
+    return writer;
+}
+
+gboolean shogi_archive_writer_add(ShogiArchiveWriter *writer, const ShogiArchiveGame *info, const ShogiMove *moves,
+                                  int count) {
+    if (count < 0 || count > SHOGI_ARCHIVE_MAX_MOVES || writer->failed)
+        return FALSE;
+    ShogiArchiveGame game = *info;
+    game.black[SHOGI_ARCHIVE_NAME_LENGTH - 1] = '\0';
+    game.white[SHOGI_ARCHIVE_NAME_LENGTH - 1] = '\0';
+    game.first_move = writer->moves->len;
+    game.length = (guint16) count;
+    game.reserved = 0;
+    g_array_append_val(writer->games, game);
+    for (int i = 0; i < count; ++i) {
+        guint16 packed = pack_move(moves[i]);
+        g_array_append_val(writer->moves, packed);
+    }
+    if (writer->games->len % SHOGI_ARCHIVE_BLOCK_GAMES == 0)
+        flush_block(writer);
+    return !writer->failed;
+}
+
+gboolean shogi_archive_writer_finish(ShogiArchiveWriter *writer, guint64 *size) {
+    SHOGI_TRACE_FUNCTION();
+    if (writer->games->len % SHOGI_ARCHIVE_BLOCK_GAMES != 0)
+        flush_block(writer); // last block, not full
+
+    ShogiArchiveHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SHOGI_ARCHIVE_MAGIC, sizeof(header.magic));
+    header.game_size = sizeof(ShogiArchiveGame);
+    header.block_size = sizeof(ShogiArchiveBlock);
+    header.game_count = writer->games->len;
+    header.block_count = writer->blocks->len;
+    // compressed blocks end anywhere, pad so the index and the game table can be read in place from mapped file
+    static const char padding[SHOGI_ARCHIVE_ALIGNMENT] = {0};
+    gsize padding_length = (gsize) (-writer->offset % SHOGI_ARCHIVE_ALIGNMENT);
+    header.index_offset = writer->offset + padding_length;
+    header.games_offset = header.index_offset + (guint64) header.block_count * sizeof(ShogiArchiveBlock);
+
+    gboolean ok = !writer->failed &&
+                  fwrite(padding, 1, padding_length, writer->file) == padding_length &&
+                  fwrite(writer->blocks->data, sizeof(ShogiArchiveBlock), writer->blocks->len, writer->file) ==
+                  writer->blocks->len &&
+                  fwrite(writer->games->data, sizeof(ShogiArchiveGame), writer->games->len, writer->file) ==
+                  writer->games->len &&
+                  fseek(writer->file, 0, SEEK_SET) == 0 &&
+                  fwrite(&header, sizeof(header), 1, writer->file) == 1;
+    ok = fclose(writer->file) == 0 && ok;
+    if (ok && rename(writer->temp_path, writer->path) != 0)
+        ok = FALSE;
+    if (!ok) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_ERROR, "Cannot write archive %s.", writer->path);
+        remove(writer->temp_path);
+    }
+    if (size)
+        *size = header.games_offset + (guint64) header.game_count * sizeof(ShogiArchiveGame);
+    writer_free(writer);
+    return ok;
+}
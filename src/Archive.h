@@ -0,0 +1,171 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#ifndef SHOGI_ARCHIVE_H
+#define SHOGI_ARCHIVE_H
+
+#include <stdio.h>
+#include <gio/gio.h>
+#include "Position.h"
+
+// Archive stores many games in one file, each move packed into 16 bits instead of a history entry with the whole
+// serialized state. Games are grouped into blocks of SHOGI_ARCHIVE_BLOCK_GAMES, moves of a block are compressed
+// with zlib on their own, so reading game N inflates only it's block. File layout:
+//   header | compressed blocks | block index | game table
+// Block index and game table are not compressed, the file is mapped into memory and the game table (players,
+// result, date, length) can be scanned without inflating any moves. Compressed blocks are padded to
+// SHOGI_ARCHIVE_ALIGNMENT, so the index and the table are read in place. All games start in the initial position.
+//
+// Packed move: [0..6] destination square, [7..13] origin square or 81 + dropped pawn (enum SHOGI_PAWN),
+// [14] promotion. Moving and captured pawns are restored from the position when the game is replayed.
+// Inside a block low bytes of all packed moves come first and high bytes after them, which compresses better.
+
+#define SHOGI_ARCHIVE_MAGIC         "SHOGIAR1"
+#define SHOGI_ARCHIVE_BLOCK_GAMES   256 // games in each block, block of game N is N / SHOGI_ARCHIVE_BLOCK_GAMES
+#define SHOGI_ARCHIVE_MAX_MOVES     1024 // longer games are not archived
+#define SHOGI_ARCHIVE_NAME_LENGTH   32 // player names are cut to SHOGI_ARCHIVE_NAME_LENGTH - 1 chars
+#define SHOGI_ARCHIVE_ALIGNMENT     8 // alignment of block index and game table in file, enough for their structs
+
+enum SHOGI_ARCHIVE_RESULT {
+    SHOGI_ARCHIVE_RESULT_UNKNOWN,
+    SHOGI_ARCHIVE_RESULT_BLACK_WIN,
+    SHOGI_ARCHIVE_RESULT_WHITE_WIN,
+    SHOGI_ARCHIVE_RESULT_DRAW
+};
+
+typedef struct _shogi_archive_header {
+    char magic[8];
+    guint32 game_size; // sizeof(ShogiArchiveGame), guards against files from different builds
+    guint32 block_size; // sizeof(ShogiArchiveBlock)
+    guint32 game_count;
+    guint32 block_count;
+    guint64 index_offset; // offset of block index in file
+    guint64 games_offset; // offset of game table in file
+} ShogiArchiveHeader;
+
+typedef struct _shogi_archive_block {
+    guint64 offset; // offset of compressed moves in file
+    guint32 size; // compressed size
+    guint32 moves; // number of moves in the block
+} ShogiArchiveBlock;
+
+typedef struct _shogi_archive_game {
+    char black[SHOGI_ARCHIVE_NAME_LENGTH]; // NUL terminated, empty if unknown
+    char white[SHOGI_ARCHIVE_NAME_LENGTH];
+    guint32 date; // YYYYMMDD, 0 if unknown
+    guint32 first_move; // moves of preceding games in the same block
+    guint16 length; // number of moves
+    guint8 result; // enum SHOGI_ARCHIVE_RESULT
+    guint8 reserved;
+} ShogiArchiveGame;
+
+typedef struct _shogi_archive {
+    int fd;
+    gsize size; // size of mapped file
+    const guint8 *data;
+    const ShogiArchiveHeader *header;
+    const ShogiArchiveBlock *blocks;
+    const ShogiArchiveGame *games;
+} ShogiArchive;
+
+/// Reads games of an archive. Keeps the last inflated block, so games of one block are read without inflating it
+/// again. Archive can be shared by threads, each with it's own reader
+typedef struct _shogi_archive_reader {
+    const ShogiArchive *archive;
+    GConverter *decompressor;
+    guint8 *block; // packed moves of the cached block, low bytes followed by high bytes
+    gsize block_capacity;
+    gint64 block_index; // index of the cached block, -1 if there's none
+} ShogiArchiveReader;
+
+typedef struct _shogi_archive_writer {
+    FILE *file;
+    char *path;
+    char *temp_path; // archive is written here and renamed to path when finished
+    GConverter *compressor;
+    GArray *games; // ShogiArchiveGame
+    GArray *blocks; // ShogiArchiveBlock
+    GArray *moves; // packed moves (guint16) of the block being filled
+    guint64 offset; // end of written data
+    gboolean failed;
+} ShogiArchiveWriter;
+
+/**
+ * Opens archive and maps it into memory
+ * @param path path to the archive
+ * @return archive or NULL if the file doesn't exist or isn't a valid archive
+ */
+ShogiArchive *shogi_archive_open(const char *path);
+
+/**
+ * Unmaps and closes the archive
+ * @param archive archive to close, may be NULL
+ */
+void shogi_archive_close(ShogiArchive *archive);
+
+/**
+ * Returns number of games in archive
+ * @param archive opened archive
+ * @return number of games
+ */
+guint32 shogi_archive_game_count(const ShogiArchive *archive);
+
+/**
+ * Returns metadata of a game, read directly from the game table
+ * @param archive opened archive
+ * @param game game number, less than shogi_archive_game_count()
+ * @return game metadata
+ */
+const ShogiArchiveGame *shogi_archive_game(const ShogiArchive *archive, guint32 game);
+
+/**
+ * Creates reader of an archive
+ * @param archive opened archive, must outlive the reader
+ * @return new reader
+ */
+ShogiArchiveReader *shogi_archive_reader_new(const ShogiArchive *archive);
+
+/**
+ * Frees reader
+ * @param reader reader to free, may be NULL
+ */
+void shogi_archive_reader_free(ShogiArchiveReader *reader);
+
+/**
+ * Inflates and replays game from the initial position, every move is checked to be pseudo legal
+ * @param reader reader
+ * @param game game number, less than shogi_archive_game_count()
+ * @param moves array of at least SHOGI_ARCHIVE_MAX_MOVES moves filled with moves of the game, may be NULL
+ * @param pos set to the position after the last move, may be NULL
+ * @return number of moves or -1 if the block is corrupted or a move cannot be played
+ */
+int shogi_archive_read_game(ShogiArchiveReader *reader, guint32 game, ShogiMove *moves, ShogiPosition *pos);
+
+/**
+ * Starts writing an archive to a temporary file next to path
+ * @param path path of the archive
+ * @return new writer or NULL if the file cannot be created
+ */
+ShogiArchiveWriter *shogi_archive_writer_new(const char *path);
+
+/**
+ * Appends game to the archive
+ * @param writer writer
+ * @param info players, result and date of the game, length and first move are filled in by the writer
+ * @param moves moves of the game played from the initial position
+ * @param count number of moves, at most SHOGI_ARCHIVE_MAX_MOVES
+ * @return false if the game is too long or the archive cannot be written
+ */
+gboolean shogi_archive_writer_add(ShogiArchiveWriter *writer, const ShogiArchiveGame *info, const ShogiMove *moves,
+                                  int count);
+
+/**
+ * Writes the last block, block index and game table, moves the archive into place and frees the writer
+ * @param writer writer
+ * @param size set to the size of the archive in bytes, may be NULL
+ * @return true on success, on failure the temporary file is removed
+ */
+gboolean shogi_archive_writer_finish(ShogiArchiveWriter *writer, guint64 *size);
+
+#endif //SHOGI_ARCHIVE_H
@@ -0,0 +1,349 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Book.h"
+#include "Logger.h"
+#include "Trace.h"
+
+enum BOOK_RESULT {
+    BOOK_RESULT_UNKNOWN,
+    BOOK_RESULT_BLACK_WIN,
+    BOOK_RESULT_WHITE_WIN
+};
+
+typedef struct _book_builder {
+    GPtrArray *games; // game records as lines of text
+    const ShogiBookBuildOptions *options;
+    gint next_game; // index of next game to replay, taken atomically by workers
+} BookBuilder;
+
+typedef struct _book_worker {
+    BookBuilder *builder;
+    GArray *entries; // ShogiBookEntry
+    ShogiBookBuildStats stats;
+} BookWorker;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static int compare_entries(const void *a, const void *b) {
+    const ShogiBookEntry *entry_a = a, *entry_b = b;
+    if (entry_a->key != entry_b->key) return entry_a->key < entry_b->key ? -1 : 1;
+    if (entry_a->move != entry_b->move) return entry_a->move < entry_b->move ? -1 : 1;
+    return 0;
+}
+
+/// sorts entries and sums up the same moves from the same positions
+static void merge_entries(GArray *entries) {
+    if (entries->len == 0) return;
+    qsort(entries->data, entries->len, sizeof(ShogiBookEntry), compare_entries);
+
+    ShogiBookEntry *data = (ShogiBookEntry *) entries->data;
+    guint merged = 0;
+    for (guint i = 1; i < entries->len; ++i) {
+        if (compare_entries(&data[merged], &data[i]) == 0) {
+            data[merged].count += data[i].count;
+            data[merged].wins += data[i].wins;
+            data[merged].losses += data[i].losses;
+        } else {
+            data[++merged] = data[i];
+        }
+    }
+    g_array_set_size(entries, merged + 1);
+}
+
+/// replays one game from the initial position and adds it's moves
+static void replay_game(BookWorker *worker, const char *game) {
+    const ShogiBookBuildOptions *options = worker->builder->options;
+    char **tokens = g_strsplit_set(game, " \t\r\n", -1);
+    enum BOOK_RESULT result = BOOK_RESULT_UNKNOWN;
+    int it = 0;
+
+    while (tokens[it] != NULL && tokens[it][0] == '\0') it++;
+    if (tokens[it] == NULL || tokens[it][0] == '#') { // empty line or comment
+        g_strfreev(tokens);
+        return;
+    }
+    if (strcmp(tokens[it], "1-0") == 0) result = BOOK_RESULT_BLACK_WIN;
+    else if (strcmp(tokens[it], "0-1") == 0) result = BOOK_RESULT_WHITE_WIN;
+    it++;
+
+    ShogiPosition pos;
+    shogi_position_init(&pos);
+    worker->stats.games++;
+    for (; tokens[it] != NULL && pos.ply < options->max_ply; ++it) {
+        if (tokens[it][0] == '\0') continue;
+        ShogiMove move = shogi_position_parse_move(&pos, tokens[it]);
+        if (move == SHOGI_MOVE_NONE) {
+            worker->stats.bad_games++;
+            break;
+        }
+
+        gboolean mover_won = pos.black_turn ? result == BOOK_RESULT_BLACK_WIN : result == BOOK_RESULT_WHITE_WIN;
+        gboolean mover_lost = pos.black_turn ? result == BOOK_RESULT_WHITE_WIN : result == BOOK_RESULT_BLACK_WIN;
+        ShogiBookEntry entry = {pos.key, move, 1, mover_won ? 1 : 0, mover_lost ? 1 : 0};
+        g_array_append_val(worker->entries, entry);
+        worker->stats.positions++;
+        shogi_position_do_move(&pos, move);
+    }
+    g_strfreev(tokens);
+}
+
+static gpointer book_worker_run(gpointer data) {
+    BookWorker *worker = data;
+    BookBuilder *builder = worker->builder;
+    int game;
+    while ((game = g_atomic_int_add(&builder->next_game, 1)) < (int) builder->games->len)
+        replay_game(worker, g_ptr_array_index(builder->games, game));
+    merge_entries(worker->entries); // most positions near the root repeat, so this shrinks the final merge
+    return NULL;
+}
+
+/// reads moves from the history of a saved game, see shogi_model_save_serialize() in Model.c
+static char *read_saved_game(FILE *file) {
+    char state[SHOGI_MODEL_SERIALIZED_STATE_LENGTH];
+    gboolean black_turn, timed;
+    gint64 timer[2];
+    int entries;
+    if (fread(state, sizeof(char), SHOGI_MODEL_SERIALIZED_STATE_LENGTH, file) != SHOGI_MODEL_SERIALIZED_STATE_LENGTH ||
+        fread(&black_turn, sizeof(gboolean), 1, file) != 1 || fread(&timed, sizeof(gboolean), 1, file) != 1 ||
+        fread(timer, sizeof(gint64), 2, file) != 2 || fread(&entries, sizeof(int), 1, file) != 1 || entries < 0)
+        return NULL;
+
+    GString *game = g_string_new("*");
+    for (int i = 0; i < entries; ++i) {
+        ShogiModelHistoryEntry entry;
+        if (fread(&entry, sizeof(ShogiModelHistoryEntry), 1, file) != 1) break;
+        entry.move[SHOGI_MODEL_MOVE_LENGTH - 1] = '\0';
+        g_string_append_c(game, ' ');
+        g_string_append(game, entry.move);
+    }
+    return g_string_free(game, FALSE);
+}
+
+/// reads games from the file, one per line or single saved game
+static gboolean read_games(const char *path, GPtrArray *games) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_ERROR, "Cannot open game records %s.", path);
+        return FALSE;
+    }
+
+    if (g_str_has_suffix(path, ".shogi")) {
+        char *game = read_saved_game(file);
+        if (game) g_ptr_array_add(games, game);
+        else shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_WARN, "Saved game %s is corrupted.", path);
+    } else {
+        char *line = NULL;
+        size_t capacity = 0;
+        while (getline(&line, &capacity, file) != -1)
+            g_ptr_array_add(games, g_strdup(line));
+        free(line);
+    }
+    fclose(file);
+    return TRUE;
+}
+
+static gboolean write_book(const char *output, GArray *entries, guint32 min_count, guint64 *written) {
+    char *directory = g_path_get_dirname(output); // data directory of a fresh install may not exist yet
+    g_mkdir_with_parents(directory, 0755);
+    g_free(directory);
+    char *temp_path = g_strconcat(output, ".tmp", NULL);
+    FILE *file = fopen(temp_path, "wb");
+    if (file == NULL) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_ERROR, "Cannot create book %s.", temp_path);
+        g_free(temp_path);
+        return FALSE;
+    }
+
+    ShogiBookHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SHOGI_BOOK_MAGIC, sizeof(header.magic));
+    header.entry_size = sizeof(ShogiBookEntry);
+    for (guint i = 0; i < entries->len; ++i)
+        if (g_array_index(entries, ShogiBookEntry, i).count >= min_count)
+            header.entry_count++;
+
+    gboolean ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (guint i = 0; ok && i < entries->len; ++i) {
+        const ShogiBookEntry *entry = &g_array_index(entries, ShogiBookEntry, i);
+        if (entry->count >= min_count)
+            ok = fwrite(entry, sizeof(ShogiBookEntry), 1, file) == 1;
+    }
+    ok = fclose(file) == 0 && ok;
+    // book being replaced may be mapped by running app, rename keeps it's old contents valid
+    if (ok && rename(temp_path, output) != 0)
+        ok = FALSE;
+    if (!ok) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_ERROR, "Cannot write book %s.", output);
+        remove(temp_path);
+    }
+    *written = header.entry_count;
+    g_free(temp_path);
+    return ok;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+ShogiBook *shogi_book_open(const char *path) {
+    SHOGI_TRACE_FUNCTION();
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_DEBUG, "No opening book at %s.", path);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (gsize) st.st_size < sizeof(ShogiBookHeader)) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_WARN, "Opening book %s is too small.", path);
+        close(fd);
+        return NULL;
+    }
+
+    void *data = mmap(NULL, (gsize) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_ERROR, "Cannot map opening book %s.", path);
+        close(fd);
+        return NULL;
+    }
+    madvise(data, (gsize) st.st_size, MADV_RANDOM); // binary search touches few pages, don't read ahead
+
+    const ShogiBookHeader *header = data;
+    if (memcmp(header->magic, SHOGI_BOOK_MAGIC, sizeof(header->magic)) != 0 ||
+        header->entry_size != sizeof(ShogiBookEntry) ||
+        sizeof(ShogiBookHeader) + (gsize) header->entry_count * sizeof(ShogiBookEntry) > (gsize) st.st_size) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_WARN, "File %s is not a valid opening book.", path);
+        munmap(data, (gsize) st.st_size);
+        close(fd);
+        return NULL;
+    }
+
+    ShogiBook *book = malloc(sizeof(ShogiBook));
+    if (book == NULL) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_ERROR, "Cannot allocate memory for opening book.");
+        munmap(data, (gsize) st.st_size);
+        close(fd);
+        return NULL;
+    }
+    book->fd = fd;
+    book->size = (gsize) st.st_size;
+    book->header = header;
+    book->entries = (const ShogiBookEntry *) (header + 1);
+    shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_INFO, "Opened book %s with %u entries.", path, header->entry_count);
+    return book;
+}
+
+void shogi_book_close(ShogiBook *book) {
+    if (book == NULL) return;
+    munmap((void *) book->header, book->size);
+    close(book->fd);
+    free(book);
+}
+
+int shogi_book_probe(const ShogiBook *book, HASH key, const ShogiBookEntry **entries) {
+    // lower bound of the key
+    guint32 low = 0, high = book->header->entry_count;
+    while (low < high) {
+        guint32 middle = low + (high - low) / 2;
+        if (book->entries[middle].key < (guint64) key) low = middle + 1;
+        else high = middle;
+    }
+
+    int count = 0;
+    while (low + count < book->header->entry_count && book->entries[low + count].key == (guint64) key)
+        count++;
+    *entries = &book->entries[low];
+    return count;
+}
+
+ShogiMove shogi_book_pick(const ShogiBook *book, const ShogiPosition *pos, guint32 random) {
+    SHOGI_TRACE_FUNCTION();
+    if (book == NULL) return SHOGI_MOVE_NONE;
+
+    const ShogiBookEntry *entries;
+    int count = MIN(shogi_book_probe(book, pos->key, &entries), SHOGI_BOOK_MAX_MOVES);
+    guint64 total = 0;
+    gboolean valid[SHOGI_BOOK_MAX_MOVES];
+    for (int i = 0; i < count; ++i) {
+        valid[i] = shogi_position_is_pseudo_legal(pos, entries[i].move); // guards against key collisions
+        if (valid[i]) total += entries[i].count;
+    }
+    if (total == 0) return SHOGI_MOVE_NONE;
+
+    guint64 pick = random % total;
+    for (int i = 0; i < count; ++i) {
+        if (!valid[i]) continue;
+        if (pick < entries[i].count) return entries[i].move;
+        pick -= entries[i].count;
+    }
+    return SHOGI_MOVE_NONE;
+}
+
+void shogi_book_build_options_default(ShogiBookBuildOptions *options) {
+    options->threads = 0;
+    options->max_ply = 40;
+    options->min_count = 1;
+}
+
+gboolean shogi_book_build(const char **files, int files_count, const char *output,
+                          const ShogiBookBuildOptions *options, ShogiBookBuildStats *stats) {
+    SHOGI_TRACE_FUNCTION();
+    ShogiBookBuildOptions defaults;
+    if (options == NULL) {
+        shogi_book_build_options_default(&defaults);
+        options = &defaults;
+    }
+
+    BookBuilder builder;
+    builder.games = g_ptr_array_new_with_free_func(g_free);
+    builder.options = options;
+    builder.next_game = 0;
+    for (int i = 0; i < files_count; ++i) {
+        if (!read_games(files[i], builder.games)) {
+            g_ptr_array_free(builder.games, TRUE);
+            return FALSE;
+        }
+    }
+
+    int threads = options->threads > 0 ? options->threads : (int) g_get_num_processors();
+    threads = CLAMP(threads, 1, 256);
+    BookWorker *workers = g_new0(BookWorker, threads);
+    GThread **handles = g_new0(GThread *, threads);
+    for (int i = 0; i < threads; ++i) {
+        workers[i].builder = &builder;
+        workers[i].entries = g_array_new(FALSE, FALSE, sizeof(ShogiBookEntry));
+        if (i > 0)
+            handles[i] = g_thread_new("book", book_worker_run, &workers[i]);
+    }
+    book_worker_run(&workers[0]);
+
+    ShogiBookBuildStats total;
+    memset(&total, 0, sizeof(total));
+    GArray *entries = workers[0].entries;
+    for (int i = 0; i < threads; ++i) {
+        if (i > 0) {
+            g_thread_join(handles[i]);
+            g_array_append_vals(entries, workers[i].entries->data, workers[i].entries->len);
+            g_array_free(workers[i].entries, TRUE);
+        }
+        total.games += workers[i].stats.games;
+        total.bad_games += workers[i].stats.bad_games;
+        total.positions += workers[i].stats.positions;
+    }
+    merge_entries(entries);
+
+    gboolean ok = write_book(output, entries, MAX(options->min_count, 1), &total.entries);
+    if (stats) *stats = total;
+
+    g_array_free(entries, TRUE);
+    g_free(workers);
+    g_free(handles);
+    g_ptr_array_free(builder.games, TRUE);
+    return ok;
+}
@@ -0,0 +1,104 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#ifndef SHOGI_BOOK_H
+#define SHOGI_BOOK_H
+
+#include <glib.h>
+#include "Position.h"
+
+// Opening book is a file of entries sorted by position key and move, preceded by a small header.
+// It's mapped into memory, so probing is a binary search over the file with no loading step.
+//
+// Builder reads game records, each game is a line of text: result followed by moves in history notation
+//   1-0 P77-76 P33-34 P27-26 ...     (1-0 black won, 0-1 white won, * unknown or draw)
+// Saved games (*.shogi) are read as well, their result is unknown as only games in progress can be saved.
+
+#define SHOGI_BOOK_MAGIC        "SHOGIBK1"
+#define SHOGI_BOOK_MAX_MOVES    64 // book moves returned for single position at most
+
+typedef struct _shogi_book_header {
+    char magic[8];
+    guint32 entry_size; // sizeof(ShogiBookEntry), guards against files from different builds
+    guint32 entry_count;
+} ShogiBookHeader;
+
+typedef struct _shogi_book_entry {
+    guint64 key; // zobrist key of position before the move
+    guint32 move; // ShogiMove
+    guint32 count; // how many times the move was played
+    guint32 wins; // games won by player who made the move
+    guint32 losses;
+} ShogiBookEntry;
+
+typedef struct _shogi_book {
+    int fd;
+    gsize size; // size of mapped file
+    const ShogiBookHeader *header;
+    const ShogiBookEntry *entries;
+} ShogiBook;
+
+typedef struct _shogi_book_build_options {
+    int threads; // 0 for number of processors
+    int max_ply; // moves deeper in the game are not added
+    guint32 min_count; // moves played less often are dropped
+} ShogiBookBuildOptions;
+
+typedef struct _shogi_book_build_stats {
+    guint64 games;
+    guint64 bad_games; // games with unknown moves, read up to the first bad move
+    guint64 positions; // moves added, before merging same ones
+    guint64 entries; // entries written to the book
+} ShogiBookBuildStats;
+
+/**
+ * Opens book and maps it into memory
+ * @param path path to the book file
+ * @return book or NULL if the file doesn't exist or isn't a valid book
+ */
+ShogiBook *shogi_book_open(const char *path);
+
+/**
+ * Unmaps and closes the book
+ * @param book book to close, may be NULL
+ */
+void shogi_book_close(ShogiBook *book);
+
+/**
+ * Finds entries of the position
+ * @param book opened book
+ * @param key zobrist key of the position
+ * @param entries set to the first entry of the position, entries of the position follow it
+ * @return number of entries of the position, 0 if it's not in the book
+ */
+int shogi_book_probe(const ShogiBook *book, HASH key, const ShogiBookEntry **entries);
+
+/**
+ * Picks a book move for the position, randomly weighted by how often it was played
+ * @param book opened book, may be NULL
+ * @param pos position
+ * @param random random number used for the pick
+ * @return book move or SHOGI_MOVE_NONE if the position isn't in the book
+ */
+ShogiMove shogi_book_pick(const ShogiBook *book, const ShogiPosition *pos, guint32 random);
+
+/**
+ * Fills options with defaults: all processors, 40 plies and moves played at least once
+ * @param options options to fill
+ */
+void shogi_book_build_options_default(ShogiBookBuildOptions *options);
+
+/**
+ * Builds book from game records. Games are replayed on all threads and merged into one sorted file
+ * @param files paths to game record files and saved games
+ * @param files_count number of files
+ * @param output path of the book to write
+ * @param options build options, NULL for defaults
+ * @param stats filled with build statistics, may be NULL
+ * @return true on success
+ */
+gboolean shogi_book_build(const char **files, int files_count, const char *output,
+                          const ShogiBookBuildOptions *options, ShogiBookBuildStats *stats);
+
+#endif //SHOGI_BOOK_H
@@ -0,0 +1,72 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#include "Clock.h"
+
+/// time the side spent in the running turn, 0 if it's not on move
+static inline gint64 turn_time(const ShogiClock *game_clock, int side, gint64 now) {
+    return game_clock->running == side ? MAX(now - game_clock->turn_start, 0) : 0;
+}
+
+void shogi_clock_init(ShogiClock *game_clock, gint64 main_time, gint64 byoyomi, gint64 increment) {
+    game_clock->remaining[SHOGI_CLOCK_WHITE] = game_clock->remaining[SHOGI_CLOCK_BLACK] = main_time * 1000;
+    game_clock->byoyomi = byoyomi * 1000;
+    game_clock->increment = increment * 1000;
+    game_clock->running = -1;
+    game_clock->turn_start = 0;
+}
+
+gboolean shogi_clock_enabled(const ShogiClock *game_clock) {
+    return game_clock->remaining[SHOGI_CLOCK_WHITE] > 0 || game_clock->remaining[SHOGI_CLOCK_BLACK] > 0 ||
+           game_clock->byoyomi > 0;
+}
+
+void shogi_clock_start(ShogiClock *game_clock, int side, gint64 now) {
+    game_clock->running = side;
+    game_clock->turn_start = now;
+}
+
+void shogi_clock_stop(ShogiClock *game_clock, gint64 now) {
+    int side = game_clock->running;
+    if (side < 0)
+        return;
+    game_clock->remaining[side] = shogi_clock_main_left(game_clock, side, now);
+    game_clock->running = -1;
+}
+
+void shogi_clock_press(ShogiClock *game_clock, gint64 now) {
+    int side = game_clock->running;
+    if (side < 0)
+        return;
+    // byoyomi period isn't carried over, the next move gets a full one again
+    game_clock->remaining[side] = shogi_clock_main_left(game_clock, side, now) + game_clock->increment;
+    shogi_clock_start(game_clock, 1 - side, now);
+}
+
+gint64 shogi_clock_main_left(const ShogiClock *game_clock, int side, gint64 now) {
+    return MAX(game_clock->remaining[side] - turn_time(game_clock, side, now), 0);
+}
+
+gint64 shogi_clock_time_left(const ShogiClock *game_clock, int side, gint64 now) {
+    gint64 left = game_clock->remaining[side] - turn_time(game_clock, side, now);
+    return left > 0 ? left : MAX(left + game_clock->byoyomi, 0);
+}
+
+int shogi_clock_flagged(const ShogiClock *game_clock, gint64 now) {
+    int side = game_clock->running;
+    if (side < 0 || game_clock->remaining[side] + game_clock->byoyomi - turn_time(game_clock, side, now) > 0)
+        return -1;
+    return side;
+}
+
+gint64 shogi_clock_next_change(const ShogiClock *game_clock, gint64 now) {
+    int side = game_clock->running;
+    if (side < 0)
+        return -1;
+    gint64 left = shogi_clock_time_left(game_clock, side, now);
+    if (left == 0)
+        return 0;
+    // shown seconds are rounded down, so they change just after the time passes a whole second
+    return left % G_USEC_PER_SEC + 1;
+}
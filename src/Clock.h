@@ -0,0 +1,106 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#ifndef SHOGI_CLOCK_H
+#define SHOGI_CLOCK_H
+
+#include <glib.h>
+
+// Game clock measured with the monotonic clock, so it counts wall time and doesn't jump with system time changes.
+// Each player has main time, optionally followed by byoyomi - a fixed time for every move once main time is used up.
+// Fischer increment is added to main time after each move. Time is read only when needed: the clock stores the
+// moment the running turn started, and callers ask for the delay until the displayed second changes.
+
+#define SHOGI_CLOCK_WHITE 0
+#define SHOGI_CLOCK_BLACK 1
+
+typedef struct _shogi_clock {
+    gint64 remaining[2]; // main time left before the running turn in us, [0] for white [1] for black
+    gint64 byoyomi; // time for every move after main time runs out, us
+    gint64 increment; // time added to main time after every move, us
+    int running; // side whose turn is running, -1 if the clock is stopped
+    gint64 turn_start; // monotonic time the running turn started, us
+} ShogiClock;
+
+/**
+ * Returns current time of the clock
+ * @return monotonic time in us
+ */
+static inline gint64 shogi_clock_now() {
+    return g_get_monotonic_time();
+}
+
+/**
+ * Sets both players' times and stops the clock
+ * @param game_clock clock to set
+ * @param main_time main time of each player, ms
+ * @param byoyomi time per move after main time, ms
+ * @param increment time added after each move, ms
+ */
+void shogi_clock_init(ShogiClock *game_clock, gint64 main_time, gint64 byoyomi, gint64 increment);
+
+/**
+ * Returns if the clock limits time at all
+ * @param game_clock clock
+ * @return true if main time or byoyomi is set
+ */
+gboolean shogi_clock_enabled(const ShogiClock *game_clock);
+
+/**
+ * Starts turn of the side
+ * @param game_clock stopped clock
+ * @param side SHOGI_CLOCK_WHITE or SHOGI_CLOCK_BLACK
+ * @param now current time from shogi_clock_now()
+ */
+void shogi_clock_start(ShogiClock *game_clock, int side, gint64 now);
+
+/**
+ * Stops the clock, charging time of the running turn without increment
+ * @param game_clock clock
+ * @param now current time from shogi_clock_now()
+ */
+void shogi_clock_stop(ShogiClock *game_clock, gint64 now);
+
+/**
+ * Ends running turn after a move - charges its time, adds increment and starts turn of the other side
+ * @param game_clock running clock
+ * @param now current time from shogi_clock_now()
+ */
+void shogi_clock_press(ShogiClock *game_clock, gint64 now);
+
+/**
+ * Returns main time left
+ * @param game_clock clock
+ * @param side side to check
+ * @param now current time from shogi_clock_now()
+ * @return main time left in us, 0 if it's used up
+ */
+gint64 shogi_clock_main_left(const ShogiClock *game_clock, int side, gint64 now);
+
+/**
+ * Returns time shown on the side's clock - main time, or time left of byoyomi once main time is used up
+ * @param game_clock clock
+ * @param side side to check
+ * @param now current time from shogi_clock_now()
+ * @return time left in us, 0 if the side ran out of time
+ */
+gint64 shogi_clock_time_left(const ShogiClock *game_clock, int side, gint64 now);
+
+/**
+ * Checks if the running side ran out of time
+ * @param game_clock clock
+ * @param now current time from shogi_clock_now()
+ * @return side that ran out of time, -1 if none
+ */
+int shogi_clock_flagged(const ShogiClock *game_clock, gint64 now);
+
+/**
+ * Returns delay until the whole seconds of the running side's time change or its time runs out
+ * @param game_clock clock
+ * @param now current time from shogi_clock_now()
+ * @return delay in us, -1 if the clock is stopped
+ */
+gint64 shogi_clock_next_change(const ShogiClock *game_clock, gint64 now);
+
+#endif //SHOGI_CLOCK_H
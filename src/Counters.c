@@ -0,0 +1,259 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "Counters.h"
+#include "Logger.h"
+
+guint64 shogi_counters[SHOGI_COUNTER_COUNT];
+ShogiHistogram shogi_histograms[SHOGI_HISTOGRAM_COUNT];
+
+static const char *counter_names[SHOGI_COUNTER_COUNT] = {
+        "moves_applied",
+        "hitmaps",
+        "is_check_calls",
+        "drop_mate_checks",
+        "history_bytes",
+        "redraws",
+        "redraw_squares",
+        "log_messages",
+        "log_dropped",
+        "log_events",
+        "log_bytes",
+        "log_batches",
+        "journal_records",
+        "journal_commits"
+};
+
+static const char *histogram_names[SHOGI_HISTOGRAM_COUNT] = {
+        "redraw_ns",
+        "timer_jitter_ns",
+        "hitmap_ns",
+        "journal_commit_ns"
+};
+
+static GThread *dump_thread;
+static gint dump_stop;
+static int dump_wakeup[2] = {-1, -1}; // pipe written by shogi_counters_dump_stop() to wake the dump thread
+static char *dump_path; // file or socket path
+static int dump_socket = -1; // listening socket, -1 when dumping to file
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void shogi_counters_record(enum SHOGI_HISTOGRAM histogram, guint64 value) {
+    ShogiHistogram *h = &shogi_histograms[histogram];
+    int bucket = value == 0 ? 0 : MIN(64 - __builtin_clzll(value), SHOGI_COUNTERS_BUCKETS - 1);
+    __atomic_fetch_add(&h->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum, value, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->buckets[bucket], 1, __ATOMIC_RELAXED);
+    guint64 max = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+    while (value > max && !__atomic_compare_exchange_n(&h->max, &max, value, TRUE, __ATOMIC_RELAXED,
+                                                       __ATOMIC_RELAXED));
+}
+
+void shogi_counters_snapshot(ShogiCountersSnapshot *snapshot) {
+    snapshot->time = g_get_real_time();
+    for (int i = 0; i < SHOGI_COUNTER_COUNT; ++i)
+        snapshot->counters[i] = __atomic_load_n(&shogi_counters[i], __ATOMIC_RELAXED);
+    for (int i = 0; i < SHOGI_HISTOGRAM_COUNT; ++i) {
+        ShogiHistogram *from = &shogi_histograms[i], *to = &snapshot->histograms[i];
+        to->count = __atomic_load_n(&from->count, __ATOMIC_RELAXED);
+        to->sum = __atomic_load_n(&from->sum, __ATOMIC_RELAXED);
+        to->max = __atomic_load_n(&from->max, __ATOMIC_RELAXED);
+        for (int j = 0; j < SHOGI_COUNTERS_BUCKETS; ++j)
+            to->buckets[j] = __atomic_load_n(&from->buckets[j], __ATOMIC_RELAXED);
+    }
+}
+
+guint64 shogi_counters_percentile(const ShogiHistogram *histogram, double percentile) {
+    guint64 total = 0;
+    for (int i = 0; i < SHOGI_COUNTERS_BUCKETS; ++i)
+        total += histogram->buckets[i]; // count may be ahead of buckets in a snapshot taken during update
+    if (total == 0)
+        return 0;
+
+    guint64 rank = (guint64) (percentile / 100.0 * total + 0.5), seen = 0;
+    for (int i = 0; i < SHOGI_COUNTERS_BUCKETS; ++i) {
+        seen += histogram->buckets[i];
+        if (seen >= MAX(rank, 1))
+            return MIN(i == 0 ? 0 : (1ull << i) - 1, histogram->max);
+    }
+    return histogram->max;
+}
+
+char *shogi_counters_format(const ShogiCountersSnapshot *snapshot) {
+    GString *text = g_string_new(NULL);
+    g_string_append_printf(text, "time %lld\n", (long long) snapshot->time);
+    for (int i = 0; i < SHOGI_COUNTER_COUNT; ++i)
+        g_string_append_printf(text, "%s %llu\n", counter_names[i], (unsigned long long) snapshot->counters[i]);
+    for (int i = 0; i < SHOGI_HISTOGRAM_COUNT; ++i) {
+        const ShogiHistogram *h = &snapshot->histograms[i];
+        g_string_append_printf(text, "%s count %llu avg %llu p50 %llu p99 %llu max %llu\n", histogram_names[i],
+                               (unsigned long long) h->count,
+                               (unsigned long long) (h->count ? h->sum / h->count : 0),
+                               (unsigned long long) shogi_counters_percentile(h, 50),
+                               (unsigned long long) shogi_counters_percentile(h, 99),
+                               (unsigned long long) h->max);
+    }
+    return g_string_free(text, FALSE);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// writes snapshot to temporary file and renames it, so readers never see a partial dump
+static void dump_to_file() {
+    ShogiCountersSnapshot snapshot;
+    shogi_counters_snapshot(&snapshot);
+    char *text = shogi_counters_format(&snapshot);
+    char *temporary = g_strconcat(dump_path, ".tmp", NULL);
+    FILE *file = fopen(temporary, "w");
+    if (file) {
+        fputs(text, file);
+        if (fclose(file) == 0)
+            rename(temporary, dump_path);
+    }
+    g_free(temporary);
+    g_free(text);
+}
+
+/// sends snapshot to one client and closes connection
+static void serve_client(int client) {
+    ShogiCountersSnapshot snapshot;
+    shogi_counters_snapshot(&snapshot);
+    char *text = shogi_counters_format(&snapshot);
+    gsize length = strlen(text), sent = 0;
+    while (sent < length) {
+        ssize_t written = send(client, text + sent, length - sent, MSG_NOSIGNAL);
+        if (written <= 0) break;
+        sent += (gsize) written;
+    }
+    close(client);
+    g_free(text);
+}
+
+static gpointer dump_thread_func(G_GNUC_UNUSED gpointer data) {
+    struct pollfd fds[2] = {{.fd = dump_wakeup[0], .events = POLLIN}, {.fd = dump_socket, .events = POLLIN}};
+    while (!g_atomic_int_get(&dump_stop)) {
+        if (dump_socket < 0) { // sleeps until the next dump or until stopped
+            dump_to_file();
+            poll(fds, 1, SHOGI_COUNTERS_DUMP_INTERVAL);
+            continue;
+        }
+        if (poll(fds, 2, -1) > 0 && (fds[1].revents & POLLIN)) {
+            int client = accept(dump_socket, NULL, NULL); // listening socket doesn't block if the client went away
+            if (client >= 0)
+                serve_client(client);
+        }
+    }
+    return NULL;
+}
+
+/// removes socket left at path by a run that crashed, returns false if path is in use or isn't a socket
+static gboolean remove_stale_socket(const char *path, const struct sockaddr_un *address) {
+    struct stat info;
+    if (lstat(path, &info) != 0)
+        return errno == ENOENT;
+    if (!S_ISSOCK(info.st_mode)) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_ERROR, "Counters socket path %s exists and isn't a socket.", path);
+        return FALSE;
+    }
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe < 0)
+        return FALSE;
+    gboolean live = connect(probe, (const struct sockaddr *) address, sizeof(*address)) == 0 || errno != ECONNREFUSED;
+    close(probe);
+    if (live) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_ERROR, "Counters socket %s is used by another process.", path);
+        return FALSE;
+    }
+    return unlink(path) == 0;
+}
+
+/// creates listening Unix socket, returns -1 on failure
+static int open_socket(const char *path) {
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_ERROR, "Counters socket path %s is too long.", path);
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+    if (!remove_stale_socket(path, &address))
+        return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (fd < 0)
+        return -1;
+    if (bind(fd, (struct sockaddr *) &address, sizeof(address)) != 0 || listen(fd, 4) != 0) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_ERROR, "Cannot listen for counters on %s.", path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+gboolean shogi_counters_dump_start(const char *target) {
+    if (dump_thread)
+        return FALSE;
+    if (g_str_has_prefix(target, "unix:")) {
+        dump_path = g_strdup(target + strlen("unix:"));
+        dump_socket = open_socket(dump_path);
+        if (dump_socket < 0) {
+            g_free(dump_path);
+            dump_path = NULL;
+            return FALSE;
+        }
+    } else {
+        dump_path = g_strdup(target);
+        dump_socket = -1;
+    }
+    if (pipe(dump_wakeup) != 0) {
+        if (dump_socket >= 0) {
+            close(dump_socket);
+            unlink(dump_path);
+            dump_socket = -1;
+        }
+        g_free(dump_path);
+        dump_path = NULL;
+        return FALSE;
+    }
+    g_atomic_int_set(&dump_stop, 0);
+    dump_thread = g_thread_new("shogi-counters", dump_thread_func, NULL);
+    shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_INFO, "Publishing counters to %s.", target);
+    return TRUE;
+}
+
+void shogi_counters_dump_start_from_env() {
+    const char *target = g_getenv(SHOGI_COUNTERS_ENV);
+    if (target && *target)
+        shogi_counters_dump_start(target);
+}
+
+void shogi_counters_dump_stop() {
+    if (dump_thread == NULL)
+        return;
+    g_atomic_int_set(&dump_stop, 1);
+    char wake = 0;
+    if (write(dump_wakeup[1], &wake, 1) != 1)
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_WARN, "Cannot wake counters thread.");
+    g_thread_join(dump_thread);
+    dump_thread = NULL;
+    close(dump_wakeup[0]);
+    close(dump_wakeup[1]);
+    dump_wakeup[0] = dump_wakeup[1] = -1;
+    if (dump_socket >= 0) {
+        close(dump_socket);
+        unlink(dump_path);
+        dump_socket = -1;
+    } else {
+        dump_to_file(); // final values
+    }
+    g_free(dump_path);
+    dump_path = NULL;
+}
@@ -0,0 +1,117 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#ifndef SHOGI_COUNTERS_H
+#define SHOGI_COUNTERS_H
+
+#include <glib.h>
+
+// Process wide performance counters and histograms. Updates are relaxed atomic adds, so they are safe from any
+// thread and cost about as much as a plain increment; reading a snapshot never blocks writers.
+// Counters can be dumped periodically to a file, or served on a local Unix socket - every connection receives
+// current snapshot as text:
+//   SHOGI_COUNTERS=counters.txt ./shogi          rewrites counters.txt every second
+//   SHOGI_COUNTERS=unix:/tmp/shogi.sock ./shogi  socat - UNIX-CONNECT:/tmp/shogi.sock
+
+#define SHOGI_COUNTERS_ENV              "SHOGI_COUNTERS"
+#define SHOGI_COUNTERS_DUMP_INTERVAL    1000 // ms between file dumps
+#define SHOGI_COUNTERS_BUCKETS          40 // histogram bucket i holds values in [2^(i-1), 2^i) ns
+
+enum SHOGI_COUNTER {
+    SHOGI_COUNTER_MOVES_APPLIED,
+    SHOGI_COUNTER_HITMAPS, // single piece hitmaps, including ones for check and drop mate detection
+    SHOGI_COUNTER_IS_CHECK, // shogi_model_is_check calls
+    SHOGI_COUNTER_DROP_MATE, // pawn drops tested for mate
+    SHOGI_COUNTER_HISTORY_BYTES, // bytes written to history file
+    SHOGI_COUNTER_REDRAWS,
+    SHOGI_COUNTER_REDRAW_SQUARES, // squares repainted by redraws
+    SHOGI_COUNTER_LOG_MESSAGES,
+    SHOGI_COUNTER_LOG_DROPPED,
+    SHOGI_COUNTER_LOG_EVENTS,
+    SHOGI_COUNTER_LOG_BYTES, // bytes written to text log and event log
+    SHOGI_COUNTER_LOG_BATCHES, // writes done by the logger thread
+    SHOGI_COUNTER_JOURNAL_RECORDS,
+    SHOGI_COUNTER_JOURNAL_COMMITS, // group commits, each one write and fdatasync of all pending records
+    SHOGI_COUNTER_COUNT
+};
+
+enum SHOGI_HISTOGRAM {
+    SHOGI_HISTOGRAM_REDRAW, // time of board redraw, ns
+    SHOGI_HISTOGRAM_TIMER_JITTER, // difference between scheduled and actual timer wake-up, ns
+    SHOGI_HISTOGRAM_HITMAP, // time of hitmap shown to the player, including drop rules, ns
+    SHOGI_HISTOGRAM_JOURNAL_COMMIT, // time of journal write and fdatasync, ns
+    SHOGI_HISTOGRAM_COUNT
+};
+
+typedef struct _shogi_histogram {
+    guint64 count;
+    guint64 sum;
+    guint64 max;
+    guint64 buckets[SHOGI_COUNTERS_BUCKETS];
+} ShogiHistogram;
+
+typedef struct _shogi_counters_snapshot {
+    gint64 time; // real time of snapshot in microseconds
+    guint64 counters[SHOGI_COUNTER_COUNT];
+    ShogiHistogram histograms[SHOGI_HISTOGRAM_COUNT];
+} ShogiCountersSnapshot;
+
+extern guint64 shogi_counters[SHOGI_COUNTER_COUNT];
+extern ShogiHistogram shogi_histograms[SHOGI_HISTOGRAM_COUNT];
+
+/**
+ * Adds value to counter
+ * @param counter counter to increase
+ * @param value value to add
+ */
+static inline void shogi_counters_add(enum SHOGI_COUNTER counter, guint64 value) {
+    __atomic_fetch_add(&shogi_counters[counter], value, __ATOMIC_RELAXED);
+}
+
+/**
+ * Records value in histogram
+ * @param histogram histogram to update
+ * @param value value, usually time in ns
+ */
+void shogi_counters_record(enum SHOGI_HISTOGRAM histogram, guint64 value);
+
+/**
+ * Copies current values of all counters and histograms
+ * @param snapshot snapshot to fill
+ */
+void shogi_counters_snapshot(ShogiCountersSnapshot *snapshot);
+
+/**
+ * Estimates percentile of histogram from its buckets
+ * @param histogram histogram
+ * @param percentile percentile in range 0-100
+ * @return upper bound of bucket containing the percentile, 0 if histogram is empty
+ */
+guint64 shogi_counters_percentile(const ShogiHistogram *histogram, double percentile);
+
+/**
+ * Writes snapshot as text, one counter or histogram per line
+ * @param snapshot snapshot to write
+ * @return newly allocated string, free with g_free()
+ */
+char *shogi_counters_format(const ShogiCountersSnapshot *snapshot);
+
+/**
+ * Starts background thread publishing counters
+ * @param target file path, or unix:path for Unix socket
+ * @return false if publishing couldn't be started or already runs
+ */
+gboolean shogi_counters_dump_start(const char *target);
+
+/**
+ * Starts publishing counters if SHOGI_COUNTERS environment variable is set
+ */
+void shogi_counters_dump_start_from_env();
+
+/**
+ * Stops publishing thread, writes final snapshot to the file and removes the socket
+ */
+void shogi_counters_dump_stop();
+
+#endif //SHOGI_COUNTERS_H
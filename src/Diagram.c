@@ -0,0 +1,138 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#include <math.h>
+#include <string.h>
+#include "Diagram.h"
+#include "ResourceManager.h"
+
+#define COLOR(c) ((c)/255.0)
+
+void shogi_diagram_init(ShogiDiagram *diagram, const ShogiPosition *position) {
+    diagram->position = *position;
+    diagram->last_from = diagram->last_to = -1;
+    memset(diagram->hints, ' ', sizeof(diagram->hints));
+    diagram->hands = TRUE;
+}
+
+/// reads square from two digits, column first, returns -1 if they aren't digits 1-9
+static int parse_square(const char *digits) {
+    if (digits[0] < '1' || digits[0] > '9' || digits[1] < '1' || digits[1] > '9')
+        return -1;
+    return SHOGI_SQUARE(digits[0] - '0', digits[1] - '0');
+}
+
+gboolean shogi_diagram_set_last_move(ShogiDiagram *diagram, const char *notation) {
+    const char *movement = strpbrk(notation, "-x*");
+    if (movement == NULL)
+        return FALSE;
+    int to = parse_square(movement + 1);
+    int from = -1;
+    if (*movement != '*') {
+        if (movement - notation < 2 || (from = parse_square(movement - 2)) < 0)
+            return FALSE;
+    }
+    if (to < 0)
+        return FALSE;
+    diagram->last_from = from;
+    diagram->last_to = to;
+    return TRUE;
+}
+
+/// fills square of the board with color
+static void fill_square(cairo_t *cr, int sq, double y) {
+    int col_ix = sq % 9, row_ix = sq / 9;
+    double x0 = shogi_resource_manager_square_offset(col_ix), x1 = shogi_resource_manager_square_offset(col_ix + 1);
+    double y0 = shogi_resource_manager_square_offset(row_ix), y1 = shogi_resource_manager_square_offset(row_ix + 1);
+    cairo_rectangle(cr, x0, y + y0, x1 - x0, y1 - y0);
+    cairo_fill(cr);
+}
+
+/// draws pawns in hand of the player in a strip of given height, counts are written next to pawns
+static void paint_hand(cairo_t *cr, const ShogiPosition *pos, gboolean black, double y, double width, double height) {
+    cairo_set_source_rgb(cr, COLOR(249), COLOR(250), COLOR(216));
+    cairo_rectangle(cr, 0, y, width, height);
+    cairo_fill(cr);
+
+    cairo_select_font_face(cr, "sans-serif", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
+    cairo_set_font_size(cr, height * 0.4);
+    double x = shogi_resource_manager_square_offset(0);
+    for (int p = SHOGI_PAWN_G; p < SHOGI_PAWN_COUNT; ++p) {
+        int count = pos->hand[SHOGI_POSITION_COLOR(black)][p];
+        if (count == 0)
+            continue;
+        cairo_set_source_surface(cr, shogi_resource_manager_get_pawn_scaled(
+                SHOGI_PAWN_TO_DETAILED_TYPE((enum SHOGI_PAWN) p, black)), x, y);
+        cairo_paint(cr);
+        x += height;
+        if (count > 1) {
+            char text[4];
+            g_snprintf(text, sizeof(text), "%d", count);
+            cairo_text_extents_t extents;
+            cairo_text_extents(cr, text, &extents);
+            cairo_set_source_rgb(cr, COLOR(35), COLOR(25), COLOR(22));
+            cairo_move_to(cr, x, y + (height + extents.height) / 2);
+            cairo_show_text(cr, text);
+            x += extents.x_advance + height * 0.2;
+        }
+    }
+}
+
+cairo_surface_t *shogi_diagram_render(const ShogiDiagram *diagram) {
+    cairo_surface_t *board = shogi_resource_manager_get_board_scaled();
+    double device_scale, unused;
+    cairo_surface_get_device_scale(board, &device_scale, &unused); // diagram has the resolution of the textures
+    double width = cairo_image_surface_get_width(board) / device_scale;
+    double board_height = cairo_image_surface_get_height(board) / device_scale;
+    double hand_height = diagram->hands ? shogi_resource_manager_square_offset(1) -
+                                          shogi_resource_manager_square_offset(0) : 0;
+    double board_y = hand_height; // white's hand is above the board, black's below
+    int height = (int) lround((board_height + 2 * hand_height) * device_scale);
+    cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, cairo_image_surface_get_width(board),
+                                                          height);
+    cairo_surface_set_device_scale(surface, device_scale, device_scale);
+    cairo_t *cr = cairo_create(surface);
+
+    cairo_set_source_surface(cr, board, 0, board_y);
+    cairo_paint(cr);
+
+    cairo_set_source_rgba(cr, COLOR(244), COLOR(196), COLOR(48), 0.45);
+    if (diagram->last_from >= 0)
+        fill_square(cr, diagram->last_from, board_y);
+    if (diagram->last_to >= 0)
+        fill_square(cr, diagram->last_to, board_y);
+
+    for (int i = 0; i < 9; ++i) {
+        for (int j = 0; j < 9; ++j) {
+            enum SHOGI_PAWN_DETAILED pawn = diagram->position.board[i][j];
+            if (pawn == SHOGI_PAWN_DETAILED_NONE)
+                continue;
+            cairo_set_source_surface(cr, shogi_resource_manager_get_pawn_scaled(pawn),
+                                     shogi_resource_manager_square_offset(j),
+                                     board_y + shogi_resource_manager_square_offset(i));
+            cairo_paint(cr);
+        }
+    }
+
+    // same colors as highlights in the app
+    for (int i = 0; i < 9; ++i) {
+        for (int j = 0; j < 9; ++j) {
+            if (diagram->hints[i][j] == 'x')
+                cairo_set_source_rgba(cr, COLOR(66), COLOR(134), COLOR(244), 0.5);
+            else if (diagram->hints[i][j] == 'o')
+                cairo_set_source_rgba(cr, COLOR(150), COLOR(150), COLOR(150), 0.3);
+            else
+                continue;
+            fill_square(cr, i * 9 + j, board_y);
+        }
+    }
+
+    if (diagram->hands) {
+        paint_hand(cr, &diagram->position, FALSE, 0, width, hand_height);
+        paint_hand(cr, &diagram->position, TRUE, board_y + board_height, width, hand_height);
+    }
+
+    cairo_destroy(cr);
+    return surface;
+}
@@ -0,0 +1,46 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#ifndef SHOGI_DIAGRAM_H
+#define SHOGI_DIAGRAM_H
+
+#include <cairo.h>
+#include "Position.h"
+
+// Board diagrams drawn without a display - position with optional last move and hint highlights painted onto
+// a cairo image surface with the textures of ResourceManager. Diagrams are independent, so any number of them
+// can be rendered in parallel once textures are scaled.
+
+typedef struct _shogi_diagram {
+    ShogiPosition position;
+    int last_from; // square the last move started from (see SHOGI_SQUARE), -1 for none or drop
+    int last_to; // square the last move ended on, -1 for none
+    char hints[9][9]; // highlights as in available moves of the model: 'x' selected, 'o' available, ' ' none
+    gboolean hands; // draws hands of players above and below the board
+} ShogiDiagram;
+
+/**
+ * Sets up diagram of position without highlights
+ * @param diagram diagram to set up
+ * @param position position to draw
+ */
+void shogi_diagram_init(ShogiDiagram *diagram, const ShogiPosition *position);
+
+/**
+ * Marks last move from notation as in history, for example P77-76, Bx22+ or P*55
+ * @param diagram diagram
+ * @param notation move notation
+ * @return false if notation is malformed
+ */
+gboolean shogi_diagram_set_last_move(ShogiDiagram *diagram, const char *notation);
+
+/**
+ * Renders diagram with textures scaled by shogi_resource_manager_scale(), the image has their device scale. Safe to
+ * call from many threads at once, as long as the scale doesn't change meanwhile
+ * @param diagram diagram to render
+ * @return new image surface, check with cairo_surface_status()
+ */
+cairo_surface_t *shogi_diagram_render(const ShogiDiagram *diagram);
+
+#endif //SHOGI_DIAGRAM_H
@@ -0,0 +1,226 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "Journal.h"
+#include "Logger.h"
+#include "Counters.h"
+
+/// CRC-32 (IEEE 802.3, reflected polynomial 0xEDB88320) with table built on first use
+static guint32 crc32(const void *data, gsize length) {
+    static guint32 table[256];
+    static gsize table_ready = 0;
+    if (g_once_init_enter(&table_ready)) {
+        for (guint32 i = 0; i < 256; ++i) {
+            guint32 c = i;
+            for (int k = 0; k < 8; ++k)
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        g_once_init_leave(&table_ready, 1);
+    }
+    guint32 crc = 0xFFFFFFFFu;
+    const guint8 *it = data;
+    for (gsize i = 0; i < length; ++i)
+        crc = table[(crc ^ it[i]) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static guint32 record_crc(const ShogiJournalRecord *record) {
+    return crc32((const guint8 *) record + sizeof(record->crc), sizeof(ShogiJournalRecord) - sizeof(record->crc));
+}
+
+/// writes whole buffer, retrying short writes, returns false on error
+static gboolean write_all(int fd, const guint8 *data, gsize length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return FALSE;
+        data += written;
+        length -= (gsize) written;
+    }
+    return TRUE;
+}
+
+static gboolean sync_file(int fd) {
+#ifdef __APPLE__
+    return fsync(fd) == 0;
+#else
+    return fdatasync(fd) == 0;
+#endif
+}
+
+/// writes batch to a new file and renames it over the journal, so a crash leaves either the old or the new journal
+static gboolean replace(ShogiJournal *journal, GByteArray *batch) {
+    char *temp_path = g_strconcat(journal->path, ".tmp", NULL);
+    int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    gboolean ok = fd >= 0 && write_all(fd, batch->data, batch->len) && sync_file(fd) &&
+                  rename(temp_path, journal->path) == 0;
+    if (ok) {
+        close(journal->fd);
+        journal->fd = fd;
+        // rename itself is durable once the directory is synced
+        char *directory = g_path_get_dirname(journal->path);
+        int directory_fd = open(directory, O_RDONLY);
+        if (directory_fd >= 0) {
+            fsync(directory_fd);
+            close(directory_fd);
+        }
+        g_free(directory);
+    } else if (fd >= 0) {
+        close(fd);
+        unlink(temp_path);
+    }
+    g_free(temp_path);
+    return ok;
+}
+
+static void commit(ShogiJournal *journal, GByteArray *batch, gboolean replace_journal) {
+    guint64 start = shogi_logger_time_ns();
+    gboolean ok = replace_journal ? replace(journal, batch) :
+                  write_all(journal->fd, batch->data, batch->len) && sync_file(journal->fd);
+    if (!ok)
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_ERROR, "Cannot commit journal: %s", g_strerror(errno));
+    shogi_counters_add(SHOGI_COUNTER_JOURNAL_COMMITS, 1);
+    shogi_counters_record(SHOGI_HISTOGRAM_JOURNAL_COMMIT, shogi_logger_time_ns() - start);
+}
+
+static gpointer writer_thread(gpointer data) {
+    ShogiJournal *journal = data;
+    g_mutex_lock(&journal->lock);
+    while (TRUE) {
+        while (!journal->quit && journal->pending->len == 0)
+            g_cond_wait(&journal->wake, &journal->lock);
+        // group commit window - records queued until the deadline are written together
+        gint64 deadline = journal->first_pending + journal->interval;
+        while (!journal->quit && g_get_monotonic_time() < deadline)
+            g_cond_wait_until(&journal->wake, &journal->lock, deadline);
+        if (journal->pending->len == 0)
+            break; // quitting with nothing left to commit
+
+        GByteArray *batch = journal->pending;
+        gboolean replace_journal = journal->replace;
+        journal->pending = journal->spare;
+        journal->replace = FALSE;
+        g_mutex_unlock(&journal->lock);
+
+        commit(journal, batch, replace_journal);
+        g_byte_array_set_size(batch, 0);
+
+        g_mutex_lock(&journal->lock);
+        journal->spare = batch;
+    }
+    g_mutex_unlock(&journal->lock);
+    return NULL;
+}
+
+ShogiJournal *shogi_journal_open(const char *path) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_WARN, "Cannot open journal %s, games won't survive a crash.", path);
+        return NULL;
+    }
+
+    ShogiJournal *journal = g_new0(ShogiJournal, 1);
+    journal->fd = fd;
+    journal->path = g_strdup(path);
+    const char *interval = g_getenv(SHOGI_JOURNAL_ENV);
+    journal->interval = (interval ? MAX(atol(interval), 0) : SHOGI_JOURNAL_DEFAULT_INTERVAL) * 1000;
+    journal->pending = g_byte_array_new();
+    journal->spare = g_byte_array_new();
+    g_mutex_init(&journal->lock);
+    g_cond_init(&journal->wake);
+    journal->writer = g_thread_new("shogi-journal", writer_thread, journal);
+    shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_DEBUG, "Journal %s opened, commit interval %ld ms.", path,
+                     (long) (journal->interval / 1000));
+    return journal;
+}
+
+void shogi_journal_close(ShogiJournal *journal) {
+    if (journal == NULL) return;
+    g_mutex_lock(&journal->lock);
+    journal->quit = TRUE;
+    g_cond_signal(&journal->wake);
+    g_mutex_unlock(&journal->lock);
+    g_thread_join(journal->writer); // commits what's pending before it exits
+
+    close(journal->fd);
+    g_free(journal->path);
+    g_byte_array_free(journal->pending, TRUE);
+    g_byte_array_free(journal->spare, TRUE);
+    g_mutex_clear(&journal->lock);
+    g_cond_clear(&journal->wake);
+    g_free(journal);
+}
+
+/// queues record, caller holds the lock
+static void queue_record(ShogiJournal *journal, ShogiJournalRecord *record) {
+    record->crc = record_crc(record);
+    if (journal->pending->len == 0)
+        journal->first_pending = g_get_monotonic_time();
+    g_byte_array_append(journal->pending, (const guint8 *) record, sizeof(ShogiJournalRecord));
+    shogi_counters_add(SHOGI_COUNTER_JOURNAL_RECORDS, 1);
+    g_cond_signal(&journal->wake);
+}
+
+void shogi_journal_append(ShogiJournal *journal, ShogiJournalRecord *record) {
+    if (journal == NULL) return;
+    g_mutex_lock(&journal->lock);
+    queue_record(journal, record);
+    g_mutex_unlock(&journal->lock);
+}
+
+void shogi_journal_restart(ShogiJournal *journal) {
+    if (journal == NULL) return;
+    ShogiJournalRecord record;
+    memset(&record, 0, sizeof(record));
+    record.type = SHOGI_JOURNAL_RECORD_GAME_START;
+
+    g_mutex_lock(&journal->lock);
+    g_byte_array_set_size(journal->pending, 0); // records of the previous game are dropped with it
+    journal->replace = TRUE;
+    queue_record(journal, &record);
+    g_mutex_unlock(&journal->lock);
+}
+
+void shogi_journal_resume(ShogiJournal *journal, guint records) {
+    if (journal == NULL) return;
+    g_mutex_lock(&journal->lock);
+    // only the torn or corrupted tail is cut, intact records stay on disk all the time
+    if (ftruncate(journal->fd, (off_t) (records * sizeof(ShogiJournalRecord))) != 0 || !sync_file(journal->fd))
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_ERROR, "Cannot cut journal after record %u: %s", records,
+                         g_strerror(errno));
+    g_mutex_unlock(&journal->lock);
+}
+
+GArray *shogi_journal_read(const char *path) {
+    GArray *records = g_array_new(FALSE, FALSE, sizeof(ShogiJournalRecord));
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return records;
+
+    ShogiJournalRecord record;
+    int read = 0;
+    while (fread(&record, sizeof(record), 1, file) == 1) {
+        if (record.crc != record_crc(&record) || record.type < SHOGI_JOURNAL_RECORD_GAME_START ||
+            record.type > SHOGI_JOURNAL_RECORD_GAME_END) {
+            shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_WARN, "Journal record %d is corrupted, later ones are skipped.",
+                             read);
+            break;
+        }
+        if (record.type == SHOGI_JOURNAL_RECORD_GAME_START)
+            g_array_set_size(records, 0);
+        g_array_append_vals(records, &record, 1);
+        read++;
+    }
+    fclose(file);
+    return records;
+}
@@ -0,0 +1,108 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#ifndef SHOGI_JOURNAL_H
+#define SHOGI_JOURNAL_H
+
+#include <glib.h>
+#include "Model.h"
+
+// Crash-safe journal of the current game. Model appends fixed size records - game start, clock settings, moves
+// with the clock after them and game end - each protected by CRC-32. Records are queued in memory and a writer
+// thread group-commits them: one write and one fdatasync for all records queued within the commit interval.
+// On startup the journal is read up to the first torn or corrupted record and an unfinished game is resumed by
+// appending to those records. A new game replaces the journal through a temporary file renamed over it.
+// Commit interval is set with environment variable, 0 commits every record right away (tournament mode):
+//   SHOGI_JOURNAL_SYNC=0 ./shogi
+
+#define SHOGI_JOURNAL_PATH              ".shogi_journal"
+#define SHOGI_JOURNAL_ENV               "SHOGI_JOURNAL_SYNC"
+#define SHOGI_JOURNAL_DEFAULT_INTERVAL  200 // ms between group commits, moves made within it share one fdatasync
+
+enum SHOGI_JOURNAL_RECORD_TYPE {
+    SHOGI_JOURNAL_RECORD_GAME_START = 1, // journal is replaced with it, so it's always the first record
+    SHOGI_JOURNAL_RECORD_CLOCK, // time control set for the game
+    SHOGI_JOURNAL_RECORD_MOVE,
+    SHOGI_JOURNAL_RECORD_GAME_END
+};
+
+typedef struct _shogi_journal_record {
+    guint32 crc; // CRC-32 of the rest of the record
+    guint16 type; // enum SHOGI_JOURNAL_RECORD_TYPE
+    guint16 ply; // history entries before the record
+    union {
+        struct {
+            guint32 initial_time; // ms, as in shogi_model_timer_set()
+            guint32 byoyomi;
+            guint32 increment;
+        } clock;
+        struct {
+            ShogiModelHistoryEntry entry; // move and the state after it
+            gboolean black_turn; // turn after the move
+            gboolean timed;
+            gint64 remaining[2]; // main time left after the clock was pressed, us, [0] white [1] black
+        } move;
+        struct {
+            gint32 mode; // enum SHOGI_MODEL_MODE of the result
+        } end;
+    } data;
+} ShogiJournalRecord;
+
+typedef struct _shogi_journal {
+    int fd; // replaced by the writer thread together with the file
+    char *path;
+    gint64 interval; // us
+    GThread *writer;
+    GMutex lock; // protects fields below
+    GCond wake;
+    GByteArray *pending; // records waiting for commit
+    GByteArray *spare; // buffer swapped with pending on commit
+    gint64 first_pending; // monotonic time the oldest pending record was queued
+    gboolean replace; // pending records replace the journal instead of being appended to it
+    gboolean quit;
+} ShogiJournal;
+
+/**
+ * Opens journal for appending and starts it's writer thread. Commit interval is read from SHOGI_JOURNAL_SYNC
+ * @param path journal file
+ * @return new journal or NULL if file can't be opened
+ */
+ShogiJournal *shogi_journal_open(const char *path);
+
+/**
+ * Commits pending records, stops the writer thread and closes the journal
+ * @param journal journal to close, can be NULL
+ */
+void shogi_journal_close(ShogiJournal *journal);
+
+/**
+ * Queues record for the next group commit, fills in it's CRC
+ * @param journal journal, can be NULL
+ * @param record record to append, it's crc is overwritten
+ */
+void shogi_journal_append(ShogiJournal *journal, ShogiJournalRecord *record);
+
+/**
+ * Drops the journal of the previous game and starts a new one with game start record. The new journal is written to
+ * a temporary file renamed over the old one, so a crash before it's committed leaves the previous game on disk
+ * @param journal journal, can be NULL
+ */
+void shogi_journal_restart(ShogiJournal *journal);
+
+/**
+ * Continues the journal of a game resumed from it: cuts the torn or corrupted records after the intact ones, so new
+ * records follow them. Call before anything is appended
+ * @param journal journal, can be NULL
+ * @param records number of intact records, as read by shogi_journal_read()
+ */
+void shogi_journal_resume(ShogiJournal *journal, guint records);
+
+/**
+ * Reads records of the last game from journal, stopping at the first one that is torn or fails CRC check
+ * @param path journal file
+ * @return array of ShogiJournalRecord, empty if there's no journal
+ */
+GArray *shogi_journal_read(const char *path);
+
+#endif //SHOGI_JOURNAL_H
@@ -5,11 +5,52 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <string.h>
 #include <time.h>
+#include <glib.h>
 #include "Logger.h"
+#include "Counters.h"
+
+// Producers copy records into a bounded multi-producer queue (slots with sequence numbers, as described by
+// D. Vyukov), a single writer thread formats their prefixes and writes them in batches. Sequence of a slot says
+// whose turn it is: equal to the write position - free for the producer, position + 1 - filled for the writer.
+// Writer with nothing to write sleeps on a condition for SHOGI_LOGGER_DRAIN_INTERVAL, so records are written in
+// batches without producers touching the lock. Producers wake it early only when the queue fills up to
+// SHOGI_LOGGER_WAKE_MARK, or when somebody flushes - errors flush right after logging. Writer sets sleeping before
+// checking the queue and producers publish before checking sleeping, so a wake up isn't lost while writer falls
+// asleep. Flushing thread waits on another condition, which writer broadcasts after each write while somebody
+// flushes, until everything logged before the flush is written.
+
+enum SHOGI_LOGGER_STATE {
+    SHOGI_LOGGER_STATE_CLOSED,
+    SHOGI_LOGGER_STATE_STARTING,
+    SHOGI_LOGGER_STATE_RUNNING
+};
+
+typedef struct _shogi_logger_record {
+    gint sequence;
+    enum SHOGI_LOGGER_LOG_LEVEL level;
+    gint64 time; // real time in microseconds
+    gboolean is_event; // record carries event instead of message
+    ShogiLoggerEvent event;
+    char message[SHOGI_LOGGER_MESSAGE_LENGTH];
+} ShogiLoggerRecord;
 
 FILE *log_file;
-bool initialized = false;
+static FILE *events_file; // NULL if events are disabled or file couldn't be opened
+static gint state = SHOGI_LOGGER_STATE_CLOSED;
+static gint stopping; // tells writer to drain the queue and exit
+static GThread *writer;
+static ShogiLoggerRecord records[SHOGI_LOGGER_QUEUE_SIZE];
+static gint write_position; // next slot claimed by producers
+static gint read_position; // next slot read by writer, written only by writer
+static gint written_position; // records before it are written to the file, written only by writer
+static gint dropped; // records dropped because the queue was full
+static gint sleeping; // writer is blocked on wakeup, or about to be
+static gint flushing; // threads waiting in shogi_logger_flush
+static GMutex wakeup_lock;
+static GCond wakeup;
+static GCond flushed; // broadcast by writer after writing records while somebody flushes
 static char *log_level_strings[] = {
         "FATAL",
         "ERROR",
@@ -18,47 +59,281 @@ static char *log_level_strings[] = {
         "DEBUG"
 };
 
+/// true if the next record is published and can be written
+static gboolean writer_ready() {
+    guint position = (guint) read_position;
+    ShogiLoggerRecord *record = &records[position & (SHOGI_LOGGER_QUEUE_SIZE - 1)];
+    return (guint) g_atomic_int_get(&record->sequence) == position + 1;
+}
+
+/// number of records claimed by producers and not read by writer yet
+static gint queued() {
+    return (gint) ((guint) g_atomic_int_get(&write_position) - (guint) g_atomic_int_get(&read_position));
+}
 
-int shogi_logger_init() {
+/// true if writer shouldn't wait for the drain interval
+static gboolean writer_urgent() {
+    return g_atomic_int_get(&stopping) || queued() >= SHOGI_LOGGER_WAKE_MARK ||
+           (g_atomic_int_get(&flushing) && writer_ready());
+}
+
+/// blocks writer for the drain interval, until it's woken up or logger is stopping
+static void writer_sleep() {
+    gint64 deadline = g_get_monotonic_time() + SHOGI_LOGGER_DRAIN_INTERVAL * 1000;
+    g_mutex_lock(&wakeup_lock);
+    g_atomic_int_set(&sleeping, 1);
+    while (g_atomic_int_get(&sleeping) && !writer_urgent() && g_cond_wait_until(&wakeup, &wakeup_lock, deadline));
+    g_atomic_int_set(&sleeping, 0);
+    g_mutex_unlock(&wakeup_lock);
+}
+
+/// tells flushing threads how far the file is written
+static void writer_written() {
+    g_atomic_int_set(&written_position, g_atomic_int_get(&read_position));
+    if (!g_atomic_int_get(&flushing))
+        return;
+    g_mutex_lock(&wakeup_lock);
+    g_cond_broadcast(&flushed);
+    g_mutex_unlock(&wakeup_lock);
+}
+
+/// wakes writer if it sleeps
+static void writer_wake() {
+    if (!g_atomic_int_get(&sleeping)) // fast path, writer is busy and will see the record
+        return;
+    g_mutex_lock(&wakeup_lock);
+    g_atomic_int_set(&sleeping, 0);
+    g_cond_signal(&wakeup);
+    g_mutex_unlock(&wakeup_lock);
+}
+
+/// wakes writer after publishing a record if the queue fills up or somebody waits for the record to be written
+static void writer_published() {
+    if (queued() >= SHOGI_LOGGER_WAKE_MARK || g_atomic_int_get(&flushing))
+        writer_wake();
+}
+
+/// formats records from the queue into buffer and writes it at once, returns number of written records
+static int writer_drain(char *buffer, gsize size, ShogiLoggerEvent *events) {
+    gsize length = 0;
+    int events_count = 0;
+    int count = 0;
+    while (TRUE) {
+        guint position = (guint) read_position;
+        ShogiLoggerRecord *record = &records[position & (SHOGI_LOGGER_QUEUE_SIZE - 1)];
+        if ((guint) g_atomic_int_get(&record->sequence) != position + 1)
+            break; // empty, or producer didn't finish copying yet
+
+        if (record->is_event) {
+            events[events_count++] = record->event; // at most queue size events in one drain
+            g_atomic_int_set(&record->sequence, (gint) (position + SHOGI_LOGGER_QUEUE_SIZE));
+            g_atomic_int_set(&read_position, (gint) (position + 1));
+            count++;
+            if (events_count == SHOGI_LOGGER_QUEUE_SIZE)
+                break;
+            continue;
+        }
+        if (length + SHOGI_LOGGER_MESSAGE_LENGTH + 64 > size) {
+            fwrite(buffer, 1, length, log_file);
+            shogi_counters_add(SHOGI_COUNTER_LOG_BATCHES, 1);
+            shogi_counters_add(SHOGI_COUNTER_LOG_BYTES, length);
+            length = 0;
+        }
+        char date[20];
+        struct tm tm;
+        time_t seconds = (time_t) (record->time / G_USEC_PER_SEC);
+        gmtime_r(&seconds, &tm);
+        strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &tm);
+        length += snprintf(buffer + length, size - length, "[%s] [%s] : %s\n", date, log_level_strings[record->level],
+                           record->message);
+
+        g_atomic_int_set(&record->sequence, (gint) (position + SHOGI_LOGGER_QUEUE_SIZE)); // slot free for next lap
+        g_atomic_int_set(&read_position, (gint) (position + 1));
+        count++;
+    }
+
+    int lost = g_atomic_int_get(&dropped);
+    if (lost > 0) {
+        g_atomic_int_add(&dropped, -lost);
+        shogi_counters_add(SHOGI_COUNTER_LOG_DROPPED, (guint64) lost);
+        length += snprintf(buffer + length, size - length, "[logger] [WARN ] : %d messages dropped, queue was full\n",
+                           lost);
+    }
+    if (length > 0) {
+        fwrite(buffer, 1, length, log_file);
+        fflush(log_file);
+        shogi_counters_add(SHOGI_COUNTER_LOG_BATCHES, 1);
+        shogi_counters_add(SHOGI_COUNTER_LOG_BYTES, length);
+    }
+    if (events_count > 0 && events_file) {
+        fwrite(events, sizeof(ShogiLoggerEvent), (size_t) events_count, events_file);
+        fflush(events_file);
+        shogi_counters_add(SHOGI_COUNTER_LOG_BATCHES, 1);
+        shogi_counters_add(SHOGI_COUNTER_LOG_BYTES, events_count * sizeof(ShogiLoggerEvent));
+    }
+    return count;
+}
+
+static gpointer writer_thread(G_GNUC_UNUSED gpointer data) {
+    char *buffer = g_malloc(SHOGI_LOGGER_QUEUE_SIZE * 64);
+    ShogiLoggerEvent *events = g_new(ShogiLoggerEvent, SHOGI_LOGGER_QUEUE_SIZE);
+    while (!g_atomic_int_get(&stopping)) {
+        if (writer_drain(buffer, SHOGI_LOGGER_QUEUE_SIZE * 64, events) == 0)
+            writer_sleep();
+        else
+            writer_written();
+    }
+    while (writer_drain(buffer, SHOGI_LOGGER_QUEUE_SIZE * 64, events) > 0);
+    writer_written();
+    g_free(events);
+    g_free(buffer);
+    return NULL;
+}
+
+static int shogi_logger_init() {
     log_file = fopen("Shogi.log", "a"); // open for appending
     if (log_file == NULL) {
         printf("Cannot open Shogi.log for appending\n");
         return 1;
     }
-    initialized = true;
+    events_file = NULL;
+    if (SHOGI_LOGGER_EVENTS) {
+        FILE *existing = fopen(SHOGI_LOGGER_EVENTS_PATH, "rb");
+        if (existing != NULL) { // events of another size can't be appended, keep the old log next to the new one
+            ShogiLoggerEventsHeader header;
+            gboolean compatible = fread(&header, sizeof(header), 1, existing) == 1 &&
+                                  memcmp(header.magic, SHOGI_LOGGER_EVENTS_MAGIC, sizeof(header.magic)) == 0 &&
+                                  header.event_size == sizeof(ShogiLoggerEvent);
+            fclose(existing);
+            if (!compatible)
+                rename(SHOGI_LOGGER_EVENTS_PATH, SHOGI_LOGGER_EVENTS_PATH ".old");
+        }
+        events_file = fopen(SHOGI_LOGGER_EVENTS_PATH, "ab");
+        if (events_file == NULL) {
+            fprintf(log_file, "Cannot open %s for appending, events won't be logged\n", SHOGI_LOGGER_EVENTS_PATH);
+        } else if (ftell(events_file) == 0) { // new file
+            ShogiLoggerEventsHeader header = {.event_size = sizeof(ShogiLoggerEvent)};
+            memcpy(header.magic, SHOGI_LOGGER_EVENTS_MAGIC, sizeof(header.magic));
+            fwrite(&header, sizeof(header), 1, events_file);
+        }
+    }
+    for (int i = 0; i < SHOGI_LOGGER_QUEUE_SIZE; ++i)
+        records[i].sequence = i;
+    write_position = read_position = written_position = dropped = stopping = sleeping = flushing = 0;
+    writer = g_thread_new("shogi-logger", writer_thread, NULL);
     return 0;
 }
 
+/// starts logger on first use, other threads wait until it's running
+static void ensure_running() {
+    while (g_atomic_int_get(&state) != SHOGI_LOGGER_STATE_RUNNING) {
+        if (g_atomic_int_compare_and_exchange(&state, SHOGI_LOGGER_STATE_CLOSED, SHOGI_LOGGER_STATE_STARTING)) {
+            if (shogi_logger_init() != 0) // if cannot initialize logger, abort app
+                abort();
+            g_atomic_int_set(&state, SHOGI_LOGGER_STATE_RUNNING);
+        } else {
+            g_thread_yield();
+        }
+    }
+}
+
+/// claims a free slot, returns NULL if queue is full
+static ShogiLoggerRecord *claim_record() {
+    guint position = (guint) g_atomic_int_get(&write_position);
+    while (TRUE) {
+        ShogiLoggerRecord *record = &records[position & (SHOGI_LOGGER_QUEUE_SIZE - 1)];
+        gint difference = (gint) ((guint) g_atomic_int_get(&record->sequence) - position);
+        if (difference == 0) {
+            if (g_atomic_int_compare_and_exchange(&write_position, (gint) position, (gint) (position + 1)))
+                return record;
+        } else if (difference < 0) {
+            return NULL; // slot still holds record from previous lap
+        }
+        position = (guint) g_atomic_int_get(&write_position);
+    }
+}
+
 void shogi_logger_log(enum SHOGI_LOGGER_LOG_LEVEL level, const char *fmt, ...) {
     if (level > SHOGI_LOGGER_MAX_LOG_LEVEL)
         return;
+    ensure_running();
 
-    if (!initialized)
-        if (shogi_logger_init() != 0) // if cannot initialize logger, abort app
-            abort();
-
-    char prefix[32];
-    char date[20];
-    struct tm *sTm;
-    time_t now = time(0);
-    sTm = gmtime(&now);
-    strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", sTm);
-    sprintf(prefix, "[%s] [%s]", date, log_level_strings[level]);
+    ShogiLoggerRecord *record = claim_record();
+    while (record == NULL) {
+        if (level > SHOGI_LOGGER_LOG_LEVEL_WARN) { // less important messages are dropped instead of waiting
+            g_atomic_int_inc(&dropped);
+            return;
+        }
+        g_thread_yield();
+        record = claim_record();
+    }
 
+    shogi_counters_add(SHOGI_COUNTER_LOG_MESSAGES, 1);
+    record->is_event = FALSE;
+    record->level = level;
+    record->time = g_get_real_time();
     va_list args;
     va_start(args, fmt);
+    vsnprintf(record->message, SHOGI_LOGGER_MESSAGE_LENGTH, fmt, args);
+    va_end(args);
+    guint position = (guint) (record->sequence);
+    g_atomic_int_set(&record->sequence, (gint) (position + 1)); // publish to writer
+    writer_published();
 
-    fprintf(log_file, "%s : ", prefix);
-    vfprintf(log_file, fmt, args);
-    fprintf(log_file, "\n");
+    if (level <= SHOGI_LOGGER_LOG_LEVEL_ERROR) // app may abort right after an error, make sure it's on disk
+        shogi_logger_flush();
+}
 
-    va_end(args);
+void shogi_logger_event(ShogiLoggerEvent *event) {
+    if (!SHOGI_LOGGER_EVENTS)
+        return;
+    event->time = shogi_logger_time_ns();
+    ensure_running();
 
-    fflush(log_file);
+    ShogiLoggerRecord *record;
+    while ((record = claim_record()) == NULL)
+        g_thread_yield();
+    shogi_counters_add(SHOGI_COUNTER_LOG_EVENTS, 1);
+    record->is_event = TRUE;
+    record->event = *event;
+    guint position = (guint) (record->sequence);
+    g_atomic_int_set(&record->sequence, (gint) (position + 1));
+    writer_published();
 }
 
-int shogi_logger_close() {
-    return fclose(log_file);
+guint64 shogi_logger_time_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (guint64) now.tv_sec * 1000000000u + (guint64) now.tv_nsec;
 }
 
+void shogi_logger_flush() {
+    if (g_atomic_int_get(&state) != SHOGI_LOGGER_STATE_RUNNING)
+        return;
+    gint target = g_atomic_int_get(&write_position);
+    g_mutex_lock(&wakeup_lock);
+    g_atomic_int_inc(&flushing);
+    g_atomic_int_set(&sleeping, 0);
+    g_cond_signal(&wakeup);
+    while ((gint) ((guint) g_atomic_int_get(&written_position) - (guint) target) < 0)
+        g_cond_wait(&flushed, &wakeup_lock);
+    g_atomic_int_add(&flushing, -1);
+    g_mutex_unlock(&wakeup_lock);
+}
 
+int shogi_logger_close() {
+    if (!g_atomic_int_compare_and_exchange(&state, SHOGI_LOGGER_STATE_RUNNING, SHOGI_LOGGER_STATE_STARTING))
+        return 0;
+    g_atomic_int_set(&stopping, 1);
+    g_mutex_lock(&wakeup_lock);
+    g_cond_signal(&wakeup);
+    g_mutex_unlock(&wakeup_lock);
+    g_thread_join(writer);
+    writer = NULL;
+    if (events_file)
+        fclose(events_file);
+    events_file = NULL;
+    int result = fclose(log_file);
+    g_atomic_int_set(&state, SHOGI_LOGGER_STATE_CLOSED);
+    return result;
+}
@@ -7,8 +7,16 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <glib.h>
 
 #define SHOGI_LOGGER_MAX_LOG_LEVEL SHOGI_LOGGER_LOG_LEVEL_INFO
+#define SHOGI_LOGGER_QUEUE_SIZE 1024 // records waiting for the writer thread, power of 2
+#define SHOGI_LOGGER_WAKE_MARK (SHOGI_LOGGER_QUEUE_SIZE / 2) // queued records that wake the writer before its interval
+#define SHOGI_LOGGER_DRAIN_INTERVAL 20 // milliseconds between drains of the writer thread when nobody wakes it
+#define SHOGI_LOGGER_MESSAGE_LENGTH 256 // longer messages are truncated
+#define SHOGI_LOGGER_EVENTS 1 // 0 disables binary event log
+#define SHOGI_LOGGER_EVENTS_PATH "Shogi.events"
+#define SHOGI_LOGGER_EVENTS_MAGIC "SHOGIEV2" // log of another version is moved aside to SHOGI_LOGGER_EVENTS_PATH.old
 
 enum SHOGI_LOGGER_LOG_LEVEL{
     SHOGI_LOGGER_LOG_LEVEL_FATAL,
@@ -18,10 +26,51 @@ enum SHOGI_LOGGER_LOG_LEVEL{
     SHOGI_LOGGER_LOG_LEVEL_DEBUG
 };
 
-static int shogi_logger_init();
+/// type of event in binary event log, meaning of event's data is given for each type
+enum SHOGI_LOGGER_EVENT {
+    SHOGI_LOGGER_EVENT_GAME_START, // new game id, no data
+    SHOGI_LOGGER_EVENT_MOVE, // text - move in history notation, not null terminated if 8 characters long
+    SHOGI_LOGGER_EVENT_HITMAP, // value[0] - square as col * 10 + row or -1 for drop, value[1] - time taken in ns
+    SHOGI_LOGGER_EVENT_GAME_END, // value[0] - SHOGI_MODEL_MODE of the winner, value[1] - SHOGI_LOGGER_GAME_END_*
+    SHOGI_LOGGER_EVENT_SAVE, // value[0] - 1 on success, value[1] - moves in history
+    SHOGI_LOGGER_EVENT_LOAD, // value[0] - 1 on success, value[1] - moves in history
+    SHOGI_LOGGER_EVENT_TIMER_SET, // value[0] - initial time of both players in ms
+    SHOGI_LOGGER_EVENT_TIMER_EXPIRED, // value[0] - 1 if black's timer expired
+    SHOGI_LOGGER_EVENT_COUNT
+};
+
+/// reason of game end
+enum SHOGI_LOGGER_GAME_END {
+    SHOGI_LOGGER_GAME_END_KING_CAPTURED,
+    SHOGI_LOGGER_GAME_END_TIMEOUT,
+    SHOGI_LOGGER_GAME_END_RESIGNATION
+};
+
+/// fixed size record of binary event log. Event log file starts with ShogiLoggerEventsHeader
+typedef struct _shogi_logger_event {
+    guint64 time; // monotonic time in nanoseconds, set by the logger
+    guint64 game; // id of the game, unique across runs of the app
+    guint16 type; // SHOGI_LOGGER_EVENT
+    guint16 ply; // moves made in the game
+    guint32 reserved;
+    union {
+        gint32 value[2];
+        char text[8];
+    } data;
+} ShogiLoggerEvent;
+
+typedef struct _shogi_logger_events_header {
+    char magic[8];
+    guint32 event_size; // sizeof(ShogiLoggerEvent)
+    guint32 reserved;
+} ShogiLoggerEventsHeader;
 
 /**
  * Writes message with format ant arguments to log file with given level.
+ * Message is queued and written by background thread within SHOGI_LOGGER_DRAIN_INTERVAL, so the call doesn't touch
+ * the file. If the queue is full, info and debug messages are dropped and counted, more important ones wait for free
+ * space.
+ * Errors and fatal errors are flushed before returning.
  * Time is set accordingly to as UTC+00:00
  * @param level logging level
  * @param fmt format as in printf
@@ -30,7 +79,24 @@ static int shogi_logger_init();
 void shogi_logger_log(enum SHOGI_LOGGER_LOG_LEVEL level, const char *fmt, ...);
 
 /**
- * Closes file
+ * Queues event for binary event log. Events are never dropped, if the queue is full the call waits
+ * @param event event to write, it's time is set by the logger
+ */
+void shogi_logger_event(ShogiLoggerEvent *event);
+
+/**
+ * Returns monotonic time used for event timestamps
+ * @return time in nanoseconds
+ */
+guint64 shogi_logger_time_ns();
+
+/**
+ * Waits until all messages logged so far are written to the file. Writer is woken to write them right away.
+ */
+void shogi_logger_flush();
+
+/**
+ * Writes queued messages and events, stops background thread and closes files
  * @warning Should be run once at the end of programs life
  * @return same as return of fclose()
  */
@@ -5,9 +5,14 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 #include "Model.h"
 #include "Logger.h"
+#include "Book.h"
+#include "Trace.h"
+#include "Counters.h"
+#include "Journal.h"
 
 enum SHOGI_MODEL_MODE mode = NONE;
 enum SHOGI_PAWN_DETAILED selected_pawn = SHOGI_PAWN_DETAILED_NONE;
@@ -21,6 +26,12 @@ gboolean previous_captured = false;
 
 static gboolean is_black_turn = TRUE;
 static ShogiModel *model;
+static ShogiBook *book; // NULL if there is no opening book
+static guint64 game_id; // identifies game in event log, new for each reset
+static ShogiClock game_clock; // runs only in timed mode
+static GArray *history_list = NULL; // copy of history file in memory, read without touching the file
+static guint32 history_id = 0; // bumped whenever history is cleared
+static ShogiJournal *journal; // NULL if journal couldn't be opened and while a game is recovered from it
 // @formatter:off
 // available moves pattern, overwritten in calculating hitmap
 static char **available_moves;
@@ -115,23 +126,129 @@ static char pawn_base_character[SHOGI_PAWN_COUNT] = {'K', 'G', 'S', 'N', 'L', 'B
 #define SHOGI_MODEL_OTHER_OCCUPIES(board, col_ix, row_ix, for_black) (((for_black) && SHOGI_PAWN_IS_WHITE(board [row_ix][col_ix])) || \
                                             (!(for_black) && SHOGI_PAWN_IS_BLACK(board [row_ix][col_ix])))
 /// checks if place on board is free
-#define SHOGI_MODEL_IS_FREE(board, col_ix, row_ix) (board[row_ix][col_ix] == SHOGI_PAWN_NONE)
+#define SHOGI_MODEL_IS_FREE(board, col_ix, row_ix) (board[row_ix][col_ix] == SHOGI_PAWN_DETAILED_NONE)
+
+/**
+ * Changes current player and journals the move
+ * @param entry history entry of the move just made, NULL if it wasn't appended to history
+ */
+inline static void change_player(const ShogiModelHistoryEntry *entry);
+
+/**
+ * Returns true if a piece may possibly move, so if pawn is in the last row it cannot etc.
+ * @param col col of pawn
+ * @param row row of pawn
+ * @param pawn pawn
+ * @return
+ */
+inline static gboolean pawn_can_possibly_move(int row, enum SHOGI_PAWN_DETAILED pawn); // DONE
+
+/**
+ * Checks if movement from can promote if moved from colA rowA to colB rowB
+ * @param colA begin column
+ * @param rowA begin row
+ * @param colB end column
+ * @param rowB end row
+ * @return true if pawn can promote
+ */
+inline static gboolean pawn_can_promote(int colA, int rowA, int colB, int rowB); // DONE
 
-/// deallocates memory for 9x9 matrix
-#define SHOGI_MODEL_FREE_MATRIX(matrix) do { for (int i = 0; i < 9; ++i) free(matrix[i]); free(matrix); }while(0)
+//----------------------------------------------------------------------------------------------------------------------
 
-/// Following macros are used during serialization and hashing
-/// macros translating pawn to and from codes
-#define SHOGI_MODEL_TO_PAWN_CODE(pawn_detailed) ((pawn_detailed) == SHOGI_PAWN_DETAILED_NONE ? (char) 32 : (char) (33 + (pawn_detailed)))
-#define SHOGI_MODEL_FROM_PAWN_CODE(pawn_code) ((pawn_code) == 32 ? SHOGI_PAWN_DETAILED_NONE : (enum SHOGI_PAWN_DETAILED) ((pawn_code) - 33))
-/// translates numbers int char codes
-#define SHOGI_MODEL_TO_COUNT_CODE(count) ((char)((count)+32));
-#define SHOGI_MODEL_FROM_COUNT_CODE(count_code) ((int)((count_code)-32));
+/// journals move of given ply with the turn and the clock after it
+static void journal_move(const ShogiModelHistoryEntry *entry, int ply, gboolean black_turn) {
+    ShogiJournalRecord record;
+    memset(&record, 0, sizeof(record));
+    record.type = SHOGI_JOURNAL_RECORD_MOVE;
+    record.ply = (guint16) ply;
+    record.data.move.entry = *entry;
+    record.data.move.black_turn = black_turn;
+    record.data.move.timed = model->TIMED_MODE;
+    gint64 now = shogi_clock_now();
+    record.data.move.remaining[0] = shogi_clock_main_left(&game_clock, SHOGI_CLOCK_WHITE, now);
+    record.data.move.remaining[1] = shogi_clock_main_left(&game_clock, SHOGI_CLOCK_BLACK, now);
+    shogi_journal_append(journal, &record);
+}
 
-//----------------------------------------------------------------------------------------------------------------------
+static void journal_clock(guint32 initial_time, guint32 byoyomi, guint32 increment) {
+    ShogiJournalRecord record;
+    memset(&record, 0, sizeof(record));
+    record.type = SHOGI_JOURNAL_RECORD_CLOCK;
+    record.ply = (guint16) model->history_entries;
+    record.data.clock.initial_time = initial_time;
+    record.data.clock.byoyomi = byoyomi;
+    record.data.clock.increment = increment;
+    shogi_journal_append(journal, &record);
+}
+
+/// opens the first opening book found: SHOGI_MODEL_BOOK_ENV, user data directory, system data directories. The book
+/// is built by the player from game records and mapped into memory, so it's a file and not a compiled-in resource
+static ShogiBook *open_book() {
+    const char *override = g_getenv(SHOGI_MODEL_BOOK_ENV);
+    if (override && *override)
+        return shogi_book_open(override);
+    char *path = g_build_filename(g_get_user_data_dir(), SHOGI_MODEL_BOOK_NAME, NULL);
+    ShogiBook *found = shogi_book_open(path);
+    g_free(path);
+    for (const gchar *const *dir = g_get_system_data_dirs(); found == NULL && *dir; ++dir) {
+        path = g_build_filename(*dir, SHOGI_MODEL_BOOK_NAME, NULL);
+        found = shogi_book_open(path);
+        g_free(path);
+    }
+    return found;
+}
+
+/// resumes unfinished game from records of the journal, right after reset, returns false if there's nothing to resume
+static gboolean journal_recover(GArray *records) {
+    const ShogiJournalRecord *clock = NULL, *last_move = NULL;
+    int moves = 0;
+    for (guint i = 0; i < records->len; ++i) {
+        const ShogiJournalRecord *record = &g_array_index(records, ShogiJournalRecord, i);
+        if (record->type == SHOGI_JOURNAL_RECORD_GAME_END)
+            return FALSE;
+        if (record->type == SHOGI_JOURNAL_RECORD_CLOCK)
+            clock = record;
+        if (record->type == SHOGI_JOURNAL_RECORD_MOVE && record->ply == moves) {
+            last_move = record;
+            moves++;
+        }
+    }
+    if (last_move == NULL) { // game didn't start, only it's clock can be restored
+        if (clock)
+            shogi_model_timer_set(clock->data.clock.initial_time, clock->data.clock.byoyomi,
+                                  clock->data.clock.increment);
+        return clock != NULL;
+    }
+
+    ShogiModelSave save;
+    memcpy(save.state, last_move->data.move.entry.state, SHOGI_MODEL_SERIALIZED_STATE_LENGTH);
+    save.black_turn = last_move->data.move.black_turn;
+    save.timed = last_move->data.move.timed;
+    save.timer[0] = last_move->data.move.remaining[0] / 1000;
+    save.timer[1] = last_move->data.move.remaining[1] / 1000;
+    save.byoyomi = clock ? clock->data.clock.byoyomi : 0;
+    save.increment = clock ? clock->data.clock.increment : 0;
+    save.history_entries = moves;
+    save.history = g_new(ShogiModelHistoryEntry, moves);
+    for (guint i = 0, ply = 0; i < records->len && ply < (guint) moves; ++i) {
+        const ShogiJournalRecord *record = &g_array_index(records, ShogiJournalRecord, i);
+        if (record->type == SHOGI_JOURNAL_RECORD_MOVE && record->ply == ply)
+            save.history[ply++] = record->data.move.entry;
+    }
+    shogi_model_save_restore(&save);
+    g_free(save.history);
+
+    if (model->TIMED_MODE) { // in us, more precise than in the save
+        game_clock.remaining[SHOGI_CLOCK_WHITE] = last_move->data.move.remaining[0];
+        game_clock.remaining[SHOGI_CLOCK_BLACK] = last_move->data.move.remaining[1];
+    }
+    shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_INFO, "Resumed unfinished game from journal after %d moves.", moves);
+    return TRUE;
+}
 
 
 ShogiModel *shogi_model_init() {
+    SHOGI_TRACE_FUNCTION();
     shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_DEBUG, "Creating new model...");
     model = malloc(sizeof(ShogiModel));
     if (model == NULL)
@@ -171,7 +288,17 @@ ShogiModel *shogi_model_init() {
 
     model->history = NULL;
 
+    GArray *journal_records = shogi_journal_read(SHOGI_JOURNAL_PATH);
+    // journal is set only after recovery, so the game isn't journaled again while it's restored from it's own records
+    ShogiJournal *opened = shogi_journal_open(SHOGI_JOURNAL_PATH);
     shogi_model_reset();
+    if (journal_recover(journal_records))
+        shogi_journal_resume(opened, journal_records->len); // new moves are appended to the recovered ones
+    else
+        shogi_journal_restart(opened);
+    journal = opened;
+    g_array_free(journal_records, TRUE);
+    book = open_book();
 
     shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_DEBUG, "New model created.");
 
@@ -179,8 +306,14 @@ ShogiModel *shogi_model_init() {
 }
 
 void shogi_model_close() {
+    shogi_journal_close(journal); // kept on disk, so unfinished game is resumed on the next start
+    journal = NULL;
     fclose(model->history);
     remove(".shogi_history.bin");
+    g_array_free(history_list, TRUE);
+    history_list = NULL;
+    shogi_book_close(book);
+    book = NULL;
 }
 
 gboolean shogi_model_is_black_turn() {
@@ -204,10 +337,37 @@ int *shogi_model_get_hand(gboolean is_white) {
 }
 
 gint64 shogi_model_timer_get_time(gboolean is_white) {
-    return model->timer[is_white ? 0 : 1];
+    if (!model->TIMED_MODE) return model->timer[is_white ? 0 : 1];
+    return shogi_clock_time_left(&game_clock, is_white ? SHOGI_CLOCK_WHITE : SHOGI_CLOCK_BLACK,
+                                 shogi_clock_now()) / 1000;
+}
+
+const ShogiClock *shogi_model_get_clock() {
+    return &game_clock;
+}
+
+void shogi_model_log_event(enum SHOGI_LOGGER_EVENT type, gint32 value0, gint32 value1) {
+    ShogiLoggerEvent event = {.game = game_id, .type = (guint16) type, .ply = (guint16) model->history_entries};
+    event.data.value[0] = value0;
+    event.data.value[1] = value1;
+    shogi_logger_event(&event);
+
+    if (type == SHOGI_LOGGER_EVENT_GAME_END) { // finished game isn't resumed
+        ShogiJournalRecord record;
+        memset(&record, 0, sizeof(record));
+        record.type = SHOGI_JOURNAL_RECORD_GAME_END;
+        record.ply = (guint16) model->history_entries;
+        record.data.end.mode = value0;
+        shogi_journal_append(journal, &record);
+    }
+}
+
+gboolean shogi_model_is_timed() {
+    return model->TIMED_MODE;
 }
 
 gboolean shogi_model_is_check(enum SHOGI_PAWN_DETAILED **board, gboolean check_for_black) {
+    shogi_counters_add(SHOGI_COUNTER_IS_CHECK, 1);
     char **hitmap = shogi_model_hitmap_new();
     shogi_model_hitmap_calc_all(hitmap, board, check_for_black);
 
@@ -233,6 +393,7 @@ gboolean shogi_model_is_check(enum SHOGI_PAWN_DETAILED **board, gboolean check_f
 
 
 gboolean shogi_model_click(int col, int row) {
+    SHOGI_TRACE_FUNCTION();
     shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_DEBUG, "Executed shogi_model_click(%d, %d)", col, row);
     if (col < 1 || col > 9 || row < 1 || row > 9) {
         return FALSE;
@@ -241,8 +402,12 @@ gboolean shogi_model_click(int col, int row) {
 
     if (mode == NONE) { /// player selected a piece on board
         if (SHOGI_MODEL_MINE_OCCUPIES(model->board, COL(col), ROW(row), is_black_turn)) { // if mine, select for move
+            guint64 start = shogi_logger_time_ns();
             available_moves = shogi_model_hitmap_calc(available_moves, model->board, col,
                                                       row); // calculate available moves map
+            guint64 duration = shogi_logger_time_ns() - start;
+            shogi_counters_record(SHOGI_HISTOGRAM_HITMAP, duration);
+            shogi_model_log_event(SHOGI_LOGGER_EVENT_HITMAP, col * 10 + row, (gint32) MIN(duration, G_MAXINT));
             selected_col = col;
             selected_row = row;
             selected_pawn = IDX(model->board, col, row);
@@ -257,12 +422,13 @@ gboolean shogi_model_click(int col, int row) {
             assert(IDX(model->board, col, row) == SHOGI_PAWN_DETAILED_NONE); // assert against drop on pawns
             IDX(model->board, col, row) = selected_pawn; // override current pos
             model->hand[is_black_turn ? 1 : 0][selected_pawn / 2]--; // upd hand
-            char *move = parse_move(selected_pawn, -1, -1, 2, col, row, 0);
+            char *move = shogi_model_parse_move(selected_pawn, -1, -1, 2, col, row, 0);
             char *state = shogi_model_serialize_state();
-            append_history(move, hash_string(state), state);
+            const ShogiModelHistoryEntry *entry = shogi_model_append_history(move, shogi_model_hash_string(state),
+                                                                             state);
             free(move);
             free(state);
-            change_player(); // nothing happens next, change player
+            change_player(entry); // nothing happens next, change player
             return TRUE;
         }
         shogi_model_hitmap_clear(available_moves); // clear for renderer on improper placement. move to initial state
@@ -281,13 +447,15 @@ gboolean shogi_model_click(int col, int row) {
 
                 if (SHOGI_PAWN_TO_BASE_TYPE(captured) == SHOGI_PAWN_K) { // win on king capture
                     mode = is_black_turn ? BLACK_WIN : WHITE_WIN;
+                    shogi_clock_stop(&game_clock, shogi_clock_now());
                     IDX(model->board, col, row) = selected_pawn;
                     IDX(model->board, selected_col, selected_row) = SHOGI_PAWN_DETAILED_NONE;
-                    char *move = parse_move(selected_pawn, selected_col, selected_row, 1, col, row, 0);
+                    char *move = shogi_model_parse_move(selected_pawn, selected_col, selected_row, 1, col, row, 0);
                     char *state = shogi_model_serialize_state();
-                    append_history(move, hash_string(state), state);
+                    shogi_model_append_history(move, shogi_model_hash_string(state), state);
                     free(move);
                     free(state);
+                    shogi_model_log_event(SHOGI_LOGGER_EVENT_GAME_END, mode, SHOGI_LOGGER_GAME_END_KING_CAPTURED);
                     return TRUE; // return true and wait for promote mode
                 }
 
@@ -321,12 +489,14 @@ gboolean shogi_model_click(int col, int row) {
                 return TRUE;
             }
             // simple move without promote and capture
-            char *move = parse_move(selected_pawn, selected_col, selected_row, previous_captured, col, row, 0);
+            char *move = shogi_model_parse_move(selected_pawn, selected_col, selected_row, previous_captured, col, row,
+                                                0);
             char *state = shogi_model_serialize_state();
-            append_history(move, hash_string(state), state);
+            const ShogiModelHistoryEntry *entry = shogi_model_append_history(move, shogi_model_hash_string(state),
+                                                                             state);
             free(move);
             free(state);
-            change_player();
+            change_player(entry);
             return TRUE;
         }
         shogi_model_hitmap_clear(available_moves);
@@ -334,9 +504,11 @@ gboolean shogi_model_click(int col, int row) {
         selected_pawn = SHOGI_PAWN_DETAILED_NONE;
         return TRUE;
     }
+    return FALSE; // board doesn't accept clicks while promoting or after the game ended
 }
 
 gboolean shogi_model_drop_mode(enum SHOGI_PAWN_DETAILED pawn) {
+    SHOGI_TRACE_FUNCTION();
     if (mode == WHITE_WIN || mode == BLACK_WIN) return FALSE;
     // if hand is empty, return
     if (model->hand[is_black_turn ? 1 : 0][pawn / 2] == 0) return FALSE;
@@ -351,6 +523,7 @@ gboolean shogi_model_drop_mode(enum SHOGI_PAWN_DETAILED pawn) {
     }
 
     mode = DROP;
+    guint64 start = shogi_logger_time_ns();
     // fill all without occupied and
     for (int i = 1; i <= 9; ++i) {
         for (int j = 1; j <= 9; ++j) {
@@ -375,32 +548,40 @@ gboolean shogi_model_drop_mode(enum SHOGI_PAWN_DETAILED pawn) {
         shogi_model_exclude_drop_mate(model->board, available_moves, is_black_turn);
     }
     selected_pawn = pawn;
+    guint64 duration = shogi_logger_time_ns() - start;
+    shogi_counters_record(SHOGI_HISTOGRAM_HITMAP, duration);
+    shogi_model_log_event(SHOGI_LOGGER_EVENT_HITMAP, -1, (gint32) MIN(duration, G_MAXINT));
 
     return TRUE;
 }
 
 void shogi_model_promote(gboolean want_promote) {
+    SHOGI_TRACE_FUNCTION();
     mode = NONE;
 
     if (want_promote) {
         assert(SHOGI_PAWN_DETAILED_IS_PROMOTABLE(IDX(model->board, selected_col, selected_row))); // paranoia check
         IDX(model->board, selected_col, selected_row) += SHOGI_PAWN_PRO_OFFSET;
     }
-    char *move = parse_move(selected_pawn,
+    char *move = shogi_model_parse_move(selected_pawn,
                             previous_col, previous_row,
                             previous_captured ? 1 : 0,
                             selected_col, selected_row,
                             want_promote ? 1 : 2);
     char *state = shogi_model_serialize_state();
-    append_history(move, hash_string(state), state);
+    const ShogiModelHistoryEntry *entry = shogi_model_append_history(move, shogi_model_hash_string(state), state);
     free(move);
     free(state);
-    change_player();
+    change_player(entry);
 }
 
 void shogi_model_reset() {
+    SHOGI_TRACE_FUNCTION();
     shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_DEBUG, "Resetting board to initial state.");
     is_black_turn = TRUE;
+    if (game_id == 0) // random start, so ids of different runs don't collide
+        game_id = ((guint64) g_random_int() << 32 | g_random_int()) & G_MAXINT64;
+    game_id++;
     for (int i = 0; i < 9; ++i)
         for (int j = 0; j < 9; ++j)
             model->board[i][j] = SHOGI_PAWN_DETAILED_NONE;
@@ -446,10 +627,14 @@ void shogi_model_reset() {
     shogi_model_hitmap_clear(available_moves);
     selected_col = 0;
     selected_row = 0;
-    shogi_model_timer_set(0);
+    shogi_model_timer_set(0, 0, 0);
 
     // reset history
     model->history_entries = 0;
+    if (history_list == NULL)
+        history_list = g_array_new(FALSE, FALSE, sizeof(ShogiModelHistoryEntry));
+    g_array_set_size(history_list, 0);
+    history_id++;
     if (model->history) {
         fclose(model->history);
         remove(".shogi_history.bin");
@@ -457,7 +642,8 @@ void shogi_model_reset() {
     model->history = fopen(".shogi_history.bin", "wb+");
     if (model->history == NULL)
         shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_WARN, "Unable to open .shogi_history.bin in wb+ mode.");
-
+    shogi_model_log_event(SHOGI_LOGGER_EVENT_GAME_START, 0, 0);
+    shogi_journal_restart(journal);
 }
 
 char **shogi_model_hitmap_new() {
@@ -468,12 +654,13 @@ char **shogi_model_hitmap_new() {
 }
 
 char **shogi_model_hitmap_calc(char **hitmap, enum SHOGI_PAWN_DETAILED **board, int col, int row) {
+    shogi_counters_add(SHOGI_COUNTER_HITMAPS, 1);
 
     // first of all, clear our hitmap;
     shogi_model_hitmap_clear(hitmap);
 
     enum SHOGI_PAWN_DETAILED pawn = IDX(board, col, row); // get pawn at given place on board
-    if (pawn == SHOGI_PAWN_NONE) return hitmap; // if no pawn is at given place, return empty hitmap
+    if (pawn == SHOGI_PAWN_DETAILED_NONE) return hitmap; // if no pawn is at given place, return empty hitmap
 
     gboolean black_turn = SHOGI_PAWN_IS_BLACK(pawn); // which pawn we calculate
 
@@ -584,35 +771,108 @@ void shogi_model_hitmap_clear(char **mask) {
             mask[i][j] = ' ';
 }
 
-void shogi_model_timer_set(guint32 initial_time) {
-    if (initial_time == 0) model->TIMED_MODE = FALSE;
-    else model->TIMED_MODE = TRUE;
+char shogi_model_pattern_at(enum SHOGI_PAWN_DETAILED pawn, int d_row, int d_col) {
+    if (pawn == SHOGI_PAWN_DETAILED_NONE) return ' ';
+
+    if (!SHOGI_PAWN_IS_BLACK(pawn)) { // patterns are written from black's perspective
+        d_row = -d_row;
+        d_col = -d_col;
+    }
+
+    int x_col = -1, x_row = -1;
+    for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 3; ++c)
+            if (pawn_move_pattern[pawn / 2][r][c] == 'x') {
+                x_row = r;
+                x_col = c;
+            }
+
+    int r = x_row + d_row, c = x_col + d_col;
+    if (r < 0 || r >= 3 || c < 0 || c >= 3 || pawn_move_pattern[pawn / 2][r][c] == 'x')
+        return ' ';
+    return pawn_move_pattern[pawn / 2][r][c];
+}
+
+/// copies main time left from the clock to the model
+static void sync_timers(gint64 now) {
+    model->timer[0] = shogi_clock_main_left(&game_clock, SHOGI_CLOCK_WHITE, now) / 1000;
+    model->timer[1] = shogi_clock_main_left(&game_clock, SHOGI_CLOCK_BLACK, now) / 1000;
+}
+
+void shogi_model_timer_set(guint32 initial_time, guint32 byoyomi, guint32 increment) {
+    shogi_clock_init(&game_clock, initial_time, byoyomi, increment);
+    model->TIMED_MODE = shogi_clock_enabled(&game_clock);
     model->timer[0] = model->timer[1] = initial_time;
+    if (model->TIMED_MODE) {
+        shogi_clock_start(&game_clock, is_black_turn ? SHOGI_CLOCK_BLACK : SHOGI_CLOCK_WHITE, shogi_clock_now());
+        shogi_model_log_event(SHOGI_LOGGER_EVENT_TIMER_SET, (gint32) initial_time, 0);
+    }
+    journal_clock(initial_time, byoyomi, increment);
 }
 
-void shogi_model_timer_decrease(clock_t delta) {
-    if (!model->TIMED_MODE || mode == WHITE_WIN || mode == BLACK_WIN) return;
-    model->timer[is_black_turn ? 1 : 0] -= (gint64) delta;
-    if (model->timer[is_black_turn ? 1 : 0] <= 0) {
-        model->timer[is_black_turn ? 1 : 0] = 0;
+gint64 shogi_model_timer_update() {
+    if (!model->TIMED_MODE) return -1;
+    gint64 now = shogi_clock_now();
+    if (mode == WHITE_WIN || mode == BLACK_WIN) { // game ended by other means, clock stopped with it
+        sync_timers(now);
+        return -1;
+    }
+    if (shogi_clock_flagged(&game_clock, now) >= 0) {
+        shogi_clock_stop(&game_clock, now);
+        sync_timers(now);
         mode = is_black_turn ? WHITE_WIN : BLACK_WIN;
+        shogi_model_log_event(SHOGI_LOGGER_EVENT_TIMER_EXPIRED, is_black_turn, 0);
+        shogi_model_log_event(SHOGI_LOGGER_EVENT_GAME_END, mode, SHOGI_LOGGER_GAME_END_TIMEOUT);
         shogi_model_hitmap_clear(available_moves);
         model->TIMED_MODE = FALSE;
+        return -1;
     }
-
+    sync_timers(now);
+    return (shogi_clock_next_change(&game_clock, now) + 999) / 1000;
 }
 
 void shogi_model_resign() {
     mode = is_black_turn ? WHITE_WIN : BLACK_WIN;
+    shogi_clock_stop(&game_clock, shogi_clock_now());
     shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_INFO, "Player resigned");
+    shogi_model_log_event(SHOGI_LOGGER_EVENT_GAME_END, mode, SHOGI_LOGGER_GAME_END_RESIGNATION);
+}
+
+const char *shogi_model_history_move(int ply) {
+    g_return_val_if_fail(history_list != NULL && ply >= 0 && ply < (int) history_list->len, NULL);
+    return g_array_index(history_list, ShogiModelHistoryEntry, ply).move;
+}
+
+guint32 shogi_model_history_id() {
+    return history_id;
+}
+
+int shogi_model_book_moves(char (*moves)[SHOGI_MODEL_MOVE_LENGTH], guint32 *counts, int max) {
+    SHOGI_TRACE_FUNCTION();
+    if (book == NULL) return 0;
+
+    ShogiPosition pos;
+    shogi_position_from_model(&pos, model->board, model->hand, is_black_turn);
+    const ShogiBookEntry *entries;
+    int count = shogi_book_probe(book, pos.key, &entries);
+    int found = 0;
+    for (int i = 0; i < count && found < max; ++i) {
+        if (!shogi_position_is_pseudo_legal(&pos, entries[i].move)) continue; // key collision
+        shogi_position_move_notation(entries[i].move, moves[found]);
+        counts[found++] = entries[i].count;
+    }
+    return found;
 }
 
 
 //----------------------------------------------------------------------------------------------------------------------
 
 
-inline static void change_player() {
+inline static void change_player(const ShogiModelHistoryEntry *entry) {
     is_black_turn = !is_black_turn;
+    shogi_clock_press(&game_clock, shogi_clock_now()); // no-op if the clock is stopped
+    if (entry != NULL) // entry points into history_list, so it's index is the ply
+        journal_move(entry, (int) (entry - (const ShogiModelHistoryEntry *) history_list->data), is_black_turn);
     selected_pawn = SHOGI_PAWN_DETAILED_NONE;
     selected_col = 0;
     selected_row = 0;
@@ -639,7 +899,7 @@ inline static gboolean pawn_can_promote(int colA, int rowA, int colB, int rowB)
     return FALSE;
 }
 
-static void shogi_model_exclude_drop_mate(enum SHOGI_PAWN_DETAILED **board, char **hitmap, gboolean black_drops) {
+void shogi_model_exclude_drop_mate(enum SHOGI_PAWN_DETAILED **board, char **hitmap, gboolean black_drops) {
 
 
     // searching for opposing king
@@ -660,6 +920,7 @@ static void shogi_model_exclude_drop_mate(enum SHOGI_PAWN_DETAILED **board, char
     if ((black_drops && K_row == 9) || (!black_drops && K_row == 1))
         return; // king in last rows => impossible to dropmate
     if (IDX(hitmap, P_col, P_row) != 'o') return; // ahead of king is occupied
+    shogi_counters_add(SHOGI_COUNTER_DROP_MATE, 1);
 
     // making working copy of board
     enum SHOGI_PAWN_DETAILED **board_copy = calloc(9, sizeof(enum SHOGI_PAWN_DETAILED *));
@@ -730,17 +991,18 @@ static void shogi_model_exclude_drop_mate(enum SHOGI_PAWN_DETAILED **board, char
     IDX(hitmap, P_col, P_row) = ' ';
 }
 
-inline static unsigned long hash_string(char *str) {
+HASH shogi_model_hash_string(const char *str) {
     HASH hash = 0;
     int c;
 
-    while (c = *str++)
+    while ((c = *str++))
         hash = c + (hash << 6) + (hash << 16) - hash;
 
     return hash;
 }
 
 char *shogi_model_serialize_state() { // TODO check corrupted files
+    SHOGI_TRACE_FUNCTION();
     char *state = calloc(SHOGI_MODEL_SERIALIZED_STATE_LENGTH, sizeof(char));
     if (state == NULL) {
         shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_ERROR, "Cannot allocate memory for model serialization string.");
@@ -757,6 +1019,7 @@ char *shogi_model_serialize_state() { // TODO check corrupted files
 }
 
 void shogi_model_deserialize_state(const char *state) {
+    SHOGI_TRACE_FUNCTION();
     for (int i = 0; i < 8; ++i) {
         model->hand[0][i] = SHOGI_MODEL_FROM_COUNT_CODE(state[i]);
         model->hand[1][i] = SHOGI_MODEL_FROM_COUNT_CODE(state[8 + i]);
@@ -765,31 +1028,136 @@ void shogi_model_deserialize_state(const char *state) {
         model->board[i / 9][i % 9] = SHOGI_MODEL_FROM_PAWN_CODE(state[16 + i]);
 }
 
-void shogi_model_load_game(FILE *file) {
+// save structure as follows:
+// [state][black_turn][timed][timer[2]][entries][{history}][byoyomi][increment]
+// clock settings come after the history, so saves without them are still read, as games with main time only
+#define SHOGI_MODEL_SAVE_HEADER_LENGTH (SHOGI_MODEL_SERIALIZED_STATE_LENGTH + 2 * sizeof(gboolean) + \
+                                        2 * sizeof(gint64) + sizeof(int))
+#define SHOGI_MODEL_SAVE_CLOCK_LENGTH (2 * sizeof(gint64))
+
+ShogiModelSave *shogi_model_save_new() {
+    ShogiModelSave *save = g_new(ShogiModelSave, 1);
+    char *state = shogi_model_serialize_state();
+    memcpy(save->state, state, SHOGI_MODEL_SERIALIZED_STATE_LENGTH);
+    free(state);
+    save->black_turn = is_black_turn;
+    save->timed = model->TIMED_MODE;
+    gint64 now = shogi_clock_now(); // main time left as of now, read without ending the game on flag fall
+    save->timer[0] = save->timed ? shogi_clock_main_left(&game_clock, SHOGI_CLOCK_WHITE, now) / 1000 : model->timer[0];
+    save->timer[1] = save->timed ? shogi_clock_main_left(&game_clock, SHOGI_CLOCK_BLACK, now) / 1000 : model->timer[1];
+    save->byoyomi = game_clock.byoyomi / 1000;
+    save->increment = game_clock.increment / 1000;
+    save->history_entries = model->history_entries;
+    save->history = g_new(ShogiModelHistoryEntry, history_list->len);
+    memcpy(save->history, history_list->data, history_list->len * sizeof(ShogiModelHistoryEntry));
+    return save;
+}
+
+void shogi_model_save_free(ShogiModelSave *save) {
+    if (save == NULL) return;
+    g_free(save->history);
+    g_free(save);
+}
+
+char *shogi_model_save_serialize(const ShogiModelSave *save, gsize *length) {
+    gsize history_length = save->history_entries * sizeof(ShogiModelHistoryEntry);
+    *length = SHOGI_MODEL_SAVE_HEADER_LENGTH + history_length + SHOGI_MODEL_SAVE_CLOCK_LENGTH;
+    char *data = g_malloc(*length), *it = data;
+    memcpy(it, save->state, SHOGI_MODEL_SERIALIZED_STATE_LENGTH);
+    it += SHOGI_MODEL_SERIALIZED_STATE_LENGTH;
+    memcpy(it, &save->black_turn, sizeof(gboolean));
+    it += sizeof(gboolean);
+    memcpy(it, &save->timed, sizeof(gboolean));
+    it += sizeof(gboolean);
+    memcpy(it, save->timer, 2 * sizeof(gint64));
+    it += 2 * sizeof(gint64);
+    memcpy(it, &save->history_entries, sizeof(int));
+    it += sizeof(int);
+    memcpy(it, save->history, history_length);
+    it += history_length;
+    memcpy(it, &save->byoyomi, sizeof(gint64));
+    it += sizeof(gint64);
+    memcpy(it, &save->increment, sizeof(gint64));
+    return data;
+}
+
+ShogiModelSave *shogi_model_save_parse(const char *data, gsize length) {
+    if (length < SHOGI_MODEL_SAVE_HEADER_LENGTH)
+        return NULL;
+    ShogiModelSave *save = g_new(ShogiModelSave, 1);
+    const char *it = data;
+    memcpy(save->state, it, SHOGI_MODEL_SERIALIZED_STATE_LENGTH);
+    it += SHOGI_MODEL_SERIALIZED_STATE_LENGTH;
+    memcpy(&save->black_turn, it, sizeof(gboolean));
+    it += sizeof(gboolean);
+    memcpy(&save->timed, it, sizeof(gboolean));
+    it += sizeof(gboolean);
+    memcpy(save->timer, it, 2 * sizeof(gint64));
+    it += 2 * sizeof(gint64);
+    memcpy(&save->history_entries, it, sizeof(int));
+    it += sizeof(int);
+    save->history = NULL;
+    save->byoyomi = save->increment = 0;
+
+    ShogiPosition pos; // checks that the state describes a board
+    gsize history_length = (gsize) MAX(save->history_entries, 0) * sizeof(ShogiModelHistoryEntry);
+    gsize body_length = length - SHOGI_MODEL_SAVE_HEADER_LENGTH; // history and clock settings
+    gboolean has_clock = body_length == history_length + SHOGI_MODEL_SAVE_CLOCK_LENGTH;
+    if (save->history_entries < 0 ||
+        (body_length != history_length && !has_clock) ||
+        save->state[SHOGI_MODEL_SERIALIZED_STATE_LENGTH - 1] != '\0' ||
+        !shogi_position_from_state(&pos, save->state, save->black_turn != 0)) {
+        g_free(save);
+        return NULL;
+    }
+    save->black_turn = save->black_turn != 0;
+    save->history = g_new(ShogiModelHistoryEntry, save->history_entries);
+    memcpy(save->history, it, history_length);
+    it += history_length;
+    if (has_clock) { // missing in saves written before clock settings were saved
+        memcpy(&save->byoyomi, it, sizeof(gint64));
+        it += sizeof(gint64);
+        memcpy(&save->increment, it, sizeof(gint64));
+        save->byoyomi = MAX(save->byoyomi, 0);
+        save->increment = MAX(save->increment, 0);
+    }
+    for (int i = 0; i < save->history_entries; ++i)
+        save->history[i].move[SHOGI_MODEL_MOVE_LENGTH - 1] = '\0';
+    return save;
+}
+
+void shogi_model_save_restore(const ShogiModelSave *save) {
+    SHOGI_TRACE_FUNCTION();
     // reset model to clear state
     shogi_model_reset();
 
-    // load structure
-    // [state][black_turn][timed][timer[2]][entries][{history}]
-    char state[SHOGI_MODEL_SERIALIZED_STATE_LENGTH];
-    fread(&state, sizeof(char), SHOGI_MODEL_SERIALIZED_STATE_LENGTH, file);
-    shogi_model_deserialize_state(state);
-    fread(&is_black_turn, sizeof(gboolean), 1, file); // if black turn
-    fread(&model->TIMED_MODE, sizeof(gboolean), 1, file); // if timed mode
-    fread(&model->timer, sizeof(gint64), 2, file); // timers time
-
-    fread(&model->history_entries, sizeof(int), 1, file); // entries in history
-    fseek(model->history, 0, SEEK_SET); // rewind history file to the beginning
-    for (int i = 0; i < model->history_entries; ++i) { // copy history
-        ShogiModelHistoryEntry entry;
-        fread(&entry, sizeof(ShogiModelHistoryEntry), 1, file);
-        fwrite(&entry, sizeof(ShogiModelHistoryEntry), 1, model->history);
+    shogi_model_deserialize_state(save->state);
+    is_black_turn = save->black_turn;
+    model->TIMED_MODE = save->timed;
+    model->timer[0] = save->timer[0];
+    model->timer[1] = save->timer[1];
+    shogi_clock_init(&game_clock, 0, save->byoyomi, save->increment);
+    game_clock.remaining[SHOGI_CLOCK_WHITE] = model->timer[0] * 1000;
+    game_clock.remaining[SHOGI_CLOCK_BLACK] = model->timer[1] * 1000;
+    if (model->TIMED_MODE)
+        shogi_clock_start(&game_clock, is_black_turn ? SHOGI_CLOCK_BLACK : SHOGI_CLOCK_WHITE, shogi_clock_now());
+    if (save->byoyomi || save->increment) // main time of a game that didn't start yet is the same for both players
+        journal_clock((guint32) MAX(save->timer[0], save->timer[1]), (guint32) save->byoyomi,
+                      (guint32) save->increment);
+
+    model->history_entries = save->history_entries;
+    g_array_append_vals(history_list, save->history, save->history_entries);
+    for (int i = 0; i < save->history_entries; ++i) // players alternate, but clock is known only after the last move
+        journal_move(&save->history[i], i, (save->history_entries - 1 - i) % 2 == 0 ? is_black_turn : !is_black_turn);
+    if (model->history) { // history file is rewritten by reset, copy the whole history in one write
+        fwrite(save->history, sizeof(ShogiModelHistoryEntry), save->history_entries, model->history);
+        fflush(model->history);
     }
-    fseek(model->history, 0, SEEK_END); // rewind history file to the end
+    shogi_model_log_event(SHOGI_LOGGER_EVENT_LOAD, TRUE, model->history_entries);
 }
 
-inline static char *
-parse_move(enum SHOGI_PAWN_DETAILED pawn, int colA, int rowA, int type, int colB, int rowB, int promote) {
+char *
+shogi_model_parse_move(enum SHOGI_PAWN_DETAILED pawn, int colA, int rowA, int type, int colB, int rowB, int promote) {
     assert(pawn != SHOGI_PAWN_DETAILED_NONE);
     char *move = calloc(SHOGI_MODEL_MOVE_LENGTH, sizeof(char));
     if (!move) {
@@ -822,16 +1190,17 @@ parse_move(enum SHOGI_PAWN_DETAILED pawn, int colA, int rowA, int type, int colB
     return move;
 }
 
-inline static void append_history(const char *move, HASH hash, const char *state_serialized) {
+const ShogiModelHistoryEntry *shogi_model_append_history(const char *move, HASH hash, const char *state_serialized) {
+    SHOGI_TRACE_FUNCTION();
     shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_DEBUG, "Writing entry to history.");
     if (model->history == NULL) {
         shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_WARN, "Cannot append to history: file is NULL.");
-        return;
+        return NULL;
     }
     if (move == NULL || state_serialized == NULL) {
         shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_WARN,
                          "Cannot append to history: one of move or state_serialized is NULL.");
-        return;
+        return NULL;
     }
 
     ShogiModelHistoryEntry entry;
@@ -843,9 +1212,17 @@ inline static void append_history(const char *move, HASH hash, const char *state
 
     // write structure to binary file file as new entry
     fwrite(&entry, sizeof(ShogiModelHistoryEntry), 1, model->history);
+    g_array_append_vals(history_list, &entry, 1);
     model->history_entries++;
+    shogi_counters_add(SHOGI_COUNTER_MOVES_APPLIED, 1);
+    shogi_counters_add(SHOGI_COUNTER_HISTORY_BYTES, sizeof(ShogiModelHistoryEntry));
+
+    ShogiLoggerEvent event = {.game = game_id, .type = SHOGI_LOGGER_EVENT_MOVE,
+                              .ply = (guint16) model->history_entries};
+    memcpy(event.data.text, entry.move, sizeof(event.data.text));
+    shogi_logger_event(&event);
 
     //printf("%s|%lu|%s\n", entry.move, hash, entry.state);
     fflush(model->history);
-
+    return &g_array_index(history_list, ShogiModelHistoryEntry, history_list->len - 1);
 }
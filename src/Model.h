@@ -4,6 +4,8 @@
 
 #include <glib.h>
 #include "Utils.h"
+#include "Logger.h"
+#include "Clock.h"
 
 #ifndef CUWR_MODEL_H
 #define CUWR_MODEL_H
@@ -25,7 +27,20 @@ enum SHOGI_MODEL_MODE {
 };
 
 #define SHOGI_MODEL_SERIALIZED_STATE_LENGTH 98
+/// Following macros are used during serialization and hashing
+/// macros translating pawn to and from codes
+#define SHOGI_MODEL_TO_PAWN_CODE(pawn_detailed) ((pawn_detailed) == SHOGI_PAWN_DETAILED_NONE ? (char) 32 : (char) (33 + (pawn_detailed)))
+#define SHOGI_MODEL_FROM_PAWN_CODE(pawn_code) ((pawn_code) == 32 ? SHOGI_PAWN_DETAILED_NONE : (enum SHOGI_PAWN_DETAILED) ((pawn_code) - 33))
+/// translates numbers int char codes
+#define SHOGI_MODEL_TO_COUNT_CODE(count) ((char)((count)+32))
+#define SHOGI_MODEL_FROM_COUNT_CODE(count_code) ((int)((count_code)-32))
 #define SHOGI_MODEL_MOVE_LENGTH 8
+#define SHOGI_MODEL_BOOK_NAME "shogi/book.bin" // opening book in user or system data directory, see Book.h
+#define SHOGI_MODEL_BOOK_ENV "SHOGI_BOOK" // path of opening book overriding data directories
+
+/// deallocates memory for 9x9 matrix
+#define SHOGI_MODEL_FREE_MATRIX(matrix) do { for (int i = 0; i < 9; ++i) free(matrix[i]); free(matrix); }while(0)
+
 typedef unsigned long HASH;
 
 
@@ -36,11 +51,23 @@ typedef struct _history_entry {
     char state[SHOGI_MODEL_SERIALIZED_STATE_LENGTH]; // state description
 } ShogiModelHistoryEntry;
 
+/// snapshot of the game as written to save files
+typedef struct _shogi_model_save {
+    char state[SHOGI_MODEL_SERIALIZED_STATE_LENGTH];
+    gboolean black_turn;
+    gboolean timed;
+    gint64 timer[2]; // main time left in ms, [0] white [1] black
+    gint64 byoyomi; // time per move after main time runs out in ms, 0 if not used
+    gint64 increment; // time added after each move in ms, 0 if not used
+    int history_entries;
+    ShogiModelHistoryEntry *history;
+} ShogiModelSave;
+
 typedef struct _shogi_model {
     int *hand[2]; // hand of player - [0]=white [1]=black
     enum SHOGI_PAWN_DETAILED **board; // board of size 9x9 with enums representing pawns
     gboolean TIMED_MODE; // true if game is set to mode with timer
-    gint64 timer[2]; // timers for players. [0] for white [1] for black
+    gint64 timer[2]; // main time left for players in ms, updated by shogi_model_timer_update(). [0] white [1] black
     FILE *history; // binary file holding current history
     int history_entries;
 } ShogiModel;
@@ -104,12 +131,32 @@ char **shogi_model_get_available_moves();
 int *shogi_model_get_hand(gboolean is_white);
 
 /**
- * Returns left time for player
+ * Returns time shown on player's clock - main time, or byoyomi once main time is used up
  * @param is_white true for white player, false for black
  * @return left time in miliseconds for player
  */
 gint64 shogi_model_timer_get_time(gboolean is_white);
 
+/**
+ * Returns game clock, valid until the next timer change
+ * @return clock of the game, stopped if the game isn't timed
+ */
+const ShogiClock *shogi_model_get_clock();
+
+/**
+ * Writes event of current game to binary event log, game id and ply are filled in
+ * @param type type of event
+ * @param value0 first value of event's data
+ * @param value1 second value of event's data
+ */
+void shogi_model_log_event(enum SHOGI_LOGGER_EVENT type, gint32 value0, gint32 value1);
+
+/**
+ * Returns if the game is played with timer
+ * @return true if game is in timed mode
+ */
+gboolean shogi_model_is_timed();
+
 /**
  * Check if specified player is in check
  * @param check_for_black true to check if black is in check
@@ -177,66 +224,71 @@ char **shogi_model_hitmap_calc_all(char **hitmap, enum SHOGI_PAWN_DETAILED **boa
 void shogi_model_hitmap_clear(char **mask);
 
 /**
- * Restarts timers of both players to initial_time in miliseconds
- * If initial_time is 0, timed mode is disabled
- * @param initial_time initial time for each player
+ * Returns symbol from move pattern of pawn at given offset from it's position.
+ * Offset is given in matrix indexes (as in board[row][col]), pattern is rotated for white pawns
+ * @param pawn pawn which pattern is checked
+ * @param d_row row offset from pawn to the field
+ * @param d_col column offset from pawn to the field
+ * @return 'o' for jump, one of '-' '|' '/' '\' for line in the direction of offset or ' ' if field is not in pattern
  */
-void shogi_model_timer_set(guint32 initial_time);
+char shogi_model_pattern_at(enum SHOGI_PAWN_DETAILED pawn, int d_row, int d_col);
 
 /**
- * Decreases current players timer by delta seconds
- * @param delta time to be removed from current players timer
+ * Removes from hitmap of available drops the field where dropped pawn would checkmate opponent's king
+ * @param board board on which pawn is dropped
+ * @param hitmap available drops, 'o' marks field where pawn can be dropped
+ * @param black_drops true if black drops the pawn
  */
-void shogi_model_timer_decrease(clock_t delta);
+void shogi_model_exclude_drop_mate(enum SHOGI_PAWN_DETAILED **board, char **hitmap, gboolean black_drops);
 
 /**
- * Execute to make current player resign
+ * Restarts timers of both players and starts the clock of the player on move
+ * If both initial_time and byoyomi are 0, timed mode is disabled
+ * @param initial_time initial main time for each player in miliseconds
+ * @param byoyomi time for every move after main time runs out in miliseconds
+ * @param increment time added after every move in miliseconds
  */
-void shogi_model_resign();
-
-//----------------------------------------------------------------------------------------------------------------------
-
+void shogi_model_timer_set(guint32 initial_time, guint32 byoyomi, guint32 increment);
 
 /**
- * Changes current player
+ * Updates timers to current time and ends the game if current player ran out of time
+ * @return ms until a shown second of the timer changes or time runs out, -1 if no timer runs
  */
-inline static void change_player();
+gint64 shogi_model_timer_update();
 
 /**
- * Returns true if a piece may possibly move, so if pawn is in the last row it cannot etc.
- * @param col col of pawn
- * @param row row of pawn
- * @param pawn pawn
- * @return
+ * Execute to make current player resign
  */
-inline static gboolean pawn_can_possibly_move(int row, enum SHOGI_PAWN_DETAILED pawn); // DONE
+void shogi_model_resign();
 
 /**
- * Checks if movement from can promote if moved from colA rowA to colB rowB
- * @param colA begin column
- * @param rowA begin row
- * @param colB end column
- * @param rowB end row
- * @return true if pawn can promote
+ * Looks up moves of the current position in the opening book
+ * @param moves buffer for moves in history notation
+ * @param counts buffer for number of games in which each move was played
+ * @param max size of the buffers
+ * @return number of book moves, 0 if position is not in the book or there is no book
  */
-inline static gboolean pawn_can_promote(int colA, int rowA, int colB, int rowB); // DONE
-#endif //CUWR_MODEL_H
+int shogi_model_book_moves(char (*moves)[SHOGI_MODEL_MOVE_LENGTH], guint32 *counts, int max);
 
 /**
- * Check if specified player is in checkmate
- * @param black_drops true to check if black is in checkmate
- * @return true if checkmate, false otherwise
+ * Returns notation of a move from history, kept in memory so it can be read without touching the history file
+ * @param ply index of the move, from 0 to history_entries - 1
+ * @return move in history notation, NULL with a critical warning if ply is out of range
  */
-static void
-shogi_model_exclude_drop_mate(enum SHOGI_PAWN_DETAILED **board, char **hitmap, gboolean black_drops); // DONE
+const char *shogi_model_history_move(int ply);
 
+/**
+ * Identifies current history, changes when history is cleared by a new or loaded game, but not when moves are added
+ * @return id of history
+ */
+guint32 shogi_model_history_id();
 
 /**
  * Returns hash of given string
  * @param str pointer to string
  * @return hash of string as unsigned long
  */
-inline static HASH hash_string(char *str);
+HASH shogi_model_hash_string(const char *str);
 
 /**
  * Serializes the state of game into single string - black_hand|white_hand|board
@@ -251,10 +303,39 @@ char *shogi_model_serialize_state();
 void shogi_model_deserialize_state(const char *state);
 
 /**
- * Loads game state based on save file
- * @param file save as binary file
+ * Takes snapshot of the game for saving, cheap enough for the main loop: the history is copied from memory. Time left
+ * is read from the clock, so a flag fall isn't handled here, but by the next shogi_model_timer_update()
+ * @return new save
  */
-void shogi_model_load_game(FILE *file);
+ShogiModelSave *shogi_model_save_new();
+
+/**
+ * Frees save
+ * @param save save to free
+ */
+void shogi_model_save_free(ShogiModelSave *save);
+
+/**
+ * Serializes save into the save file format. Doesn't touch the model, so it can run on any thread
+ * @param save save to serialize
+ * @param length set to length of the data
+ * @return data of the save file, free with g_free()
+ */
+char *shogi_model_save_serialize(const ShogiModelSave *save, gsize *length);
+
+/**
+ * Parses contents of a save file. Doesn't touch the model, so it can run on any thread
+ * @param data contents of the file
+ * @param length length of data
+ * @return new save or NULL if data isn't a valid save
+ */
+ShogiModelSave *shogi_model_save_parse(const char *data, gsize length);
+
+/**
+ * Replaces the game with the saved one
+ * @param save save to restore
+ */
+void shogi_model_save_restore(const ShogiModelSave *save);
 
 /**
  * Parses move of pawn
@@ -267,8 +348,8 @@ void shogi_model_load_game(FILE *file);
  * @param promote 0 for no promotion, 1 for promotion 2 for declined promotion
  * @return new char of size 7 representing move
  */
-inline static char *
-parse_move(enum SHOGI_PAWN_DETAILED pawn, int colA, int rowA, int type, int colB, int rowB, int promote);
+char *
+shogi_model_parse_move(enum SHOGI_PAWN_DETAILED pawn, int colA, int rowA, int type, int colB, int rowB, int promote);
 
 /**
  * Appends entry to history.
@@ -277,5 +358,8 @@ parse_move(enum SHOGI_PAWN_DETAILED pawn, int colA, int rowA, int type, int colB
  * move = sizeof(char)*6
  * hash = sizeof(unsigned long)
  * state = sizeof(char) * 96 (7x2 for hands + 81 for board + 1 for null terminator)
+ * @return appended entry, valid until the next append, or NULL if it wasn't appended
  */
-inline static void append_history(const char *move, HASH hash, const char *state_serialized);
+const ShogiModelHistoryEntry *shogi_model_append_history(const char *move, HASH hash, const char *state_serialized);
+
+#endif //CUWR_MODEL_H
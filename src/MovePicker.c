@@ -0,0 +1,277 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#include <string.h>
+#include "MovePicker.h"
+
+#define SHOGI_SEE_KING_VALUE 15000
+
+/// value of a pawn in exchange, king is worth more than anything it could capture
+static inline int see_value(enum SHOGI_PAWN_DETAILED pawn) {
+    if (SHOGI_PAWN_TO_BASE_TYPE(pawn) == SHOGI_PAWN_K) return SHOGI_SEE_KING_VALUE;
+    return shogi_position_pawn_value[pawn];
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+int shogi_move_picker_see(const ShogiPosition *pos, ShogiMove move) {
+    if (SHOGI_MOVE_IS_DROP(move) || !SHOGI_MOVE_IS_CAPTURE(move))
+        return 0;
+
+    enum SHOGI_PAWN_DETAILED board[9][9];
+    memcpy(board, pos->board, sizeof(board));
+
+    int to = SHOGI_MOVE_TO(move);
+    int from = SHOGI_MOVE_FROM(move);
+    int gain[40];
+    int depth = 0;
+
+    gain[0] = see_value(SHOGI_MOVE_CAPTURED(move)) +
+              see_value(SHOGI_MOVE_PLACED(move)) - see_value(SHOGI_MOVE_PAWN(move)); // promotion gain
+    int on_square = see_value(SHOGI_MOVE_PLACED(move));
+    board[from / 9][from % 9] = SHOGI_PAWN_DETAILED_NONE;
+    board[to / 9][to % 9] = SHOGI_MOVE_PLACED(move);
+    gboolean black = !pos->black_turn;
+
+    while (depth < 39) {
+        // find least valuable attacker of the side to recapture
+        int attackers[16];
+        int count = shogi_position_attackers(board, to, black, attackers);
+        if (count == 0) break;
+
+        int best = attackers[0];
+        for (int i = 1; i < count; ++i)
+            if (see_value(board[attackers[i] / 9][attackers[i] % 9]) < see_value(board[best / 9][best % 9]))
+                best = attackers[i];
+
+        depth++;
+        gain[depth] = on_square - gain[depth - 1];
+        if (MAX(-gain[depth - 1], gain[depth]) < 0) break; // neither side can gain anything further
+
+        on_square = see_value(board[best / 9][best % 9]);
+        board[to / 9][to % 9] = board[best / 9][best % 9];
+        board[best / 9][best % 9] = SHOGI_PAWN_DETAILED_NONE;
+        black = !black;
+    }
+
+    while (depth > 0) {
+        gain[depth - 1] = -MAX(-gain[depth - 1], gain[depth]);
+        depth--;
+    }
+    return gain[0];
+}
+
+void shogi_move_heuristics_clear(ShogiMoveHeuristics *heuristics) {
+    guint flags = heuristics->flags;
+    memset(heuristics, 0, sizeof(ShogiMoveHeuristics));
+    heuristics->flags = flags;
+}
+
+/// moves history value towards bonus, so values stay within +-SHOGI_MOVE_PICKER_HISTORY_MAX
+static inline void history_add(int *entry, int bonus) {
+    *entry += bonus - *entry * ABS(bonus) / SHOGI_MOVE_PICKER_HISTORY_MAX;
+}
+
+void shogi_move_heuristics_update(ShogiMoveHeuristics *heuristics, ShogiMove best, int ply, int depth,
+                                  ShogiMove previous_move, const ShogiMove *quiets, int quiets_count) {
+    if (SHOGI_MOVE_IS_CAPTURE(best)) return; // captures are ordered by SEE
+
+    if (ply < SHOGI_MOVE_PICKER_MAX_PLY && heuristics->killers[ply][0] != best) {
+        heuristics->killers[ply][1] = heuristics->killers[ply][0];
+        heuristics->killers[ply][0] = best;
+    }
+
+    if (previous_move != SHOGI_MOVE_NONE)
+        heuristics->counter_moves[SHOGI_MOVE_PLACED(previous_move)][SHOGI_MOVE_TO(previous_move)] = best;
+
+    int bonus = MIN(depth * depth, 400);
+    history_add(&heuristics->history[SHOGI_MOVE_PAWN(best)][SHOGI_MOVE_TO(best)], bonus);
+    for (int i = 0; i < quiets_count; ++i)
+        if (quiets[i] != best)
+            history_add(&heuristics->history[SHOGI_MOVE_PAWN(quiets[i])][SHOGI_MOVE_TO(quiets[i])], -bonus);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void shogi_move_picker_init(ShogiMovePicker *picker, const ShogiPosition *pos, const ShogiMoveHeuristics *heuristics,
+                            ShogiMove tt_move, int ply, ShogiMove previous_move) {
+    guint flags = heuristics->flags;
+    picker->pos = pos;
+    picker->heuristics = heuristics;
+    picker->stage = SHOGI_MOVE_PICKER_STAGE_TT;
+    picker->tt_move = (flags & SHOGI_MOVE_ORDER_TT) ? tt_move : SHOGI_MOVE_NONE;
+    picker->killers[0] = picker->killers[1] = SHOGI_MOVE_NONE;
+    if ((flags & SHOGI_MOVE_ORDER_KILLERS) && ply < SHOGI_MOVE_PICKER_MAX_PLY) {
+        picker->killers[0] = heuristics->killers[ply][0];
+        picker->killers[1] = heuristics->killers[ply][1];
+    }
+    picker->counter_move = SHOGI_MOVE_NONE;
+    if ((flags & SHOGI_MOVE_ORDER_COUNTER_MOVES) && previous_move != SHOGI_MOVE_NONE)
+        picker->counter_move = heuristics->counter_moves[SHOGI_MOVE_PLACED(previous_move)][SHOGI_MOVE_TO(previous_move)];
+    picker->current = picker->end = picker->captures_end = picker->bad_captures_end = 0;
+    picker->quiescence = picker->quiescence_checks = FALSE;
+}
+
+void shogi_move_picker_init_quiescence(ShogiMovePicker *picker, const ShogiPosition *pos,
+                                       const ShogiMoveHeuristics *heuristics, ShogiMove tt_move, gboolean checks) {
+    shogi_move_picker_init(picker, pos, heuristics, SHOGI_MOVE_IS_CAPTURE(tt_move) ? tt_move : SHOGI_MOVE_NONE,
+                           SHOGI_MOVE_PICKER_MAX_PLY, SHOGI_MOVE_NONE);
+    picker->killers[0] = picker->killers[1] = picker->counter_move = SHOGI_MOVE_NONE;
+    picker->quiescence = TRUE;
+    picker->quiescence_checks = checks;
+}
+
+/// moves best scored move from the rest of the stage to current position and returns it
+static inline ShogiMove pick_best(ShogiMovePicker *picker) {
+    int best = picker->current;
+    for (int i = picker->current + 1; i < picker->end; ++i)
+        if (picker->scores[i] > picker->scores[best])
+            best = i;
+
+    ShogiMove move = picker->moves[best];
+    int score = picker->scores[best];
+    picker->moves[best] = picker->moves[picker->current];
+    picker->scores[best] = picker->scores[picker->current];
+    picker->moves[picker->current] = move;
+    picker->scores[picker->current] = score;
+    picker->current++;
+    return move;
+}
+
+/// quiet check is worth searching in quiescence only if the checking pawn can't be taken for free
+static inline gboolean is_safe_check(const ShogiPosition *pos, ShogiMove move) {
+    enum SHOGI_PAWN_DETAILED (*board)[9] = (enum SHOGI_PAWN_DETAILED (*)[9]) pos->board;
+    int to = SHOGI_MOVE_TO(move);
+    if (shogi_position_attackers(board, to, !pos->black_turn, NULL) == 0)
+        return TRUE;
+    // pawn moving on the board attacks it's destination itself, so it's one of the defenders
+    return shogi_position_attackers(board, to, pos->black_turn, NULL) > (SHOGI_MOVE_IS_DROP(move) ? 0 : 1);
+}
+
+/// checks if killer or counter move should be returned in it's stage
+static inline gboolean is_usable_refutation(ShogiMovePicker *picker, ShogiMove move) {
+    return move != SHOGI_MOVE_NONE && move != picker->tt_move && !SHOGI_MOVE_IS_CAPTURE(move) &&
+           shogi_position_is_pseudo_legal(picker->pos, move);
+}
+
+static inline gboolean is_refutation(ShogiMovePicker *picker, ShogiMove move) {
+    return move == picker->killers[0] || move == picker->killers[1] || move == picker->counter_move;
+}
+
+ShogiMove shogi_move_picker_next(ShogiMovePicker *picker) {
+    guint flags = picker->heuristics->flags;
+    ShogiMove move;
+
+    switch (picker->stage) {
+        case SHOGI_MOVE_PICKER_STAGE_TT:
+            picker->stage = SHOGI_MOVE_PICKER_STAGE_CAPTURES_INIT;
+            if (shogi_position_is_pseudo_legal(picker->pos, picker->tt_move))
+                return picker->tt_move;
+            picker->tt_move = SHOGI_MOVE_NONE;
+            // fall through
+
+        case SHOGI_MOVE_PICKER_STAGE_CAPTURES_INIT:
+            picker->end = picker->captures_end = shogi_position_generate_captures(picker->pos, picker->moves);
+            for (int i = 0; i < picker->end; ++i) {
+                move = picker->moves[i];
+                if (flags & SHOGI_MOVE_ORDER_SEE)
+                    picker->scores[i] = shogi_move_picker_see(picker->pos, move);
+                else // most valuable victim - least valuable attacker
+                    picker->scores[i] = see_value(SHOGI_MOVE_CAPTURED(move)) * 16 - see_value(SHOGI_MOVE_PAWN(move)) / 16;
+            }
+            picker->stage = SHOGI_MOVE_PICKER_STAGE_GOOD_CAPTURES;
+            // fall through
+
+        case SHOGI_MOVE_PICKER_STAGE_GOOD_CAPTURES:
+            while (picker->current < picker->end) {
+                int score_index = picker->current;
+                move = pick_best(picker);
+                if (move == picker->tt_move) continue;
+                if ((flags & SHOGI_MOVE_ORDER_SEE) && picker->scores[score_index] < 0 &&
+                    !SHOGI_MOVE_IS_KING_CAPTURE(move)) {
+                    picker->moves[picker->bad_captures_end++] = move; // try it after quiet moves
+                    continue;
+                }
+                return move;
+            }
+            if (picker->quiescence) { // losing captures are not worth searching in quiescence
+                picker->stage = SHOGI_MOVE_PICKER_STAGE_QUIESCENCE_QUIETS_INIT;
+                return shogi_move_picker_next(picker);
+            }
+            picker->stage = SHOGI_MOVE_PICKER_STAGE_KILLER_1;
+            // fall through
+
+        case SHOGI_MOVE_PICKER_STAGE_KILLER_1:
+            picker->stage = SHOGI_MOVE_PICKER_STAGE_KILLER_2;
+            if (is_usable_refutation(picker, picker->killers[0]))
+                return picker->killers[0];
+            picker->killers[0] = SHOGI_MOVE_NONE;
+            // fall through
+
+        case SHOGI_MOVE_PICKER_STAGE_KILLER_2:
+            picker->stage = SHOGI_MOVE_PICKER_STAGE_COUNTER_MOVE;
+            if (picker->killers[1] != picker->killers[0] && is_usable_refutation(picker, picker->killers[1]))
+                return picker->killers[1];
+            picker->killers[1] = SHOGI_MOVE_NONE;
+            // fall through
+
+        case SHOGI_MOVE_PICKER_STAGE_COUNTER_MOVE:
+            picker->stage = SHOGI_MOVE_PICKER_STAGE_QUIETS_INIT;
+            if (picker->counter_move != picker->killers[0] && picker->counter_move != picker->killers[1] &&
+                is_usable_refutation(picker, picker->counter_move))
+                return picker->counter_move;
+            picker->counter_move = SHOGI_MOVE_NONE;
+            // fall through
+
+        case SHOGI_MOVE_PICKER_STAGE_QUIETS_INIT:
+            picker->current = picker->captures_end;
+            picker->end = picker->captures_end +
+                          shogi_position_generate_quiets(picker->pos, picker->moves + picker->captures_end);
+            for (int i = picker->current; i < picker->end; ++i)
+                picker->scores[i] = (flags & SHOGI_MOVE_ORDER_HISTORY) ?
+                                    picker->heuristics->history[SHOGI_MOVE_PAWN(picker->moves[i])]
+                                    [SHOGI_MOVE_TO(picker->moves[i])] : 0;
+            picker->stage = SHOGI_MOVE_PICKER_STAGE_QUIETS;
+            // fall through
+
+        case SHOGI_MOVE_PICKER_STAGE_QUIETS:
+            while (picker->current < picker->end) {
+                move = (flags & SHOGI_MOVE_ORDER_HISTORY) ? pick_best(picker) : picker->moves[picker->current++];
+                if (move == picker->tt_move || is_refutation(picker, move)) continue;
+                return move;
+            }
+            picker->current = 0;
+            picker->end = picker->bad_captures_end;
+            picker->stage = SHOGI_MOVE_PICKER_STAGE_BAD_CAPTURES;
+            // fall through
+
+        case SHOGI_MOVE_PICKER_STAGE_BAD_CAPTURES:
+            if (picker->current < picker->end)
+                return picker->moves[picker->current++];
+            picker->stage = SHOGI_MOVE_PICKER_STAGE_DONE;
+            // fall through
+
+        case SHOGI_MOVE_PICKER_STAGE_QUIESCENCE_QUIETS_INIT:
+            picker->current = picker->captures_end;
+            picker->end = picker->captures_end +
+                          shogi_position_generate_quiets(picker->pos, picker->moves + picker->captures_end);
+            picker->stage = SHOGI_MOVE_PICKER_STAGE_QUIESCENCE_QUIETS;
+            // fall through
+
+        case SHOGI_MOVE_PICKER_STAGE_QUIESCENCE_QUIETS:
+            while (picker->current < picker->end) {
+                move = picker->moves[picker->current++];
+                if (SHOGI_MOVE_IS_PROMOTION(move) ||
+                    (picker->quiescence_checks && shogi_position_gives_check(picker->pos, move) &&
+                     is_safe_check(picker->pos, move)))
+                    return move;
+            }
+            picker->stage = SHOGI_MOVE_PICKER_STAGE_DONE;
+            // fall through
+
+        case SHOGI_MOVE_PICKER_STAGE_DONE:
+        default:
+            return SHOGI_MOVE_NONE;
+    }
+}
@@ -0,0 +1,126 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#ifndef SHOGI_MOVEPICKER_H
+#define SHOGI_MOVEPICKER_H
+
+#include "Position.h"
+
+// Move picker returns moves of a position one by one, best looking first. Moves are generated in stages,
+// so when search cuts off after first few moves the rest of them is never generated:
+// transposition table move -> captures with SEE >= 0 -> killers and counter move -> quiet moves and drops
+// ordered by history -> captures losing material.
+// Quiescence picker returns only captures with SEE >= 0 followed by promotions and, optionally, checks
+// which don't hang the checking pawn.
+
+#define SHOGI_MOVE_PICKER_MAX_PLY       128
+#define SHOGI_MOVE_PICKER_HISTORY_MAX   16384
+
+/// heuristics that can be switched off to measure their effect
+#define SHOGI_MOVE_ORDER_TT             (1 << 0)
+#define SHOGI_MOVE_ORDER_SEE            (1 << 1)
+#define SHOGI_MOVE_ORDER_KILLERS        (1 << 2)
+#define SHOGI_MOVE_ORDER_COUNTER_MOVES  (1 << 3)
+#define SHOGI_MOVE_ORDER_HISTORY        (1 << 4)
+#define SHOGI_MOVE_ORDER_ALL            0x1F
+
+enum SHOGI_MOVE_PICKER_STAGE {
+    SHOGI_MOVE_PICKER_STAGE_TT,
+    SHOGI_MOVE_PICKER_STAGE_CAPTURES_INIT,
+    SHOGI_MOVE_PICKER_STAGE_GOOD_CAPTURES,
+    SHOGI_MOVE_PICKER_STAGE_KILLER_1,
+    SHOGI_MOVE_PICKER_STAGE_KILLER_2,
+    SHOGI_MOVE_PICKER_STAGE_COUNTER_MOVE,
+    SHOGI_MOVE_PICKER_STAGE_QUIETS_INIT,
+    SHOGI_MOVE_PICKER_STAGE_QUIETS,
+    SHOGI_MOVE_PICKER_STAGE_BAD_CAPTURES,
+    SHOGI_MOVE_PICKER_STAGE_QUIESCENCE_QUIETS_INIT,
+    SHOGI_MOVE_PICKER_STAGE_QUIESCENCE_QUIETS,
+    SHOGI_MOVE_PICKER_STAGE_DONE
+};
+
+/// tables filled by search with moves that caused beta cutoffs
+typedef struct _shogi_move_heuristics {
+    guint flags; // enabled heuristics, SHOGI_MOVE_ORDER_*
+    ShogiMove killers[SHOGI_MOVE_PICKER_MAX_PLY][2];
+    ShogiMove counter_moves[SHOGI_PAWN_DETAILED_COUNT][SHOGI_SQUARE_COUNT]; // [previous pawn][previous destination]
+    int history[SHOGI_PAWN_DETAILED_COUNT][SHOGI_SQUARE_COUNT]; // [pawn][destination], colors differ by pawn
+} ShogiMoveHeuristics;
+
+typedef struct _shogi_move_picker {
+    const ShogiPosition *pos;
+    const ShogiMoveHeuristics *heuristics;
+    enum SHOGI_MOVE_PICKER_STAGE stage;
+    ShogiMove tt_move;
+    ShogiMove killers[2];
+    ShogiMove counter_move;
+    ShogiMove moves[SHOGI_POSITION_MAX_MOVES];
+    int scores[SHOGI_POSITION_MAX_MOVES];
+    int current; // next move to pick
+    int end; // end of generated moves in current stage
+    int captures_end; // end of captures, quiets are generated after them
+    int bad_captures_end; // captures with negative SEE are moved to the beginning of the array
+    gboolean quiescence; // picker made with shogi_move_picker_init_quiescence()
+    gboolean quiescence_checks; // quiescence picker returns quiet checks
+} ShogiMovePicker;
+
+/**
+ * Prepares move picker for a position
+ * @param picker picker to initialize
+ * @param pos position, must not change while picker is in use
+ * @param heuristics killer, counter move and history tables
+ * @param tt_move move from transposition table or SHOGI_MOVE_NONE
+ * @param ply distance from the root of search, used to pick killers
+ * @param previous_move move which led to the position or SHOGI_MOVE_NONE, used to pick counter move
+ */
+void shogi_move_picker_init(ShogiMovePicker *picker, const ShogiPosition *pos, const ShogiMoveHeuristics *heuristics,
+                            ShogiMove tt_move, int ply, ShogiMove previous_move);
+
+/**
+ * Prepares move picker for quiescence search: captures that don't lose material, promotions and optionally safe checks
+ * @param picker picker to initialize
+ * @param pos position, must not change while picker is in use
+ * @param heuristics move ordering tables, only flags are used
+ * @param tt_move move from transposition table or SHOGI_MOVE_NONE, used only if it's a capture
+ * @param checks true to return quiet moves and drops that check the opponent
+ */
+void shogi_move_picker_init_quiescence(ShogiMovePicker *picker, const ShogiPosition *pos,
+                                       const ShogiMoveHeuristics *heuristics, ShogiMove tt_move, gboolean checks);
+
+/**
+ * Returns next move to try
+ * @param picker initialized picker
+ * @return next move or SHOGI_MOVE_NONE when all moves were returned
+ */
+ShogiMove shogi_move_picker_next(ShogiMovePicker *picker);
+
+/**
+ * Static exchange evaluation - material balance after all captures and recaptures on destination square
+ * of the move, when each side captures with least valuable pawn first and may stop at any time
+ * @param pos position before the move
+ * @param move capture to evaluate
+ * @return material gained by the side making the move
+ */
+int shogi_move_picker_see(const ShogiPosition *pos, ShogiMove move);
+
+/**
+ * Clears killers, counter moves and history. Flags are kept
+ * @param heuristics tables to clear
+ */
+void shogi_move_heuristics_clear(ShogiMoveHeuristics *heuristics);
+
+/**
+ * Updates tables after move caused beta cutoff
+ * @param heuristics tables to update
+ * @param best move that caused cutoff
+ * @param ply distance from the root
+ * @param depth remaining depth
+ * @param previous_move move which led to the position or SHOGI_MOVE_NONE
+ * @param quiets quiet moves tried before the best one, their history is lowered
+ * @param quiets_count number of quiet moves tried before
+ */
+void shogi_move_heuristics_update(ShogiMoveHeuristics *heuristics, ShogiMove best, int ply, int depth,
+                                  ShogiMove previous_move, const ShogiMove *quiets, int quiets_count);
+
+#endif //SHOGI_MOVEPICKER_H
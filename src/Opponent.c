@@ -0,0 +1,107 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#include "Opponent.h"
+#include "Logger.h"
+#include "Trace.h"
+
+typedef struct _shogi_opponent_task {
+    ShogiOpponent *opponent;
+    ShogiPosition pos; // copy of the model position, the model belongs to the main thread
+    ShogiTimeControl control;
+    int ply;
+} ShogiOpponentTask;
+
+ShogiOpponent *shogi_opponent_new() {
+    ShogiSearch *search = shogi_search_new(SHOGI_OPPONENT_HASH_MB);
+    if (search == NULL)
+        return NULL;
+    ShogiOpponent *opponent = g_new0(ShogiOpponent, 1);
+    opponent->search = search;
+    return opponent;
+}
+
+void shogi_opponent_free(ShogiOpponent *opponent) {
+    if (opponent == NULL) return;
+    shogi_search_free(opponent->search);
+    g_free(opponent);
+}
+
+static void stop_search(G_GNUC_UNUSED GCancellable *cancellable, gpointer data) {
+    shogi_search_stop(data);
+}
+
+static void think_thread(GTask *task, G_GNUC_UNUSED gpointer source, gpointer data, GCancellable *cancellable) {
+    SHOGI_TRACE_FUNCTION();
+    ShogiOpponentTask *think = data;
+    ShogiSearch *search = think->opponent->search;
+    ShogiTimeManager time;
+    shogi_time_manager_init(&time, &think->control, think->ply);
+    search->time = &time;
+
+    ShogiMove best = SHOGI_MOVE_NONE;
+    gulong handler = g_cancellable_connect(cancellable, G_CALLBACK(stop_search), search, NULL);
+    if (!g_cancellable_is_cancelled(cancellable))
+        shogi_search_run(search, &think->pos, SHOGI_SEARCH_MAX_PLY - 1, &best);
+    g_cancellable_disconnect(cancellable, handler);
+    search->time = NULL;
+
+    if (!g_task_return_error_if_cancelled(task))
+        g_task_return_int(task, best);
+}
+
+void shogi_opponent_think(ShogiOpponent *opponent, int ply, GAsyncReadyCallback callback, gpointer data) {
+    ShogiOpponentTask *think = g_new(ShogiOpponentTask, 1);
+    think->opponent = opponent;
+    think->ply = ply;
+    int *hand[2] = {shogi_model_get_hand(TRUE), shogi_model_get_hand(FALSE)};
+    shogi_position_from_model(&think->pos, shogi_model_get_board(), hand, shogi_model_is_black_turn());
+    if (!shogi_time_manager_control_from_model(&think->control)) { // fixed time per move without timer
+        think->control = (ShogiTimeControl) {.byoyomi = SHOGI_OPPONENT_MOVE_TIME};
+    }
+
+    opponent->cancellable = g_cancellable_new();
+    GTask *task = g_task_new(NULL, opponent->cancellable, callback, data);
+    g_task_set_task_data(task, think, g_free);
+    g_task_run_in_thread(task, think_thread);
+    g_object_unref(task);
+    shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_DEBUG, "Opponent started thinking.");
+}
+
+ShogiMove shogi_opponent_think_finish(ShogiOpponent *opponent, GAsyncResult *result, GError **error) {
+    g_clear_object(&opponent->cancellable);
+    gssize move = g_task_propagate_int(G_TASK(result), error);
+    return move < 0 ? SHOGI_MOVE_NONE : (ShogiMove) move;
+}
+
+void shogi_opponent_cancel(ShogiOpponent *opponent) {
+    if (opponent->cancellable)
+        g_cancellable_cancel(opponent->cancellable);
+}
+
+gboolean shogi_opponent_is_thinking(const ShogiOpponent *opponent) {
+    return opponent->cancellable != NULL;
+}
+
+gboolean shogi_opponent_play(ShogiMove move) {
+    if (move == SHOGI_MOVE_NONE)
+        return FALSE;
+    gboolean black_turn = shogi_model_is_black_turn();
+    int to = SHOGI_MOVE_TO(move);
+
+    if (SHOGI_MOVE_IS_DROP(move)) {
+        if (!shogi_model_drop_mode(SHOGI_MOVE_PAWN(move)) || shogi_model_get_mode() != DROP)
+            return FALSE;
+    } else {
+        int from = SHOGI_MOVE_FROM(move);
+        if (!shogi_model_click(SHOGI_SQUARE_COL(from), SHOGI_SQUARE_ROW(from)) || shogi_model_get_mode() != MOVE)
+            return FALSE;
+    }
+    shogi_model_click(SHOGI_SQUARE_COL(to), SHOGI_SQUARE_ROW(to));
+    if (shogi_model_get_mode() == PROMOTING)
+        shogi_model_promote(SHOGI_MOVE_IS_PROMOTION(move));
+
+    enum SHOGI_MODEL_MODE mode = shogi_model_get_mode();
+    return mode == WHITE_WIN || mode == BLACK_WIN || shogi_model_is_black_turn() != black_turn;
+}
@@ -0,0 +1,73 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#ifndef SHOGI_OPPONENT_H
+#define SHOGI_OPPONENT_H
+
+#include <gio/gio.h>
+#include "Search.h"
+
+// Computer opponent of the app. The engine thinks on a worker thread of GTask, so the main loop keeps painting
+// and ticking clocks, and the found move is played on the main thread with the same model calls a player's
+// clicks make. Thinking can be cancelled at any time, the search then stops within a few hundred nodes.
+
+#define SHOGI_OPPONENT_HASH_MB      64
+#define SHOGI_OPPONENT_MOVE_TIME    2000 // ms per move in games without timer
+
+typedef struct _shogi_opponent {
+    ShogiSearch *search;
+    GCancellable *cancellable; // of the running think, NULL if the opponent is idle
+} ShogiOpponent;
+
+/**
+ * Creates opponent with it's own search tables
+ * @return new opponent or NULL on failure
+ */
+ShogiOpponent *shogi_opponent_new();
+
+/**
+ * Frees opponent, it must not be thinking
+ * @param opponent opponent to free
+ */
+void shogi_opponent_free(ShogiOpponent *opponent);
+
+/**
+ * Starts thinking about the current position of the model, using the time of the player to move if the game is timed
+ * @param opponent idle opponent
+ * @param ply moves played in the game, used to spread time over the rest of the game
+ * @param callback called on the main thread when the move is found or thinking was cancelled
+ * @param data user data of callback
+ */
+void shogi_opponent_think(ShogiOpponent *opponent, int ply, GAsyncReadyCallback callback, gpointer data);
+
+/**
+ * Finishes thinking, to be called from the callback passed to shogi_opponent_think()
+ * @param opponent opponent
+ * @param result result passed to the callback
+ * @param error set to G_IO_ERROR_CANCELLED if thinking was cancelled
+ * @return best move, SHOGI_MOVE_NONE if thinking was cancelled or there are no moves
+ */
+ShogiMove shogi_opponent_think_finish(ShogiOpponent *opponent, GAsyncResult *result, GError **error);
+
+/**
+ * Cancels running think, the callback is still called
+ * @param opponent opponent
+ */
+void shogi_opponent_cancel(ShogiOpponent *opponent);
+
+/**
+ * Returns if the opponent is thinking
+ * @param opponent opponent
+ * @return true between shogi_opponent_think() and the call of it's callback
+ */
+gboolean shogi_opponent_is_thinking(const ShogiOpponent *opponent);
+
+/**
+ * Plays the move on the model through the same calls clicks and drop buttons make, promotion included
+ * @param move move of the player to move
+ * @return false if the model rejected the move
+ */
+gboolean shogi_opponent_play(ShogiMove move);
+
+#endif //SHOGI_OPPONENT_H
@@ -0,0 +1,692 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#include <string.h>
+#include <ctype.h>
+#include <assert.h>
+#include "Position.h"
+
+// @formatter:off
+const int shogi_position_pawn_value[SHOGI_PAWN_DETAILED_COUNT] = {
+        0,    0,    // K - king is never counted, capturing it ends the game
+        540,  540,  // G
+        495,  495,  // S
+        405,  405,  // N
+        315,  315,  // L
+        855,  855,  // B
+        990,  990,  // R
+        90,   90,   // P
+        540,  540,  // S+
+        540,  540,  // N+
+        540,  540,  // L+
+        945,  945,  // B+
+        1395, 1395, // R+
+        540,  540   // P+
+};
+const int shogi_position_hand_value[SHOGI_PAWN_COUNT] = {0, 600, 550, 450, 350, 950, 1100, 100};
+static const char pawn_sfen_character[SHOGI_PAWN_COUNT] = {'K', 'G', 'S', 'N', 'L', 'B', 'R', 'P'};
+// @formatter:on
+
+// Move vectors of each pawn, derived once from the move patterns used by shogi_model_hitmap_calc()
+typedef struct _pawn_vectors {
+    int count;
+    int d_row[8];
+    int d_col[8];
+    gboolean slide[8];
+} PawnVectors;
+
+static PawnVectors pawn_vectors[SHOGI_PAWN_DETAILED_COUNT];
+
+static HASH zobrist_board[SHOGI_PAWN_DETAILED_COUNT][SHOGI_SQUARE_COUNT];
+static HASH zobrist_hand[2][SHOGI_PAWN_COUNT][19];
+static HASH zobrist_black_turn;
+
+#define SHOGI_POSITION_IS_LINE(symbol) ((symbol) == '-' || (symbol) == '|' || (symbol) == '/' || (symbol) == '\\')
+#define SHOGI_POSITION_ON_BOARD(row_ix, col_ix) ((row_ix) >= 0 && (row_ix) < 9 && (col_ix) >= 0 && (col_ix) < 9)
+#define SHOGI_POSITION_OWNS(pawn, is_black) ((is_black) ? SHOGI_PAWN_IS_BLACK(pawn) : SHOGI_PAWN_IS_WHITE(pawn))
+#define SHOGI_POSITION_AT(pos, sq) ((pos)->board[(sq) / 9][(sq) % 9])
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static guint64 splitmix64(guint64 *state) {
+    guint64 z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static void position_tables_init() {
+    static gsize initialized = 0;
+    if (!g_once_init_enter(&initialized))
+        return;
+
+    guint64 seed = 0x5109;
+    for (int p = 0; p < SHOGI_PAWN_DETAILED_COUNT; ++p)
+        for (int sq = 0; sq < SHOGI_SQUARE_COUNT; ++sq)
+            zobrist_board[p][sq] = (HASH) splitmix64(&seed);
+    for (int c = 0; c < 2; ++c)
+        for (int p = 0; p < SHOGI_PAWN_COUNT; ++p)
+            for (int n = 0; n < 19; ++n)
+                zobrist_hand[c][p][n] = (HASH) splitmix64(&seed);
+    zobrist_black_turn = (HASH) splitmix64(&seed);
+
+    for (int p = 0; p < SHOGI_PAWN_DETAILED_COUNT; ++p) {
+        PawnVectors *v = &pawn_vectors[p];
+        v->count = 0;
+        for (int d_row = -2; d_row <= 2; ++d_row) {
+            for (int d_col = -1; d_col <= 1; ++d_col) {
+                char symbol = shogi_model_pattern_at((enum SHOGI_PAWN_DETAILED) p, d_row, d_col);
+                if (symbol == ' ') continue;
+                assert(v->count < 8);
+                v->d_row[v->count] = d_row;
+                v->d_col[v->count] = d_col;
+                v->slide[v->count] = SHOGI_POSITION_IS_LINE(symbol);
+                v->count++;
+            }
+        }
+    }
+
+    g_once_init_leave(&initialized, 1);
+}
+
+/// same rule as pawn_can_possibly_move() in Model.c
+static inline gboolean position_pawn_can_move(int row, enum SHOGI_PAWN_DETAILED pawn) {
+    if (pawn == SHOGI_PAWN_DETAILED_N_BLACK && row <= 2) return FALSE;
+    if (pawn == SHOGI_PAWN_DETAILED_N_WHITE && row >= 8) return FALSE;
+    if (pawn == SHOGI_PAWN_DETAILED_L_BLACK && row == 1) return FALSE;
+    if (pawn == SHOGI_PAWN_DETAILED_L_WHITE && row == 9) return FALSE;
+    if (pawn == SHOGI_PAWN_DETAILED_P_BLACK && row == 1) return FALSE;
+    if (pawn == SHOGI_PAWN_DETAILED_P_WHITE && row == 9) return FALSE;
+    return TRUE;
+}
+
+/// same rule as pawn_can_promote() in Model.c
+static inline gboolean position_pawn_can_promote(gboolean is_black, int row_a, int row_b) {
+    if (is_black) return row_a <= 3 || row_b <= 3;
+    return row_a >= 7 || row_b >= 7;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+int shogi_position_king_square(const ShogiPosition *pos, gboolean black_king) {
+    enum SHOGI_PAWN_DETAILED king = SHOGI_PAWN_TO_DETAILED_TYPE(SHOGI_PAWN_K, black_king);
+    for (int sq = 0; sq < SHOGI_SQUARE_COUNT; ++sq)
+        if (SHOGI_POSITION_AT(pos, sq) == king)
+            return sq;
+    return -1;
+}
+
+void shogi_position_init(ShogiPosition *pos) {
+    shogi_position_from_sfen(pos, "lnsgkgsnl/1r5b1/ppppppppp/9/9/9/PPPPPPPPP/1B5R1/LNSGKGSNL b - 1");
+}
+
+gboolean shogi_position_from_sfen(ShogiPosition *pos, const char *sfen) {
+    position_tables_init();
+    memset(pos, 0, sizeof(ShogiPosition));
+
+    const char *it = sfen;
+    int row_ix = 0, col_ix = 0;
+    gboolean promoted = FALSE;
+    // board: rows from 1 to 9, each from column 9 to 1
+    for (; *it && *it != ' '; ++it) {
+        if (*it == '/') {
+            if (col_ix != 9) return FALSE;
+            row_ix++;
+            col_ix = 0;
+            continue;
+        }
+        if (row_ix >= 9) return FALSE;
+        if (isdigit((unsigned char) *it)) {
+            for (int n = *it - '0'; n > 0; --n) {
+                if (col_ix >= 9) return FALSE;
+                pos->board[row_ix][col_ix++] = SHOGI_PAWN_DETAILED_NONE;
+            }
+            continue;
+        }
+        if (*it == '+') {
+            promoted = TRUE;
+            continue;
+        }
+        const char *found = memchr(pawn_sfen_character, toupper((unsigned char) *it), SHOGI_PAWN_COUNT);
+        if (found == NULL || col_ix >= 9) return FALSE;
+        enum SHOGI_PAWN_DETAILED pawn = SHOGI_PAWN_TO_DETAILED_TYPE((enum SHOGI_PAWN) (found - pawn_sfen_character),
+                                                                    isupper((unsigned char) *it));
+        if (promoted) {
+            if (!SHOGI_PAWN_DETAILED_IS_PROMOTABLE(pawn)) return FALSE;
+            pawn += SHOGI_PAWN_PRO_OFFSET;
+            promoted = FALSE;
+        }
+        pos->board[row_ix][col_ix++] = pawn;
+    }
+    if (row_ix != 8 || col_ix != 9 || *it != ' ') return FALSE;
+
+    // side to move
+    it++;
+    if (*it != 'b' && *it != 'w') return FALSE;
+    pos->black_turn = *it == 'b';
+    it++;
+
+    // hands
+    if (*it == ' ') {
+        it++;
+        if (*it == '-') {
+            it++;
+        } else {
+            int count = 0;
+            for (; *it && *it != ' '; ++it) {
+                if (isdigit((unsigned char) *it)) {
+                    count = count * 10 + (*it - '0');
+                    continue;
+                }
+                const char *found = memchr(pawn_sfen_character, toupper((unsigned char) *it), SHOGI_PAWN_COUNT);
+                if (found == NULL || found == pawn_sfen_character) return FALSE; // king cannot be in hand
+                int *in_hand = &pos->hand[SHOGI_POSITION_COLOR(isupper((unsigned char) *it))][found - pawn_sfen_character];
+                *in_hand += count == 0 ? 1 : count;
+                if (*in_hand > 18) return FALSE;
+                count = 0;
+            }
+        }
+    }
+
+    // move number is ignored, ply counts from the set up
+    pos->ply = 0;
+    shogi_position_refresh(pos);
+    return TRUE;
+}
+
+char *shogi_position_to_sfen(const ShogiPosition *pos) {
+    // 9 rows * (9 pawns * 2 chars + '/') + side + hands + move number
+    char sfen[256];
+    int it = 0;
+
+    for (int row_ix = 0; row_ix < 9; ++row_ix) {
+        int empty = 0;
+        for (int col_ix = 0; col_ix < 9; ++col_ix) {
+            enum SHOGI_PAWN_DETAILED pawn = pos->board[row_ix][col_ix];
+            if (pawn == SHOGI_PAWN_DETAILED_NONE) {
+                empty++;
+                continue;
+            }
+            if (empty) sfen[it++] = (char) ('0' + empty);
+            empty = 0;
+            if (SHOGI_PAWN_IS_PROMOTED(pawn)) sfen[it++] = '+';
+            char symbol = pawn_sfen_character[SHOGI_PAWN_TO_BASE_TYPE(pawn)];
+            sfen[it++] = (char) (SHOGI_PAWN_IS_BLACK(pawn) ? symbol : tolower(symbol));
+        }
+        if (empty) sfen[it++] = (char) ('0' + empty);
+        sfen[it++] = row_ix == 8 ? ' ' : '/';
+    }
+    sfen[it++] = pos->black_turn ? 'b' : 'w';
+    sfen[it++] = ' ';
+
+    // hands in the conventional order R B G S N L P, black first
+    static const enum SHOGI_PAWN hand_order[] = {SHOGI_PAWN_R, SHOGI_PAWN_B, SHOGI_PAWN_G, SHOGI_PAWN_S,
+                                                 SHOGI_PAWN_N, SHOGI_PAWN_L, SHOGI_PAWN_P};
+    gboolean any = FALSE;
+    for (int color = 1; color >= 0; --color) {
+        for (int i = 0; i < 7; ++i) {
+            int count = pos->hand[color][hand_order[i]];
+            if (count == 0) continue;
+            if (count > 1) it += sprintf(sfen + it, "%d", count);
+            char symbol = pawn_sfen_character[hand_order[i]];
+            sfen[it++] = (char) (color == 1 ? symbol : tolower(symbol));
+            any = TRUE;
+        }
+    }
+    if (!any) sfen[it++] = '-';
+    sprintf(sfen + it, " %d", pos->ply + 1);
+
+    return g_strdup(sfen);
+}
+
+void shogi_position_from_model(ShogiPosition *pos, enum SHOGI_PAWN_DETAILED **board, int *hand[2], gboolean black_turn) {
+    for (int row = 0; row < 9; ++row)
+        for (int col = 0; col < 9; ++col)
+            pos->board[row][col] = board[row][col];
+    for (int c = 0; c < 2; ++c)
+        for (int p = 0; p < SHOGI_PAWN_COUNT; ++p)
+            pos->hand[c][p] = hand[c][p];
+    pos->black_turn = black_turn;
+    pos->ply = 0;
+    shogi_position_refresh(pos);
+}
+
+gboolean shogi_position_from_state(ShogiPosition *pos, const char *state, gboolean black_turn) {
+    if (strlen(state) != SHOGI_MODEL_SERIALIZED_STATE_LENGTH - 1)
+        return FALSE;
+    memset(pos, 0, sizeof(ShogiPosition));
+    for (int p = 0; p < SHOGI_PAWN_COUNT; ++p) {
+        pos->hand[0][p] = SHOGI_MODEL_FROM_COUNT_CODE(state[p]);
+        pos->hand[1][p] = SHOGI_MODEL_FROM_COUNT_CODE(state[SHOGI_PAWN_COUNT + p]);
+        if (pos->hand[0][p] < 0 || pos->hand[0][p] > 18 || pos->hand[1][p] < 0 || pos->hand[1][p] > 18)
+            return FALSE;
+    }
+    for (int sq = 0; sq < SHOGI_SQUARE_COUNT; ++sq) {
+        char code = state[2 * SHOGI_PAWN_COUNT + sq];
+        if (code != 32 && (code < 33 || code >= 33 + SHOGI_PAWN_DETAILED_COUNT))
+            return FALSE;
+        pos->board[sq / 9][sq % 9] = SHOGI_MODEL_FROM_PAWN_CODE(code);
+    }
+    pos->black_turn = black_turn;
+    shogi_position_refresh(pos);
+    return TRUE;
+}
+
+void shogi_position_refresh(ShogiPosition *pos) {
+    position_tables_init();
+    pos->key = pos->black_turn ? zobrist_black_turn : 0;
+    pos->material = 0;
+    for (int sq = 0; sq < SHOGI_SQUARE_COUNT; ++sq) {
+        enum SHOGI_PAWN_DETAILED pawn = SHOGI_POSITION_AT(pos, sq);
+        if (pawn == SHOGI_PAWN_DETAILED_NONE) continue;
+        pos->key ^= zobrist_board[pawn][sq];
+        pos->material += SHOGI_PAWN_IS_BLACK(pawn) ? shogi_position_pawn_value[pawn] : -shogi_position_pawn_value[pawn];
+    }
+    for (int c = 0; c < 2; ++c) {
+        for (int p = 0; p < SHOGI_PAWN_COUNT; ++p) {
+            pos->key ^= zobrist_hand[c][p][pos->hand[c][p]];
+            pos->material += (c == 1 ? 1 : -1) * pos->hand[c][p] * shogi_position_hand_value[p];
+        }
+    }
+}
+
+HASH shogi_position_board_key(const ShogiPosition *pos) {
+    HASH key = pos->key;
+    for (int c = 0; c < 2; ++c)
+        for (int p = 0; p < SHOGI_PAWN_COUNT; ++p)
+            key ^= zobrist_hand[c][p][pos->hand[c][p]];
+    return key;
+}
+
+void shogi_position_do_move(ShogiPosition *pos, ShogiMove move) {
+    int to = SHOGI_MOVE_TO(move);
+    enum SHOGI_PAWN_DETAILED pawn = SHOGI_MOVE_PAWN(move);
+    int color = SHOGI_POSITION_COLOR(pos->black_turn);
+    int sign = pos->black_turn ? 1 : -1;
+
+    if (SHOGI_MOVE_IS_DROP(move)) {
+        enum SHOGI_PAWN base = SHOGI_PAWN_TO_BASE_TYPE(pawn);
+        pos->key ^= zobrist_hand[color][base][pos->hand[color][base]];
+        pos->hand[color][base]--;
+        pos->key ^= zobrist_hand[color][base][pos->hand[color][base]];
+        pos->board[to / 9][to % 9] = pawn;
+        pos->key ^= zobrist_board[pawn][to];
+        pos->material += sign * (shogi_position_pawn_value[pawn] - shogi_position_hand_value[base]);
+    } else {
+        int from = SHOGI_MOVE_FROM(move);
+        enum SHOGI_PAWN_DETAILED captured = SHOGI_MOVE_CAPTURED(move);
+        enum SHOGI_PAWN_DETAILED placed = SHOGI_MOVE_PLACED(move);
+
+        if (captured != SHOGI_PAWN_DETAILED_NONE) {
+            pos->key ^= zobrist_board[captured][to];
+            pos->material += sign * shogi_position_pawn_value[captured];
+            enum SHOGI_PAWN base = SHOGI_PAWN_TO_BASE_TYPE(captured);
+            if (base != SHOGI_PAWN_K) { // king is never added to the hand, as in shogi_model_click()
+                pos->key ^= zobrist_hand[color][base][pos->hand[color][base]];
+                pos->hand[color][base]++;
+                pos->key ^= zobrist_hand[color][base][pos->hand[color][base]];
+                pos->material += sign * shogi_position_hand_value[base];
+            }
+        }
+        pos->board[from / 9][from % 9] = SHOGI_PAWN_DETAILED_NONE;
+        pos->key ^= zobrist_board[pawn][from];
+        pos->board[to / 9][to % 9] = placed;
+        pos->key ^= zobrist_board[placed][to];
+        pos->material += sign * (shogi_position_pawn_value[placed] - shogi_position_pawn_value[pawn]);
+    }
+
+    pos->black_turn = !pos->black_turn;
+    pos->key ^= zobrist_black_turn;
+    pos->ply++;
+}
+
+void shogi_position_undo_move(ShogiPosition *pos, ShogiMove move) {
+    pos->black_turn = !pos->black_turn;
+    pos->key ^= zobrist_black_turn;
+    pos->ply--;
+
+    int to = SHOGI_MOVE_TO(move);
+    enum SHOGI_PAWN_DETAILED pawn = SHOGI_MOVE_PAWN(move);
+    int color = SHOGI_POSITION_COLOR(pos->black_turn);
+    int sign = pos->black_turn ? 1 : -1;
+
+    if (SHOGI_MOVE_IS_DROP(move)) {
+        enum SHOGI_PAWN base = SHOGI_PAWN_TO_BASE_TYPE(pawn);
+        pos->key ^= zobrist_board[pawn][to];
+        pos->board[to / 9][to % 9] = SHOGI_PAWN_DETAILED_NONE;
+        pos->key ^= zobrist_hand[color][base][pos->hand[color][base]];
+        pos->hand[color][base]++;
+        pos->key ^= zobrist_hand[color][base][pos->hand[color][base]];
+        pos->material -= sign * (shogi_position_pawn_value[pawn] - shogi_position_hand_value[base]);
+    } else {
+        int from = SHOGI_MOVE_FROM(move);
+        enum SHOGI_PAWN_DETAILED captured = SHOGI_MOVE_CAPTURED(move);
+        enum SHOGI_PAWN_DETAILED placed = SHOGI_MOVE_PLACED(move);
+
+        pos->key ^= zobrist_board[placed][to];
+        pos->board[to / 9][to % 9] = captured;
+        pos->key ^= zobrist_board[pawn][from];
+        pos->board[from / 9][from % 9] = pawn;
+        pos->material -= sign * (shogi_position_pawn_value[placed] - shogi_position_pawn_value[pawn]);
+
+        if (captured != SHOGI_PAWN_DETAILED_NONE) {
+            pos->key ^= zobrist_board[captured][to];
+            pos->material -= sign * shogi_position_pawn_value[captured];
+            enum SHOGI_PAWN base = SHOGI_PAWN_TO_BASE_TYPE(captured);
+            if (base != SHOGI_PAWN_K) {
+                pos->key ^= zobrist_hand[color][base][pos->hand[color][base]];
+                pos->hand[color][base]--;
+                pos->key ^= zobrist_hand[color][base][pos->hand[color][base]];
+                pos->material -= sign * shogi_position_hand_value[base];
+            }
+        }
+    }
+}
+
+void shogi_position_do_null_move(ShogiPosition *pos) {
+    pos->black_turn = !pos->black_turn;
+    pos->key ^= zobrist_black_turn;
+    pos->ply++;
+}
+
+void shogi_position_undo_null_move(ShogiPosition *pos) {
+    pos->black_turn = !pos->black_turn;
+    pos->key ^= zobrist_black_turn;
+    pos->ply--;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// adds move from -> to with all available promotion variants
+static inline int add_board_move(ShogiMove *moves, int count, int from, int to,
+                                 enum SHOGI_PAWN_DETAILED pawn, enum SHOGI_PAWN_DETAILED captured) {
+    gboolean is_black = SHOGI_PAWN_IS_BLACK(pawn);
+    int to_row = SHOGI_SQUARE_ROW(to);
+    if (SHOGI_PAWN_DETAILED_IS_PROMOTABLE(pawn) && position_pawn_can_promote(is_black, SHOGI_SQUARE_ROW(from), to_row))
+        moves[count++] = SHOGI_MOVE_NEW(from, to, pawn, captured, 1);
+    if (position_pawn_can_move(to_row, pawn))
+        moves[count++] = SHOGI_MOVE_NEW(from, to, pawn, captured, 0);
+    return count;
+}
+
+/// generates moves of pawns on board, captures or non captures depending on want_captures
+static int generate_board_moves(const ShogiPosition *pos, ShogiMove *moves, int count, gboolean want_captures) {
+    gboolean black = pos->black_turn;
+    for (int from = 0; from < SHOGI_SQUARE_COUNT; ++from) {
+        enum SHOGI_PAWN_DETAILED pawn = SHOGI_POSITION_AT(pos, from);
+        if (!SHOGI_POSITION_OWNS(pawn, black)) continue;
+
+        const PawnVectors *v = &pawn_vectors[pawn];
+        int from_row = from / 9, from_col = from % 9;
+        for (int i = 0; i < v->count; ++i) {
+            int row = from_row + v->d_row[i];
+            int col = from_col + v->d_col[i];
+            while (SHOGI_POSITION_ON_BOARD(row, col)) {
+                enum SHOGI_PAWN_DETAILED target = pos->board[row][col];
+                if (target == SHOGI_PAWN_DETAILED_NONE) {
+                    if (!want_captures)
+                        count = add_board_move(moves, count, from, row * 9 + col, pawn, target);
+                } else {
+                    if (want_captures && !SHOGI_POSITION_OWNS(target, black))
+                        count = add_board_move(moves, count, from, row * 9 + col, pawn, target);
+                    break;
+                }
+                if (!v->slide[i]) break;
+                row += v->d_row[i];
+                col += v->d_col[i];
+            }
+        }
+    }
+    return count;
+}
+
+/// checks if dropping a pawn on square ahead of enemy king would be forbidden drop mate
+static gboolean is_drop_mate(const ShogiPosition *pos, int to) {
+    enum SHOGI_PAWN_DETAILED *rows[9];
+    char hitmap_data[9][9];
+    char *hitmap[9];
+    for (int i = 0; i < 9; ++i) {
+        rows[i] = (enum SHOGI_PAWN_DETAILED *) pos->board[i];
+        hitmap[i] = hitmap_data[i];
+    }
+    shogi_model_hitmap_clear(hitmap);
+    hitmap[to / 9][to % 9] = 'o';
+    shogi_model_exclude_drop_mate(rows, hitmap, pos->black_turn);
+    return hitmap[to / 9][to % 9] != 'o';
+}
+
+static int generate_drops(const ShogiPosition *pos, ShogiMove *moves, int count) {
+    gboolean black = pos->black_turn;
+    const int *hand = pos->hand[SHOGI_POSITION_COLOR(black)];
+
+    // square ahead of enemy king, the only one where pawn drop can mate
+    int king = shogi_position_king_square(pos, !black);
+    int mate_square = -1;
+    if (king != -1) {
+        int row_ix = king / 9 + (black ? 1 : -1);
+        if (row_ix >= 0 && row_ix < 9)
+            mate_square = row_ix * 9 + king % 9;
+    }
+
+    for (int base = SHOGI_PAWN_G; base < SHOGI_PAWN_COUNT; ++base) {
+        if (hand[base] == 0) continue;
+        enum SHOGI_PAWN_DETAILED pawn = SHOGI_PAWN_TO_DETAILED_TYPE(base, black);
+
+        for (int col_ix = 0; col_ix < 9; ++col_ix) {
+            if (base == SHOGI_PAWN_P) { // two pawns in column rule
+                gboolean has_pawn = FALSE;
+                for (int row_ix = 0; row_ix < 9 && !has_pawn; ++row_ix)
+                    has_pawn = pos->board[row_ix][col_ix] == pawn;
+                if (has_pawn) continue;
+            }
+            for (int row_ix = 0; row_ix < 9; ++row_ix) {
+                if (pos->board[row_ix][col_ix] != SHOGI_PAWN_DETAILED_NONE ||
+                    !position_pawn_can_move(row_ix + 1, pawn))
+                    continue;
+                int to = row_ix * 9 + col_ix;
+                if (base == SHOGI_PAWN_P && to == mate_square && is_drop_mate(pos, to))
+                    continue;
+                moves[count++] = SHOGI_MOVE_DROP_NEW(to, pawn);
+            }
+        }
+    }
+    return count;
+}
+
+int shogi_position_generate_captures(const ShogiPosition *pos, ShogiMove *moves) {
+    return generate_board_moves(pos, moves, 0, TRUE);
+}
+
+int shogi_position_generate_quiets(const ShogiPosition *pos, ShogiMove *moves) {
+    int count = generate_board_moves(pos, moves, 0, FALSE);
+    return generate_drops(pos, moves, count);
+}
+
+int shogi_position_generate_all(const ShogiPosition *pos, ShogiMove *moves) {
+    int count = generate_board_moves(pos, moves, 0, TRUE);
+    count = generate_board_moves(pos, moves, count, FALSE);
+    return generate_drops(pos, moves, count);
+}
+
+gboolean shogi_position_is_pseudo_legal(const ShogiPosition *pos, ShogiMove move) {
+    if (move == SHOGI_MOVE_NONE) return FALSE;
+
+    gboolean black = pos->black_turn;
+    enum SHOGI_PAWN_DETAILED pawn = SHOGI_MOVE_PAWN(move);
+    int to = SHOGI_MOVE_TO(move);
+    if (pawn >= SHOGI_PAWN_DETAILED_COUNT || to >= SHOGI_SQUARE_COUNT || !SHOGI_POSITION_OWNS(pawn, black))
+        return FALSE;
+
+    if (SHOGI_MOVE_IS_DROP(move)) {
+        enum SHOGI_PAWN base = SHOGI_PAWN_TO_BASE_TYPE(pawn);
+        if (SHOGI_PAWN_IS_PROMOTED(pawn) || base == SHOGI_PAWN_K || pos->hand[SHOGI_POSITION_COLOR(black)][base] == 0)
+            return FALSE;
+        if (SHOGI_POSITION_AT(pos, to) != SHOGI_PAWN_DETAILED_NONE || !position_pawn_can_move(SHOGI_SQUARE_ROW(to), pawn))
+            return FALSE;
+        if (base == SHOGI_PAWN_P) {
+            for (int row_ix = 0; row_ix < 9; ++row_ix)
+                if (pos->board[row_ix][to % 9] == pawn)
+                    return FALSE;
+            int king = shogi_position_king_square(pos, !black);
+            if (king != -1 && king % 9 == to % 9 && king / 9 == to / 9 + (black ? 1 : -1) && is_drop_mate(pos, to))
+                return FALSE;
+        }
+        return TRUE;
+    }
+
+    int from = SHOGI_MOVE_FROM(move);
+    enum SHOGI_PAWN_DETAILED captured = SHOGI_MOVE_CAPTURED(move);
+    if (from >= SHOGI_SQUARE_COUNT || from == to || SHOGI_POSITION_AT(pos, from) != pawn ||
+        SHOGI_POSITION_AT(pos, to) != captured || SHOGI_POSITION_OWNS(captured, black))
+        return FALSE;
+
+    // promotion must be available, and a pawn which cannot move afterwards must promote
+    if (SHOGI_MOVE_IS_PROMOTION(move)) {
+        if (!SHOGI_PAWN_DETAILED_IS_PROMOTABLE(pawn) ||
+            !position_pawn_can_promote(black, SHOGI_SQUARE_ROW(from), SHOGI_SQUARE_ROW(to)))
+            return FALSE;
+    } else if (!position_pawn_can_move(SHOGI_SQUARE_ROW(to), pawn)) {
+        return FALSE;
+    }
+
+    // the destination must be reachable with a jump or along a free line
+    int d_row = to / 9 - from / 9, d_col = to % 9 - from % 9;
+    char symbol = shogi_model_pattern_at(pawn, d_row, d_col);
+    if (symbol != ' ')
+        return TRUE;
+
+    int distance = MAX(ABS(d_row), ABS(d_col));
+    if ((d_row != 0 && ABS(d_row) != distance) || (d_col != 0 && ABS(d_col) != distance))
+        return FALSE; // not on a line
+    int step_row = d_row / distance, step_col = d_col / distance;
+    if (!SHOGI_POSITION_IS_LINE(shogi_model_pattern_at(pawn, step_row, step_col)))
+        return FALSE;
+    for (int i = 1; i < distance; ++i)
+        if (pos->board[from / 9 + i * step_row][from % 9 + i * step_col] != SHOGI_PAWN_DETAILED_NONE)
+            return FALSE;
+    return TRUE;
+}
+
+int shogi_position_attackers(enum SHOGI_PAWN_DETAILED board[9][9], int sq, gboolean by_black, int *attackers) {
+    static const int directions[8][2] = {{-1, -1}, {-1, 0}, {-1, 1}, {0, -1}, {0, 1}, {1, -1}, {1, 0}, {1, 1}};
+    static const int knights[4][2] = {{-2, -1}, {-2, 1}, {2, -1}, {2, 1}};
+    int row = sq / 9, col = sq % 9;
+    int count = 0;
+
+    // walk from the square outwards, first pawn on each line attacks if it's pattern points back at the square
+    for (int d = 0; d < 8; ++d) {
+        int r = row + directions[d][0], c = col + directions[d][1];
+        for (int distance = 1; SHOGI_POSITION_ON_BOARD(r, c); ++distance) {
+            enum SHOGI_PAWN_DETAILED pawn = board[r][c];
+            if (pawn != SHOGI_PAWN_DETAILED_NONE) {
+                if (SHOGI_POSITION_OWNS(pawn, by_black)) {
+                    char symbol = shogi_model_pattern_at(pawn, -directions[d][0], -directions[d][1]);
+                    if ((distance == 1 && symbol != ' ') || SHOGI_POSITION_IS_LINE(symbol)) {
+                        if (attackers) attackers[count] = r * 9 + c;
+                        count++;
+                    }
+                }
+                break;
+            }
+            r += directions[d][0];
+            c += directions[d][1];
+        }
+    }
+
+    for (int k = 0; k < 4; ++k) {
+        int r = row + knights[k][0], c = col + knights[k][1];
+        if (!SHOGI_POSITION_ON_BOARD(r, c)) continue;
+        enum SHOGI_PAWN_DETAILED pawn = board[r][c];
+        if (SHOGI_POSITION_OWNS(pawn, by_black) &&
+            shogi_model_pattern_at(pawn, -knights[k][0], -knights[k][1]) == 'o') {
+            if (attackers) attackers[count] = r * 9 + c;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+gboolean shogi_position_gives_check(const ShogiPosition *pos, ShogiMove move) {
+    int king = shogi_position_king_square(pos, !pos->black_turn);
+    if (king == -1) return FALSE;
+
+    // check comes from a pawn next to the king (or knight's jump away), or along a line through the king
+    // from destination or uncovered by leaving origin
+    int to = SHOGI_MOVE_TO(move);
+    int d_row = ABS(to / 9 - king / 9), d_col = ABS(to % 9 - king % 9);
+    gboolean possible = (d_row <= 2 && d_col <= 2) || d_row == 0 || d_col == 0 || d_row == d_col;
+    if (!possible && !SHOGI_MOVE_IS_DROP(move)) {
+        int from = SHOGI_MOVE_FROM(move);
+        d_row = ABS(from / 9 - king / 9);
+        d_col = ABS(from % 9 - king % 9);
+        possible = d_row == 0 || d_col == 0 || d_row == d_col;
+    }
+    if (!possible) return FALSE;
+
+    enum SHOGI_PAWN_DETAILED board[9][9];
+    memcpy(board, pos->board, sizeof(board));
+    if (!SHOGI_MOVE_IS_DROP(move)) {
+        int from = SHOGI_MOVE_FROM(move);
+        board[from / 9][from % 9] = SHOGI_PAWN_DETAILED_NONE;
+    }
+    board[to / 9][to % 9] = SHOGI_MOVE_PLACED(move);
+    return shogi_position_attackers(board, king, pos->black_turn, NULL) > 0;
+}
+
+gboolean shogi_position_in_check(const ShogiPosition *pos, gboolean check_for_black) {
+    int king = shogi_position_king_square(pos, check_for_black);
+    if (king == -1) return FALSE;
+    return shogi_position_attackers((enum SHOGI_PAWN_DETAILED (*)[9]) pos->board, king, !check_for_black, NULL) > 0;
+}
+
+void shogi_position_move_notation(ShogiMove move, char *notation) {
+    static const char pawn_base_character[SHOGI_PAWN_COUNT] = {'K', 'G', 'S', 'N', 'L', 'B', 'R', 'P'};
+    enum SHOGI_PAWN_DETAILED pawn = SHOGI_MOVE_PAWN(move);
+    int to = SHOGI_MOVE_TO(move);
+    int it = 0;
+
+    if (SHOGI_PAWN_IS_PROMOTED(pawn))
+        notation[it++] = '+';
+    notation[it++] = pawn_base_character[SHOGI_PAWN_TO_BASE_TYPE(pawn)];
+    if (SHOGI_MOVE_IS_DROP(move)) {
+        notation[it++] = '*';
+    } else {
+        int from = SHOGI_MOVE_FROM(move);
+        notation[it++] = (char) ('0' + SHOGI_SQUARE_COL(from));
+        notation[it++] = (char) ('0' + SHOGI_SQUARE_ROW(from));
+        notation[it++] = SHOGI_MOVE_IS_CAPTURE(move) ? 'x' : '-';
+    }
+    notation[it++] = (char) ('0' + SHOGI_SQUARE_COL(to));
+    notation[it++] = (char) ('0' + SHOGI_SQUARE_ROW(to));
+
+    if (!SHOGI_MOVE_IS_DROP(move)) {
+        int from = SHOGI_MOVE_FROM(move);
+        if (SHOGI_MOVE_IS_PROMOTION(move))
+            notation[it++] = '+';
+        else if (SHOGI_PAWN_DETAILED_IS_PROMOTABLE(pawn) && position_pawn_can_move(SHOGI_SQUARE_ROW(to), pawn) &&
+                 position_pawn_can_promote(SHOGI_PAWN_IS_BLACK(pawn), SHOGI_SQUARE_ROW(from), SHOGI_SQUARE_ROW(to)))
+            notation[it++] = '='; // promotion was declined
+    }
+    notation[it] = '\0';
+}
+
+ShogiMove shogi_position_parse_move(const ShogiPosition *pos, const char *notation) {
+    // destination follows the movement character, only moves to it need to be written down and compared
+    const char *movement = strpbrk(notation, "-x*");
+    if (movement == NULL || movement[1] < '1' || movement[1] > '9' || movement[2] < '1' || movement[2] > '9')
+        return SHOGI_MOVE_NONE;
+    int to = SHOGI_SQUARE(movement[1] - '0', movement[2] - '0');
+
+    ShogiMove moves[SHOGI_POSITION_MAX_MOVES];
+    char move_notation[SHOGI_MODEL_MOVE_LENGTH];
+    int count = shogi_position_generate_all(pos, moves);
+    for (int i = 0; i < count; ++i) {
+        if (SHOGI_MOVE_TO(moves[i]) != to) continue;
+        shogi_position_move_notation(moves[i], move_notation);
+        if (strcmp(move_notation, notation) == 0)
+            return moves[i];
+    }
+    return SHOGI_MOVE_NONE;
+}
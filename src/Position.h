@@ -0,0 +1,226 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#ifndef SHOGI_POSITION_H
+#define SHOGI_POSITION_H
+
+#include <glib.h>
+#include "Model.h"
+#include "Utils.h"
+
+// Position is a self contained copy of the game state used by the engine. Unlike ShogiModel it holds no
+// selection or history, so it can be copied, searched and modified on any thread.
+
+/// squares are indexed as in serialized state: row index * 9 + column index (see ROW() and COL() in Model.h)
+#define SHOGI_SQUARE(col, row)          (ROW(row) * 9 + COL(col))
+#define SHOGI_SQUARE_COL(sq)            (9 - (sq) % 9)
+#define SHOGI_SQUARE_ROW(sq)            ((sq) / 9 + 1)
+#define SHOGI_SQUARE_COUNT              81
+
+#define SHOGI_POSITION_MAX_MOVES        600
+#define SHOGI_POSITION_COLOR(is_black)  ((is_black) ? 1 : 0) // index to hand, same as in ShogiModel
+
+/// Moves are packed into 32 bits:
+/// [0..6] destination square, [7..13] origin square, [14] promotion, [15] drop,
+/// [16..20] moving (or dropped) pawn, [21..25] captured pawn + 1, 0 if nothing is captured
+typedef guint32 ShogiMove;
+
+#define SHOGI_MOVE_NONE                 ((ShogiMove) 0)
+#define SHOGI_MOVE_NEW(from, to, pawn, captured, promote) ((ShogiMove) ((to) | ((from) << 7) | \
+                                                                        ((promote) ? 1 << 14 : 0) | \
+                                                                        ((pawn) << 16) | \
+                                                                        (((captured) + 1) << 21)))
+#define SHOGI_MOVE_DROP_NEW(to, pawn)   ((ShogiMove) ((to) | (1 << 15) | ((pawn) << 16)))
+#define SHOGI_MOVE_TO(move)             ((int) ((move) & 0x7F))
+#define SHOGI_MOVE_FROM(move)           ((int) (((move) >> 7) & 0x7F))
+#define SHOGI_MOVE_IS_PROMOTION(move)   (((move) >> 14) & 1)
+#define SHOGI_MOVE_IS_DROP(move)        (((move) >> 15) & 1)
+#define SHOGI_MOVE_PAWN(move)           ((enum SHOGI_PAWN_DETAILED) (((move) >> 16) & 0x1F))
+#define SHOGI_MOVE_CAPTURED(move)       ((enum SHOGI_PAWN_DETAILED) ((int) (((move) >> 21) & 0x1F) - 1))
+#define SHOGI_MOVE_IS_CAPTURE(move)     ((((move) >> 21) & 0x1F) != 0)
+#define SHOGI_MOVE_IS_KING_CAPTURE(move) (SHOGI_MOVE_IS_CAPTURE(move) && \
+                                          SHOGI_PAWN_TO_BASE_TYPE(SHOGI_MOVE_CAPTURED(move)) == SHOGI_PAWN_K)
+/// pawn standing on destination square after the move
+#define SHOGI_MOVE_PLACED(move)         ((enum SHOGI_PAWN_DETAILED) (SHOGI_MOVE_PAWN(move) + \
+                                         (SHOGI_MOVE_IS_PROMOTION(move) ? SHOGI_PAWN_PRO_OFFSET : 0)))
+
+typedef struct _shogi_position {
+    enum SHOGI_PAWN_DETAILED board[9][9]; // board as in ShogiModel
+    int hand[2][SHOGI_PAWN_COUNT]; // hands of players - [0]=white [1]=black
+    gboolean black_turn;
+    HASH key; // zobrist key of the position
+    int material; // material balance from black's perspective
+    int ply; // moves made since position was set up
+} ShogiPosition;
+
+/// values of pawns on board, indexed with enum SHOGI_PAWN_DETAILED
+extern const int shogi_position_pawn_value[SHOGI_PAWN_DETAILED_COUNT];
+/// values of pawns in hand, indexed with enum SHOGI_PAWN
+extern const int shogi_position_hand_value[SHOGI_PAWN_COUNT];
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Sets up position to the initial state of the game, the same as shogi_model_reset()
+ * @param pos position to set up
+ */
+void shogi_position_init(ShogiPosition *pos);
+
+/**
+ * Sets up position from SFEN string, for example
+ * "lnsgkgsnl/1r5b1/ppppppppp/9/9/9/PPPPPPPPP/1B5R1/LNSGKGSNL b - 1"
+ * @param pos position to set up
+ * @param sfen SFEN string
+ * @return true on success, false if string is malformed. Position is undefined on failure
+ */
+gboolean shogi_position_from_sfen(ShogiPosition *pos, const char *sfen);
+
+/**
+ * Writes position as SFEN string
+ * @param pos position
+ * @return newly allocated string, free with g_free()
+ */
+char *shogi_position_to_sfen(const ShogiPosition *pos);
+
+/**
+ * Sets up position from the board and hands of the game model
+ * @param pos position to set up
+ * @param board board of the model, as returned by shogi_model_get_board()
+ * @param hand hands of the model - [0]=white [1]=black
+ * @param black_turn true if black is to move
+ */
+void shogi_position_from_model(ShogiPosition *pos, enum SHOGI_PAWN_DETAILED **board, int *hand[2], gboolean black_turn);
+
+/**
+ * Sets up position from state serialized by shogi_model_serialize_state()
+ * @param pos position to set up
+ * @param state serialized state, SHOGI_MODEL_SERIALIZED_STATE_LENGTH - 1 characters
+ * @param black_turn true if black is to move, the state doesn't store it
+ * @return true on success, false if state is malformed
+ */
+gboolean shogi_position_from_state(ShogiPosition *pos, const char *state, gboolean black_turn);
+
+/**
+ * Recalculates zobrist key and material of the position after it's fields were changed directly
+ * @param pos position to update
+ */
+void shogi_position_refresh(ShogiPosition *pos);
+
+/**
+ * Returns zobrist key of the board and player to move, without pawns in hands
+ * @param pos position
+ * @return key of position without hands
+ */
+HASH shogi_position_board_key(const ShogiPosition *pos);
+
+/**
+ * Makes move on position. Move must be pseudo legal in this position
+ * @param pos position
+ * @param move move to make
+ */
+void shogi_position_do_move(ShogiPosition *pos, ShogiMove move);
+
+/**
+ * Takes back the move made with shogi_position_do_move()
+ * @param pos position
+ * @param move last move made on position
+ */
+void shogi_position_undo_move(ShogiPosition *pos, ShogiMove move);
+
+/**
+ * Passes the turn to the other player without moving, used by null move pruning
+ * @param pos position
+ */
+void shogi_position_do_null_move(ShogiPosition *pos);
+
+/**
+ * Takes back the null move made with shogi_position_do_null_move()
+ * @param pos position
+ */
+void shogi_position_undo_null_move(ShogiPosition *pos);
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Generates captures (with promotions) of the player to move
+ * @param pos position
+ * @param moves array of at least SHOGI_POSITION_MAX_MOVES moves
+ * @return number of generated moves
+ */
+int shogi_position_generate_captures(const ShogiPosition *pos, ShogiMove *moves);
+
+/**
+ * Generates non capturing moves and drops of the player to move
+ * @param pos position
+ * @param moves array of at least SHOGI_POSITION_MAX_MOVES moves
+ * @return number of generated moves
+ */
+int shogi_position_generate_quiets(const ShogiPosition *pos, ShogiMove *moves);
+
+/**
+ * Generates all moves of the player to move. Same as captures followed by quiets
+ * @param pos position
+ * @param moves array of at least SHOGI_POSITION_MAX_MOVES moves
+ * @return number of generated moves
+ */
+int shogi_position_generate_all(const ShogiPosition *pos, ShogiMove *moves);
+
+/**
+ * Checks if move could have been generated in this position. Used to validate moves from tables
+ * @param pos position
+ * @param move move to validate
+ * @return true if move is pseudo legal
+ */
+gboolean shogi_position_is_pseudo_legal(const ShogiPosition *pos, ShogiMove move);
+
+/**
+ * Finds pieces of given player attacking given square
+ * @param board board
+ * @param sq attacked square
+ * @param by_black true for black attackers, false for white
+ * @param attackers array of at least 16 squares for found attackers, may be NULL
+ * @return number of attackers
+ */
+int shogi_position_attackers(enum SHOGI_PAWN_DETAILED board[9][9], int sq, gboolean by_black, int *attackers);
+
+/**
+ * Checks if move attacks king of the opponent, directly or by uncovering a line
+ * @param pos position before the move
+ * @param move move of the player to move
+ * @return true if opponent's king is attacked after the move
+ */
+gboolean shogi_position_gives_check(const ShogiPosition *pos, ShogiMove move);
+
+/**
+ * Finds king of given player
+ * @param pos position
+ * @param black_king true to find black's king
+ * @return square of the king or -1 if there is none
+ */
+int shogi_position_king_square(const ShogiPosition *pos, gboolean black_king);
+
+/**
+ * Checks if king of given player is attacked
+ * @param pos position
+ * @param check_for_black true to check black's king
+ * @return true if king is attacked
+ */
+gboolean shogi_position_in_check(const ShogiPosition *pos, gboolean check_for_black);
+
+/**
+ * Writes the move in the same notation the history uses, for example P77-76 or Bx22+
+ * @param move move
+ * @param notation buffer of SHOGI_MODEL_MOVE_LENGTH chars
+ */
+void shogi_position_move_notation(ShogiMove move, char *notation);
+
+/**
+ * Finds the move written in history notation among moves of the position
+ * @param pos position
+ * @param notation move, for example P77-76, Bx22+ or P*55
+ * @return move or SHOGI_MOVE_NONE if there's no such move in the position
+ */
+ShogiMove shogi_position_parse_move(const ShogiPosition *pos, const char *notation);
+
+#endif //SHOGI_POSITION_H
@@ -0,0 +1,55 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#include "Replay.h"
+#include "Logger.h"
+#include "Trace.h"
+
+ShogiReplay *shogi_replay_new(const ShogiPosition *start) {
+    ShogiReplay *replay = g_new(ShogiReplay, 1);
+    replay->keyframes = g_array_new(FALSE, FALSE, sizeof(ShogiPosition));
+    replay->moves = g_array_new(FALSE, FALSE, sizeof(ShogiMove));
+    replay->last = *start;
+    g_array_append_vals(replay->keyframes, start, 1);
+    return replay;
+}
+
+void shogi_replay_free(ShogiReplay *replay) {
+    if (replay == NULL) return;
+    g_array_free(replay->keyframes, TRUE);
+    g_array_free(replay->moves, TRUE);
+    g_free(replay);
+}
+
+gboolean shogi_replay_append(ShogiReplay *replay, const char *notation) {
+    ShogiMove move = shogi_position_parse_move(&replay->last, notation);
+    if (move == SHOGI_MOVE_NONE) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_WARN, "Move %s of ply %d cannot be replayed.", notation,
+                         (int) replay->moves->len);
+        return FALSE;
+    }
+    shogi_position_do_move(&replay->last, move);
+    g_array_append_vals(replay->moves, &move, 1);
+    if (replay->moves->len % SHOGI_REPLAY_KEYFRAME_INTERVAL == 0)
+        g_array_append_vals(replay->keyframes, &replay->last, 1);
+    return TRUE;
+}
+
+int shogi_replay_length(const ShogiReplay *replay) {
+    return (int) replay->moves->len;
+}
+
+ShogiMove shogi_replay_move(const ShogiReplay *replay, int ply) {
+    return g_array_index(replay->moves, ShogiMove, ply);
+}
+
+int shogi_replay_seek(const ShogiReplay *replay, int ply, ShogiPosition *pos) {
+    SHOGI_TRACE_FUNCTION();
+    ply = CLAMP(ply, 0, shogi_replay_length(replay));
+    int keyframe = ply / SHOGI_REPLAY_KEYFRAME_INTERVAL;
+    *pos = g_array_index(replay->keyframes, ShogiPosition, keyframe);
+    for (int i = keyframe * SHOGI_REPLAY_KEYFRAME_INTERVAL; i < ply; ++i)
+        shogi_position_do_move(pos, shogi_replay_move(replay, i));
+    return ply;
+}
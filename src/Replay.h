@@ -0,0 +1,68 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#ifndef SHOGI_REPLAY_H
+#define SHOGI_REPLAY_H
+
+#include <glib.h>
+#include "Position.h"
+
+// Random access to positions of a game. Replay keeps a full position every SHOGI_REPLAY_KEYFRAME_INTERVAL plies
+// and the moves in between, so any ply is reached from the nearest keyframe before it with at most
+// SHOGI_REPLAY_KEYFRAME_INTERVAL - 1 moves, no matter how long the game is. Moves are appended as they are played.
+
+#define SHOGI_REPLAY_KEYFRAME_INTERVAL 16
+
+typedef struct _shogi_replay {
+    GArray *keyframes; // ShogiPosition at ply i * SHOGI_REPLAY_KEYFRAME_INTERVAL
+    GArray *moves; // ShogiMove played at each ply
+    ShogiPosition last; // position after the last move, next moves are appended to it
+} ShogiReplay;
+
+/**
+ * Creates replay of a game starting in position
+ * @param start position before the first move
+ * @return new replay
+ */
+ShogiReplay *shogi_replay_new(const ShogiPosition *start);
+
+/**
+ * Frees replay
+ * @param replay replay to free
+ */
+void shogi_replay_free(ShogiReplay *replay);
+
+/**
+ * Appends move played in the last position
+ * @param replay replay
+ * @param notation move in history notation, for example P77-76
+ * @return false if there's no such move in the last position, replay is left unchanged
+ */
+gboolean shogi_replay_append(ShogiReplay *replay, const char *notation);
+
+/**
+ * Returns number of moves in replay
+ * @param replay replay
+ * @return number of moves, positions are available for plies 0 to length
+ */
+int shogi_replay_length(const ShogiReplay *replay);
+
+/**
+ * Returns move played at ply
+ * @param replay replay
+ * @param ply ply from 0 to length - 1
+ * @return move leading from position at ply to the one at ply + 1
+ */
+ShogiMove shogi_replay_move(const ShogiReplay *replay, int ply);
+
+/**
+ * Sets up position after given number of moves, in time bound by SHOGI_REPLAY_KEYFRAME_INTERVAL
+ * @param replay replay
+ * @param ply number of moves played, clamped to 0 - length
+ * @param pos position to set up
+ * @return ply of the position
+ */
+int shogi_replay_seek(const ShogiReplay *replay, int ply, ShogiPosition *pos);
+
+#endif //SHOGI_REPLAY_H
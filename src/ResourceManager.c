@@ -4,107 +4,132 @@
 
 #include "ResourceManager.h"
 #include "Logger.h"
+#include "Trace.h"
 #include <math.h>
-#include <glib.h>
+#include <string.h>
+#include <gio/gio.h>
 
+static cairo_surface_t *texture_atlas;
 static cairo_surface_t *texture_board;
 static cairo_surface_t *texture_pawn[SHOGI_PAWN_DETAILED_COUNT];
+static double texture_scale = 0; // scale of scaled textures, 0 if they weren't created
+static int texture_device_scale = 1; // device pixels per user unit of scaled textures
+static cairo_surface_t *texture_board_scaled;
+static cairo_surface_t *texture_pawn_scaled[SHOGI_PAWN_DETAILED_COUNT];
+
+#define SHOGI_RESOURCE_BOARD_MARGIN 68 // distance from the edge of board texture to the first square
+
+typedef struct _shogi_resource_reader {
+    const guchar *data;
+    gsize size;
+    gsize offset;
+} ShogiResourceReader;
+
+/// cairo PNG stream reading from embedded resource
+static cairo_status_t read_resource(void *closure, unsigned char *data, unsigned int length) {
+    ShogiResourceReader *reader = closure;
+    if (reader->size - reader->offset < length)
+        return CAIRO_STATUS_READ_ERROR;
+    memcpy(data, reader->data + reader->offset, length);
+    reader->offset += length;
+    return CAIRO_STATUS_SUCCESS;
+}
 
-gboolean shogi_resource_manager_init() {
+int shogi_resource_manager_init(void) {
+    SHOGI_TRACE_FUNCTION();
     shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_DEBUG, "Loading resources...");
-    texture_board = cairo_image_surface_create_from_png("resources/board.png");
-
-    // @formatter:off
-    texture_pawn[SHOGI_PAWN_DETAILED_K_WHITE]        = cairo_image_surface_create_from_png("resources/pawns/96x96/K_white.png");
-    texture_pawn[SHOGI_PAWN_DETAILED_K_BLACK]        = cairo_image_surface_create_from_png("resources/pawns/96x96/K_black.png");
-
-    texture_pawn[SHOGI_PAWN_DETAILED_G_WHITE]        = cairo_image_surface_create_from_png("resources/pawns/96x96/G_white.png");
-    texture_pawn[SHOGI_PAWN_DETAILED_G_BLACK]        = cairo_image_surface_create_from_png("resources/pawns/96x96/G_black.png");
-
-    texture_pawn[SHOGI_PAWN_DETAILED_S_WHITE]        = cairo_image_surface_create_from_png("resources/pawns/96x96/S_white.png");
-    texture_pawn[SHOGI_PAWN_DETAILED_S_BLACK]        = cairo_image_surface_create_from_png("resources/pawns/96x96/S_black.png");
-    texture_pawn[SHOGI_PAWN_DETAILED_S_PRO_WHITE]    = cairo_image_surface_create_from_png("resources/pawns/96x96/S+_white.png");
-    texture_pawn[SHOGI_PAWN_DETAILED_S_PRO_BLACK]    = cairo_image_surface_create_from_png("resources/pawns/96x96/S+_black.png");
-
-    texture_pawn[SHOGI_PAWN_DETAILED_N_WHITE]        = cairo_image_surface_create_from_png("resources/pawns/96x96/N_white.png");
-    texture_pawn[SHOGI_PAWN_DETAILED_N_BLACK]        = cairo_image_surface_create_from_png("resources/pawns/96x96/N_black.png");
-    texture_pawn[SHOGI_PAWN_DETAILED_N_PRO_WHITE]    = cairo_image_surface_create_from_png("resources/pawns/96x96/N+_white.png");
-    texture_pawn[SHOGI_PAWN_DETAILED_N_PRO_BLACK]    = cairo_image_surface_create_from_png("resources/pawns/96x96/N+_black.png");
-
-    texture_pawn[SHOGI_PAWN_DETAILED_L_WHITE]        = cairo_image_surface_create_from_png("resources/pawns/96x96/L_white.png");
-    texture_pawn[SHOGI_PAWN_DETAILED_L_BLACK]        = cairo_image_surface_create_from_png("resources/pawns/96x96/L_black.png");
-    texture_pawn[SHOGI_PAWN_DETAILED_L_PRO_WHITE]    = cairo_image_surface_create_from_png("resources/pawns/96x96/L+_white.png");
-    texture_pawn[SHOGI_PAWN_DETAILED_L_PRO_BLACK]    = cairo_image_surface_create_from_png("resources/pawns/96x96/L+_black.png");
-
-    texture_pawn[SHOGI_PAWN_DETAILED_B_WHITE]        = cairo_image_surface_create_from_png("resources/pawns/96x96/B_white.png");
-    texture_pawn[SHOGI_PAWN_DETAILED_B_BLACK]        = cairo_image_surface_create_from_png("resources/pawns/96x96/B_black.png");
-    texture_pawn[SHOGI_PAWN_DETAILED_B_PRO_WHITE]    = cairo_image_surface_create_from_png("resources/pawns/96x96/B+_white.png");
-    texture_pawn[SHOGI_PAWN_DETAILED_B_PRO_BLACK]    = cairo_image_surface_create_from_png("resources/pawns/96x96/B+_black.png");
-
-    texture_pawn[SHOGI_PAWN_DETAILED_R_WHITE]        = cairo_image_surface_create_from_png("resources/pawns/96x96/R_white.png");
-    texture_pawn[SHOGI_PAWN_DETAILED_R_BLACK]        = cairo_image_surface_create_from_png("resources/pawns/96x96/R_black.png");
-    texture_pawn[SHOGI_PAWN_DETAILED_R_PRO_WHITE]    = cairo_image_surface_create_from_png("resources/pawns/96x96/R+_white.png");
-    texture_pawn[SHOGI_PAWN_DETAILED_R_PRO_BLACK]    = cairo_image_surface_create_from_png("resources/pawns/96x96/R+_black.png");
-
-    texture_pawn[SHOGI_PAWN_DETAILED_P_WHITE]        = cairo_image_surface_create_from_png("resources/pawns/96x96/P_white.png");
-    texture_pawn[SHOGI_PAWN_DETAILED_P_BLACK]        = cairo_image_surface_create_from_png("resources/pawns/96x96/P_black.png");
-    texture_pawn[SHOGI_PAWN_DETAILED_P_PRO_WHITE]    = cairo_image_surface_create_from_png("resources/pawns/96x96/P+_white.png");
-    texture_pawn[SHOGI_PAWN_DETAILED_P_PRO_BLACK]    = cairo_image_surface_create_from_png("resources/pawns/96x96/P+_black.png");
-    // @formatter:on
-
-    int load_status = cairo_surface_status(texture_board);
-    if (cairo_surface_status(texture_board) != 0) {
-        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_FATAL, "Couldn't load texture board.");
-        return load_status;
+    GBytes *atlas = g_resources_lookup_data(SHOGI_ATLAS_RESOURCE, G_RESOURCE_LOOKUP_FLAGS_NONE, NULL);
+    if (atlas == NULL) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_FATAL, "Texture atlas is missing from the binary.");
+        return 1;
     }
-    /*
-    load_status == CAIRO_STATUS_NO_MEMORY ||
-    load_status == CAIRO_STATUS_FILE_NOT_FOUND ||
-    load_status == CAIRO_STATUS_READ_ERROR
-    */
-    for (int i = 0; i < SHOGI_PAWN_DETAILED_COUNT; ++i) {
-        load_status = cairo_surface_status(texture_pawn[i]);
-        if (load_status != 0) {
-            shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_FATAL, "Couldn't load texture for pawn enum number %d.", i);
-            return load_status;
-        }
+    ShogiResourceReader reader = {.offset = 0};
+    reader.data = g_bytes_get_data(atlas, &reader.size);
+    texture_atlas = cairo_image_surface_create_from_png_stream(read_resource, &reader);
+    g_bytes_unref(atlas);
+
+    int load_status = cairo_surface_status(texture_atlas);
+    if (load_status != CAIRO_STATUS_SUCCESS || cairo_image_surface_get_width(texture_atlas) != SHOGI_ATLAS_WIDTH ||
+        cairo_image_surface_get_height(texture_atlas) != SHOGI_ATLAS_HEIGHT) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_FATAL, "Couldn't decode texture atlas.");
+        return load_status ? load_status : 1;
     }
 
+    // textures are views of the atlas, painting them reads atlas pixels directly
+    texture_board = cairo_surface_create_for_rectangle(texture_atlas, 0, 0,
+                                                       SHOGI_ATLAS_BOARD_SIZE, SHOGI_ATLAS_BOARD_SIZE);
+    for (int i = 0; i < SHOGI_PAWN_DETAILED_COUNT; ++i)
+        texture_pawn[i] = cairo_surface_create_for_rectangle(texture_atlas, SHOGI_ATLAS_PAWN_X(i),
+                                                             SHOGI_ATLAS_PAWN_Y(i), SHOGI_ATLAS_PAWN_SIZE,
+                                                             SHOGI_ATLAS_PAWN_SIZE);
     shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_DEBUG, "Textures loaded.");
-    shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_DEBUG, "Scaling and rotating textures with cairo...");
-    for (int i = 0; i < SHOGI_PAWN_DETAILED_COUNT; ++i) {
-        if (!SHOGI_PAWN_IS_BLACK(i)) {
-            cairo_surface_t *rotated = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 96,96);
-            cairo_t *cr = cairo_create(rotated);
-            cairo_translate(cr, 96 / 2, 96 / 2);
-            cairo_rotate(cr, M_PI);
-            cairo_translate(cr, -96 / 2, -96 / 2);
-            cairo_set_source_surface(cr, texture_pawn[i], 0, 0);
-            cairo_paint(cr);
-
-            cairo_destroy(cr);
-            cr = cairo_create(texture_pawn[i]);
-            cairo_set_operator(cr, CAIRO_OPERATOR_CLEAR);
-            cairo_paint(cr);
-            cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
-            cairo_set_source_surface(cr, rotated, 0, 0);
-            cairo_paint(cr);
-
-            cairo_destroy(cr);
-            cairo_surface_destroy(rotated);
-        }
-    }
-    shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_DEBUG, "Textures scaled and rotated.");
 
     return 0;
 }
 
-
 cairo_surface_t *shogi_resource_manager_get_pawn(enum SHOGI_PAWN_DETAILED pawn) {
     if (pawn < 0 || pawn > SHOGI_PAWN_DETAILED_COUNT) return NULL;
     return texture_pawn[pawn];
 }
 
-cairo_surface_t *shogi_resource_manager_get_board() {
+cairo_surface_t *shogi_resource_manager_get_board(void) {
     return texture_board;
 }
+
+/// draws texture scaled to size x size device pixels onto new surface, resampling with the best filter as it's done
+/// once, the surface is painted device_scale times smaller
+static cairo_surface_t *scale_texture(cairo_surface_t *texture, int texture_size, int size, int device_scale) {
+    cairo_surface_t *scaled = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, size, size);
+    cairo_t *cr = cairo_create(scaled);
+    cairo_scale(cr, (double) size / texture_size, (double) size / texture_size);
+    cairo_set_source_surface(cr, texture, 0, 0);
+    cairo_pattern_set_filter(cairo_get_source(cr), CAIRO_FILTER_BEST);
+    cairo_paint(cr);
+    cairo_destroy(cr);
+    cairo_surface_set_device_scale(scaled, device_scale, device_scale);
+    return scaled;
+}
+
+int shogi_resource_manager_scale(double scale, int device_scale) {
+    if (scale == texture_scale && device_scale == texture_device_scale)
+        return 0;
+    SHOGI_TRACE_FUNCTION();
+    shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_DEBUG, "Scaling textures by %.3f for device scale %d...", scale,
+                     device_scale);
+
+    double pixel_scale = scale * device_scale;
+    if (texture_board_scaled)
+        cairo_surface_destroy(texture_board_scaled);
+    texture_board_scaled = scale_texture(texture_board, SHOGI_ATLAS_BOARD_SIZE,
+                                         (int) ceil(SHOGI_ATLAS_BOARD_SIZE * pixel_scale), device_scale);
+    int pawn_size = (int) lround(SHOGI_ATLAS_PAWN_SIZE * pixel_scale);
+    for (int i = 0; i < SHOGI_PAWN_DETAILED_COUNT; ++i) {
+        if (texture_pawn_scaled[i])
+            cairo_surface_destroy(texture_pawn_scaled[i]);
+        texture_pawn_scaled[i] = scale_texture(texture_pawn[i], SHOGI_ATLAS_PAWN_SIZE, pawn_size, device_scale);
+    }
+
+    if (cairo_surface_status(texture_board_scaled) != CAIRO_STATUS_SUCCESS) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_ERROR, "Couldn't scale textures.");
+        texture_scale = 0;
+        return 1;
+    }
+    texture_scale = scale;
+    texture_device_scale = device_scale;
+    return 0;
+}
+
+double shogi_resource_manager_square_offset(int index) {
+    double pixel_scale = texture_scale * texture_device_scale;
+    return (double) lround((SHOGI_RESOURCE_BOARD_MARGIN + SHOGI_ATLAS_PAWN_SIZE * index) * pixel_scale) /
+           texture_device_scale;
+}
+
+cairo_surface_t *shogi_resource_manager_get_board_scaled(void) {
+    return texture_board_scaled;
+}
+
+cairo_surface_t *shogi_resource_manager_get_pawn_scaled(enum SHOGI_PAWN_DETAILED pawn) {
+    if (pawn < 0 || pawn >= SHOGI_PAWN_DETAILED_COUNT) return NULL;
+    return texture_pawn_scaled[pawn];
+}
@@ -9,13 +9,45 @@
 #include "Utils.h"
 #include <cairo.h>
 
+// Board and pawn textures are packed by shogi-atlas at build time into a single image, with white pawns already
+// rotated, and compiled into the binary as GResource. Board is in the top left corner, pawns are in a grid on its right.
+#define SHOGI_ATLAS_RESOURCE        "/org/tooster/shogi/atlas.png"
+#define SHOGI_ATLAS_BOARD_SIZE      1000
+#define SHOGI_ATLAS_PAWN_SIZE       96
+#define SHOGI_ATLAS_COLUMNS         4 // columns of pawn grid
+#define SHOGI_ATLAS_WIDTH           (SHOGI_ATLAS_BOARD_SIZE + SHOGI_ATLAS_COLUMNS * SHOGI_ATLAS_PAWN_SIZE)
+#define SHOGI_ATLAS_HEIGHT          SHOGI_ATLAS_BOARD_SIZE
+#define SHOGI_ATLAS_PAWN_X(pawn)    (SHOGI_ATLAS_BOARD_SIZE + (pawn) % SHOGI_ATLAS_COLUMNS * SHOGI_ATLAS_PAWN_SIZE)
+#define SHOGI_ATLAS_PAWN_Y(pawn)    ((pawn) / SHOGI_ATLAS_COLUMNS * SHOGI_ATLAS_PAWN_SIZE)
+
 /**
- * Loads files to memory
+ * Decodes embedded texture atlas
  * @return 0 on success, 1 on error
  */
-int shogi_resource_manager_init();
+int shogi_resource_manager_init(void);
 
-cairo_surface_t *shogi_resource_manager_get_board();
+cairo_surface_t *shogi_resource_manager_get_board(void);
 cairo_surface_t *shogi_resource_manager_get_pawn(enum SHOGI_PAWN_DETAILED pawn);
 
+/**
+ * Prepares copies of board and pawn textures in device resolution, so painting them needs no resampling.
+ * Copies have scale * device_scale pixels per texture pixel and carry device_scale as their cairo device scale, so
+ * they're painted with scale user units per texture pixel. Does nothing if textures are already prepared for the scales
+ * @param scale ratio of user units to texture pixels
+ * @param device_scale device pixels per user unit, as gtk_widget_get_scale_factor() on HiDPI screens
+ * @return 0 on success, 1 on error
+ */
+int shogi_resource_manager_scale(double scale, int device_scale);
+
+/**
+ * Returns coordinate of the line between squares in textures scaled by shogi_resource_manager_scale(), lying on
+ * a device pixel boundary
+ * @param index 0 for the edge of first square, 9 for the edge of the last one
+ * @return coordinate in user units, same for rows and columns
+ */
+double shogi_resource_manager_square_offset(int index);
+
+cairo_surface_t *shogi_resource_manager_get_board_scaled(void);
+cairo_surface_t *shogi_resource_manager_get_pawn_scaled(enum SHOGI_PAWN_DETAILED pawn);
+
 #endif //CUWR_RESOURCEMANAGER_H
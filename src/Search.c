@@ -0,0 +1,398 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#include <string.h>
+#include "Search.h"
+#include "Logger.h"
+#include "Trace.h"
+
+#define SHOGI_SEARCH_DELTA_MARGIN       200 // captures which can't raise score to alpha with this margin are skipped
+#define SHOGI_SEARCH_NULL_MOVE_DEPTH    3 // minimal depth at which null move is tried
+#define SHOGI_SEARCH_FUTILITY_DEPTH     3 // futility pruning is done at this and lower depths
+#define SHOGI_SEARCH_LMR_DEPTH          3
+#define SHOGI_SEARCH_LMR_MOVES          3 // moves searched at full depth before reductions start
+
+static const int futility_margin[SHOGI_SEARCH_FUTILITY_DEPTH + 1] = {0, 250, 450, 700};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// mate scores are stored relative to the node, so they stay valid when found at different distance from root
+static inline int score_to_tt(int score, int ply) {
+    if (score >= SHOGI_SEARCH_MATE_IN_MAX_PLY) return score + ply;
+    if (score <= -SHOGI_SEARCH_MATE_IN_MAX_PLY) return score - ply;
+    return score;
+}
+
+static inline int score_from_tt(int score, int ply) {
+    if (score >= SHOGI_SEARCH_MATE_IN_MAX_PLY) return score - ply;
+    if (score <= -SHOGI_SEARCH_MATE_IN_MAX_PLY) return score + ply;
+    return score;
+}
+
+static inline ShogiSearchTTEntry *tt_probe(ShogiSearch *search, HASH key) {
+    ShogiSearchTTEntry *entry = &search->tt[key & search->tt_mask];
+    return entry->key == key ? entry : NULL;
+}
+
+static inline void tt_store(ShogiSearch *search, HASH key, int score, int depth, int bound, ShogiMove move) {
+    ShogiSearchTTEntry *entry = &search->tt[key & search->tt_mask];
+    if (entry->key == key && depth < entry->depth && bound != SHOGI_SEARCH_BOUND_EXACT)
+        return; // keep deeper result of the same position
+    if (move == SHOGI_MOVE_NONE && entry->key == key)
+        move = entry->move;
+    entry->key = key;
+    entry->move = move;
+    entry->score = (gint16) score;
+    entry->depth = (gint8) depth;
+    entry->bound = (guint8) bound;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+ShogiSearch *shogi_search_new(gsize tt_megabytes) {
+    ShogiSearch *search = calloc(1, sizeof(ShogiSearch));
+    if (search == NULL) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_ERROR, "Cannot allocate memory for search.");
+        return NULL;
+    }
+
+    gsize entries = 1;
+    while (entries * 2 * sizeof(ShogiSearchTTEntry) <= MAX(tt_megabytes, 1) * 1024 * 1024)
+        entries *= 2;
+    search->tt = calloc(entries, sizeof(ShogiSearchTTEntry));
+    if (search->tt == NULL) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_ERROR, "Cannot allocate %lu MB for transposition table.",
+                         (unsigned long) tt_megabytes);
+        free(search);
+        return NULL;
+    }
+    search->tt_mask = entries - 1;
+    search->heuristics.flags = SHOGI_MOVE_ORDER_ALL;
+    search->flags = SHOGI_SEARCH_ALL;
+    return search;
+}
+
+void shogi_search_free(ShogiSearch *search) {
+    if (search == NULL) return;
+    free(search->tt);
+    free(search);
+}
+
+void shogi_search_clear(ShogiSearch *search) {
+    memset(search->tt, 0, (search->tt_mask + 1) * sizeof(ShogiSearchTTEntry));
+    shogi_move_heuristics_clear(&search->heuristics);
+}
+
+void shogi_search_stop(ShogiSearch *search) {
+    g_atomic_int_set(&search->stop, 1);
+}
+
+int shogi_search_evaluate(const ShogiPosition *pos) {
+    return pos->black_turn ? pos->material : -pos->material;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// copies principal variation of the child after move improved alpha
+static inline void update_pv(ShogiSearch *search, int ply, ShogiMove move) {
+    search->pv[ply][ply] = move;
+    for (int i = ply + 1; i < search->pv_length[ply + 1]; ++i)
+        search->pv[ply][i] = search->pv[ply + 1][i];
+    search->pv_length[ply] = search->pv_length[ply + 1];
+}
+
+/// material gained by capture or promotion, used by delta pruning
+static inline int move_gain(ShogiMove move) {
+    int gain = shogi_position_pawn_value[SHOGI_MOVE_PLACED(move)] - shogi_position_pawn_value[SHOGI_MOVE_PAWN(move)];
+    if (SHOGI_MOVE_IS_CAPTURE(move))
+        gain += shogi_position_pawn_value[SHOGI_MOVE_CAPTURED(move)] +
+                shogi_position_hand_value[SHOGI_PAWN_TO_BASE_TYPE(SHOGI_MOVE_CAPTURED(move))];
+    return gain;
+}
+
+/// checks if pawn which just moved to the square can't be captured for free
+static inline gboolean is_defended(ShogiPosition *pos, int sq) {
+    enum SHOGI_PAWN_DETAILED (*board)[9] = (enum SHOGI_PAWN_DETAILED (*)[9]) pos->board;
+    return shogi_position_attackers(board, sq, pos->black_turn, NULL) == 0 ||
+           shogi_position_attackers(board, sq, !pos->black_turn, NULL) > 0;
+}
+
+/// checks stop request and, every few hundred nodes, hard time limit
+static inline gboolean should_stop(ShogiSearch *search) {
+    if (search->time && (search->stats.nodes & SHOGI_TIME_MANAGER_POLL_MASK) == 0 &&
+        shogi_time_manager_hard_limit(search->time))
+        g_atomic_int_set(&search->stop, 1);
+    return g_atomic_int_get(&search->stop);
+}
+
+/// searches captures, promotions and, at first ply, checks until position is quiet
+static int quiescence(ShogiSearch *search, int alpha, int beta, int ply, int quiescence_ply) {
+    ShogiPosition *pos = &search->pos;
+    search->pv_length[ply] = ply;
+    search->stats.nodes++;
+    search->stats.quiescence_nodes++;
+
+    if (ply >= SHOGI_SEARCH_MAX_PLY - 1)
+        return shogi_search_evaluate(pos);
+    if (should_stop(search))
+        return 0;
+
+    ShogiMove tt_move = SHOGI_MOVE_NONE;
+    ShogiSearchTTEntry *entry = tt_probe(search, pos->key);
+    if (entry) {
+        search->stats.tt_hits++;
+        tt_move = entry->move;
+        int tt_score = score_from_tt(entry->score, ply);
+        if (entry->bound == SHOGI_SEARCH_BOUND_EXACT ||
+            (entry->bound == SHOGI_SEARCH_BOUND_LOWER && tt_score >= beta) ||
+            (entry->bound == SHOGI_SEARCH_BOUND_UPPER && tt_score <= alpha))
+            return tt_score;
+    }
+
+    // in check every move has to be tried, otherwise the player may stand pat and keep current evaluation
+    gboolean in_check = shogi_position_in_check(pos, pos->black_turn);
+    int stand_pat = shogi_search_evaluate(pos);
+    int best_score = -SHOGI_SEARCH_INFINITE;
+    int original_alpha = alpha;
+    if (!in_check) {
+        if (stand_pat >= beta)
+            return stand_pat;
+        alpha = MAX(alpha, stand_pat);
+        best_score = stand_pat;
+    }
+
+    ShogiMovePicker picker;
+    if (in_check)
+        shogi_move_picker_init(&picker, pos, &search->heuristics, tt_move, ply, SHOGI_MOVE_NONE);
+    else
+        shogi_move_picker_init_quiescence(&picker, pos, &search->heuristics, tt_move, quiescence_ply == 0);
+
+    ShogiMove best_move = SHOGI_MOVE_NONE;
+    int moves_tried = 0;
+    ShogiMove move;
+    while ((move = shogi_move_picker_next(&picker)) != SHOGI_MOVE_NONE) {
+        if (SHOGI_MOVE_IS_KING_CAPTURE(move)) {
+            search->pv_length[ply + 1] = ply + 1;
+            update_pv(search, ply, move);
+            return SHOGI_SEARCH_MATE - ply;
+        }
+        if (!in_check && SHOGI_MOVE_IS_CAPTURE(move) && stand_pat + move_gain(move) + SHOGI_SEARCH_DELTA_MARGIN <= alpha)
+            continue; // even winning the pawn for free won't reach alpha
+
+        shogi_position_do_move(pos, move);
+        if (in_check && shogi_position_in_check(pos, !pos->black_turn)) { // doesn't escape, king would be captured
+            shogi_position_undo_move(pos, move);
+            continue;
+        }
+        int score = -quiescence(search, -beta, -alpha, ply + 1, quiescence_ply + 1);
+        shogi_position_undo_move(pos, move);
+        moves_tried++;
+
+        if (g_atomic_int_get(&search->stop))
+            return 0;
+
+        if (score > best_score) {
+            best_score = score;
+            if (score > alpha) {
+                alpha = score;
+                best_move = move;
+                update_pv(search, ply, move);
+                if (alpha >= beta)
+                    break;
+            }
+        }
+    }
+
+    if (in_check && moves_tried == 0)
+        return -SHOGI_SEARCH_MATE + ply;
+
+    tt_store(search, pos->key, score_to_tt(best_score, ply), 0,
+             best_score >= beta ? SHOGI_SEARCH_BOUND_LOWER :
+             best_score > original_alpha ? SHOGI_SEARCH_BOUND_EXACT : SHOGI_SEARCH_BOUND_UPPER,
+             best_move);
+    return best_score;
+}
+
+static int alpha_beta(ShogiSearch *search, int alpha, int beta, int depth, int ply, ShogiMove previous_move) {
+    ShogiPosition *pos = &search->pos;
+    guint flags = search->flags;
+    search->pv_length[ply] = ply;
+
+    if (ply >= SHOGI_SEARCH_MAX_PLY - 1)
+        return shogi_search_evaluate(pos);
+    if (depth <= 0) {
+        if (flags & SHOGI_SEARCH_QUIESCENCE)
+            return quiescence(search, alpha, beta, ply, 0);
+        search->stats.nodes++;
+        return shogi_search_evaluate(pos);
+    }
+    search->stats.nodes++;
+    if (should_stop(search))
+        return 0;
+
+    gboolean pv_node = beta - alpha > 1;
+    ShogiMove tt_move = SHOGI_MOVE_NONE;
+    ShogiSearchTTEntry *entry = tt_probe(search, pos->key);
+    if (entry) {
+        search->stats.tt_hits++;
+        tt_move = entry->move;
+        int tt_score = score_from_tt(entry->score, ply);
+        if (ply > 0 && entry->depth >= depth &&
+            (entry->bound == SHOGI_SEARCH_BOUND_EXACT ||
+             (entry->bound == SHOGI_SEARCH_BOUND_LOWER && tt_score >= beta) ||
+             (entry->bound == SHOGI_SEARCH_BOUND_UPPER && tt_score <= alpha)))
+            return tt_score;
+    }
+
+    gboolean in_check = shogi_position_in_check(pos, pos->black_turn);
+    int static_eval = shogi_search_evaluate(pos);
+
+    // null move: if position is still good enough after passing the turn, real move will be even better.
+    // Drops make zugzwang very rare in shogi, so there is no special care for it
+    if ((flags & SHOGI_SEARCH_NULL_MOVE) && !pv_node && !in_check && previous_move != SHOGI_MOVE_NONE &&
+        depth >= SHOGI_SEARCH_NULL_MOVE_DEPTH && static_eval >= beta && ABS(beta) < SHOGI_SEARCH_MATE_IN_MAX_PLY) {
+        int reduction = 2 + depth / 6;
+        shogi_position_do_null_move(pos);
+        int score = -alpha_beta(search, -beta, -beta + 1, depth - 1 - reduction, ply + 1, SHOGI_MOVE_NONE);
+        shogi_position_undo_null_move(pos);
+        if (g_atomic_int_get(&search->stop))
+            return 0;
+        if (score >= beta) {
+            search->stats.null_move_cutoffs++;
+            return score >= SHOGI_SEARCH_MATE_IN_MAX_PLY ? beta : score; // unproven mates are not returned
+        }
+    }
+
+    // futility: near the horizon quiet moves can't bring hopeless position back to alpha
+    gboolean futile = (flags & SHOGI_SEARCH_FUTILITY) && !pv_node && !in_check &&
+                      depth <= SHOGI_SEARCH_FUTILITY_DEPTH && ABS(alpha) < SHOGI_SEARCH_MATE_IN_MAX_PLY &&
+                      static_eval + futility_margin[depth] <= alpha;
+
+    ShogiMovePicker picker;
+    shogi_move_picker_init(&picker, pos, &search->heuristics, tt_move, ply, previous_move);
+
+    int original_alpha = alpha;
+    int best_score = -SHOGI_SEARCH_INFINITE;
+    ShogiMove best_move = SHOGI_MOVE_NONE;
+    ShogiMove quiets[64];
+    int quiets_count = 0;
+    int moves_tried = 0;
+    ShogiMove move;
+
+    while ((move = shogi_move_picker_next(&picker)) != SHOGI_MOVE_NONE) {
+        int score;
+        gboolean quiet = !SHOGI_MOVE_IS_CAPTURE(move) && !SHOGI_MOVE_IS_PROMOTION(move);
+        if (SHOGI_MOVE_IS_KING_CAPTURE(move)) { // game ends on king capture
+            score = SHOGI_SEARCH_MATE - ply;
+            search->pv_length[ply + 1] = ply + 1;
+        } else {
+            shogi_position_do_move(pos, move);
+            gboolean gives_check = shogi_position_in_check(pos, pos->black_turn);
+
+            if (futile && quiet && !gives_check && moves_tried > 0) {
+                shogi_position_undo_move(pos, move);
+                search->stats.futility_prunes++;
+                continue;
+            }
+
+            int new_depth = depth - 1;
+            // drops make sequences of checks very long, so only checks by pawns that can't be taken for free
+            // are extended, up to double of iteration depth
+            if ((flags & SHOGI_SEARCH_CHECK_EXTENSIONS) && gives_check && ply < 2 * search->root_depth &&
+                is_defended(pos, SHOGI_MOVE_TO(move)))
+                new_depth++;
+
+            int reduction = 0;
+            if ((flags & SHOGI_SEARCH_LMR) && depth >= SHOGI_SEARCH_LMR_DEPTH && moves_tried >= SHOGI_SEARCH_LMR_MOVES &&
+                quiet && !in_check && !gives_check && move != picker.killers[0] && move != picker.killers[1] &&
+                move != picker.counter_move) {
+                reduction = 1 + (moves_tried >= 8 && depth >= 6) + (!pv_node && moves_tried >= 16);
+                reduction = MAX(0, MIN(reduction, new_depth - 1));
+                if (reduction > 0)
+                    search->stats.reductions++;
+            }
+
+            // principal variation search: later moves are expected to fail low, so null window proves it
+            if (moves_tried == 0) {
+                score = -alpha_beta(search, -beta, -alpha, new_depth, ply + 1, move);
+            } else {
+                score = -alpha_beta(search, -alpha - 1, -alpha, new_depth - reduction, ply + 1, move);
+                if (score > alpha && reduction > 0)
+                    score = -alpha_beta(search, -alpha - 1, -alpha, new_depth, ply + 1, move);
+                if (score > alpha && score < beta)
+                    score = -alpha_beta(search, -beta, -alpha, new_depth, ply + 1, move);
+            }
+            shogi_position_undo_move(pos, move);
+        }
+        moves_tried++;
+
+        if (g_atomic_int_get(&search->stop))
+            return 0;
+
+        if (score > best_score) {
+            best_score = score;
+            best_move = move;
+            if (score > alpha) {
+                alpha = score;
+                update_pv(search, ply, move);
+
+                if (alpha >= beta) {
+                    search->stats.beta_cutoffs++;
+                    if (moves_tried == 1)
+                        search->stats.first_move_cutoffs++;
+                    shogi_move_heuristics_update(&search->heuristics, move, ply, depth, previous_move,
+                                                 quiets, quiets_count);
+                    break;
+                }
+            }
+        }
+        if (!SHOGI_MOVE_IS_CAPTURE(move) && quiets_count < 64)
+            quiets[quiets_count++] = move;
+    }
+
+    if (moves_tried == 0) // player without any move loses
+        return -SHOGI_SEARCH_MATE + ply;
+
+    tt_store(search, pos->key, score_to_tt(best_score, ply), depth,
+             best_score >= beta ? SHOGI_SEARCH_BOUND_LOWER :
+             best_score > original_alpha ? SHOGI_SEARCH_BOUND_EXACT : SHOGI_SEARCH_BOUND_UPPER,
+             best_move);
+    return best_score;
+}
+
+int shogi_search_run(ShogiSearch *search, const ShogiPosition *pos, int max_depth, ShogiMove *best_move) {
+    SHOGI_TRACE_FUNCTION();
+    search->pos = *pos;
+    memset(&search->stats, 0, sizeof(ShogiSearchStats));
+    memset(search->heuristics.killers, 0, sizeof(search->heuristics.killers));
+    g_atomic_int_set(&search->stop, 0);
+
+    ShogiMove best = SHOGI_MOVE_NONE;
+    int best_score = 0;
+    max_depth = MIN(max_depth, SHOGI_SEARCH_MAX_PLY - 1);
+
+    for (int depth = 1; depth <= max_depth; ++depth) {
+        search->root_depth = depth;
+        ShogiTraceSpan iteration = shogi_trace_begin("search iteration");
+        int score = alpha_beta(search, -SHOGI_SEARCH_INFINITE, SHOGI_SEARCH_INFINITE, depth, 0, SHOGI_MOVE_NONE);
+        shogi_trace_scope_end(&iteration);
+        if (g_atomic_int_get(&search->stop)) {
+            if (best == SHOGI_MOVE_NONE && search->pv_length[0] > 0)
+                best = search->pv[0][0]; // out of time before first iteration ended, partial result is all we have
+            break;
+        }
+        best_score = score;
+        best = search->pv_length[0] > 0 ? search->pv[0][0] : SHOGI_MOVE_NONE;
+        if (search->report)
+            search->report(search, depth, score, search->report_data);
+        if (ABS(score) >= SHOGI_SEARCH_MATE_IN_MAX_PLY)
+            break; // mate found, deeper search won't change it
+        if (search->time && shogi_time_manager_iteration_done(search->time, depth, best, score))
+            break;
+    }
+
+    if (best_move)
+        *best_move = best;
+    return best_score;
+}
@@ -0,0 +1,122 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#ifndef SHOGI_SEARCH_H
+#define SHOGI_SEARCH_H
+
+#include <glib.h>
+#include "Position.h"
+#include "MovePicker.h"
+#include "TimeManager.h"
+
+#define SHOGI_SEARCH_MAX_PLY            SHOGI_MOVE_PICKER_MAX_PLY
+#define SHOGI_SEARCH_INFINITE           32000
+#define SHOGI_SEARCH_MATE               30000 // score of king capture, lowered by distance from the root
+#define SHOGI_SEARCH_MATE_IN_MAX_PLY    (SHOGI_SEARCH_MATE - SHOGI_SEARCH_MAX_PLY)
+
+/// selective search features that can be switched off to measure their effect on nodes to depth
+#define SHOGI_SEARCH_QUIESCENCE         (1 << 0) // captures, promotions and checks are searched past the horizon
+#define SHOGI_SEARCH_NULL_MOVE          (1 << 1)
+#define SHOGI_SEARCH_LMR                (1 << 2) // late move reductions
+#define SHOGI_SEARCH_FUTILITY           (1 << 3)
+#define SHOGI_SEARCH_CHECK_EXTENSIONS   (1 << 4)
+#define SHOGI_SEARCH_ALL                0x1F
+
+enum SHOGI_SEARCH_BOUND {
+    SHOGI_SEARCH_BOUND_NONE,
+    SHOGI_SEARCH_BOUND_UPPER, // all moves failed low
+    SHOGI_SEARCH_BOUND_LOWER, // move failed high
+    SHOGI_SEARCH_BOUND_EXACT
+};
+
+typedef struct _shogi_search_tt_entry {
+    HASH key;
+    ShogiMove move;
+    gint16 score;
+    gint8 depth;
+    guint8 bound;
+} ShogiSearchTTEntry;
+
+typedef struct _shogi_search_stats {
+    guint64 nodes; // all nodes, including quiescence
+    guint64 quiescence_nodes;
+    guint64 beta_cutoffs;
+    guint64 first_move_cutoffs; // cutoffs by the first move tried, measures quality of move ordering
+    guint64 tt_hits;
+    guint64 null_move_cutoffs;
+    guint64 reductions; // moves searched with late move reduction
+    guint64 futility_prunes; // moves skipped by futility pruning
+} ShogiSearchStats;
+
+typedef struct _shogi_search ShogiSearch;
+
+/**
+ * Called after each completed iteration of iterative deepening
+ * @param search search, principal variation and statistics can be read from it
+ * @param depth completed depth
+ * @param score score of the position from the perspective of the player to move
+ * @param data user data
+ */
+typedef void (*ShogiSearchReportFunc)(const ShogiSearch *search, int depth, int score, gpointer data);
+
+struct _shogi_search {
+    ShogiPosition pos; // position being searched, modified during search
+    ShogiMoveHeuristics heuristics;
+    guint flags; // enabled selective search features, SHOGI_SEARCH_*
+    ShogiSearchStats stats;
+    ShogiSearchTTEntry *tt;
+    gsize tt_mask; // number of tt entries - 1
+    ShogiMove pv[SHOGI_SEARCH_MAX_PLY][SHOGI_SEARCH_MAX_PLY]; // triangular table of principal variations
+    int pv_length[SHOGI_SEARCH_MAX_PLY];
+    int root_depth; // depth of current iteration
+    gint stop; // set asynchronously to stop the search
+    ShogiTimeManager *time; // limits thinking time if set, polled from the search
+    ShogiSearchReportFunc report;
+    gpointer report_data;
+};
+
+/**
+ * Creates new search with it's own transposition table
+ * @param tt_megabytes size of transposition table
+ * @return new search or NULL on failure
+ */
+ShogiSearch *shogi_search_new(gsize tt_megabytes);
+
+/**
+ * Frees search and it's tables
+ * @param search search to free
+ */
+void shogi_search_free(ShogiSearch *search);
+
+/**
+ * Clears transposition table and move ordering heuristics, as before a new game
+ * @param search search to clear
+ */
+void shogi_search_clear(ShogiSearch *search);
+
+/**
+ * Searches position with iterative deepening. If search->time is set, search stops at it's hard limit and
+ * doesn't start iterations which won't fit in the budget
+ * @param search search
+ * @param pos position to search
+ * @param max_depth depth of the last iteration
+ * @param best_move best move found, SHOGI_MOVE_NONE if there are no moves
+ * @return score of the position from the perspective of the player to move
+ */
+int shogi_search_run(ShogiSearch *search, const ShogiPosition *pos, int max_depth, ShogiMove *best_move);
+
+/**
+ * Asks running search to stop as soon as possible. Can be called from any thread
+ * @param search running search
+ */
+void shogi_search_stop(ShogiSearch *search);
+
+/**
+ * Static evaluation of position
+ * @param pos position
+ * @return score from the perspective of the player to move
+ */
+int shogi_search_evaluate(const ShogiPosition *pos);
+
+#endif //SHOGI_SEARCH_H
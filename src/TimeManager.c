@@ -0,0 +1,79 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#include "TimeManager.h"
+#include "Logger.h"
+#include "Model.h"
+
+#define SHOGI_TIME_MANAGER_MIN_MOVES_LEFT   15
+#define SHOGI_TIME_MANAGER_MAX_MOVES_LEFT   50
+#define SHOGI_TIME_MANAGER_GAME_PLIES       160 // typical length of a game, used to guess moves left
+#define SHOGI_TIME_MANAGER_SCORE_DROP       60 // score drop which makes the search think longer
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void shogi_time_manager_init(ShogiTimeManager *manager, const ShogiTimeControl *control, int ply) {
+    manager->start = g_get_monotonic_time();
+    manager->best_move = SHOGI_MOVE_NONE;
+    manager->best_score = 0;
+    manager->stable_iterations = 0;
+    manager->scale = 1.0;
+
+    int moves_left = control->moves_to_go > 0 ? control->moves_to_go :
+                     CLAMP((SHOGI_TIME_MANAGER_GAME_PLIES - ply) / 2, SHOGI_TIME_MANAGER_MIN_MOVES_LEFT,
+                           SHOGI_TIME_MANAGER_MAX_MOVES_LEFT);
+    gint64 remaining = MAX(control->remaining - SHOGI_TIME_MANAGER_MOVE_OVERHEAD, 0);
+    gint64 byoyomi = MAX(control->byoyomi - SHOGI_TIME_MANAGER_MOVE_OVERHEAD, 0);
+
+    // byoyomi is lost if not used, so the whole period is the base of each move, main time only adds to it
+    manager->soft = remaining / moves_left + control->increment * 3 / 4 + byoyomi;
+    // hard limit lets a move take a few soft budgets, but never more than a part of main time
+    manager->hard = MIN(manager->soft * 4, remaining / 3 + control->increment / 2 + byoyomi);
+    if (control->moves_to_go == 1) // last move before time control may use everything
+        manager->hard = remaining + byoyomi;
+
+    manager->soft = MAX(manager->soft, 1);
+    manager->hard = MAX(manager->hard, manager->soft);
+    if (byoyomi == 0 && remaining > 0)
+        manager->hard = MIN(manager->hard, remaining);
+    manager->hard_deadline = manager->start + manager->hard * 1000;
+
+    shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_DEBUG, "Time budget: soft %ld ms, hard %ld ms.",
+                     (long) manager->soft, (long) manager->hard);
+}
+
+gboolean shogi_time_manager_control_from_model(ShogiTimeControl *control) {
+    const ShogiClock *game_clock = shogi_model_get_clock();
+    int side = shogi_model_is_black_turn() ? SHOGI_CLOCK_BLACK : SHOGI_CLOCK_WHITE;
+    control->remaining = shogi_clock_main_left(game_clock, side, shogi_clock_now()) / 1000;
+    control->byoyomi = game_clock->byoyomi / 1000;
+    control->increment = game_clock->increment / 1000;
+    control->moves_to_go = 0;
+    return shogi_model_is_timed();
+}
+
+gboolean shogi_time_manager_iteration_done(ShogiTimeManager *manager, int depth, ShogiMove best_move, int score) {
+    if (depth > 1) {
+        if (best_move == manager->best_move)
+            manager->stable_iterations++;
+        else
+            manager->stable_iterations = 0;
+
+        // changing best move means search is unsure, stable one means more depth won't change much
+        double scale = manager->stable_iterations == 0 ? 1.5 : manager->stable_iterations >= 3 ? 0.6 : 1.0;
+        if (score < manager->best_score - SHOGI_TIME_MANAGER_SCORE_DROP)
+            scale *= 1.5; // position turned worse, look for a way out
+        manager->scale = MIN(scale, 2.5);
+    }
+    manager->best_move = best_move;
+    manager->best_score = score;
+
+    // next iteration takes at least as long as all previous ones together
+    gint64 budget = MIN((gint64) (manager->soft * manager->scale), manager->hard);
+    return shogi_time_manager_elapsed(manager) * 2 >= budget;
+}
+
+gint64 shogi_time_manager_elapsed(const ShogiTimeManager *manager) {
+    return (g_get_monotonic_time() - manager->start) / 1000;
+}
@@ -0,0 +1,78 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#ifndef SHOGI_TIMEMANAGER_H
+#define SHOGI_TIMEMANAGER_H
+
+#include <glib.h>
+#include "Position.h"
+
+// Time manager decides how long the search thinks about a move. It gives each move a soft budget, after which
+// no new iteration is started, and a hard budget, at which running iteration is stopped. Soft budget is
+// stretched when best move keeps changing or score drops, and shrunk when best move is stable.
+// All times are in milliseconds.
+
+#define SHOGI_TIME_MANAGER_MOVE_OVERHEAD    30 // time lost between search end and clock stop
+#define SHOGI_TIME_MANAGER_POLL_MASK        255 // search polls clock every 256 nodes, well under a millisecond
+
+typedef struct _shogi_time_control {
+    gint64 remaining; // main time left for player to move
+    gint64 byoyomi; // time for each move after main time runs out, 0 if none
+    gint64 increment; // time added after each move (Fischer), 0 if none
+    int moves_to_go; // moves until next time control, 0 if all remaining moves have to fit
+} ShogiTimeControl;
+
+typedef struct _shogi_time_manager {
+    gint64 start; // monotonic time of search start, in microseconds
+    gint64 soft; // budget of the move
+    gint64 hard; // time at which search must stop
+    gint64 hard_deadline; // start + hard, in microseconds
+    ShogiMove best_move; // best move of last iteration
+    int best_score;
+    int stable_iterations; // iterations with the same best move
+    double scale; // current adjustment of soft budget
+} ShogiTimeManager;
+
+/**
+ * Allocates budget for the move and starts measuring time
+ * @param manager manager to initialize
+ * @param control clock state of player to move
+ * @param ply moves played in the game so far, used to estimate how many moves are left
+ */
+void shogi_time_manager_init(ShogiTimeManager *manager, const ShogiTimeControl *control, int ply);
+
+/**
+ * Fills time control from the clock of the game model
+ * @param control control to fill
+ * @return false if the game is not timed
+ */
+gboolean shogi_time_manager_control_from_model(ShogiTimeControl *control);
+
+/**
+ * Called after each completed iteration, adjusts soft budget based on stability of best move and score
+ * @param manager initialized manager
+ * @param depth completed depth
+ * @param best_move best move of the iteration
+ * @param score score of the iteration
+ * @return true if there is not enough time for next iteration and search should stop
+ */
+gboolean shogi_time_manager_iteration_done(ShogiTimeManager *manager, int depth, ShogiMove best_move, int score);
+
+/**
+ * Cheap check of hard limit, meant to be called from the search every SHOGI_TIME_MANAGER_POLL_MASK + 1 nodes
+ * @param manager initialized manager
+ * @return true if hard limit has passed
+ */
+static inline gboolean shogi_time_manager_hard_limit(const ShogiTimeManager *manager) {
+    return g_get_monotonic_time() >= manager->hard_deadline;
+}
+
+/**
+ * Returns time elapsed from search start
+ * @param manager initialized manager
+ * @return elapsed time in milliseconds
+ */
+gint64 shogi_time_manager_elapsed(const ShogiTimeManager *manager);
+
+#endif //SHOGI_TIMEMANAGER_H
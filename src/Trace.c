@@ -0,0 +1,179 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include "Trace.h"
+#include "Logger.h"
+
+typedef struct _shogi_trace_event {
+    const char *name;
+    guint64 start;
+    guint64 duration;
+} ShogiTraceEvent;
+
+typedef struct _shogi_trace_chunk {
+    struct _shogi_trace_chunk *next;
+    int count;
+    ShogiTraceEvent events[SHOGI_TRACE_CHUNK_EVENTS];
+} ShogiTraceChunk;
+
+typedef struct _shogi_trace_buffer {
+    int thread; // index of thread in trace
+    guint32 events;
+    guint32 dropped;
+    ShogiTraceChunk *first;
+    ShogiTraceChunk *last;
+} ShogiTraceBuffer;
+
+gint shogi_trace_enabled = 0;
+static char *trace_path;
+static GMutex buffers_lock; // guards registration of thread buffers
+static GPtrArray *buffers; // all ShogiTraceBuffer, kept after their threads exit
+static guint generation; // incremented on every start, so threads drop buffers of previous traces
+static __thread ShogiTraceBuffer *local_buffer;
+static __thread guint local_generation;
+
+/// returns buffer of calling thread, registering new one on first span of the trace, NULL if tracing stopped
+static ShogiTraceBuffer *thread_buffer() {
+    if (G_LIKELY(local_buffer && local_generation == g_atomic_int_get(&generation)))
+        return local_buffer;
+
+    g_mutex_lock(&buffers_lock);
+    if (buffers == NULL) { // tracing stopped meanwhile
+        g_mutex_unlock(&buffers_lock);
+        return NULL;
+    }
+    ShogiTraceBuffer *buffer = g_new0(ShogiTraceBuffer, 1);
+    buffer->thread = (int) buffers->len;
+    g_ptr_array_add(buffers, buffer);
+    local_generation = generation;
+    g_mutex_unlock(&buffers_lock);
+    local_buffer = buffer;
+    return buffer;
+}
+
+guint64 shogi_trace_now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (guint64) now.tv_sec * 1000000000u + (guint64) now.tv_nsec;
+}
+
+void shogi_trace_end(const ShogiTraceSpan *span) {
+    guint64 end = shogi_trace_now();
+    if (span->start == 0 || !g_atomic_int_get(&shogi_trace_enabled))
+        return;
+
+    ShogiTraceBuffer *buffer = thread_buffer();
+    if (buffer == NULL)
+        return;
+    if (buffer->events >= SHOGI_TRACE_MAX_THREAD_EVENTS) {
+        buffer->dropped++;
+        return;
+    }
+    if (buffer->last == NULL || buffer->last->count == SHOGI_TRACE_CHUNK_EVENTS) {
+        ShogiTraceChunk *chunk = g_try_new(ShogiTraceChunk, 1);
+        if (chunk == NULL) {
+            buffer->dropped++;
+            return;
+        }
+        chunk->next = NULL;
+        chunk->count = 0;
+        if (buffer->last) buffer->last->next = chunk;
+        else buffer->first = chunk;
+        buffer->last = chunk;
+    }
+    ShogiTraceEvent *event = &buffer->last->events[buffer->last->count++];
+    event->name = span->name;
+    event->start = span->start;
+    event->duration = end - span->start;
+    buffer->events++;
+}
+
+gboolean shogi_trace_start(const char *path) {
+    g_mutex_lock(&buffers_lock);
+    if (g_atomic_int_get(&shogi_trace_enabled)) {
+        g_mutex_unlock(&buffers_lock);
+        return FALSE;
+    }
+    trace_path = g_strdup(path);
+    buffers = g_ptr_array_new();
+    g_atomic_int_inc(&generation);
+    g_atomic_int_set(&shogi_trace_enabled, 1);
+    g_mutex_unlock(&buffers_lock);
+    shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_INFO, "Tracing to %s.", path);
+    return TRUE;
+}
+
+void shogi_trace_start_from_env() {
+    const char *path = g_getenv(SHOGI_TRACE_ENV);
+    if (path && *path)
+        shogi_trace_start(path);
+}
+
+/// writes name as JSON string, names are identifiers and literals so only quotes and backslashes are escaped
+static void write_name(FILE *file, const char *name) {
+    fputc('"', file);
+    for (const char *c = name; *c; ++c) {
+        if (*c == '"' || *c == '\\') fputc('\\', file);
+        fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+gboolean shogi_trace_stop() {
+    g_mutex_lock(&buffers_lock);
+    if (!g_atomic_int_get(&shogi_trace_enabled)) {
+        g_mutex_unlock(&buffers_lock);
+        return FALSE;
+    }
+    g_atomic_int_set(&shogi_trace_enabled, 0);
+
+    gboolean written = FALSE;
+    FILE *file = fopen(trace_path, "w");
+    if (file == NULL) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_ERROR, "Cannot open trace file %s.", trace_path);
+    } else {
+        int pid = (int) getpid();
+        guint64 dropped = 0;
+        fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"shogi\"}}", pid);
+        for (guint i = 0; i < buffers->len; ++i) {
+            ShogiTraceBuffer *buffer = g_ptr_array_index(buffers, i);
+            dropped += buffer->dropped;
+            fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+                          "\"args\":{\"name\":\"thread %d\"}}", pid, buffer->thread, buffer->thread);
+            for (ShogiTraceChunk *chunk = buffer->first; chunk; chunk = chunk->next) {
+                for (int j = 0; j < chunk->count; ++j) {
+                    const ShogiTraceEvent *event = &chunk->events[j];
+                    fprintf(file, ",\n{\"name\":");
+                    write_name(file, event->name);
+                    fprintf(file, ",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", pid,
+                            buffer->thread, event->start / 1000.0, event->duration / 1000.0);
+                }
+            }
+        }
+        fprintf(file, "\n]}\n");
+        written = fclose(file) == 0;
+        if (dropped)
+            shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_WARN, "Trace buffers were full, %lu spans dropped.",
+                             (unsigned long) dropped);
+    }
+
+    for (guint i = 0; i < buffers->len; ++i) {
+        ShogiTraceBuffer *buffer = g_ptr_array_index(buffers, i);
+        for (ShogiTraceChunk *chunk = buffer->first, *next; chunk; chunk = next) {
+            next = chunk->next;
+            g_free(chunk);
+        }
+        g_free(buffer);
+    }
+    g_ptr_array_free(buffers, TRUE);
+    buffers = NULL;
+    g_free(trace_path);
+    trace_path = NULL;
+    g_mutex_unlock(&buffers_lock);
+    return written;
+}
@@ -0,0 +1,83 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#ifndef SHOGI_TRACE_H
+#define SHOGI_TRACE_H
+
+#include <glib.h>
+
+// Scoped tracing of hot paths. Spans are recorded into per-thread buffers, so recording takes no locks, and
+// are written as Chrome trace event JSON (chrome://tracing, ui.perfetto.dev) when tracing stops.
+// When tracing is disabled span costs one load and a branch.
+//
+//   void redraw() {
+//       SHOGI_TRACE_FUNCTION(); // span lasts until the end of the scope
+//       ...
+//   }
+
+#define SHOGI_TRACE_ENV                 "SHOGI_TRACE" // path of the trace file, tracing is enabled if set
+#define SHOGI_TRACE_CHUNK_EVENTS        4096
+#define SHOGI_TRACE_MAX_THREAD_EVENTS   (1 << 20) // later spans of a thread are dropped
+
+typedef struct _shogi_trace_span {
+    const char *name; // must outlive tracing, string literal or __func__
+    guint64 start; // monotonic time in ns, 0 if tracing was disabled when span began
+} ShogiTraceSpan;
+
+extern gint shogi_trace_enabled;
+
+/**
+ * Enables tracing
+ * @param path file the trace is written to by shogi_trace_stop()
+ * @return false if tracing is already running
+ */
+gboolean shogi_trace_start(const char *path);
+
+/**
+ * Enables tracing if SHOGI_TRACE environment variable is set to a file path
+ */
+void shogi_trace_start_from_env();
+
+/**
+ * Disables tracing, writes recorded spans of all threads and frees buffers.
+ * Other threads shouldn't record spans while it runs
+ * @return false if trace couldn't be written
+ */
+gboolean shogi_trace_stop();
+
+/**
+ * Returns current time of trace clock
+ * @return monotonic time in ns
+ */
+guint64 shogi_trace_now();
+
+/**
+ * Ends span, records it in buffer of calling thread
+ * @param span span returned by shogi_trace_begin()
+ */
+void shogi_trace_end(const ShogiTraceSpan *span);
+
+/**
+ * Begins span
+ * @param name name of span shown in trace viewer
+ * @return span to pass to shogi_trace_end()
+ */
+static inline ShogiTraceSpan shogi_trace_begin(const char *name) {
+    ShogiTraceSpan span = {name, 0};
+    if (G_UNLIKELY(g_atomic_int_get(&shogi_trace_enabled)))
+        span.start = shogi_trace_now();
+    return span;
+}
+
+static inline void shogi_trace_scope_end(ShogiTraceSpan *span) {
+    if (G_UNLIKELY(span->start != 0))
+        shogi_trace_end(span);
+}
+
+/// span from this point to the end of enclosing scope
+#define SHOGI_TRACE_SCOPE(name) \
+    ShogiTraceSpan _shogi_trace_span __attribute__((cleanup(shogi_trace_scope_end))) = shogi_trace_begin(name)
+#define SHOGI_TRACE_FUNCTION() SHOGI_TRACE_SCOPE(__func__)
+
+#endif //SHOGI_TRACE_H
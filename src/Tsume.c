@@ -0,0 +1,553 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#include <string.h>
+#include "Tsume.h"
+#include "Logger.h"
+#include "Trace.h"
+
+// Proof numbers are kept from the attacker's perspective: pn is the cost of proving the mate, dn of disproving it.
+//
+// Hash table entries are keyed by board without hands and hold attacker's hand. When the board is the same,
+// a mate proven with some hand is proven with any hand that has at least the same pawns (hand superiority),
+// and a disproof holds for any hand that has at most the same pawns.
+//
+// Repetition is not a mate, so a node that repeats a position on the current path is disproven. Such disproof
+// depends on the path (graph history interaction), so it is stored with the key of the repeated position
+// (anchor) and trusted only while the anchor is on the current path. When a node is disproven only because
+// lines repeat the node itself, the disproof no longer depends on the path.
+
+#define SHOGI_TSUME_INFINITE    100000000u
+#define SHOGI_TSUME_CLUSTER     4
+#define SHOGI_TSUME_LOCKS       1024
+#define SHOGI_TSUME_ANY_ANCHOR  ((HASH) -1) // disproof depends on several positions, never trusted outside it's path
+
+typedef struct _tsume_entry {
+    HASH board_key;
+    HASH anchor; // key of repeated position the disproof depends on, 0 if it doesn't
+    guint32 pn;
+    guint32 dn;
+    guint32 work; // nodes searched below, entries with less work are replaced first
+    guint16 distance; // plies to mate, for proven nodes
+    guint16 working; // threads currently searching this node, wide enough for all of them
+    guint8 hand[SHOGI_PAWN_COUNT]; // attacker's hand
+} TsumeEntry;
+
+typedef struct _tsume_value {
+    guint32 pn;
+    guint32 dn;
+    guint16 distance;
+    HASH anchor;
+} TsumeValue;
+
+typedef struct _tsume_child {
+    ShogiMove move;
+    HASH key; // full key, for repetition detection
+    HASH board_key;
+    guint8 hand[SHOGI_PAWN_COUNT]; // attacker's hand after the move
+} TsumeChild;
+
+typedef struct _tsume_solver {
+    TsumeEntry *entries;
+    gsize cluster_mask;
+    GMutex locks[SHOGI_TSUME_LOCKS];
+    gboolean black_attacks;
+    gint stop;
+    gint64 deadline; // monotonic time in microseconds, 0 for no limit
+    guint64 max_nodes;
+    GMutex nodes_lock;
+    guint64 nodes; // nodes of all threads, updated in batches
+} TsumeSolver;
+
+typedef struct _tsume_thread {
+    TsumeSolver *solver;
+    int id;
+    ShogiPosition pos;
+    HASH path[SHOGI_TSUME_MAX_PLY]; // keys of positions on current path, for repetition detection
+    int path_length;
+    guint64 nodes;
+    guint64 nodes_reported;
+} TsumeThread;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static inline guint32 sum_numbers(guint32 a, guint32 b) {
+    if (a >= SHOGI_TSUME_INFINITE || b >= SHOGI_TSUME_INFINITE) return SHOGI_TSUME_INFINITE;
+    return (guint32) MIN((guint64) a + b, SHOGI_TSUME_INFINITE - 1);
+}
+
+static inline void get_hand(const TsumeThread *thread, guint8 *hand) {
+    const int *attacker_hand = thread->pos.hand[SHOGI_POSITION_COLOR(thread->solver->black_attacks)];
+    for (int i = 0; i < SHOGI_PAWN_COUNT; ++i)
+        hand[i] = (guint8) attacker_hand[i];
+}
+
+/// checks if hand a has at least as many pawns of each kind as hand b
+static inline gboolean hand_superior(const guint8 *a, const guint8 *b) {
+    for (int i = 0; i < SHOGI_PAWN_COUNT; ++i)
+        if (a[i] < b[i]) return FALSE;
+    return TRUE;
+}
+
+static gboolean on_path(const TsumeThread *thread, HASH key) {
+    for (int i = thread->path_length - 1; i >= 0; --i)
+        if (thread->path[i] == key)
+            return TRUE;
+    return FALSE;
+}
+
+static inline gboolean anchor_valid(const TsumeThread *thread, HASH anchor) {
+    if (anchor == 0) return TRUE;
+    if (anchor == SHOGI_TSUME_ANY_ANCHOR) return FALSE;
+    return on_path(thread, anchor);
+}
+
+static inline GMutex *cluster_lock(TsumeSolver *solver, gsize cluster) {
+    return &solver->locks[cluster % SHOGI_TSUME_LOCKS];
+}
+
+/// reads proof and disproof numbers of current position of the thread
+static void tt_lookup(TsumeThread *thread, HASH board_key, const guint8 *hand, TsumeValue *value) {
+    TsumeSolver *solver = thread->solver;
+    gsize cluster = board_key & solver->cluster_mask;
+    TsumeEntry *entries = &solver->entries[cluster * SHOGI_TSUME_CLUSTER];
+
+    value->pn = 1;
+    value->dn = 1;
+    value->distance = 0;
+    value->anchor = 0;
+
+    g_mutex_lock(cluster_lock(solver, cluster));
+    for (int i = 0; i < SHOGI_TSUME_CLUSTER; ++i) {
+        TsumeEntry *entry = &entries[i];
+        if (entry->board_key != board_key) continue;
+
+        if (entry->pn == 0 && hand_superior(hand, entry->hand)) {
+            value->pn = 0;
+            value->dn = SHOGI_TSUME_INFINITE;
+            value->distance = entry->distance;
+            break;
+        }
+        if (entry->dn == 0 && hand_superior(entry->hand, hand) && anchor_valid(thread, entry->anchor)) {
+            value->pn = SHOGI_TSUME_INFINITE;
+            value->dn = 0;
+            value->anchor = entry->anchor;
+            break;
+        }
+        if (entry->pn != 0 && entry->dn != 0 && memcmp(entry->hand, hand, SHOGI_PAWN_COUNT) == 0) {
+            // other threads working on the node make it look worse, so this thread picks something else
+            value->pn = sum_numbers(entry->pn, entry->working);
+            value->dn = sum_numbers(entry->dn, entry->working);
+        }
+    }
+    g_mutex_unlock(cluster_lock(solver, cluster));
+}
+
+/// finds entry of the position or the one to be replaced, cluster must be locked
+static TsumeEntry *tt_find(TsumeSolver *solver, gsize cluster, HASH board_key, const guint8 *hand) {
+    TsumeEntry *entries = &solver->entries[cluster * SHOGI_TSUME_CLUSTER];
+    TsumeEntry *replace = &entries[0];
+    for (int i = 0; i < SHOGI_TSUME_CLUSTER; ++i) {
+        if (entries[i].board_key == board_key && memcmp(entries[i].hand, hand, SHOGI_PAWN_COUNT) == 0)
+            return &entries[i];
+        if (entries[i].work < replace->work)
+            replace = &entries[i];
+    }
+    memset(replace, 0, sizeof(TsumeEntry));
+    replace->board_key = board_key;
+    memcpy(replace->hand, hand, SHOGI_PAWN_COUNT);
+    replace->pn = replace->dn = 1;
+    return replace;
+}
+
+static void tt_store(TsumeThread *thread, HASH board_key, const guint8 *hand, const TsumeValue *value, guint32 work) {
+    TsumeSolver *solver = thread->solver;
+    gsize cluster = board_key & solver->cluster_mask;
+
+    g_mutex_lock(cluster_lock(solver, cluster));
+    TsumeEntry *entry = tt_find(solver, cluster, board_key, hand);
+    entry->pn = value->pn;
+    entry->dn = value->dn;
+    entry->distance = value->distance;
+    entry->anchor = value->anchor;
+    entry->work = (guint32) MIN((guint64) entry->work + work, G_MAXUINT32);
+    g_mutex_unlock(cluster_lock(solver, cluster));
+}
+
+static void tt_set_working(TsumeThread *thread, HASH board_key, const guint8 *hand, gboolean working) {
+    TsumeSolver *solver = thread->solver;
+    gsize cluster = board_key & solver->cluster_mask;
+
+    g_mutex_lock(cluster_lock(solver, cluster));
+    TsumeEntry *entry = tt_find(solver, cluster, board_key, hand);
+    if (working) entry->working++;
+    else if (entry->working > 0) entry->working--;
+    g_mutex_unlock(cluster_lock(solver, cluster));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static inline gboolean on_line(int a, int b) {
+    int d_row = SHOGI_SQUARE_ROW(a) - SHOGI_SQUARE_ROW(b), d_col = SHOGI_SQUARE_COL(a) - SHOGI_SQUARE_COL(b);
+    return d_row == 0 || d_col == 0 || ABS(d_row) == ABS(d_col);
+}
+
+/// cheap filter of moves that can't check: check must come from the moved pawn or be discovered from behind it
+static inline gboolean may_check(ShogiMove move, int king) {
+    int to = SHOGI_MOVE_TO(move);
+    if (king == -1) return TRUE;
+    if (ABS(SHOGI_SQUARE_ROW(to) - SHOGI_SQUARE_ROW(king)) <= 2 && ABS(SHOGI_SQUARE_COL(to) - SHOGI_SQUARE_COL(king)) <= 2)
+        return TRUE;
+    return on_line(to, king) || (!SHOGI_MOVE_IS_DROP(move) && on_line(SHOGI_MOVE_FROM(move), king));
+}
+
+/// checks if square lies strictly between two squares on a line
+static inline gboolean between(int sq, int a, int b) {
+    int row = SHOGI_SQUARE_ROW(sq), col = SHOGI_SQUARE_COL(sq);
+    int row_a = SHOGI_SQUARE_ROW(a), col_a = SHOGI_SQUARE_COL(a);
+    int row_b = SHOGI_SQUARE_ROW(b), col_b = SHOGI_SQUARE_COL(b);
+    if (!on_line(a, b) || !on_line(sq, a) || sq == a || sq == b) return FALSE;
+    return MIN(row_a, row_b) <= row && row <= MAX(row_a, row_b) && MIN(col_a, col_b) <= col && col <= MAX(col_a, col_b) &&
+           (row - row_a) * (col_b - col_a) == (col - col_a) * (row_b - row_a);
+}
+
+/// cheap filter of escapes: king moves, captures of the checking pawn and blocks, double check leaves only king moves
+static inline gboolean may_escape(ShogiMove move, int king, const int *checkers, int checkers_count) {
+    if (king == -1 || checkers_count == 0) return TRUE;
+    if (!SHOGI_MOVE_IS_DROP(move) && SHOGI_MOVE_FROM(move) == king) return TRUE;
+    if (checkers_count > 1) return FALSE;
+    int to = SHOGI_MOVE_TO(move);
+    return to == checkers[0] || between(to, king, checkers[0]);
+}
+
+/// generates checks for attacker or king escapes for defender, returns -1 with the move in children[0] if king can be captured
+static int generate_children(TsumeThread *thread, gboolean or_node, TsumeChild *children) {
+    ShogiPosition *pos = &thread->pos;
+    gboolean black_attacks = thread->solver->black_attacks;
+    ShogiMove moves[SHOGI_POSITION_MAX_MOVES];
+    int count = shogi_position_generate_all(pos, moves);
+    int children_count = 0;
+    int king = shogi_position_king_square(pos, !black_attacks);
+    int checkers[SHOGI_SQUARE_COUNT];
+    int checkers_count = or_node || king == -1 ? 0 :
+                         shogi_position_attackers((enum SHOGI_PAWN_DETAILED (*)[9]) pos->board, king, black_attacks,
+                                                  checkers);
+
+    for (int i = 0; i < count; ++i) {
+        ShogiMove move = moves[i];
+        if (or_node && SHOGI_MOVE_IS_KING_CAPTURE(move)) { // defender left his king attacked, game is over
+            children[0].move = move;
+            return -1;
+        }
+        if (or_node ? !may_check(move, king) : !may_escape(move, king, checkers, checkers_count))
+            continue;
+        shogi_position_do_move(pos, move);
+        gboolean keep = or_node ?
+                        shogi_position_in_check(pos, !black_attacks) && !shogi_position_in_check(pos, black_attacks) :
+                        !shogi_position_in_check(pos, !black_attacks);
+        if (keep) {
+            TsumeChild *child = &children[children_count++];
+            child->move = move;
+            child->key = pos->key;
+            child->board_key = shogi_position_board_key(pos);
+            get_hand(thread, child->hand);
+        }
+        shogi_position_undo_move(pos, move);
+    }
+    return children_count;
+}
+
+static gboolean should_stop(TsumeThread *thread) {
+    TsumeSolver *solver = thread->solver;
+    if ((thread->nodes & 1023) == 0) {
+        g_mutex_lock(&solver->nodes_lock);
+        solver->nodes += thread->nodes - thread->nodes_reported;
+        guint64 total = solver->nodes;
+        g_mutex_unlock(&solver->nodes_lock);
+        thread->nodes_reported = thread->nodes;
+
+        if ((solver->max_nodes && total >= solver->max_nodes) ||
+            (solver->deadline && g_get_monotonic_time() >= solver->deadline))
+            g_atomic_int_set(&solver->stop, 1);
+    }
+    return g_atomic_int_get(&solver->stop) != 0;
+}
+
+/// reads value of the child, repetition of a position on the path is a disproof anchored at that position
+static void child_value(TsumeThread *thread, const TsumeChild *child, TsumeValue *value) {
+    if (on_path(thread, child->key)) {
+        value->pn = SHOGI_TSUME_INFINITE;
+        value->dn = 0;
+        value->distance = 0;
+        value->anchor = child->key;
+    } else {
+        tt_lookup(thread, child->board_key, child->hand, value);
+    }
+}
+
+/// merges anchors of disproven children, dependency on the node itself is dropped
+static inline HASH merge_anchor(HASH merged, HASH anchor, HASH own_key) {
+    if (anchor == own_key || anchor == 0) return merged;
+    if (merged == 0) return anchor;
+    return merged == anchor ? merged : SHOGI_TSUME_ANY_ANCHOR;
+}
+
+static void mid(TsumeThread *thread, TsumeValue *node, guint32 threshold_pn, guint32 threshold_dn) {
+    TsumeSolver *solver = thread->solver;
+    ShogiPosition *pos = &thread->pos;
+    gboolean or_node = pos->black_turn == solver->black_attacks;
+    HASH own_key = pos->key;
+    HASH board_key = shogi_position_board_key(pos);
+    guint8 hand[SHOGI_PAWN_COUNT];
+    get_hand(thread, hand);
+    guint64 nodes_before = thread->nodes;
+
+    thread->nodes++;
+    if (should_stop(thread))
+        return;
+
+    if (thread->path_length >= SHOGI_TSUME_MAX_PLY - 1) { // too deep, give up on this line only
+        node->pn = SHOGI_TSUME_INFINITE;
+        node->dn = 0;
+        node->anchor = SHOGI_TSUME_ANY_ANCHOR;
+        return;
+    }
+
+    TsumeChild *children = g_new(TsumeChild, SHOGI_POSITION_MAX_MOVES);
+    int count = generate_children(thread, or_node, children);
+    if (count <= 0) {
+        // no checks - attacker failed, no escapes or king capture - mate
+        gboolean proven = or_node ? count < 0 : TRUE;
+        node->pn = proven ? 0 : SHOGI_TSUME_INFINITE;
+        node->dn = proven ? SHOGI_TSUME_INFINITE : 0;
+        node->distance = (guint16) (count < 0 ? 1 : 0);
+        node->anchor = 0;
+        tt_store(thread, board_key, hand, node, 1);
+        g_free(children);
+        return;
+    }
+
+    TsumeValue *values = g_new(TsumeValue, count);
+    int last_searched = -1;
+    TsumeValue last_value = {0};
+
+    thread->path[thread->path_length++] = own_key;
+    tt_set_working(thread, board_key, hand, TRUE);
+
+    while (TRUE) {
+        // collect values of children and compute value of the node
+        guint32 pn = or_node ? SHOGI_TSUME_INFINITE : 0;
+        guint32 dn = or_node ? 0 : SHOGI_TSUME_INFINITE;
+        for (int i = 0; i < count; ++i) {
+            child_value(thread, &children[i], &values[i]);
+            if (i == last_searched && values[i].pn != 0 && values[i].dn != 0)
+                values[i] = last_value; // tt entry could have been replaced, result of search is fresher
+            if (or_node) {
+                pn = MIN(pn, values[i].pn);
+                dn = sum_numbers(dn, values[i].dn);
+            } else {
+                pn = sum_numbers(pn, values[i].pn);
+                dn = MIN(dn, values[i].dn);
+            }
+        }
+        node->pn = pn;
+        node->dn = dn;
+
+        if (pn == 0 || dn == 0 || pn >= threshold_pn || dn >= threshold_dn || g_atomic_int_get(&solver->stop))
+            break;
+
+        // select most promising child, threads start the scan at different children to spread out
+        int best = -1;
+        guint32 best_number = SHOGI_TSUME_INFINITE, second_number = SHOGI_TSUME_INFINITE;
+        for (int k = 0; k < count; ++k) {
+            int i = (k + thread->id) % count;
+            guint32 number = or_node ? values[i].pn : values[i].dn;
+            if (best == -1 || number < best_number) {
+                second_number = best_number;
+                best_number = number;
+                best = i;
+            } else if (number < second_number) {
+                second_number = number;
+            }
+        }
+
+        guint32 child_threshold_pn, child_threshold_dn;
+        if (or_node) {
+            child_threshold_pn = MIN(threshold_pn, sum_numbers(second_number, 1));
+            child_threshold_dn = threshold_dn >= SHOGI_TSUME_INFINITE ? SHOGI_TSUME_INFINITE :
+                                 threshold_dn - dn + values[best].dn;
+        } else {
+            child_threshold_dn = MIN(threshold_dn, sum_numbers(second_number, 1));
+            child_threshold_pn = threshold_pn >= SHOGI_TSUME_INFINITE ? SHOGI_TSUME_INFINITE :
+                                 threshold_pn - pn + values[best].pn;
+        }
+
+        last_value = values[best];
+        shogi_position_do_move(pos, children[best].move);
+        mid(thread, &last_value, child_threshold_pn, child_threshold_dn);
+        shogi_position_undo_move(pos, children[best].move);
+        last_searched = best;
+    }
+
+    thread->path_length--;
+    tt_set_working(thread, board_key, hand, FALSE);
+
+    node->distance = 0;
+    node->anchor = 0;
+    if (node->pn == 0) {
+        // attacker picks the shortest mate, defender the longest resistance
+        int distance = or_node ? G_MAXINT : 0;
+        for (int i = 0; i < count; ++i) {
+            if (values[i].pn != 0) continue;
+            distance = or_node ? MIN(distance, values[i].distance) : MAX(distance, values[i].distance);
+        }
+        node->distance = (guint16) MIN(distance + 1, G_MAXUINT16);
+    } else if (node->dn == 0) {
+        HASH anchor = 0;
+        if (or_node) { // all checks fail
+            for (int i = 0; i < count; ++i)
+                anchor = merge_anchor(anchor, values[i].anchor, own_key);
+        } else { // one escape is enough, prefer one which doesn't depend on the path
+            anchor = SHOGI_TSUME_ANY_ANCHOR;
+            for (int i = 0; i < count && anchor != 0; ++i)
+                if (values[i].dn == 0)
+                    anchor = merge_anchor(0, values[i].anchor, own_key);
+        }
+        node->anchor = anchor;
+    }
+
+    if (!g_atomic_int_get(&solver->stop) || node->pn == 0 || node->dn == 0)
+        tt_store(thread, board_key, hand, node, (guint32) MIN(thread->nodes - nodes_before, G_MAXUINT32));
+
+    g_free(values);
+    g_free(children);
+}
+
+static gpointer solve_thread(gpointer data) {
+    SHOGI_TRACE_FUNCTION();
+    TsumeThread *thread = data;
+    TsumeValue root = {1, 1, 0, 0};
+    while (root.pn != 0 && root.dn != 0 && !g_atomic_int_get(&thread->solver->stop))
+        mid(thread, &root, SHOGI_TSUME_INFINITE, SHOGI_TSUME_INFINITE);
+    g_atomic_int_set(&thread->solver->stop, 1); // solved, other threads can finish
+    return NULL;
+}
+
+/// follows proven children from the root: attacker's shortest mate against defender's longest resistance
+static int extract_mate(TsumeThread *thread, ShogiMove *moves) {
+    ShogiPosition *pos = &thread->pos;
+    TsumeChild *children = g_new(TsumeChild, SHOGI_POSITION_MAX_MOVES);
+    int length = 0;
+    thread->path_length = 0;
+
+    while (length < SHOGI_TSUME_MAX_PLY) {
+        gboolean or_node = pos->black_turn == thread->solver->black_attacks;
+        int count = generate_children(thread, or_node, children);
+        if (count < 0) { // king capture ends the game
+            moves[length++] = children[0].move;
+            break;
+        }
+        if (count == 0) break;
+
+        int best = -1;
+        int best_distance = 0;
+        for (int i = 0; i < count; ++i) {
+            TsumeValue value;
+            child_value(thread, &children[i], &value);
+            if (value.pn != 0) continue;
+            if (best == -1 || (or_node ? value.distance < best_distance : value.distance > best_distance)) {
+                best = i;
+                best_distance = value.distance;
+            }
+        }
+        if (best == -1) break; // proof was overwritten in hash table
+
+        thread->path[thread->path_length++] = pos->key;
+        shogi_position_do_move(pos, children[best].move);
+        moves[length++] = children[best].move;
+    }
+    g_free(children);
+    return length;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void shogi_tsume_options_default(ShogiTsumeOptions *options) {
+    options->hash_megabytes = 64;
+    options->threads = 1;
+    options->max_nodes = 0;
+    options->max_time = 0;
+}
+
+enum SHOGI_TSUME_RESULT shogi_tsume_solve(const ShogiPosition *pos, const ShogiTsumeOptions *options,
+                                          ShogiTsumeSolution *solution) {
+    SHOGI_TRACE_FUNCTION();
+    ShogiTsumeOptions defaults;
+    if (options == NULL) {
+        shogi_tsume_options_default(&defaults);
+        options = &defaults;
+    }
+    memset(solution, 0, sizeof(ShogiTsumeSolution));
+
+    TsumeSolver *solver = g_new0(TsumeSolver, 1);
+    gsize clusters = 1;
+    while (clusters * 2 * SHOGI_TSUME_CLUSTER * sizeof(TsumeEntry) <= MAX(options->hash_megabytes, 1) * 1024 * 1024)
+        clusters *= 2;
+    solver->entries = calloc(clusters * SHOGI_TSUME_CLUSTER, sizeof(TsumeEntry));
+    if (solver->entries == NULL) {
+        shogi_logger_log(SHOGI_LOGGER_LOG_LEVEL_ERROR, "Cannot allocate tsume hash table.");
+        g_free(solver);
+        return SHOGI_TSUME_UNKNOWN;
+    }
+    solver->cluster_mask = clusters - 1;
+    for (int i = 0; i < SHOGI_TSUME_LOCKS; ++i)
+        g_mutex_init(&solver->locks[i]);
+    g_mutex_init(&solver->nodes_lock);
+    solver->black_attacks = pos->black_turn;
+    solver->max_nodes = options->max_nodes;
+    solver->deadline = options->max_time > 0 ? g_get_monotonic_time() + options->max_time * 1000 : 0;
+
+    int thread_count = CLAMP(options->threads, 1, 256);
+    TsumeThread *threads = g_new0(TsumeThread, thread_count);
+    GThread **handles = g_new0(GThread *, thread_count);
+    for (int i = 0; i < thread_count; ++i) {
+        threads[i].solver = solver;
+        threads[i].id = i;
+        threads[i].pos = *pos;
+        if (i > 0)
+            handles[i] = g_thread_new("tsume", solve_thread, &threads[i]);
+    }
+    solve_thread(&threads[0]);
+    for (int i = 1; i < thread_count; ++i)
+        g_thread_join(handles[i]);
+
+    // read result of the root
+    TsumeThread *main = &threads[0];
+    main->pos = *pos;
+    main->path_length = 0;
+    guint8 hand[SHOGI_PAWN_COUNT];
+    get_hand(main, hand);
+    TsumeValue root;
+    tt_lookup(main, shogi_position_board_key(pos), hand, &root);
+
+    for (int i = 0; i < thread_count; ++i)
+        solution->nodes += threads[i].nodes;
+    if (root.pn == 0) {
+        solution->result = SHOGI_TSUME_PROVEN;
+        solution->length = extract_mate(main, solution->moves);
+    } else if (root.dn == 0) {
+        solution->result = SHOGI_TSUME_DISPROVEN;
+    } else {
+        solution->result = SHOGI_TSUME_UNKNOWN;
+    }
+
+    for (int i = 0; i < SHOGI_TSUME_LOCKS; ++i)
+        g_mutex_clear(&solver->locks[i]);
+    g_mutex_clear(&solver->nodes_lock);
+    free(solver->entries);
+    g_free(solver);
+    g_free(threads);
+    g_free(handles);
+    return solution->result;
+}
@@ -0,0 +1,53 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#ifndef SHOGI_TSUME_H
+#define SHOGI_TSUME_H
+
+#include <glib.h>
+#include "Position.h"
+
+// Checkmate (tsume) solver based on depth-first proof-number search (df-pn).
+// Player to move in the given position attacks and may only play checks, the other player may play any move
+// that gets his king out of check. Attacker wins when defender has no such move.
+
+#define SHOGI_TSUME_MAX_PLY 256
+
+enum SHOGI_TSUME_RESULT {
+    SHOGI_TSUME_UNKNOWN, // search was stopped before the position was solved
+    SHOGI_TSUME_PROVEN, // attacker mates
+    SHOGI_TSUME_DISPROVEN // there is no mate
+};
+
+typedef struct _shogi_tsume_options {
+    gsize hash_megabytes;
+    int threads;
+    guint64 max_nodes; // 0 for no limit
+    gint64 max_time; // in miliseconds, 0 for no limit
+} ShogiTsumeOptions;
+
+typedef struct _shogi_tsume_solution {
+    enum SHOGI_TSUME_RESULT result;
+    ShogiMove moves[SHOGI_TSUME_MAX_PLY]; // mate sequence when proven, defender plays the longest resistance
+    int length;
+    guint64 nodes;
+} ShogiTsumeSolution;
+
+/**
+ * Fills options with default values: 64 MB hash, one thread and no limits
+ * @param options options to fill
+ */
+void shogi_tsume_options_default(ShogiTsumeOptions *options);
+
+/**
+ * Solves mate problem for the player to move
+ * @param pos position to solve
+ * @param options solver options, NULL for defaults
+ * @param solution filled with result, mate sequence and number of searched nodes
+ * @return result of the search, same as solution->result
+ */
+enum SHOGI_TSUME_RESULT shogi_tsume_solve(const ShogiPosition *pos, const ShogiTsumeOptions *options,
+                                          ShogiTsumeSolution *solution);
+
+#endif //SHOGI_TSUME_H
@@ -10,8 +10,8 @@
 
 #define     SHOGI_UI_SCALE                     0.7
 
-#define     SHOGI_PAWN_IS_BLACK(pawn)       ((pawn) == SHOGI_PAWN_NONE ? 0 : ((pawn)%2 == 1))
-#define     SHOGI_PAWN_IS_WHITE(pawn)       ((pawn) == SHOGI_PAWN_NONE ? 0 : ((pawn)%2 == 0))
+#define     SHOGI_PAWN_IS_BLACK(pawn)       ((pawn) == SHOGI_PAWN_DETAILED_NONE ? 0 : ((pawn)%2 == 1))
+#define     SHOGI_PAWN_IS_WHITE(pawn)       ((pawn) == SHOGI_PAWN_DETAILED_NONE ? 0 : ((pawn)%2 == 0))
 
 #define     SHOGI_PAWN_COUNT                8
 enum SHOGI_PAWN {
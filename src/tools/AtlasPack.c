@@ -0,0 +1,88 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+// Build step packing board and pawn textures into the atlas embedded in the app, see ResourceManager.h.
+// usage: shogi-atlas <resources dir> <atlas.png>
+
+#include <stdio.h>
+#include <math.h>
+#include <glib.h>
+#include "../ResourceManager.h"
+
+static const char *pawn_files[SHOGI_PAWN_DETAILED_COUNT] = {
+        "K_white", "K_black", "G_white", "G_black", "S_white", "S_black", "N_white", "N_black",
+        "L_white", "L_black", "B_white", "B_black", "R_white", "R_black", "P_white", "P_black",
+        "S+_white", "S+_black", "N+_white", "N+_black", "L+_white", "L+_black",
+        "B+_white", "B+_black", "R+_white", "R+_black", "P+_white", "P+_black"
+};
+
+/// loads PNG, returns NULL and prints error on failure
+static cairo_surface_t *load_texture(const char *path, int size) {
+    cairo_surface_t *texture = cairo_image_surface_create_from_png(path);
+    if (cairo_surface_status(texture) != CAIRO_STATUS_SUCCESS) {
+        fprintf(stderr, "Cannot load %s: %s\n", path, cairo_status_to_string(cairo_surface_status(texture)));
+        cairo_surface_destroy(texture);
+        return NULL;
+    }
+    if (cairo_image_surface_get_width(texture) != size || cairo_image_surface_get_height(texture) != size) {
+        fprintf(stderr, "%s is not %dx%d\n", path, size, size);
+        cairo_surface_destroy(texture);
+        return NULL;
+    }
+    return texture;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        printf("usage: shogi-atlas <resources dir> <atlas.png>\n");
+        return 1;
+    }
+
+    cairo_surface_t *atlas = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, SHOGI_ATLAS_WIDTH, SHOGI_ATLAS_HEIGHT);
+    cairo_t *cr = cairo_create(atlas);
+    int status = 0;
+
+    char *path = g_build_filename(argv[1], "board.png", NULL);
+    cairo_surface_t *board = load_texture(path, SHOGI_ATLAS_BOARD_SIZE);
+    g_free(path);
+    if (board) {
+        cairo_set_source_surface(cr, board, 0, 0);
+        cairo_paint(cr);
+        cairo_surface_destroy(board);
+    } else {
+        status = 1;
+    }
+
+    for (int i = 0; i < SHOGI_PAWN_DETAILED_COUNT && status == 0; ++i) {
+        char *name = g_strconcat(pawn_files[i], ".png", NULL);
+        path = g_build_filename(argv[1], "pawns", "96x96", name, NULL);
+        cairo_surface_t *pawn = load_texture(path, SHOGI_ATLAS_PAWN_SIZE);
+        g_free(path);
+        g_free(name);
+        if (pawn == NULL) {
+            status = 1;
+            break;
+        }
+
+        // white pawns face the other side, so they are rotated by half a turn around the center of their cell
+        cairo_save(cr);
+        cairo_translate(cr, SHOGI_ATLAS_PAWN_X(i) + SHOGI_ATLAS_PAWN_SIZE / 2.0,
+                        SHOGI_ATLAS_PAWN_Y(i) + SHOGI_ATLAS_PAWN_SIZE / 2.0);
+        if (!SHOGI_PAWN_IS_BLACK(i))
+            cairo_rotate(cr, M_PI);
+        cairo_translate(cr, -SHOGI_ATLAS_PAWN_SIZE / 2.0, -SHOGI_ATLAS_PAWN_SIZE / 2.0);
+        cairo_set_source_surface(cr, pawn, 0, 0);
+        cairo_paint(cr);
+        cairo_restore(cr);
+        cairo_surface_destroy(pawn);
+    }
+    cairo_destroy(cr);
+
+    if (status == 0 && cairo_surface_write_to_png(atlas, argv[2]) != CAIRO_STATUS_SUCCESS) {
+        fprintf(stderr, "Cannot write %s\n", argv[2]);
+        status = 1;
+    }
+    cairo_surface_destroy(atlas);
+    return status;
+}
@@ -0,0 +1,605 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+// Microbenchmarks of the rules engine primitives in Model.c.
+// usage: shogi-bench [--filter text] [--samples N] [--min-time ms] [--warmup ms] [--json file] [--compare file]
+//   --filter   runs only benchmarks with text in their name, for example hitmap_calc/
+//   --samples  timed samples of each benchmark, 20 by default
+//   --min-time length of one sample, operations per sample are doubled until it takes this long, 20 ms by default
+//   --warmup   time each benchmark runs before it's measured, 100 ms by default
+//   --json     writes results with all samples to file, one benchmark per line
+//   --compare  compares results with earlier --json output, differences are tested with Mann-Whitney U test
+// Benchmarks run over a fixed corpus: positions of the engine suite and positions of random playouts from a fixed
+// seed, so results of different commits are comparable as long as the corpus doesn't change (see BENCH_CORPUS_*).
+// The bench runs in a temporary directory, since the model writes it's history and journal to working directory.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+#include "PositionSuite.h"
+#include "../Model.h"
+#include "../Position.h"
+#include "../Logger.h"
+
+#define BENCH_CORPUS_SEED       0x5EED5EEDu
+#define BENCH_CORPUS_GAMES      32 // random playouts added to the suite positions
+#define BENCH_CORPUS_PLIES      160 // plies of each playout at most
+#define BENCH_CORPUS_STRIDE     4 // every n-th position of a playout is added
+#define BENCH_DEFAULT_SAMPLES   20
+#define BENCH_DEFAULT_MIN_TIME  20 // ms
+#define BENCH_DEFAULT_WARMUP    100 // ms
+#define BENCH_SIGNIFICANT_Z     2.576 // two sided p < 0.01
+#define BENCH_PIECE_TYPES       (SHOGI_PAWN_DETAILED_COUNT / 2)
+
+typedef struct _shogi_bench_position {
+    enum SHOGI_PAWN_DETAILED **board; // board as in ShogiModel
+    gboolean black_turn;
+    char state[SHOGI_MODEL_SERIALIZED_STATE_LENGTH];
+    int drop_col, drop_row; // square in front of opponent's king checked for pawn drop mate, -1 if it's occupied
+} ShogiBenchPosition;
+
+typedef struct _shogi_bench_square {
+    int position;
+    int col, row;
+} ShogiBenchSquare;
+
+/// arguments of shogi_model_parse_move() for a move of the corpus
+typedef struct _shogi_bench_move {
+    enum SHOGI_PAWN_DETAILED pawn;
+    int col_a, row_a, type, col_b, row_b, promote;
+} ShogiBenchMove;
+
+typedef struct _shogi_bench_spec {
+    char name[32];
+    void (*setup)(struct _shogi_bench_spec *spec, int sample); // prepares a sample, not timed, may be NULL
+    guint64 (*run)(struct _shogi_bench_spec *spec, guint64 ops); // returns value depending on the work
+    GArray *squares; // ShogiBenchSquare, only for hitmap_calc of one piece type
+    guint cursor; // next case, benchmarks cycle through the corpus
+} ShogiBenchSpec;
+
+typedef struct _shogi_bench_result {
+    char name[32];
+    guint64 ops; // operations per sample
+    double *samples; // ns per operation
+    int count;
+    double median, mean, stddev, mad, min, max;
+} ShogiBenchResult;
+
+static GArray *positions; // ShogiBenchPosition
+static GArray *moves; // ShogiBenchMove
+static int drop_positions; // positions with free square in front of opponent's king
+static char **hitmap;
+static volatile guint64 sink; // keeps results of measured calls alive
+static ShogiModel *bench_model;
+
+static const char *piece_names[BENCH_PIECE_TYPES] = {
+        "K", "G", "S", "N", "L", "B", "R", "P", "+S", "+N", "+L", "+B", "+R", "+P"
+};
+
+static void print_usage() {
+    printf("usage: shogi-bench [--filter text] [--samples N] [--min-time ms] [--warmup ms] [--json file]\n"
+           "                   [--compare file]\n");
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// xorshift32, the corpus mustn't depend on the C library's rand()
+static guint32 corpus_random(guint32 *state) {
+    guint32 x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static void corpus_add(const ShogiPosition *pos) {
+    ShogiBenchPosition entry;
+    entry.board = g_new(enum SHOGI_PAWN_DETAILED *, 9);
+    for (int i = 0; i < 9; ++i) {
+        entry.board[i] = g_new(enum SHOGI_PAWN_DETAILED, 9);
+        memcpy(entry.board[i], pos->board[i], 9 * sizeof(enum SHOGI_PAWN_DETAILED));
+    }
+    entry.black_turn = pos->black_turn;
+    for (int i = 0; i < SHOGI_PAWN_COUNT; ++i) {
+        entry.state[i] = SHOGI_MODEL_TO_COUNT_CODE(pos->hand[0][i]);
+        entry.state[SHOGI_PAWN_COUNT + i] = SHOGI_MODEL_TO_COUNT_CODE(pos->hand[1][i]);
+    }
+    for (int i = 0; i < SHOGI_SQUARE_COUNT; ++i)
+        entry.state[16 + i] = SHOGI_MODEL_TO_PAWN_CODE(pos->board[i / 9][i % 9]);
+    entry.state[SHOGI_MODEL_SERIALIZED_STATE_LENGTH - 1] = '\0';
+
+    entry.drop_col = entry.drop_row = -1;
+    int king = shogi_position_king_square(pos, !pos->black_turn);
+    int drop = king == -1 ? -1 : king + (pos->black_turn ? 9 : -9);
+    if (drop >= 0 && drop < SHOGI_SQUARE_COUNT && pos->board[drop / 9][drop % 9] == SHOGI_PAWN_DETAILED_NONE) {
+        entry.drop_col = SHOGI_SQUARE_COL(drop);
+        entry.drop_row = SHOGI_SQUARE_ROW(drop);
+        drop_positions++;
+    }
+    g_array_append_val(positions, entry);
+
+    ShogiMove generated[SHOGI_POSITION_MAX_MOVES];
+    int count = shogi_position_generate_all(pos, generated);
+    for (int i = 0; i < count; ++i) {
+        ShogiMove move = generated[i];
+        int from = SHOGI_MOVE_FROM(move), to = SHOGI_MOVE_TO(move);
+        gboolean drop_move = SHOGI_MOVE_IS_DROP(move);
+        ShogiBenchMove args = {SHOGI_MOVE_PAWN(move), drop_move ? -1 : SHOGI_SQUARE_COL(from),
+                               drop_move ? -1 : SHOGI_SQUARE_ROW(from),
+                               drop_move ? 2 : SHOGI_MOVE_IS_CAPTURE(move) ? 1 : 0,
+                               SHOGI_SQUARE_COL(to), SHOGI_SQUARE_ROW(to), SHOGI_MOVE_IS_PROMOTION(move) ? 1 : 0};
+        g_array_append_val(moves, args);
+    }
+}
+
+/// plays random moves which don't leave the king in check, adding every BENCH_CORPUS_STRIDE-th position
+static void corpus_playout(guint32 *random) {
+    ShogiPosition pos;
+    shogi_position_init(&pos);
+    for (int ply = 0; ply < BENCH_CORPUS_PLIES; ++ply) {
+        if (ply % BENCH_CORPUS_STRIDE == 0)
+            corpus_add(&pos);
+        ShogiMove generated[SHOGI_POSITION_MAX_MOVES], legal[SHOGI_POSITION_MAX_MOVES];
+        int count = shogi_position_generate_all(&pos, generated), legal_count = 0;
+        for (int i = 0; i < count; ++i) {
+            if (SHOGI_MOVE_IS_KING_CAPTURE(generated[i]))
+                continue;
+            shogi_position_do_move(&pos, generated[i]);
+            if (!shogi_position_in_check(&pos, !pos.black_turn))
+                legal[legal_count++] = generated[i];
+            shogi_position_undo_move(&pos, generated[i]);
+        }
+        if (legal_count == 0)
+            return;
+        shogi_position_do_move(&pos, legal[corpus_random(random) % legal_count]);
+    }
+}
+
+static void corpus_init() {
+    positions = g_array_new(FALSE, FALSE, sizeof(ShogiBenchPosition));
+    moves = g_array_new(FALSE, FALSE, sizeof(ShogiBenchMove));
+    for (int i = 0; i < SHOGI_POSITION_SUITE_SIZE; ++i) {
+        ShogiPosition pos;
+        if (shogi_position_from_sfen(&pos, shogi_position_suite[i]))
+            corpus_add(&pos);
+    }
+    guint32 random = BENCH_CORPUS_SEED;
+    for (int i = 0; i < BENCH_CORPUS_GAMES; ++i)
+        corpus_playout(&random);
+    hitmap = shogi_model_hitmap_new();
+}
+
+static void corpus_free() {
+    for (guint i = 0; i < positions->len; ++i) {
+        ShogiBenchPosition *entry = &g_array_index(positions, ShogiBenchPosition, i);
+        for (int j = 0; j < 9; ++j)
+            g_free(entry->board[j]);
+        g_free(entry->board);
+    }
+    g_array_free(positions, TRUE);
+    g_array_free(moves, TRUE);
+    SHOGI_MODEL_FREE_MATRIX(hitmap);
+}
+
+/// next case of the benchmark, wrapping around
+static guint next_case(ShogiBenchSpec *spec, guint count) {
+    guint it = spec->cursor;
+    spec->cursor = it + 1 == count ? 0 : it + 1;
+    return it;
+}
+
+#define BENCH_POSITION(i) (&g_array_index(positions, ShogiBenchPosition, (i)))
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static guint64 run_hitmap_calc(ShogiBenchSpec *spec, guint64 ops) {
+    guint64 result = 0;
+    for (guint64 i = 0; i < ops; ++i) {
+        const ShogiBenchSquare *square = &g_array_index(spec->squares, ShogiBenchSquare,
+                                                        next_case(spec, spec->squares->len));
+        shogi_model_hitmap_calc(hitmap, BENCH_POSITION(square->position)->board, square->col, square->row);
+        result += (guint8) hitmap[i % 9][(i / 9) % 9];
+    }
+    return result;
+}
+
+static guint64 run_hitmap_calc_all(ShogiBenchSpec *spec, guint64 ops) {
+    guint64 result = 0;
+    for (guint64 i = 0; i < ops; ++i) {
+        const ShogiBenchPosition *pos = BENCH_POSITION(next_case(spec, positions->len));
+        shogi_model_hitmap_calc_all(hitmap, pos->board, pos->black_turn);
+        result += (guint8) hitmap[i % 9][(i / 9) % 9];
+    }
+    return result;
+}
+
+static guint64 run_is_check(ShogiBenchSpec *spec, guint64 ops) {
+    guint64 result = 0;
+    for (guint64 i = 0; i < ops; ++i) {
+        const ShogiBenchPosition *pos = BENCH_POSITION(next_case(spec, positions->len));
+        result += shogi_model_is_check(pos->board, pos->black_turn);
+    }
+    return result;
+}
+
+/// checks the pawn drop in front of the opponent's king, positions where the square is occupied are skipped
+static guint64 run_exclude_drop_mate(ShogiBenchSpec *spec, guint64 ops) {
+    guint64 result = 0;
+    shogi_model_hitmap_clear(hitmap);
+    for (guint64 i = 0; i < ops;) {
+        const ShogiBenchPosition *pos = BENCH_POSITION(next_case(spec, positions->len));
+        if (pos->drop_col == -1)
+            continue;
+        IDX(hitmap, pos->drop_col, pos->drop_row) = 'o';
+        shogi_model_exclude_drop_mate(pos->board, hitmap, pos->black_turn);
+        result += IDX(hitmap, pos->drop_col, pos->drop_row) == 'o';
+        IDX(hitmap, pos->drop_col, pos->drop_row) = ' ';
+        ++i;
+    }
+    return result;
+}
+
+static void setup_serialize_state(G_GNUC_UNUSED ShogiBenchSpec *spec, int sample) {
+    shogi_model_deserialize_state(BENCH_POSITION(sample % positions->len)->state);
+}
+
+static guint64 run_serialize_state(G_GNUC_UNUSED ShogiBenchSpec *spec, guint64 ops) {
+    guint64 result = 0;
+    for (guint64 i = 0; i < ops; ++i) {
+        char *state = shogi_model_serialize_state();
+        result += (guint8) state[i % (SHOGI_MODEL_SERIALIZED_STATE_LENGTH - 1)];
+        free(state);
+    }
+    return result;
+}
+
+static guint64 run_deserialize_state(ShogiBenchSpec *spec, guint64 ops) {
+    guint64 result = 0;
+    enum SHOGI_PAWN_DETAILED **board = shogi_model_get_board();
+    for (guint64 i = 0; i < ops; ++i) {
+        shogi_model_deserialize_state(BENCH_POSITION(next_case(spec, positions->len))->state);
+        result += (guint) board[i % 9][(i / 9) % 9];
+    }
+    return result;
+}
+
+static guint64 run_hash_string(ShogiBenchSpec *spec, guint64 ops) {
+    guint64 result = 0;
+    for (guint64 i = 0; i < ops; ++i)
+        result += shogi_model_hash_string(BENCH_POSITION(next_case(spec, positions->len))->state);
+    return result;
+}
+
+static guint64 run_parse_move(ShogiBenchSpec *spec, guint64 ops) {
+    guint64 result = 0;
+    for (guint64 i = 0; i < ops; ++i) {
+        const ShogiBenchMove *args = &g_array_index(moves, ShogiBenchMove, next_case(spec, moves->len));
+        char *move = shogi_model_parse_move(args->pawn, args->col_a, args->row_a, args->type, args->col_b,
+                                            args->row_b, args->promote);
+        result += (guint8) move[1];
+        free(move);
+    }
+    return result;
+}
+
+/// history of the previous sample is dropped, so every sample appends to a short history file
+static void setup_history_append(G_GNUC_UNUSED ShogiBenchSpec *spec, G_GNUC_UNUSED int sample) {
+    shogi_model_reset();
+}
+
+static guint64 run_history_append(ShogiBenchSpec *spec, guint64 ops) {
+    for (guint64 i = 0; i < ops; ++i) {
+        const ShogiBenchPosition *pos = BENCH_POSITION(next_case(spec, positions->len));
+        shogi_model_append_history("P77-76", (HASH) i, pos->state);
+    }
+    return (guint64) bench_model->history_entries;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static ShogiBenchSpec *spec_new(GPtrArray *specs, const char *name, guint64 (*run)(ShogiBenchSpec *, guint64)) {
+    ShogiBenchSpec *spec = g_new0(ShogiBenchSpec, 1);
+    g_strlcpy(spec->name, name, sizeof(spec->name));
+    spec->run = run;
+    g_ptr_array_add(specs, spec);
+    return spec;
+}
+
+static void spec_free(gpointer data) {
+    ShogiBenchSpec *spec = data;
+    if (spec->squares)
+        g_array_free(spec->squares, TRUE);
+    g_free(spec);
+}
+
+static GPtrArray *specs_new() {
+    GPtrArray *specs = g_ptr_array_new_with_free_func(spec_free);
+    ShogiBenchSpec *by_piece[BENCH_PIECE_TYPES];
+    for (int i = 0; i < BENCH_PIECE_TYPES; ++i) {
+        char name[32];
+        g_snprintf(name, sizeof(name), "hitmap_calc/%s", piece_names[i]);
+        by_piece[i] = spec_new(specs, name, run_hitmap_calc);
+        by_piece[i]->squares = g_array_new(FALSE, FALSE, sizeof(ShogiBenchSquare));
+    }
+    for (guint i = 0; i < positions->len; ++i) {
+        for (int sq = 0; sq < SHOGI_SQUARE_COUNT; ++sq) {
+            enum SHOGI_PAWN_DETAILED pawn = BENCH_POSITION(i)->board[sq / 9][sq % 9];
+            if (pawn == SHOGI_PAWN_DETAILED_NONE)
+                continue;
+            ShogiBenchSquare square = {(int) i, SHOGI_SQUARE_COL(sq), SHOGI_SQUARE_ROW(sq)};
+            g_array_append_val(by_piece[pawn / 2]->squares, square);
+        }
+    }
+    for (guint i = 0; i < specs->len;) { // promoted pieces may be missing from the corpus
+        ShogiBenchSpec *spec = g_ptr_array_index(specs, i);
+        if (spec->squares->len == 0) g_ptr_array_remove_index(specs, i);
+        else ++i;
+    }
+
+    spec_new(specs, "hitmap_calc_all", run_hitmap_calc_all);
+    spec_new(specs, "is_check", run_is_check);
+    if (drop_positions > 0)
+        spec_new(specs, "exclude_drop_mate", run_exclude_drop_mate);
+    spec_new(specs, "serialize_state", run_serialize_state)->setup = setup_serialize_state;
+    spec_new(specs, "deserialize_state", run_deserialize_state);
+    spec_new(specs, "hash_string", run_hash_string);
+    spec_new(specs, "parse_move", run_parse_move);
+    spec_new(specs, "history_append", run_history_append)->setup = setup_history_append;
+    return specs;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+static double median_of(double *sorted, int count) {
+    return count % 2 ? sorted[count / 2] : (sorted[count / 2 - 1] + sorted[count / 2]) / 2;
+}
+
+/// ns per operation of one sample
+static double time_sample(ShogiBenchSpec *spec, int sample, guint64 ops) {
+    if (spec->setup)
+        spec->setup(spec, sample);
+    guint64 start = shogi_logger_time_ns();
+    sink += spec->run(spec, ops);
+    return (double) (shogi_logger_time_ns() - start) / ops;
+}
+
+static void measure(ShogiBenchSpec *spec, ShogiBenchResult *result, int samples, guint64 min_time, guint64 warmup) {
+    // calibrate operations per sample, this warms up caches and branch predictors as well
+    guint64 ops = 1;
+    while (time_sample(spec, 0, ops) * ops < min_time && ops < G_MAXUINT32)
+        ops *= 2;
+    guint64 warmup_start = shogi_logger_time_ns();
+    while (shogi_logger_time_ns() - warmup_start < warmup)
+        time_sample(spec, 0, ops);
+
+    g_strlcpy(result->name, spec->name, sizeof(result->name));
+    result->ops = ops;
+    result->count = samples;
+    result->samples = g_new(double, samples);
+    for (int i = 0; i < samples; ++i)
+        result->samples[i] = time_sample(spec, i, ops);
+
+    double *sorted = g_new(double, samples);
+    memcpy(sorted, result->samples, samples * sizeof(double));
+    qsort(sorted, samples, sizeof(double), compare_doubles);
+    result->min = sorted[0];
+    result->max = sorted[samples - 1];
+    result->median = median_of(sorted, samples);
+    double sum = 0, squares = 0;
+    for (int i = 0; i < samples; ++i)
+        sum += sorted[i];
+    result->mean = sum / samples;
+    for (int i = 0; i < samples; ++i) {
+        squares += (sorted[i] - result->mean) * (sorted[i] - result->mean);
+        sorted[i] = fabs(sorted[i] - result->median);
+    }
+    result->stddev = samples > 1 ? sqrt(squares / (samples - 1)) : 0;
+    qsort(sorted, samples, sizeof(double), compare_doubles);
+    result->mad = median_of(sorted, samples);
+    g_free(sorted);
+}
+
+static gboolean write_json(const char *path, ShogiBenchResult *results, int count, int samples, guint64 min_time) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL)
+        return FALSE;
+    fprintf(file, "{\"corpus\": {\"positions\": %u, \"moves\": %u, \"seed\": %u}, \"samples\": %d, "
+                  "\"min_time_ns\": %lu,\n \"benchmarks\": [\n", positions->len, moves->len, BENCH_CORPUS_SEED,
+            samples, (unsigned long) min_time);
+    for (int i = 0; i < count; ++i) {
+        const ShogiBenchResult *result = &results[i];
+        fprintf(file, "  {\"name\": \"%s\", \"ops\": %lu, \"median_ns\": %.3f, \"mean_ns\": %.3f, \"stddev_ns\": %.3f, "
+                      "\"mad_ns\": %.3f, \"min_ns\": %.3f, \"max_ns\": %.3f, \"samples\": [", result->name,
+                (unsigned long) result->ops, result->median, result->mean, result->stddev, result->mad, result->min,
+                result->max);
+        for (int j = 0; j < result->count; ++j)
+            fprintf(file, "%s%.3f", j ? ", " : "", result->samples[j]);
+        fprintf(file, "]}%s\n", i + 1 < count ? "," : "");
+    }
+    fprintf(file, " ]}\n");
+    return fclose(file) == 0;
+}
+
+/// reads samples of a benchmark from json written by write_json(), NULL if it's not there
+static GArray *read_json_samples(const char *json, const char *name) {
+    char *key = g_strdup_printf("{\"name\": \"%s\",", name);
+    const char *line = strstr(json, key);
+    g_free(key);
+    const char *it = line ? strstr(line, "\"samples\": [") : NULL;
+    const char *end = it ? strchr(it, ']') : NULL;
+    if (it == NULL || end == NULL)
+        return NULL;
+    GArray *samples = g_array_new(FALSE, FALSE, sizeof(double));
+    it += strlen("\"samples\": [");
+    while (it < end) {
+        char *next;
+        double value = g_ascii_strtod(it, &next);
+        if (next == it)
+            break;
+        g_array_append_val(samples, value);
+        it = next;
+        while (it < end && (*it == ',' || *it == ' '))
+            it++;
+    }
+    return samples;
+}
+
+/// z score of Mann-Whitney U test, positive when the new samples are slower
+static double mann_whitney_z(const double *old, int old_count, const double *new, int new_count) {
+    int total = old_count + new_count;
+    double *values = g_new(double, total);
+    memcpy(values, old, old_count * sizeof(double));
+    memcpy(values + old_count, new, new_count * sizeof(double));
+    double *sorted = g_new(double, total);
+    memcpy(sorted, values, total * sizeof(double));
+    qsort(sorted, total, sizeof(double), compare_doubles);
+
+    double rank_sum = 0; // of new samples, ties get their average rank
+    for (int i = old_count; i < total; ++i) {
+        int below = 0, equal = 0;
+        for (int j = 0; j < total; ++j) {
+            if (sorted[j] < values[i]) below++;
+            else if (sorted[j] == values[i]) equal++;
+        }
+        rank_sum += below + (equal + 1) / 2.0;
+    }
+    g_free(sorted);
+    g_free(values);
+
+    double u = rank_sum - new_count * (new_count + 1) / 2.0;
+    double mean = old_count * new_count / 2.0;
+    double deviation = sqrt(old_count * new_count * (total + 1) / 12.0);
+    return deviation > 0 ? (u - mean) / deviation : 0;
+}
+
+static void compare(const char *path, ShogiBenchResult *results, int count) {
+    char *json;
+    if (!g_file_get_contents(path, &json, NULL, NULL)) {
+        fprintf(stderr, "Cannot read %s\n", path);
+        return;
+    }
+    printf("\n%-24s %12s %12s %9s\n", "compared to", "old ns/op", "new ns/op", "change");
+    for (int i = 0; i < count; ++i) {
+        GArray *old = read_json_samples(json, results[i].name);
+        if (old == NULL || old->len == 0) {
+            printf("%-24s %12s %12.1f\n", results[i].name, "-", results[i].median);
+            if (old) g_array_free(old, TRUE);
+            continue;
+        }
+        double *old_samples = (double *) old->data;
+        qsort(old_samples, old->len, sizeof(double), compare_doubles);
+        double old_median = median_of(old_samples, (int) old->len);
+        double z = mann_whitney_z(old_samples, (int) old->len, results[i].samples, results[i].count);
+        printf("%-24s %12.1f %12.1f %+8.1f%%  %s\n", results[i].name, old_median, results[i].median,
+               (results[i].median / old_median - 1) * 100,
+               fabs(z) < BENCH_SIGNIFICANT_Z ? "~" : z < 0 ? "faster" : "slower");
+        g_array_free(old, TRUE);
+    }
+    g_free(json);
+}
+
+/// removes files the model left in the temporary directory and the directory itself
+static void remove_directory(const char *path) {
+    GDir *dir = g_dir_open(path, 0, NULL);
+    if (dir) {
+        const char *name;
+        while ((name = g_dir_read_name(dir))) {
+            char *file = g_build_filename(path, name, NULL);
+            g_remove(file);
+            g_free(file);
+        }
+        g_dir_close(dir);
+    }
+    g_rmdir(path);
+}
+
+static char *absolute_path(const char *path) {
+    if (path == NULL || g_path_is_absolute(path))
+        return g_strdup(path);
+    char *current = g_get_current_dir();
+    char *absolute = g_build_filename(current, path, NULL);
+    g_free(current);
+    return absolute;
+}
+
+int main(int argc, char **argv) {
+    const char *filter = NULL;
+    int samples = BENCH_DEFAULT_SAMPLES;
+    guint64 min_time = BENCH_DEFAULT_MIN_TIME * 1000000ull, warmup = BENCH_DEFAULT_WARMUP * 1000000ull;
+    char *json_path = NULL, *compare_path = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) filter = argv[++i];
+        else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) samples = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) min_time = atol(argv[++i]) * 1000000ull;
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) warmup = atol(argv[++i]) * 1000000ull;
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) json_path = absolute_path(argv[++i]);
+        else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc) compare_path = absolute_path(argv[++i]);
+        else {
+            print_usage();
+            return 1;
+        }
+    }
+    if (samples < 2) {
+        print_usage();
+        return 1;
+    }
+
+    char *directory = g_dir_make_tmp("shogi-bench-XXXXXX", NULL);
+    if (directory == NULL || chdir(directory) != 0) {
+        fprintf(stderr, "Cannot create temporary directory\n");
+        return 1;
+    }
+    if ((bench_model = shogi_model_init()) == NULL) {
+        fprintf(stderr, "Cannot create model\n");
+        return 1;
+    }
+    corpus_init();
+    GPtrArray *specs = specs_new();
+    printf("corpus: %u positions, %u moves; %d samples of at least %.0f ms\n", positions->len, moves->len, samples,
+           min_time / 1e6);
+    printf("%-24s %12s %10s %10s %10s %10s %12s\n", "benchmark", "median ns/op", "mean", "stddev", "mad", "min",
+           "ops/sample");
+
+    ShogiBenchResult *results = g_new0(ShogiBenchResult, specs->len);
+    int count = 0;
+    for (guint i = 0; i < specs->len; ++i) {
+        ShogiBenchSpec *spec = g_ptr_array_index(specs, i);
+        if (filter && strstr(spec->name, filter) == NULL)
+            continue;
+        ShogiBenchResult *result = &results[count++];
+        measure(spec, result, samples, min_time, warmup);
+        printf("%-24s %12.1f %10.1f %10.1f %10.1f %10.1f %12lu\n", result->name, result->median, result->mean,
+               result->stddev, result->mad, result->min, (unsigned long) result->ops);
+        fflush(stdout);
+    }
+
+    int status = 0;
+    if (json_path && !write_json(json_path, results, count, samples, min_time)) {
+        fprintf(stderr, "Cannot write %s\n", json_path);
+        status = 1;
+    }
+    if (compare_path)
+        compare(compare_path, results, count);
+
+    for (int i = 0; i < count; ++i)
+        g_free(results[i].samples);
+    g_free(results);
+    g_ptr_array_free(specs, TRUE);
+    corpus_free();
+    shogi_model_close();
+    shogi_logger_close();
+    remove_directory(directory);
+    g_free(directory);
+    g_free(json_path);
+    g_free(compare_path);
+    return status;
+}
@@ -0,0 +1,418 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+// Differential test of the engine's move generator (Position.c) against the hitmaps of the rules engine (Model.c).
+// usage: shogi-difftest [--positions N] [--threads N] [--seed S] [--max-ply N]
+//   --positions  positions to check, 1000000 by default
+//   --seed       seed of random games, each thread plays it's own games from seed + thread number
+//   --max-ply    random games are restarted after this many plies, 300 by default
+// Every thread plays random games of moves which don't leave the king in check. In each position destinations of
+// every piece of both players are compared: squares of the generated moves from the piece's square against
+// squares marked by shogi_model_hitmap_calc(). Drops of the player to move are compared against the rules of
+// shogi_model_drop_mode(), which works only on the global model, so it's rules are repeated here with
+// shogi_model_exclude_drop_mate(). Each difference is minimized by removing pieces and pawns in hand while the
+// difference persists, and reported as SFEN with the square and the squares each side disagrees on.
+//
+// Both engines are pseudo legal, so only destination squares are compared, with these allowances:
+//   promotions     generator has separate moves with and without promotion and omits the latter where the piece
+//                  couldn't move any more, the promoting move to the same square is always there
+//   king captures  compared like other captures, but random games never capture a king, so positions without
+//                  a king are not tested
+//   drop mate      generator calls shogi_model_exclude_drop_mate() only for the square ahead of the king, the
+//                  reference for all squares, so this compares it's shortcut but not the mate detection itself
+//   self check     neither engine filters moves leaving the own king in check, random games skip them
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../Position.h"
+#include "../Logger.h"
+#include "../Trace.h"
+#include "../Counters.h"
+
+#define SHOGI_DIFFTEST_DEFAULT_POSITIONS    1000000
+#define SHOGI_DIFFTEST_DEFAULT_MAX_PLY      300
+#define SHOGI_DIFFTEST_BATCH                1024 // positions taken by a thread at once
+#define SHOGI_DIFFTEST_MAX_REPORTS          20 // distinct counterexamples printed at most
+
+enum SHOGI_DIFFTEST_KIND {
+    SHOGI_DIFFTEST_BOARD, // destinations of a piece on board
+    SHOGI_DIFFTEST_DROP // drops of a pawn in hand
+};
+
+/// set of squares, bit sq of word sq / 64
+typedef struct _shogi_difftest_squares {
+    guint64 bits[2];
+} ShogiDiffTestSquares;
+
+typedef struct _shogi_difftest_options {
+    gint64 positions;
+    int threads;
+    guint32 seed;
+    int max_ply;
+} ShogiDiffTestOptions;
+
+typedef struct _shogi_difftest {
+    const ShogiDiffTestOptions *options;
+    gint next_batch; // taken atomically by workers
+    GMutex lock; // protects fields below
+    gint64 positions;
+    gint64 pieces; // destination sets compared
+    gint64 drops; // drop sets compared
+    gint64 differences; // positions with a difference, before minimization
+    GHashTable *reported; // minimized counterexamples, SFEN with the square
+} ShogiDiffTest;
+
+typedef struct _shogi_difftest_worker {
+    ShogiDiffTest *test;
+    int index;
+    guint32 random;
+    char **hitmap;
+} ShogiDiffTestWorker;
+
+static void print_usage() {
+    printf("usage: shogi-difftest [--positions N] [--threads N] [--seed S] [--max-ply N]\n");
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static void squares_add(ShogiDiffTestSquares *squares, int sq) {
+    squares->bits[sq / 64] |= G_GUINT64_CONSTANT(1) << (sq % 64);
+}
+
+static gboolean squares_equal(const ShogiDiffTestSquares *a, const ShogiDiffTestSquares *b) {
+    return a->bits[0] == b->bits[0] && a->bits[1] == b->bits[1];
+}
+
+/// appends squares of a that are not in b in board notation, for example 76,75
+static void squares_print(GString *out, const ShogiDiffTestSquares *a, const ShogiDiffTestSquares *b) {
+    gboolean first = TRUE;
+    for (int sq = 0; sq < SHOGI_SQUARE_COUNT; ++sq) {
+        guint64 bit = G_GUINT64_CONSTANT(1) << (sq % 64);
+        if ((a->bits[sq / 64] & bit) && !(b->bits[sq / 64] & bit)) {
+            g_string_append_printf(out, "%s%d%d", first ? "" : ",", SHOGI_SQUARE_COL(sq), SHOGI_SQUARE_ROW(sq));
+            first = FALSE;
+        }
+    }
+    if (first)
+        g_string_append_c(out, '-');
+}
+
+static guint32 next_random(guint32 *state) {
+    guint32 x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+/// board rows of the position in the layout Model.c takes
+static void model_board(const ShogiPosition *pos, enum SHOGI_PAWN_DETAILED **rows) {
+    for (int i = 0; i < 9; ++i)
+        rows[i] = (enum SHOGI_PAWN_DETAILED *) pos->board[i];
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// destinations of piece on sq, pos has the piece's owner to move
+static void generator_board(const ShogiPosition *pos, int sq, ShogiDiffTestSquares *squares) {
+    ShogiMove moves[SHOGI_POSITION_MAX_MOVES];
+    int count = shogi_position_generate_all(pos, moves);
+    memset(squares, 0, sizeof(*squares));
+    for (int i = 0; i < count; ++i)
+        if (!SHOGI_MOVE_IS_DROP(moves[i]) && SHOGI_MOVE_FROM(moves[i]) == sq)
+            squares_add(squares, SHOGI_MOVE_TO(moves[i]));
+}
+
+static void legacy_board(const ShogiPosition *pos, int sq, char **hitmap, ShogiDiffTestSquares *squares) {
+    enum SHOGI_PAWN_DETAILED *rows[9];
+    model_board(pos, rows);
+    shogi_model_hitmap_calc(hitmap, rows, SHOGI_SQUARE_COL(sq), SHOGI_SQUARE_ROW(sq));
+    memset(squares, 0, sizeof(*squares));
+    for (int i = 0; i < SHOGI_SQUARE_COUNT; ++i)
+        if (hitmap[i / 9][i % 9] == 'o')
+            squares_add(squares, i);
+}
+
+/// drops of pawn of the player to move
+static void generator_drops(const ShogiPosition *pos, enum SHOGI_PAWN_DETAILED pawn, ShogiDiffTestSquares *squares) {
+    ShogiMove moves[SHOGI_POSITION_MAX_MOVES];
+    int count = shogi_position_generate_all(pos, moves);
+    memset(squares, 0, sizeof(*squares));
+    for (int i = 0; i < count; ++i)
+        if (SHOGI_MOVE_IS_DROP(moves[i]) && SHOGI_MOVE_PAWN(moves[i]) == pawn)
+            squares_add(squares, SHOGI_MOVE_TO(moves[i]));
+}
+
+/// rules of shogi_model_drop_mode(): free squares the pawn can move from, no second pawn in column, no drop mate
+static void legacy_drops(const ShogiPosition *pos, enum SHOGI_PAWN_DETAILED pawn, char **hitmap,
+                         ShogiDiffTestSquares *squares) {
+    shogi_model_hitmap_clear(hitmap);
+    for (int row = 1; row <= 9; ++row) {
+        for (int col = 1; col <= 9; ++col) {
+            gboolean dead_end = (pawn == SHOGI_PAWN_DETAILED_N_BLACK && row <= 2) ||
+                                (pawn == SHOGI_PAWN_DETAILED_N_WHITE && row >= 8) ||
+                                ((pawn == SHOGI_PAWN_DETAILED_L_BLACK || pawn == SHOGI_PAWN_DETAILED_P_BLACK) &&
+                                 row == 1) ||
+                                ((pawn == SHOGI_PAWN_DETAILED_L_WHITE || pawn == SHOGI_PAWN_DETAILED_P_WHITE) &&
+                                 row == 9);
+            if (IDX(pos->board, col, row) == SHOGI_PAWN_DETAILED_NONE && !dead_end)
+                IDX(hitmap, col, row) = 'o';
+        }
+    }
+    if (SHOGI_PAWN_TO_BASE_TYPE(pawn) == SHOGI_PAWN_P) {
+        for (int col = 1; col <= 9; ++col)
+            for (int row = 1; row <= 9; ++row)
+                if (IDX(pos->board, col, row) == pawn)
+                    for (int k = 1; k <= 9; ++k)
+                        IDX(hitmap, col, k) = ' ';
+        enum SHOGI_PAWN_DETAILED *rows[9];
+        model_board(pos, rows);
+        shogi_model_exclude_drop_mate(rows, hitmap, pos->black_turn);
+    }
+    memset(squares, 0, sizeof(*squares));
+    for (int i = 0; i < SHOGI_SQUARE_COUNT; ++i)
+        if (hitmap[i / 9][i % 9] == 'o')
+            squares_add(squares, i);
+}
+
+/// compares one destination set, subject is the square of the piece or the dropped pawn
+static gboolean differs(const ShogiPosition *pos, enum SHOGI_DIFFTEST_KIND kind, int subject, char **hitmap,
+                        ShogiDiffTestSquares *generated, ShogiDiffTestSquares *legacy) {
+    if (kind == SHOGI_DIFFTEST_BOARD) {
+        generator_board(pos, subject, generated);
+        legacy_board(pos, subject, hitmap, legacy);
+    } else {
+        generator_drops(pos, (enum SHOGI_PAWN_DETAILED) subject, generated);
+        legacy_drops(pos, (enum SHOGI_PAWN_DETAILED) subject, hitmap, legacy);
+    }
+    return !squares_equal(generated, legacy);
+}
+
+/// removes pieces and pawns in hand one by one while the difference persists, kings and the subject are kept
+static void minimize(ShogiPosition *pos, enum SHOGI_DIFFTEST_KIND kind, int subject, char **hitmap) {
+    ShogiDiffTestSquares generated, legacy;
+    gboolean changed = TRUE;
+    while (changed) {
+        changed = FALSE;
+        for (int sq = 0; sq < SHOGI_SQUARE_COUNT; ++sq) {
+            enum SHOGI_PAWN_DETAILED pawn = pos->board[sq / 9][sq % 9];
+            if (pawn == SHOGI_PAWN_DETAILED_NONE || SHOGI_PAWN_TO_BASE_TYPE(pawn) == SHOGI_PAWN_K ||
+                (kind == SHOGI_DIFFTEST_BOARD && sq == subject))
+                continue;
+            ShogiPosition reduced = *pos;
+            reduced.board[sq / 9][sq % 9] = SHOGI_PAWN_DETAILED_NONE;
+            shogi_position_refresh(&reduced);
+            if (differs(&reduced, kind, subject, hitmap, &generated, &legacy)) {
+                *pos = reduced;
+                changed = TRUE;
+            }
+        }
+        for (int color = 0; color < 2; ++color) {
+            for (int base = 0; base < SHOGI_PAWN_COUNT; ++base) {
+                gboolean kept = kind == SHOGI_DIFFTEST_DROP && color == SHOGI_POSITION_COLOR(pos->black_turn) &&
+                                base == SHOGI_PAWN_TO_BASE_TYPE(subject);
+                while (pos->hand[color][base] > (kept ? 1 : 0)) {
+                    ShogiPosition reduced = *pos;
+                    reduced.hand[color][base]--;
+                    shogi_position_refresh(&reduced);
+                    if (!differs(&reduced, kind, subject, hitmap, &generated, &legacy))
+                        break;
+                    *pos = reduced;
+                    changed = TRUE;
+                }
+            }
+        }
+    }
+}
+
+/// minimizes the difference and prints it unless the same counterexample was already reported
+static void report(ShogiDiffTestWorker *worker, const ShogiPosition *found, enum SHOGI_DIFFTEST_KIND kind,
+                   int subject) {
+    static const char drop_character[SHOGI_PAWN_COUNT] = {'K', 'G', 'S', 'N', 'L', 'B', 'R', 'P'};
+    ShogiPosition pos = *found;
+    minimize(&pos, kind, subject, worker->hitmap);
+    ShogiDiffTestSquares generated, legacy;
+    differs(&pos, kind, subject, worker->hitmap, &generated, &legacy);
+    pos.ply = 0; // the same counterexample is found in games of different length
+
+    char *sfen = shogi_position_to_sfen(&pos);
+    GString *line = g_string_new(NULL);
+    if (kind == SHOGI_DIFFTEST_BOARD)
+        g_string_append_printf(line, "%s\tpiece %d%d\tonly generator ", sfen, SHOGI_SQUARE_COL(subject),
+                               SHOGI_SQUARE_ROW(subject));
+    else
+        g_string_append_printf(line, "%s\tdrop %c\tonly generator ", sfen,
+                               drop_character[SHOGI_PAWN_TO_BASE_TYPE(subject)]);
+    squares_print(line, &generated, &legacy);
+    g_string_append(line, "\tonly hitmap ");
+    squares_print(line, &legacy, &generated);
+    g_free(sfen);
+
+    ShogiDiffTest *test = worker->test;
+    g_mutex_lock(&test->lock);
+    if (!g_hash_table_contains(test->reported, line->str)) {
+        if (g_hash_table_size(test->reported) < SHOGI_DIFFTEST_MAX_REPORTS)
+            printf("difference: %s\n", line->str);
+        g_hash_table_add(test->reported, g_strdup(line->str));
+    }
+    g_mutex_unlock(&test->lock);
+    g_string_free(line, TRUE);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// compares all pieces of the player to move and it's drops, returns number of sets compared
+static int check_side(ShogiDiffTestWorker *worker, const ShogiPosition *pos, gint64 *drops, gboolean *different) {
+    ShogiDiffTestSquares generated[SHOGI_SQUARE_COUNT], generated_drops[SHOGI_PAWN_COUNT], legacy;
+    memset(generated, 0, sizeof(generated));
+    memset(generated_drops, 0, sizeof(generated_drops));
+    ShogiMove moves[SHOGI_POSITION_MAX_MOVES];
+    int count = shogi_position_generate_all(pos, moves);
+    for (int i = 0; i < count; ++i) {
+        if (SHOGI_MOVE_IS_DROP(moves[i]))
+            squares_add(&generated_drops[SHOGI_PAWN_TO_BASE_TYPE(SHOGI_MOVE_PAWN(moves[i]))], SHOGI_MOVE_TO(moves[i]));
+        else
+            squares_add(&generated[SHOGI_MOVE_FROM(moves[i])], SHOGI_MOVE_TO(moves[i]));
+    }
+
+    int compared = 0;
+    for (int sq = 0; sq < SHOGI_SQUARE_COUNT; ++sq) {
+        enum SHOGI_PAWN_DETAILED pawn = pos->board[sq / 9][sq % 9];
+        if (pawn == SHOGI_PAWN_DETAILED_NONE || SHOGI_PAWN_IS_BLACK(pawn) != pos->black_turn)
+            continue;
+        compared++;
+        legacy_board(pos, sq, worker->hitmap, &legacy);
+        if (!squares_equal(&generated[sq], &legacy)) {
+            *different = TRUE;
+            report(worker, pos, SHOGI_DIFFTEST_BOARD, sq);
+        }
+    }
+
+    for (int base = SHOGI_PAWN_G; base < SHOGI_PAWN_COUNT; ++base) {
+        if (pos->hand[SHOGI_POSITION_COLOR(pos->black_turn)][base] == 0)
+            continue;
+        enum SHOGI_PAWN_DETAILED pawn = SHOGI_PAWN_TO_DETAILED_TYPE(base, pos->black_turn);
+        (*drops)++;
+        legacy_drops(pos, pawn, worker->hitmap, &legacy);
+        if (!squares_equal(&generated_drops[base], &legacy)) {
+            *different = TRUE;
+            report(worker, pos, SHOGI_DIFFTEST_DROP, pawn);
+        }
+    }
+    return compared;
+}
+
+/// plays a random move which doesn't leave the king in check, false if there's none
+static gboolean random_move(ShogiDiffTestWorker *worker, ShogiPosition *pos) {
+    ShogiMove moves[SHOGI_POSITION_MAX_MOVES];
+    int count = shogi_position_generate_all(pos, moves);
+    while (count > 0) {
+        int pick = (int) (next_random(&worker->random) % (guint32) count);
+        ShogiMove move = moves[pick];
+        moves[pick] = moves[--count];
+        if (SHOGI_MOVE_IS_KING_CAPTURE(move))
+            continue;
+        shogi_position_do_move(pos, move);
+        if (!shogi_position_in_check(pos, !pos->black_turn))
+            return TRUE;
+        shogi_position_undo_move(pos, move);
+    }
+    return FALSE;
+}
+
+static gpointer worker_run(gpointer data) {
+    ShogiDiffTestWorker *worker = data;
+    ShogiDiffTest *test = worker->test;
+    const ShogiDiffTestOptions *options = test->options;
+    gint64 positions = 0, pieces = 0, drops = 0, differences = 0;
+    ShogiPosition pos;
+    shogi_position_init(&pos);
+
+    gint64 batch;
+    while ((batch = g_atomic_int_add(&test->next_batch, 1)) * SHOGI_DIFFTEST_BATCH < options->positions) {
+        gint64 batch_end = MIN((batch + 1) * SHOGI_DIFFTEST_BATCH, options->positions);
+        for (gint64 i = batch * SHOGI_DIFFTEST_BATCH; i < batch_end; ++i) {
+            gboolean different = FALSE;
+            pieces += check_side(worker, &pos, &drops, &different);
+            ShogiPosition other = pos; // pieces of the player who just moved
+            shogi_position_do_null_move(&other);
+            pieces += check_side(worker, &other, &drops, &different);
+            positions++;
+            differences += different;
+            if (pos.ply >= options->max_ply || !random_move(worker, &pos))
+                shogi_position_init(&pos);
+        }
+    }
+
+    g_mutex_lock(&test->lock);
+    test->positions += positions;
+    test->pieces += pieces;
+    test->drops += drops;
+    test->differences += differences;
+    g_mutex_unlock(&test->lock);
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    ShogiDiffTestOptions options = {SHOGI_DIFFTEST_DEFAULT_POSITIONS, (int) g_get_num_processors(), 1,
+                                    SHOGI_DIFFTEST_DEFAULT_MAX_PLY};
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--positions") == 0 && i + 1 < argc) options.positions = atoll(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) options.threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) options.seed = (guint32) strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--max-ply") == 0 && i + 1 < argc) options.max_ply = atoi(argv[++i]);
+        else {
+            print_usage();
+            return 1;
+        }
+    }
+    if (options.positions < 1 || options.threads < 1 || options.max_ply < 1) {
+        print_usage();
+        return 1;
+    }
+    shogi_trace_start_from_env();
+    shogi_counters_dump_start_from_env();
+
+    ShogiDiffTest test;
+    memset(&test, 0, sizeof(test));
+    test.options = &options;
+    test.reported = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    g_mutex_init(&test.lock);
+
+    ShogiDiffTestWorker *workers = g_new0(ShogiDiffTestWorker, options.threads);
+    GThread **threads = g_new(GThread *, options.threads);
+    gint64 start = g_get_monotonic_time();
+    for (int i = 0; i < options.threads; ++i) {
+        workers[i].test = &test;
+        workers[i].index = i;
+        workers[i].random = options.seed * 2654435761u + (guint32) i + 1; // xorshift state must not be 0
+        if (workers[i].random == 0) workers[i].random = 1;
+        workers[i].hitmap = shogi_model_hitmap_new();
+        threads[i] = g_thread_new("difftest", worker_run, &workers[i]);
+    }
+    for (int i = 0; i < options.threads; ++i) {
+        g_thread_join(threads[i]);
+        for (int j = 0; j < 9; ++j)
+            free(workers[i].hitmap[j]);
+        free(workers[i].hitmap);
+    }
+    double seconds = (g_get_monotonic_time() - start) / 1e6;
+
+    guint distinct = g_hash_table_size(test.reported);
+    printf("positions %ld  pieces %ld  drops %ld  time %.2f s  %.2f M positions/min on %d threads\n",
+           (long) test.positions, (long) test.pieces, (long) test.drops, seconds,
+           seconds > 0 ? test.positions / seconds * 60 / 1e6 : 0.0, options.threads);
+    printf("positions with differences %ld, %u distinct minimized counterexamples\n", (long) test.differences,
+           distinct);
+
+    g_free(threads);
+    g_free(workers);
+    g_hash_table_destroy(test.reported);
+    g_mutex_clear(&test.lock);
+    shogi_trace_stop();
+    shogi_counters_dump_stop();
+    shogi_logger_close();
+    return distinct ? 1 : 0;
+}
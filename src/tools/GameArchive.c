@@ -0,0 +1,419 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+// Packs game records into a compressed archive (see Archive.h) and reads them back.
+// usage: shogi-archive pack <archive> <games...> [--threads N]
+//        shogi-archive list <archive> [--player name] [--result 1-0|0-1|draw|*] [--from YYYYMMDD] [--to YYYYMMDD]
+//                                     [--min-length N] [--count]
+//        shogi-archive show <archive> <game>
+//        shogi-archive bench <archive> [--threads N]
+// Game records are lines of text as for the opening book, optionally preceded by tab separated metadata:
+//   [black <TAB> white <TAB> date <TAB>] result moves...
+//   Habu <TAB> Moriuchi <TAB> 2026-10-19 <TAB> 1-0 P77-76 P33-34 ...
+// Result is 1-0 (black won), 0-1 (white won), 1/2-1/2 (draw) or *. Saved games (*.shogi) are packed as well.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../Archive.h"
+#include "../Logger.h"
+#include "../Trace.h"
+#include "../Counters.h"
+
+#define SHOGI_ARCHIVE_PACK_CHUNK 4096  // games parsed in parallel before they are written in order
+
+typedef struct _shogi_archive_parsed_game {
+    char *record; // line of the records file, NULL for saved games
+    ShogiModelSave *save;
+    ShogiArchiveGame info;
+    ShogiMove moves[SHOGI_ARCHIVE_MAX_MOVES];
+    int count; // -1 if a move is unknown, the game is skipped
+} ShogiArchiveParsedGame;
+
+typedef struct _shogi_archive_pack_chunk {
+    ShogiArchiveParsedGame *games;
+    int count;
+    gint next; // index of next game to parse, taken atomically by workers
+} ShogiArchivePackChunk;
+
+typedef struct _shogi_archive_bench {
+    const ShogiArchive *archive;
+    gint next_block; // taken atomically by workers
+    GMutex lock; // protects totals below
+    gint64 moves;
+    gint64 games;
+    gint corrupted;
+} ShogiArchiveBench;
+
+static void print_usage() {
+    printf("usage: shogi-archive pack <archive> <games...> [--threads N]\n"
+           "       shogi-archive list <archive> [--player name] [--result 1-0|0-1|draw|*] [--from YYYYMMDD]\n"
+           "                                    [--to YYYYMMDD] [--min-length N] [--count]\n"
+           "       shogi-archive show <archive> <game>\n"
+           "       shogi-archive bench <archive> [--threads N]\n"
+           "  line of game records: [black<TAB>white<TAB>date<TAB>]result moves..., result is 1-0, 0-1, 1/2-1/2 or *\n");
+}
+
+static const char *result_name(guint8 result) {
+    switch (result) {
+        case SHOGI_ARCHIVE_RESULT_BLACK_WIN:
+            return "1-0";
+        case SHOGI_ARCHIVE_RESULT_WHITE_WIN:
+            return "0-1";
+        case SHOGI_ARCHIVE_RESULT_DRAW:
+            return "1/2-1/2";
+        default:
+            return "*";
+    }
+}
+
+static guint8 parse_result(const char *token) {
+    if (strcmp(token, "1-0") == 0) return SHOGI_ARCHIVE_RESULT_BLACK_WIN;
+    if (strcmp(token, "0-1") == 0) return SHOGI_ARCHIVE_RESULT_WHITE_WIN;
+    if (strcmp(token, "1/2-1/2") == 0 || strcmp(token, "draw") == 0) return SHOGI_ARCHIVE_RESULT_DRAW;
+    return SHOGI_ARCHIVE_RESULT_UNKNOWN;
+}
+
+/// parses date as YYYY-MM-DD or YYYYMMDD, 0 if it's unknown
+static guint32 parse_date(const char *date) {
+    guint32 value = 0;
+    int digits = 0;
+    for (const char *it = date; *it; ++it) {
+        if (*it >= '0' && *it <= '9') {
+            value = value * 10 + (guint32) (*it - '0');
+            digits++;
+        } else if (*it != '-') {
+            return 0;
+        }
+    }
+    return digits == 8 ? value : 0;
+}
+
+/// replays moves written in history notation, count is set to -1 if one of them cannot be played
+static void parse_moves(ShogiArchiveParsedGame *game, char **tokens) {
+    ShogiPosition pos;
+    shogi_position_init(&pos);
+    game->count = 0;
+    for (; *tokens; ++tokens) {
+        if ((*tokens)[0] == '\0') continue;
+        ShogiMove move = game->count < SHOGI_ARCHIVE_MAX_MOVES ? shogi_position_parse_move(&pos, *tokens)
+                                                               : SHOGI_MOVE_NONE;
+        if (move == SHOGI_MOVE_NONE) {
+            game->count = -1;
+            return;
+        }
+        shogi_position_do_move(&pos, move);
+        game->moves[game->count++] = move;
+    }
+}
+
+static void parse_record(ShogiArchiveParsedGame *game) {
+    char **fields = g_strsplit(g_strchomp(game->record), "\t", 4);
+    guint count = g_strv_length(fields);
+    if (count == 4) {
+        g_strlcpy(game->info.black, fields[0], SHOGI_ARCHIVE_NAME_LENGTH);
+        g_strlcpy(game->info.white, fields[1], SHOGI_ARCHIVE_NAME_LENGTH);
+        game->info.date = parse_date(fields[2]);
+    }
+    char **tokens = g_strsplit_set(count > 0 ? fields[count == 4 ? 3 : 0] : "", " \t", -1);
+    char **it = tokens;
+    while (*it && (*it)[0] == '\0') it++;
+    if (*it) {
+        game->info.result = parse_result(*it);
+        parse_moves(game, it + 1);
+    }
+    g_strfreev(tokens);
+    g_strfreev(fields);
+}
+
+static void parse_save(ShogiArchiveParsedGame *game) {
+    char **tokens = g_new(char *, game->save->history_entries + 1);
+    for (int i = 0; i < game->save->history_entries; ++i)
+        tokens[i] = game->save->history[i].move;
+    tokens[game->save->history_entries] = NULL;
+    parse_moves(game, tokens);
+    g_free(tokens);
+}
+
+static gpointer pack_worker(gpointer data) {
+    ShogiArchivePackChunk *chunk = data;
+    int game;
+    while ((game = g_atomic_int_add(&chunk->next, 1)) < chunk->count) {
+        ShogiArchiveParsedGame *parsed = &chunk->games[game];
+        if (parsed->save) parse_save(parsed);
+        else parse_record(parsed);
+    }
+    return NULL;
+}
+
+/// parses queued games on all threads and writes them in order, returns number of skipped games
+static int pack_chunk(ShogiArchiveWriter *writer, ShogiArchivePackChunk *chunk, int threads, gboolean *ok) {
+    GThread **workers = g_new(GThread *, threads);
+    chunk->next = 0;
+    for (int i = 0; i < threads; ++i)
+        workers[i] = g_thread_new("archive-pack", pack_worker, chunk);
+    for (int i = 0; i < threads; ++i)
+        g_thread_join(workers[i]);
+    g_free(workers);
+
+    int skipped = 0;
+    for (int i = 0; i < chunk->count; ++i) {
+        ShogiArchiveParsedGame *game = &chunk->games[i];
+        if (game->count < 0) skipped++;
+        else if (*ok) *ok = shogi_archive_writer_add(writer, &game->info, game->moves, game->count);
+        g_free(game->record);
+        shogi_model_save_free(game->save);
+    }
+    chunk->count = 0;
+    return skipped;
+}
+
+/// adds game to the chunk, packing the chunk once it's full
+static ShogiArchiveParsedGame *queue_game(ShogiArchiveWriter *writer, ShogiArchivePackChunk *chunk, int threads,
+                                          int *skipped, gboolean *ok) {
+    if (chunk->count == SHOGI_ARCHIVE_PACK_CHUNK)
+        *skipped += pack_chunk(writer, chunk, threads, ok);
+    ShogiArchiveParsedGame *game = &chunk->games[chunk->count++];
+    memset(&game->info, 0, sizeof(game->info));
+    game->record = NULL;
+    game->save = NULL;
+    game->count = -1; // lines without result are skipped
+    return game;
+}
+
+static int run_pack(int argc, char **argv) {
+    int threads = (int) g_get_num_processors();
+    const char **files = g_new(const char *, argc);
+    int files_count = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = MAX(atoi(argv[++i]), 1);
+        else files[files_count++] = argv[i];
+    }
+    ShogiArchiveWriter *writer = shogi_archive_writer_new(argv[0]);
+    if (writer == NULL) {
+        g_free(files);
+        return 1;
+    }
+
+    gint64 start = g_get_monotonic_time();
+    ShogiArchivePackChunk chunk = {g_new(ShogiArchiveParsedGame, SHOGI_ARCHIVE_PACK_CHUNK), 0, 0};
+    int skipped = 0;
+    gboolean ok = TRUE;
+    for (int i = 0; i < files_count && ok; ++i) {
+        if (g_str_has_suffix(files[i], ".shogi")) {
+            char *data;
+            gsize length;
+            ShogiModelSave *save = NULL;
+            if (g_file_get_contents(files[i], &data, &length, NULL)) {
+                save = shogi_model_save_parse(data, length);
+                g_free(data);
+            }
+            if (save == NULL) {
+                fprintf(stderr, "Saved game %s is corrupted, skipped\n", files[i]);
+                skipped++;
+                continue;
+            }
+            queue_game(writer, &chunk, threads, &skipped, &ok)->save = save;
+            continue;
+        }
+
+        FILE *file = fopen(files[i], "r");
+        if (file == NULL) {
+            fprintf(stderr, "Cannot open %s\n", files[i]);
+            ok = FALSE;
+            break;
+        }
+        char *line = NULL;
+        size_t capacity = 0;
+        while (ok && getline(&line, &capacity, file) != -1) {
+            if (line[0] == '\n' || line[0] == '#')
+                continue;
+            queue_game(writer, &chunk, threads, &skipped, &ok)->record = g_strdup(line);
+        }
+        free(line);
+        fclose(file);
+    }
+    skipped += pack_chunk(writer, &chunk, threads, &ok);
+    g_free(chunk.games);
+    g_free(files);
+
+    guint32 games = writer->games->len;
+    guint64 moves = 0, size = 0;
+    for (guint i = 0; i < writer->blocks->len; ++i)
+        moves += g_array_index(writer->blocks, ShogiArchiveBlock, i).moves;
+    moves += writer->moves->len;
+    ok = shogi_archive_writer_finish(writer, &size) && ok;
+    if (!ok) {
+        fprintf(stderr, "Cannot write archive %s\n", argv[0]);
+        return 1;
+    }
+    printf("games %u (%d skipped)  moves %lu  size %lu B (%.2f B/move)  time %.2f s\n", games, skipped,
+           (unsigned long) moves, (unsigned long) size, moves ? (double) size / moves : 0.0,
+           (g_get_monotonic_time() - start) / 1e6);
+    return 0;
+}
+
+/// scans the game table, moves are never inflated
+static int run_list(const char *path, int argc, char **argv) {
+    const char *player = NULL;
+    int result = -1, min_length = 0;
+    guint32 from = 0, to = G_MAXUINT32;
+    gboolean count_only = FALSE;
+    for (int i = 0; i < argc; ++i) {
+        if (strcmp(argv[i], "--player") == 0 && i + 1 < argc) player = argv[++i];
+        else if (strcmp(argv[i], "--result") == 0 && i + 1 < argc) result = parse_result(argv[++i]);
+        else if (strcmp(argv[i], "--from") == 0 && i + 1 < argc) from = parse_date(argv[++i]);
+        else if (strcmp(argv[i], "--to") == 0 && i + 1 < argc) to = parse_date(argv[++i]);
+        else if (strcmp(argv[i], "--min-length") == 0 && i + 1 < argc) min_length = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--count") == 0) count_only = TRUE;
+    }
+    ShogiArchive *archive = shogi_archive_open(path);
+    if (archive == NULL) {
+        fprintf(stderr, "Cannot open archive %s\n", path);
+        return 1;
+    }
+
+    gint64 start = g_get_monotonic_time();
+    guint32 total = shogi_archive_game_count(archive), matched = 0;
+    for (guint32 i = 0; i < total; ++i) {
+        const ShogiArchiveGame *game = shogi_archive_game(archive, i);
+        if ((player && strcmp(game->black, player) != 0 && strcmp(game->white, player) != 0) ||
+            (result >= 0 && game->result != result) || game->length < min_length ||
+            (game->date && (game->date < from || game->date > to)))
+            continue;
+        matched++;
+        if (!count_only)
+            printf("%8u  %08u  %-20s %-20s %-7s %3u moves\n", i, game->date, game->black[0] ? game->black : "-",
+                   game->white[0] ? game->white : "-", result_name(game->result), game->length);
+    }
+    printf("%u of %u games matched, scan %.1f ms\n", matched, total, (g_get_monotonic_time() - start) / 1000.0);
+    shogi_archive_close(archive);
+    return 0;
+}
+
+static int run_show(const char *path, const char *number) {
+    ShogiArchive *archive = shogi_archive_open(path);
+    if (archive == NULL) {
+        fprintf(stderr, "Cannot open archive %s\n", path);
+        return 1;
+    }
+    guint32 game = (guint32) strtoul(number, NULL, 10);
+    if (game >= shogi_archive_game_count(archive)) {
+        fprintf(stderr, "Archive has %u games\n", shogi_archive_game_count(archive));
+        shogi_archive_close(archive);
+        return 1;
+    }
+
+    ShogiArchiveReader *reader = shogi_archive_reader_new(archive);
+    ShogiMove moves[SHOGI_ARCHIVE_MAX_MOVES];
+    ShogiPosition pos;
+    int count = shogi_archive_read_game(reader, game, moves, &pos);
+    const ShogiArchiveGame *info = shogi_archive_game(archive, game);
+    int status = 0;
+    if (count < 0) {
+        fprintf(stderr, "Game %u is corrupted\n", game);
+        status = 1;
+    } else {
+        printf("%s\t%s\t%08u\t%s", info->black, info->white, info->date, result_name(info->result));
+        for (int i = 0; i < count; ++i) {
+            char move[SHOGI_MODEL_MOVE_LENGTH];
+            shogi_position_move_notation(moves[i], move);
+            printf(" %s", move);
+        }
+        char *sfen = shogi_position_to_sfen(&pos);
+        printf("\n%s\n", sfen);
+        g_free(sfen);
+    }
+    shogi_archive_reader_free(reader);
+    shogi_archive_close(archive);
+    return status;
+}
+
+static gpointer bench_worker(gpointer data) {
+    ShogiArchiveBench *bench = data;
+    ShogiArchiveReader *reader = shogi_archive_reader_new(bench->archive);
+    guint32 games = shogi_archive_game_count(bench->archive);
+    gint64 moves = 0, read = 0;
+    guint32 block;
+    while ((block = (guint32) g_atomic_int_add(&bench->next_block, 1)) < bench->archive->header->block_count) {
+        guint32 last = MIN((block + 1) * SHOGI_ARCHIVE_BLOCK_GAMES, games);
+        for (guint32 game = block * SHOGI_ARCHIVE_BLOCK_GAMES; game < last; ++game) {
+            int count = shogi_archive_read_game(reader, game, NULL, NULL);
+            if (count < 0) {
+                g_atomic_int_inc(&bench->corrupted);
+                continue;
+            }
+            moves += count;
+            read++;
+        }
+    }
+    shogi_archive_reader_free(reader);
+    g_mutex_lock(&bench->lock);
+    bench->moves += moves;
+    bench->games += read;
+    g_mutex_unlock(&bench->lock);
+    return NULL;
+}
+
+/// inflates and replays every game of the archive on all threads
+static int run_bench(const char *path, int threads) {
+    ShogiArchive *archive = shogi_archive_open(path);
+    if (archive == NULL) {
+        fprintf(stderr, "Cannot open archive %s\n", path);
+        return 1;
+    }
+    ShogiArchiveBench bench;
+    memset(&bench, 0, sizeof(bench));
+    bench.archive = archive;
+    g_mutex_init(&bench.lock);
+    GThread **workers = g_new(GThread *, threads);
+    gint64 start = g_get_monotonic_time();
+    for (int i = 0; i < threads; ++i)
+        workers[i] = g_thread_new("archive-bench", bench_worker, &bench);
+    for (int i = 0; i < threads; ++i)
+        g_thread_join(workers[i]);
+    double seconds = (g_get_monotonic_time() - start) / 1e6;
+    g_free(workers);
+    g_mutex_clear(&bench.lock);
+
+    printf("games %ld  moves %ld  time %.3f s  %.2f M moves/s  %.0f games/s on %d threads", (long) bench.games,
+           (long) bench.moves, seconds, seconds > 0 ? bench.moves / seconds / 1e6 : 0.0,
+           seconds > 0 ? bench.games / seconds : 0.0, threads);
+    if (bench.corrupted)
+        printf(", %d corrupted", bench.corrupted);
+    printf("\n");
+    shogi_archive_close(archive);
+    return bench.corrupted ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        print_usage();
+        return 1;
+    }
+    shogi_trace_start_from_env();
+    shogi_counters_dump_start_from_env();
+
+    int status;
+    if (strcmp(argv[1], "pack") == 0 && argc >= 4) {
+        status = run_pack(argc - 2, argv + 2);
+    } else if (strcmp(argv[1], "list") == 0) {
+        status = run_list(argv[2], argc - 3, argv + 3);
+    } else if (strcmp(argv[1], "show") == 0 && argc >= 4) {
+        status = run_show(argv[2], argv[3]);
+    } else if (strcmp(argv[1], "bench") == 0) {
+        int threads = (int) g_get_num_processors();
+        for (int i = 3; i < argc; ++i)
+            if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = MAX(atoi(argv[++i]), 1);
+        status = run_bench(argv[2], threads);
+    } else {
+        print_usage();
+        status = 1;
+    }
+
+    shogi_trace_stop();
+    shogi_counters_dump_stop();
+    shogi_logger_close();
+    return status;
+}
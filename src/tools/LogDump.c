@@ -0,0 +1,227 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+// Decoder of binary event log written by the app.
+// usage: shogi-logdump [--type name] [--game id] [--stats] <Shogi.events...>
+//   --type   prints only events of given type (start, move, hitmap, end, save, load, timer, timeout)
+//   --game   prints only events of given game
+//   --stats  prints aggregates instead of events
+
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#include "../Logger.h"
+#include "../Model.h"
+
+#define SHOGI_LOGDUMP_BATCH 4096 // events read at once
+
+static const char *event_names[SHOGI_LOGGER_EVENT_COUNT] = {
+        "start", "move", "hitmap", "end", "save", "load", "timer", "timeout"
+};
+
+typedef struct _shogi_logdump_filter {
+    int type; // -1 for all types
+    gboolean by_game;
+    guint64 game;
+    gboolean stats;
+} ShogiLogDumpFilter;
+
+typedef struct _shogi_logdump_game {
+    guint64 id; // first, so the game is hashed by it's id
+    guint64 moves;
+} ShogiLogDumpGame;
+
+typedef struct _shogi_logdump_stats {
+    guint64 events[SHOGI_LOGGER_EVENT_COUNT];
+    guint64 wins[2]; // [0] white, [1] black
+    guint64 endings[3]; // by SHOGI_LOGGER_GAME_END
+    guint64 finished_moves; // moves of games which ended
+    guint64 hitmap_time; // ns
+    guint32 hitmap_max;
+    guint64 move_intervals; // sum of time between consecutive moves of the same game, ns
+    guint64 move_interval_count;
+    guint64 max_ply;
+    guint64 first_time, last_time;
+    guint64 last_game; // for move intervals, events of one game are consecutive in the log
+    guint64 last_move_time;
+    GHashTable *games; // set of ShogiLogDumpGame
+} ShogiLogDumpStats;
+
+static void print_usage() {
+    printf("usage: shogi-logdump [--type name] [--game id] [--stats] <Shogi.events...>\n"
+           "  types: start, move, hitmap, end, save, load, timer, timeout\n");
+}
+
+static void print_event(const ShogiLoggerEvent *event) {
+    printf("%llu.%09llu  game %19" G_GUINT64_FORMAT "  ply %3u  %-7s ",
+           (unsigned long long) (event->time / 1000000000u), (unsigned long long) (event->time % 1000000000u),
+           event->game, event->ply, event_names[event->type]);
+    const gint32 *value = event->data.value;
+    switch (event->type) {
+        case SHOGI_LOGGER_EVENT_MOVE:
+            printf(" %.8s", event->data.text);
+            break;
+        case SHOGI_LOGGER_EVENT_HITMAP:
+            if (value[0] < 0) printf(" drop");
+            else printf(" %02d", value[0]);
+            printf("  %.1f us", value[1] / 1000.0);
+            break;
+        case SHOGI_LOGGER_EVENT_GAME_END:
+            printf(" %s wins by %s", value[0] == BLACK_WIN ? "black" : "white",
+                   value[1] == SHOGI_LOGGER_GAME_END_KING_CAPTURED ? "king capture" :
+                   value[1] == SHOGI_LOGGER_GAME_END_TIMEOUT ? "timeout" : "resignation");
+            break;
+        case SHOGI_LOGGER_EVENT_SAVE:
+        case SHOGI_LOGGER_EVENT_LOAD:
+            printf(" %s, %d moves", value[0] ? "ok" : "failed", value[1]);
+            break;
+        case SHOGI_LOGGER_EVENT_TIMER_SET:
+            printf(" %d ms", value[0]);
+            break;
+        case SHOGI_LOGGER_EVENT_TIMER_EXPIRED:
+            printf(" %s", value[0] ? "black" : "white");
+            break;
+        default:
+            break;
+    }
+    printf("\n");
+}
+
+static void add_event(ShogiLogDumpStats *stats, const ShogiLoggerEvent *event) {
+    stats->events[event->type]++;
+    if (stats->first_time == 0 || event->time < stats->first_time) stats->first_time = event->time;
+    stats->last_time = MAX(stats->last_time, event->time);
+    ShogiLogDumpGame *game = g_hash_table_lookup(stats->games, &event->game);
+    if (game == NULL) {
+        game = g_new0(ShogiLogDumpGame, 1);
+        game->id = event->game;
+        g_hash_table_add(stats->games, game);
+    }
+    stats->max_ply = MAX(stats->max_ply, event->ply);
+
+    switch (event->type) {
+        case SHOGI_LOGGER_EVENT_MOVE:
+            game->moves++;
+            if (event->game == stats->last_game && stats->last_move_time && event->time > stats->last_move_time) {
+                stats->move_intervals += event->time - stats->last_move_time;
+                stats->move_interval_count++;
+            }
+            stats->last_game = event->game;
+            stats->last_move_time = event->time;
+            break;
+        case SHOGI_LOGGER_EVENT_HITMAP:
+            stats->hitmap_time += (guint32) event->data.value[1];
+            stats->hitmap_max = MAX(stats->hitmap_max, (guint32) event->data.value[1]);
+            break;
+        case SHOGI_LOGGER_EVENT_GAME_END:
+            stats->wins[event->data.value[0] == BLACK_WIN ? 1 : 0]++;
+            stats->finished_moves += game->moves; // unfinished games would lower the average
+            if (event->data.value[1] >= 0 && event->data.value[1] < 3)
+                stats->endings[event->data.value[1]]++;
+            break;
+        default:
+            break;
+    }
+}
+
+static void print_stats(const ShogiLogDumpStats *stats) {
+    guint64 total = 0;
+    for (int i = 0; i < SHOGI_LOGGER_EVENT_COUNT; ++i)
+        total += stats->events[i];
+    printf("events %lu  games %u  span %.1f h\n", (unsigned long) total, g_hash_table_size(stats->games),
+           total ? (stats->last_time - stats->first_time) / 3.6e12 : 0.0);
+    for (int i = 0; i < SHOGI_LOGGER_EVENT_COUNT; ++i)
+        printf("  %-8s %lu\n", event_names[i], (unsigned long) stats->events[i]);
+
+    guint64 ended = stats->wins[0] + stats->wins[1];
+    printf("results: black %lu  white %lu  (king capture %lu, timeout %lu, resignation %lu)\n",
+           (unsigned long) stats->wins[1], (unsigned long) stats->wins[0], (unsigned long) stats->endings[0],
+           (unsigned long) stats->endings[1], (unsigned long) stats->endings[2]);
+    if (ended)
+        printf("moves per finished game %.1f\n", (double) stats->finished_moves / ended);
+    if (stats->move_interval_count)
+        printf("time per move %.2f s\n", stats->move_intervals / 1e9 / stats->move_interval_count);
+    if (stats->events[SHOGI_LOGGER_EVENT_HITMAP])
+        printf("hitmap: average %.1f us  max %.1f us\n",
+               stats->hitmap_time / 1000.0 / stats->events[SHOGI_LOGGER_EVENT_HITMAP], stats->hitmap_max / 1000.0);
+}
+
+/// reads events of file in batches and prints or aggregates the ones passing filter
+static gboolean dump_file(const char *path, const ShogiLogDumpFilter *filter, ShogiLogDumpStats *stats) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return FALSE;
+    }
+    ShogiLoggerEventsHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, SHOGI_LOGGER_EVENTS_MAGIC, sizeof(header.magic)) != 0 ||
+        header.event_size != sizeof(ShogiLoggerEvent)) {
+        fprintf(stderr, "%s is not an event log of this version\n", path);
+        fclose(file);
+        return FALSE;
+    }
+
+    ShogiLoggerEvent *events = g_new(ShogiLoggerEvent, SHOGI_LOGDUMP_BATCH);
+    size_t count;
+    while ((count = fread(events, sizeof(ShogiLoggerEvent), SHOGI_LOGDUMP_BATCH, file)) > 0) {
+        for (size_t i = 0; i < count; ++i) {
+            const ShogiLoggerEvent *event = &events[i];
+            if (event->type >= SHOGI_LOGGER_EVENT_COUNT ||
+                (filter->type >= 0 && event->type != filter->type) ||
+                (filter->by_game && event->game != filter->game))
+                continue;
+            if (filter->stats) add_event(stats, event);
+            else print_event(event);
+        }
+    }
+    g_free(events);
+    fclose(file);
+    return TRUE;
+}
+
+int main(int argc, char **argv) {
+    ShogiLogDumpFilter filter = {.type = -1};
+    ShogiLogDumpStats stats = {0};
+    const char **files = g_new(const char *, argc);
+    int files_count = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--stats") == 0) {
+            filter.stats = TRUE;
+        } else if (strcmp(argv[i], "--game") == 0 && i + 1 < argc) {
+            filter.by_game = TRUE;
+            filter.game = g_ascii_strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--type") == 0 && i + 1 < argc) {
+            const char *name = argv[++i];
+            for (int type = 0; type < SHOGI_LOGGER_EVENT_COUNT; ++type)
+                if (strcmp(name, event_names[type]) == 0)
+                    filter.type = type;
+            if (filter.type < 0) {
+                fprintf(stderr, "Unknown event type %s\n", name);
+                g_free(files);
+                return 1;
+            }
+        } else {
+            files[files_count++] = argv[i];
+        }
+    }
+    if (files_count == 0) {
+        print_usage();
+        g_free(files);
+        return 1;
+    }
+
+    stats.games = g_hash_table_new_full(g_int64_hash, g_int64_equal, g_free, NULL);
+    int status = 0;
+    for (int i = 0; i < files_count; ++i)
+        if (!dump_file(files[i], &filter, &stats))
+            status = 1;
+    if (filter.stats)
+        print_stats(&stats);
+
+    g_hash_table_destroy(stats.games);
+    g_free(files);
+    return status;
+}
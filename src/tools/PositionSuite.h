@@ -0,0 +1,28 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#ifndef SHOGI_POSITIONSUITE_H
+#define SHOGI_POSITIONSUITE_H
+
+// Fixed set of positions used to measure the engine. Changing it invalidates earlier measurements.
+static const char *shogi_position_suite[] = {
+        // initial position
+        "lnsgkgsnl/1r5b1/ppppppppp/9/9/9/PPPPPPPPP/1B5R1/LNSGKGSNL b - 1",
+        // opening after P76 P34
+        "lnsgkgsnl/1r5b1/pppppp1pp/6p2/9/2P6/PP1PPPPPP/1B5R1/LNSGKGSNL b - 3",
+        // bishops exchanged
+        "lnsgkg1nl/1r5s1/pppppp1pp/6p2/9/2P6/PP1PPPPPP/7R1/LNSGKGSNL b Bb 1",
+        // middle game with many drops available
+        "l6nl/5+P1gk/2np1S3/p1p4Pp/3P2Sp1/1PPb2P1P/P5GS1/R8/LN4bKL w RGgsn5p 1",
+        // middle game
+        "lnsgkgsnl/1r7/p1ppp1bpp/1p3pp2/7P1/2P6/PP1PPPP1P/1B3S1R1/LNSGKG1NL b - 9",
+        // attack on the king
+        "ln1g3nl/1r3kg2/p2pppsp1/2ps2p1p/1p7/2P1P1P1P/PPSP1P3/2G1K2R1/LN3G1NL b BSbp 1",
+        // end game
+        "8l/1l+R2P3/p2pBG1pp/kps1p4/Nn1P2G2/P1P1P2PP/1PS6/1KSG3+r1/LN2+p3L w Sbgn3p 1",
+};
+
+#define SHOGI_POSITION_SUITE_SIZE ((int) (sizeof(shogi_position_suite) / sizeof(shogi_position_suite[0])))
+
+#endif //SHOGI_POSITIONSUITE_H
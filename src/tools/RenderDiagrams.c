@@ -0,0 +1,164 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+// Headless renderer of board diagrams, draws positions to PNG files on all cores without a display server.
+// usage: shogi-render [--scale s] [--threads N] [--out dir] [--no-hands] <positions file or ->
+// Each line of positions file describes one diagram, fields are separated by tabs:
+//   name <TAB> position [<TAB> last move [<TAB> hints]]
+//   name       output file is <dir>/<name>.png
+//   position   SFEN, or state serialized by the app (black to move)
+//   last move  move in history notation, for example P77-76, or - for none
+//   hints      comma separated squares to highlight as available moves, square followed by ! is selected,
+//              for example 77!,76,75
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include "../ResourceManager.h"
+#include "../Diagram.h"
+#include "../Logger.h"
+
+#define SHOGI_RENDER_DEFAULT_SCALE 0.5
+
+typedef struct _shogi_render_job {
+    char *path; // output file
+    ShogiDiagram diagram;
+} ShogiRenderJob;
+
+typedef struct _shogi_render_batch {
+    gint rendered;
+    gint failed;
+} ShogiRenderBatch;
+
+static void print_usage() {
+    printf("usage: shogi-render [--scale s] [--threads N] [--out dir] [--no-hands] <positions file or ->\n"
+           "  line of positions file: name<TAB>position[<TAB>last move[<TAB>hints]]\n"
+           "  position is SFEN or serialized state, hints are squares like 77!,76,75 (! marks selected)\n");
+}
+
+static void render_job(gpointer data, gpointer user_data) {
+    ShogiRenderJob *job = data;
+    ShogiRenderBatch *batch = user_data;
+    cairo_surface_t *surface = shogi_diagram_render(&job->diagram);
+    if (cairo_surface_status(surface) == CAIRO_STATUS_SUCCESS &&
+        cairo_surface_write_to_png(surface, job->path) == CAIRO_STATUS_SUCCESS) {
+        g_atomic_int_inc(&batch->rendered);
+    } else {
+        fprintf(stderr, "Cannot render %s\n", job->path);
+        g_atomic_int_inc(&batch->failed);
+    }
+    cairo_surface_destroy(surface);
+    g_free(job->path);
+    g_free(job);
+}
+
+/// marks hint squares of the diagram, returns false if list is malformed
+static gboolean parse_hints(ShogiDiagram *diagram, const char *hints) {
+    char **squares = g_strsplit(hints, ",", -1);
+    gboolean valid = TRUE;
+    for (char **square = squares; *square && valid; ++square) {
+        const char *it = *square;
+        if (it[0] < '1' || it[0] > '9' || it[1] < '1' || it[1] > '9' || (it[2] != '\0' && strcmp(it + 2, "!") != 0)) {
+            valid = FALSE;
+            break;
+        }
+        IDX(diagram->hints, it[0] - '0', it[1] - '0') = it[2] == '!' ? 'x' : 'o';
+    }
+    g_strfreev(squares);
+    return valid;
+}
+
+/// sets up diagram from tab separated fields of positions file, returns false if they're malformed
+static gboolean parse_diagram(ShogiDiagram *diagram, char **fields, guint count) {
+    ShogiPosition position;
+    gboolean parsed = strlen(fields[1]) == SHOGI_MODEL_SERIALIZED_STATE_LENGTH - 1 ?
+                      shogi_position_from_state(&position, fields[1], TRUE) :
+                      shogi_position_from_sfen(&position, fields[1]);
+    if (!parsed)
+        return FALSE;
+    shogi_diagram_init(diagram, &position);
+    if (count >= 3 && strcmp(fields[2], "-") != 0 && !shogi_diagram_set_last_move(diagram, fields[2]))
+        return FALSE;
+    return count < 4 || parse_hints(diagram, fields[3]);
+}
+
+/// creates job from line of positions file, NULL if the line is malformed
+static ShogiRenderJob *parse_line(char *line, const char *out_dir, gboolean hands) {
+    char **fields = g_strsplit(g_strchomp(line), "\t", 4);
+    guint count = g_strv_length(fields);
+    ShogiRenderJob *job = g_new(ShogiRenderJob, 1);
+
+    if (count < 2 || fields[0][0] == '\0' || strchr(fields[0], '/') || !parse_diagram(&job->diagram, fields, count)) {
+        g_free(job);
+        g_strfreev(fields);
+        return NULL;
+    }
+    job->diagram.hands = hands;
+    char *name = g_strconcat(fields[0], ".png", NULL);
+    job->path = g_build_filename(out_dir, name, NULL);
+    g_free(name);
+    g_strfreev(fields);
+    return job;
+}
+
+int main(int argc, char **argv) {
+    double scale = SHOGI_RENDER_DEFAULT_SCALE;
+    int threads = (int) g_get_num_processors();
+    const char *out_dir = ".";
+    const char *input = NULL;
+    gboolean hands = TRUE;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) scale = g_ascii_strtod(argv[++i], NULL);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) out_dir = argv[++i];
+        else if (strcmp(argv[i], "--no-hands") == 0) hands = FALSE;
+        else input = argv[i];
+    }
+    if (input == NULL || scale <= 0 || threads < 1) {
+        print_usage();
+        return 1;
+    }
+
+    FILE *file = strcmp(input, "-") == 0 ? stdin : fopen(input, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Cannot open %s\n", input);
+        return 1;
+    }
+    if (shogi_resource_manager_init() != 0 || shogi_resource_manager_scale(scale, 1) != 0) {
+        fprintf(stderr, "Cannot load textures\n");
+        return 1;
+    }
+
+    gint64 start = g_get_monotonic_time();
+    ShogiRenderBatch batch = {0, 0};
+    GThreadPool *pool = g_thread_pool_new(render_job, &batch, threads, TRUE, NULL);
+    char line[1024];
+    int line_number = 0, skipped = 0;
+    while (fgets(line, sizeof(line), file)) {
+        line_number++;
+        if (line[0] == '\n' || line[0] == '#')
+            continue;
+        ShogiRenderJob *job = parse_line(line, out_dir, hands);
+        if (job == NULL) {
+            fprintf(stderr, "Line %d is malformed, skipped\n", line_number);
+            skipped++;
+            continue;
+        }
+        g_thread_pool_push(pool, job, NULL);
+    }
+    if (file != stdin)
+        fclose(file);
+    g_thread_pool_free(pool, FALSE, TRUE); // waits for queued diagrams
+
+    double seconds = (g_get_monotonic_time() - start) / 1e6;
+    printf("rendered %d diagrams in %.2f s (%.0f/s) on %d threads", batch.rendered, seconds,
+           seconds > 0 ? batch.rendered / seconds : 0.0, threads);
+    if (batch.failed || skipped)
+        printf(", %d failed, %d skipped", batch.failed, skipped);
+    printf("\n");
+    shogi_logger_close();
+    return batch.failed || skipped ? 1 : 0;
+}
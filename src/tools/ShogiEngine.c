@@ -0,0 +1,271 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+// Command line front end of the engine.
+// usage: shogi-engine suite [depth] [--no-tt] [--no-see] [--no-killers] [--no-counter] [--no-history]
+//                          [--no-qsearch] [--no-null] [--no-lmr] [--no-futility] [--no-check-ext]
+//        shogi-engine tsume <sfen> [--threads N] [--hash MB] [--time ms] [--nodes N]
+//        shogi-engine think <sfen> [--time ms] [--byoyomi ms] [--inc ms] [--movestogo N]
+//        shogi-engine book build <book> <games...> [--threads N] [--plies N] [--min N]
+//        shogi-engine book probe <book> [sfen]
+
+#include <stdio.h>
+#include <string.h>
+#include "../Position.h"
+#include "../Search.h"
+#include "../Tsume.h"
+#include "../Book.h"
+#include "../Logger.h"
+#include "../Trace.h"
+#include "../Counters.h"
+#include "PositionSuite.h"
+
+static void print_usage() {
+    printf("usage: shogi-engine suite [depth] [--no-tt] [--no-see] [--no-killers] [--no-counter] [--no-history]\n"
+           "                          [--no-qsearch] [--no-null] [--no-lmr] [--no-futility] [--no-check-ext]\n"
+           "       shogi-engine tsume <sfen> [--threads N] [--hash MB] [--time ms] [--nodes N]\n"
+           "       shogi-engine think <sfen> [--time ms] [--byoyomi ms] [--inc ms] [--movestogo N]\n"
+           "       shogi-engine book build <book> <games...> [--threads N] [--plies N] [--min N]\n"
+           "       shogi-engine book probe <book> [sfen]\n");
+}
+
+static void suite_report(const ShogiSearch *search, int depth, int score, gpointer data) {
+    gint64 start = *(gint64 *) data;
+    const ShogiSearchStats *stats = &search->stats;
+    char move[SHOGI_MODEL_MOVE_LENGTH] = "-";
+    if (search->pv_length[0] > 0)
+        shogi_position_move_notation(search->pv[0][0], move);
+
+    printf("  depth %2d  score %6d  nodes %10lu  cutoffs %9lu  first %5.1f%%  %8.1f ms  %s\n",
+           depth, score, (unsigned long) stats->nodes, (unsigned long) stats->beta_cutoffs,
+           stats->beta_cutoffs ? 100.0 * stats->first_move_cutoffs / stats->beta_cutoffs : 0.0,
+           (g_get_monotonic_time() - start) / 1000.0, move);
+}
+
+/// searches every position of the suite to given depth, prints nodes to depth and cutoff rate
+static int run_suite(int depth, guint flags, guint search_flags) {
+    ShogiSearch *search = shogi_search_new(64);
+    if (search == NULL) return 1;
+    search->heuristics.flags = flags;
+    search->flags = search_flags;
+    search->report = suite_report;
+
+    guint64 total_nodes = 0, total_quiescence = 0, total_cutoffs = 0, total_first = 0;
+    gint64 suite_start = g_get_monotonic_time();
+
+    for (int i = 0; i < SHOGI_POSITION_SUITE_SIZE; ++i) {
+        ShogiPosition pos;
+        if (!shogi_position_from_sfen(&pos, shogi_position_suite[i])) {
+            fprintf(stderr, "Malformed suite position %d: %s\n", i, shogi_position_suite[i]);
+            shogi_search_free(search);
+            return 1;
+        }
+        printf("position %d: %s\n", i + 1, shogi_position_suite[i]);
+
+        gint64 start = g_get_monotonic_time();
+        search->report_data = &start;
+        shogi_search_clear(search);
+        shogi_search_run(search, &pos, depth, NULL);
+
+        total_nodes += search->stats.nodes;
+        total_quiescence += search->stats.quiescence_nodes;
+        total_cutoffs += search->stats.beta_cutoffs;
+        total_first += search->stats.first_move_cutoffs;
+    }
+
+    double seconds = (g_get_monotonic_time() - suite_start) / 1e6;
+    printf("total: nodes %lu  quiescence %lu  first move cutoffs %.1f%%  time %.2f s  %.0f nps\n",
+           (unsigned long) total_nodes, (unsigned long) total_quiescence,
+           total_cutoffs ? 100.0 * total_first / total_cutoffs : 0.0,
+           seconds, seconds > 0 ? total_nodes / seconds : 0.0);
+
+    shogi_search_free(search);
+    return 0;
+}
+
+/// searches position under time control like in a game, prints how the budget was used
+static int run_think(const char *sfen, const ShogiTimeControl *control) {
+    ShogiPosition pos;
+    if (!shogi_position_from_sfen(&pos, sfen)) {
+        fprintf(stderr, "Malformed position: %s\n", sfen);
+        return 1;
+    }
+    ShogiSearch *search = shogi_search_new(64);
+    if (search == NULL) return 1;
+
+    ShogiTimeManager time;
+    shogi_time_manager_init(&time, control, pos.ply);
+    printf("budget: soft %ld ms  hard %ld ms\n", (long) time.soft, (long) time.hard);
+
+    search->time = &time;
+    search->report = suite_report;
+    search->report_data = &time.start;
+    ShogiMove best;
+    int score = shogi_search_run(search, &pos, SHOGI_SEARCH_MAX_PLY, &best);
+
+    double elapsed = (g_get_monotonic_time() - time.start) / 1000.0;
+    char move[SHOGI_MODEL_MOVE_LENGTH] = "-";
+    if (best != SHOGI_MOVE_NONE)
+        shogi_position_move_notation(best, move);
+    printf("best %s  score %d  time %.1f ms  %s\n", move, score, elapsed,
+           g_atomic_int_get(&search->stop) ? "stopped at hard limit" : "iterations stopped by budget");
+
+    shogi_search_free(search);
+    return 0;
+}
+
+/// solves mate problem and prints the mate sequence
+static int run_tsume(const char *sfen, const ShogiTsumeOptions *options) {
+    ShogiPosition pos;
+    if (!shogi_position_from_sfen(&pos, sfen)) {
+        fprintf(stderr, "Malformed position: %s\n", sfen);
+        return 1;
+    }
+
+    ShogiTsumeSolution *solution = g_new(ShogiTsumeSolution, 1);
+    gint64 start = g_get_monotonic_time();
+    shogi_tsume_solve(&pos, options, solution);
+    double seconds = (g_get_monotonic_time() - start) / 1e6;
+
+    switch (solution->result) {
+        case SHOGI_TSUME_PROVEN:
+            printf("mate in %d plies:", solution->length);
+            for (int i = 0; i < solution->length; ++i) {
+                char move[SHOGI_MODEL_MOVE_LENGTH];
+                shogi_position_move_notation(solution->moves[i], move);
+                printf(" %s", move);
+            }
+            printf("\n");
+            break;
+        case SHOGI_TSUME_DISPROVEN:
+            printf("no mate\n");
+            break;
+        default:
+            printf("unknown, search stopped\n");
+            break;
+    }
+    printf("nodes %lu  time %.2f s  %.0f nps\n", (unsigned long) solution->nodes, seconds,
+           seconds > 0 ? solution->nodes / seconds : 0.0);
+
+    int status = solution->result == SHOGI_TSUME_UNKNOWN ? 2 : 0;
+    g_free(solution);
+    return status;
+}
+
+/// builds book from game records given after the output path, options may be mixed with files
+static int run_book_build(int argc, char **argv) {
+    ShogiBookBuildOptions options;
+    shogi_book_build_options_default(&options);
+    const char **files = g_new(const char *, argc);
+    int files_count = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) options.threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--plies") == 0 && i + 1 < argc) options.max_ply = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--min") == 0 && i + 1 < argc) options.min_count = (guint32) atoi(argv[++i]);
+        else files[files_count++] = argv[i];
+    }
+
+    ShogiBookBuildStats stats;
+    gint64 start = g_get_monotonic_time();
+    gboolean ok = shogi_book_build(files, files_count, argv[0], &options, &stats);
+    g_free(files);
+    if (!ok) {
+        fprintf(stderr, "Cannot build book %s\n", argv[0]);
+        return 1;
+    }
+    printf("games %lu (%lu with unknown moves)  positions %lu  entries %lu  time %.2f s\n",
+           (unsigned long) stats.games, (unsigned long) stats.bad_games, (unsigned long) stats.positions,
+           (unsigned long) stats.entries, (g_get_monotonic_time() - start) / 1e6);
+    return 0;
+}
+
+/// prints book moves of the position
+static int run_book_probe(const char *path, const char *sfen) {
+    ShogiBook *book = shogi_book_open(path);
+    if (book == NULL) {
+        fprintf(stderr, "Cannot open book %s\n", path);
+        return 1;
+    }
+    ShogiPosition pos;
+    shogi_position_init(&pos);
+    if (sfen && !shogi_position_from_sfen(&pos, sfen)) {
+        fprintf(stderr, "Malformed position: %s\n", sfen);
+        shogi_book_close(book);
+        return 1;
+    }
+
+    const ShogiBookEntry *entries;
+    gint64 start = g_get_monotonic_time();
+    int count = shogi_book_probe(book, pos.key, &entries);
+    gint64 elapsed = g_get_monotonic_time() - start;
+    for (int i = 0; i < count; ++i) {
+        char move[SHOGI_MODEL_MOVE_LENGTH];
+        shogi_position_move_notation(entries[i].move, move);
+        printf("%-8s count %6u  won %6u  lost %6u\n", move, entries[i].count, entries[i].wins, entries[i].losses);
+    }
+    printf("%d moves, probe %ld us\n", count, (long) elapsed);
+    shogi_book_close(book);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        print_usage();
+        return 1;
+    }
+
+    shogi_trace_start_from_env();
+    shogi_counters_dump_start_from_env();
+    int status;
+    if (strcmp(argv[1], "suite") == 0) {
+        int depth = 5;
+        guint flags = SHOGI_MOVE_ORDER_ALL;
+        guint search_flags = SHOGI_SEARCH_ALL;
+        for (int i = 2; i < argc; ++i) {
+            if (strcmp(argv[i], "--no-tt") == 0) flags &= ~SHOGI_MOVE_ORDER_TT;
+            else if (strcmp(argv[i], "--no-see") == 0) flags &= ~SHOGI_MOVE_ORDER_SEE;
+            else if (strcmp(argv[i], "--no-killers") == 0) flags &= ~SHOGI_MOVE_ORDER_KILLERS;
+            else if (strcmp(argv[i], "--no-counter") == 0) flags &= ~SHOGI_MOVE_ORDER_COUNTER_MOVES;
+            else if (strcmp(argv[i], "--no-history") == 0) flags &= ~SHOGI_MOVE_ORDER_HISTORY;
+            else if (strcmp(argv[i], "--no-qsearch") == 0) search_flags &= ~SHOGI_SEARCH_QUIESCENCE;
+            else if (strcmp(argv[i], "--no-null") == 0) search_flags &= ~SHOGI_SEARCH_NULL_MOVE;
+            else if (strcmp(argv[i], "--no-lmr") == 0) search_flags &= ~SHOGI_SEARCH_LMR;
+            else if (strcmp(argv[i], "--no-futility") == 0) search_flags &= ~SHOGI_SEARCH_FUTILITY;
+            else if (strcmp(argv[i], "--no-check-ext") == 0) search_flags &= ~SHOGI_SEARCH_CHECK_EXTENSIONS;
+            else depth = atoi(argv[i]);
+        }
+        status = run_suite(depth, flags, search_flags);
+    } else if (strcmp(argv[1], "tsume") == 0 && argc >= 3) {
+        ShogiTsumeOptions options;
+        shogi_tsume_options_default(&options);
+        for (int i = 3; i + 1 < argc; i += 2) {
+            if (strcmp(argv[i], "--threads") == 0) options.threads = atoi(argv[i + 1]);
+            else if (strcmp(argv[i], "--hash") == 0) options.hash_megabytes = (gsize) atol(argv[i + 1]);
+            else if (strcmp(argv[i], "--time") == 0) options.max_time = atol(argv[i + 1]);
+            else if (strcmp(argv[i], "--nodes") == 0) options.max_nodes = (guint64) atoll(argv[i + 1]);
+        }
+        status = run_tsume(argv[2], &options);
+    } else if (strcmp(argv[1], "think") == 0 && argc >= 3) {
+        ShogiTimeControl control = {.remaining = 60000};
+        for (int i = 3; i + 1 < argc; i += 2) {
+            if (strcmp(argv[i], "--time") == 0) control.remaining = atol(argv[i + 1]);
+            else if (strcmp(argv[i], "--byoyomi") == 0) control.byoyomi = atol(argv[i + 1]);
+            else if (strcmp(argv[i], "--inc") == 0) control.increment = atol(argv[i + 1]);
+            else if (strcmp(argv[i], "--movestogo") == 0) control.moves_to_go = atoi(argv[i + 1]);
+        }
+        status = run_think(argv[2], &control);
+    } else if (strcmp(argv[1], "book") == 0 && argc >= 4 && strcmp(argv[2], "build") == 0) {
+        status = run_book_build(argc - 3, argv + 3);
+    } else if (strcmp(argv[1], "book") == 0 && argc >= 4 && strcmp(argv[2], "probe") == 0) {
+        status = run_book_probe(argv[3], argc >= 5 ? argv[4] : NULL);
+    } else {
+        print_usage();
+        status = 1;
+    }
+
+    shogi_trace_stop();
+    shogi_counters_dump_stop();
+    shogi_logger_close();
+    return status;
+}
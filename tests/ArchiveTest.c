@@ -0,0 +1,142 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+// Writes random legal games into an archive, reads them back and compares moves and metadata with the written ones.
+// Games read back are written into a second archive, which must be byte identical to the first one.
+
+#include <string.h>
+#include "Test.h"
+#include "../src/Archive.h"
+
+#define GAME_COUNT      (3 * SHOGI_ARCHIVE_BLOCK_GAMES + 17) // last block is partially filled
+#define GAME_SEED       0x5EED5EEDu
+#define GAME_MAX_PLIES  400
+
+typedef struct _shogi_test_game {
+    ShogiArchiveGame info;
+    ShogiMove moves[SHOGI_ARCHIVE_MAX_MOVES];
+    int length;
+} ShogiTestGame;
+
+/// plays random legal moves from the initial position until the game ends or length is reached
+static int random_game(GRand *random, ShogiMove *moves, int length) {
+    ShogiPosition pos;
+    shogi_position_init(&pos);
+    for (int ply = 0; ply < length; ++ply) {
+        ShogiMove generated[SHOGI_POSITION_MAX_MOVES], legal[SHOGI_POSITION_MAX_MOVES];
+        int count = shogi_position_generate_all(&pos, generated), legal_count = 0;
+        for (int i = 0; i < count; ++i) {
+            if (SHOGI_MOVE_IS_KING_CAPTURE(generated[i]))
+                continue;
+            shogi_position_do_move(&pos, generated[i]);
+            if (!shogi_position_in_check(&pos, !pos.black_turn))
+                legal[legal_count++] = generated[i];
+            shogi_position_undo_move(&pos, generated[i]);
+        }
+        if (legal_count == 0)
+            return ply;
+        moves[ply] = legal[g_rand_int_range(random, 0, legal_count)];
+        shogi_position_do_move(&pos, moves[ply]);
+    }
+    return length;
+}
+
+static void games_init(ShogiTestGame *games) {
+    GRand *random = g_rand_new_with_seed(GAME_SEED);
+    for (int i = 0; i < GAME_COUNT; ++i) {
+        ShogiTestGame *game = &games[i];
+        memset(&game->info, 0, sizeof(game->info));
+        g_snprintf(game->info.black, SHOGI_ARCHIVE_NAME_LENGTH, "black %d", i);
+        g_snprintf(game->info.white, SHOGI_ARCHIVE_NAME_LENGTH, "white player with a name longer than the limit %d",
+                   i);
+        game->info.date = 20260101 + i % 28;
+        game->info.result = (guint8) (i % 4);
+        // every block gets a game without moves
+        int length = i % SHOGI_ARCHIVE_BLOCK_GAMES == 7 ? 0 : g_rand_int_range(random, 1, GAME_MAX_PLIES);
+        game->length = random_game(random, game->moves, length);
+    }
+    g_rand_free(random);
+}
+
+/// writes games into an archive
+static gboolean write_archive(const char *path, const ShogiTestGame *games) {
+    ShogiArchiveWriter *writer = shogi_archive_writer_new(path);
+    if (writer == NULL)
+        return FALSE;
+    gboolean written = TRUE;
+    for (int i = 0; i < GAME_COUNT && written; ++i)
+        written = shogi_archive_writer_add(writer, &games[i].info, games[i].moves, games[i].length);
+    return shogi_archive_writer_finish(writer, NULL) && written;
+}
+
+/// reads all games of the archive in the order they were written and checks them against the written games
+static void check_games(const ShogiArchive *archive, const ShogiTestGame *games, ShogiTestGame *read_back) {
+    SHOGI_TEST_CHECK(shogi_archive_game_count(archive) == GAME_COUNT, "%u games read, %d written",
+                     shogi_archive_game_count(archive), GAME_COUNT);
+    if (shogi_archive_game_count(archive) != GAME_COUNT)
+        return;
+
+    ShogiArchiveReader *reader = shogi_archive_reader_new(archive);
+    for (guint32 i = 0; i < GAME_COUNT; ++i) {
+        const ShogiArchiveGame *info = shogi_archive_game(archive, i);
+        const ShogiTestGame *game = &games[i];
+        read_back[i].info = *info;
+        read_back[i].length = shogi_archive_read_game(reader, i, read_back[i].moves, NULL);
+
+        SHOGI_TEST_CHECK(strcmp(info->black, game->info.black) == 0, "game %u: black is %s", i, info->black);
+        SHOGI_TEST_CHECK(strncmp(info->white, game->info.white, SHOGI_ARCHIVE_NAME_LENGTH - 1) == 0 &&
+                         strlen(info->white) == SHOGI_ARCHIVE_NAME_LENGTH - 1, "game %u: white is %s", i, info->white);
+        SHOGI_TEST_CHECK(info->date == game->info.date && info->result == game->info.result,
+                         "game %u: date %u and result %u", i, info->date, info->result);
+        SHOGI_TEST_CHECK(info->length == game->length && read_back[i].length == game->length,
+                         "game %u: %d moves read, %d written", i, read_back[i].length, game->length);
+        if (read_back[i].length == game->length)
+            SHOGI_TEST_CHECK(memcmp(read_back[i].moves, game->moves, game->length * sizeof(ShogiMove)) == 0,
+                             "game %u: moves differ", i);
+    }
+    shogi_archive_reader_free(reader);
+}
+
+/// compares two files byte by byte
+static gboolean same_files(const char *path_a, const char *path_b) {
+    char *a = NULL, *b = NULL;
+    gsize size_a = 0, size_b = 0;
+    gboolean same = g_file_get_contents(path_a, &a, &size_a, NULL) && g_file_get_contents(path_b, &b, &size_b, NULL) &&
+                    size_a == size_b && memcmp(a, b, size_a) == 0;
+    g_free(a);
+    g_free(b);
+    return same;
+}
+
+int main() {
+    char *directory = shogi_test_enter_directory("shogi-test-archive-XXXXXX");
+    if (directory == NULL)
+        return 1;
+
+    ShogiTestGame *games = g_new(ShogiTestGame, GAME_COUNT), *read_back = g_new(ShogiTestGame, GAME_COUNT);
+    games_init(games);
+
+    ShogiMove too_long[SHOGI_ARCHIVE_MAX_MOVES + 1] = {0};
+    ShogiArchiveWriter *writer = shogi_archive_writer_new("rejected.archive");
+    SHOGI_TEST_CHECK(!shogi_archive_writer_add(writer, &games[0].info, too_long, SHOGI_ARCHIVE_MAX_MOVES + 1),
+                     "game longer than %d moves was added", SHOGI_ARCHIVE_MAX_MOVES);
+    shogi_archive_writer_finish(writer, NULL);
+
+    SHOGI_TEST_CHECK(write_archive("games.archive", games), "cannot write games.archive");
+    ShogiArchive *archive = shogi_archive_open("games.archive");
+    SHOGI_TEST_CHECK(archive != NULL, "cannot open games.archive");
+    if (archive) {
+        check_games(archive, games, read_back);
+        shogi_archive_close(archive);
+
+        // games read back carry the same metadata and moves, so they must be written into the same bytes
+        SHOGI_TEST_CHECK(write_archive("rewritten.archive", read_back), "cannot write rewritten.archive");
+        SHOGI_TEST_CHECK(same_files("games.archive", "rewritten.archive"), "rewritten archive differs");
+    }
+    printf("%d games written and read back\n", GAME_COUNT);
+
+    g_free(games);
+    g_free(read_back);
+    return shogi_test_finish(directory);
+}
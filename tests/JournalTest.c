@@ -0,0 +1,147 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+// Plays a few moves, closes the model and damages the journal the way a crash or a bad disk would: a record torn in
+// the middle, a record with wrong CRC at the end and a corrupted record inside. Each time the model is started again
+// and must resume the game after the last intact move, keeping the intact records instead of journaling them again.
+
+#include <string.h>
+#include <stdlib.h>
+#include "Test.h"
+#include "../src/Model.h"
+#include "../src/Journal.h"
+
+#define MOVE_COUNT 6
+
+/// moves played from the initial position as clicks: column and row of the pawn, then of it's destination
+static const int moves[MOVE_COUNT][4] = {
+        {7, 7, 7, 6}, // P-7f
+        {3, 3, 3, 4}, // P-3d
+        {2, 7, 2, 6}, // P-2f
+        {8, 3, 8, 4}, // P-8d
+        {2, 6, 2, 5}, // P-2e
+        {8, 4, 8, 5}, // P-8e
+};
+
+static char *states[MOVE_COUNT + 1]; // serialized state after given number of moves
+
+/// plays all moves in a new game and remembers the states, the journal is left as after a crash
+static void play_game() {
+    ShogiModel *model = shogi_model_init(); // journal is empty, so a new game starts
+    states[0] = shogi_model_serialize_state();
+    for (int i = 0; i < MOVE_COUNT; ++i) {
+        shogi_model_click(moves[i][0], moves[i][1]);
+        shogi_model_click(moves[i][2], moves[i][3]);
+        SHOGI_TEST_CHECK(model->history_entries == i + 1, "move %d wasn't played", i + 1);
+        states[i + 1] = shogi_model_serialize_state();
+    }
+    shogi_model_close();
+}
+
+/// starts the model and checks that it resumed the game after given number of moves
+static void check_resumed(const char *damage, int expected) {
+    ShogiModel *model = shogi_model_init();
+    SHOGI_TEST_CHECK(model->history_entries == expected, "%s: resumed after %d moves, expected %d", damage,
+                     model->history_entries, expected);
+    char *state = shogi_model_serialize_state();
+    SHOGI_TEST_CHECK(strcmp(state, states[expected]) == 0, "%s: board differs from the one after %d moves", damage,
+                     expected);
+    free(state);
+    SHOGI_TEST_CHECK(shogi_model_is_black_turn() == (expected % 2 == 0), "%s: wrong player to move", damage);
+    shogi_model_close();
+}
+
+/// offset of the record of given move in the journal, -1 if there's none
+static gssize record_offset(int ply) {
+    GArray *records = shogi_journal_read(SHOGI_JOURNAL_PATH);
+    gssize offset = -1;
+    for (guint i = 0; i < records->len && offset < 0; ++i) {
+        const ShogiJournalRecord *record = &g_array_index(records, ShogiJournalRecord, i);
+        if (record->type == SHOGI_JOURNAL_RECORD_MOVE && record->ply == ply)
+            offset = (gssize) (i * sizeof(ShogiJournalRecord)); // journal starts with the game start record
+    }
+    g_array_free(records, TRUE);
+    return offset;
+}
+
+/// cuts the journal to length bytes
+static void truncate_journal(gsize length) {
+    char *data;
+    gsize size;
+    if (!g_file_get_contents(SHOGI_JOURNAL_PATH, &data, &size, NULL)) {
+        SHOGI_TEST_CHECK(FALSE, "cannot read %s", SHOGI_JOURNAL_PATH);
+        return;
+    }
+    SHOGI_TEST_CHECK(g_file_set_contents(SHOGI_JOURNAL_PATH, data, (gssize) MIN(length, size), NULL),
+                     "cannot write %s", SHOGI_JOURNAL_PATH);
+    g_free(data);
+}
+
+/// flips bits of one byte of the journal
+static void corrupt_journal(gsize offset) {
+    char *data;
+    gsize size;
+    if (!g_file_get_contents(SHOGI_JOURNAL_PATH, &data, &size, NULL) || offset >= size) {
+        SHOGI_TEST_CHECK(FALSE, "cannot read byte %lu of %s", (unsigned long) offset, SHOGI_JOURNAL_PATH);
+        g_free(data);
+        return;
+    }
+    data[offset] ^= 0x5A;
+    SHOGI_TEST_CHECK(g_file_set_contents(SHOGI_JOURNAL_PATH, data, (gssize) size, NULL), "cannot write %s",
+                     SHOGI_JOURNAL_PATH);
+    g_free(data);
+}
+
+static gsize journal_size() {
+    GStatBuf stat;
+    return g_stat(SHOGI_JOURNAL_PATH, &stat) == 0 ? (gsize) stat.st_size : 0;
+}
+
+/// inode of the journal, a new journal is renamed over the old one so it gets a new inode
+static guint64 journal_inode() {
+    GStatBuf stat;
+    return g_stat(SHOGI_JOURNAL_PATH, &stat) == 0 ? (guint64) stat.st_ino : 0;
+}
+
+int main() {
+    char *directory = shogi_test_enter_directory("shogi-test-journal-XXXXXX");
+    if (directory == NULL)
+        return 1;
+    g_setenv(SHOGI_JOURNAL_ENV, "0", TRUE); // every record is committed right away
+
+    play_game();
+    gsize played = journal_size();
+    guint64 inode = journal_inode();
+    check_resumed("intact journal", MOVE_COUNT);
+    SHOGI_TEST_CHECK(journal_inode() == inode && journal_size() == played, "journal of resumed game was rewritten");
+
+    // damaged records are cut off when a game is resumed, so each check damages what the previous one left
+    truncate_journal(journal_size() - sizeof(ShogiJournalRecord) / 2);
+    check_resumed("torn last record", MOVE_COUNT - 1);
+
+    corrupt_journal(journal_size() - sizeof(ShogiJournalRecord)); // first byte of CRC of the last record
+    check_resumed("wrong CRC of last record", MOVE_COUNT - 2);
+
+    gssize offset = record_offset(1);
+    SHOGI_TEST_CHECK(offset >= 0, "record of the second move is missing");
+    if (offset >= 0) {
+        corrupt_journal((gsize) offset + offsetof(ShogiJournalRecord, data)); // records after it are dropped
+        check_resumed("corrupted second move", 1);
+
+        // the second move played again is appended to the records left by the recovery
+        shogi_model_init();
+        shogi_model_click(moves[1][0], moves[1][1]);
+        shogi_model_click(moves[1][2], moves[1][3]);
+        shogi_model_close();
+        check_resumed("move after recovery", 2);
+    }
+
+    truncate_journal(0);
+    check_resumed("empty journal", 0);
+
+    printf("journal replayed after a torn record, wrong CRC and corrupted record\n");
+    for (int i = 0; i <= MOVE_COUNT; ++i)
+        free(states[i]);
+    return shogi_test_finish(directory);
+}
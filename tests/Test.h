@@ -0,0 +1,68 @@
+//
+// Created by Tooster on 19.10.2026.
+//
+
+#ifndef SHOGI_TEST_H
+#define SHOGI_TEST_H
+
+#include <stdio.h>
+#include <unistd.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include "../src/Logger.h"
+
+// Helpers shared by the tests run with ctest. Every test is a program returning non zero if any check failed.
+// Tests run in a temporary directory, since the model and the logger write their files to working directory.
+
+static int shogi_test_failures = 0;
+
+/// reports failed check and continues, so one run shows all failures
+#define SHOGI_TEST_CHECK(condition, ...) do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: check failed: %s: ", __FILE__, __LINE__, #condition); \
+            fprintf(stderr, __VA_ARGS__); \
+            fprintf(stderr, "\n"); \
+            shogi_test_failures++; \
+        } \
+    } while (0)
+
+/**
+ * Creates temporary directory and makes it working directory of the test
+ * @param name_template name of the directory ending with XXXXXX, as in g_dir_make_tmp()
+ * @return path of the directory, NULL if it can't be created
+ */
+static char *shogi_test_enter_directory(const char *name_template) {
+    char *directory = g_dir_make_tmp(name_template, NULL);
+    if (directory == NULL || chdir(directory) != 0) {
+        fprintf(stderr, "Cannot create temporary directory\n");
+        g_free(directory);
+        return NULL;
+    }
+    return directory;
+}
+
+/**
+ * Closes the logger, removes the temporary directory with files left in it and frees it's path
+ * @param directory path returned by shogi_test_enter_directory()
+ * @return exit status of the test, 1 if any check failed
+ */
+static int shogi_test_finish(char *directory) {
+    shogi_logger_close();
+    GDir *dir = g_dir_open(directory, 0, NULL);
+    if (dir) {
+        const char *name;
+        while ((name = g_dir_read_name(dir))) {
+            char *file = g_build_filename(directory, name, NULL);
+            g_remove(file);
+            g_free(file);
+        }
+        g_dir_close(dir);
+    }
+    g_rmdir(directory);
+    g_free(directory);
+    if (shogi_test_failures > 0)
+        fprintf(stderr, "%d checks failed\n", shogi_test_failures);
+    return shogi_test_failures > 0 ? 1 : 0;
+}
+
+#endif //SHOGI_TEST_H